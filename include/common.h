@@ -25,9 +25,18 @@ namespace TakeAwayPlatform
     struct DBConfig {
         std::string host;
         int port;
+        int classicPort = 3306;            // 经典协议端口，mysql_classic 后端使用
         std::string user;
         std::string password;
         std::string database;
+        std::string backend = "mysql";     // 存储后端：mysql（X 协议）、mysql_classic（经典协议）、
+                                           // sqlite（单机嵌入式）或 memory（进程内存储，用于压测）
+        std::string schemaFile;            // memory、sqlite 后端首次打开时执行的建表脚本
+        std::string sqliteFile;            // sqlite 后端的数据库文件
+        std::string migrationsDir;         // memory、sqlite 后端在建表脚本之后执行的迁移目录，为空时用默认目录
     };
 
+    // 从 entry 读取连接参数，未配置的字段沿用 defaults（如从库、分片沿用全局主库）
+    DBConfig load_db_config(const Json::Value& entry, const Json::Value& defaults);
+
 }
\ No newline at end of file
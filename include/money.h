@@ -0,0 +1,137 @@
+/*
+ * Copyright (C), 2025-2030, 华中师范大学计算机学院
+ * FileName: money.h
+ * Author: sz
+ * Date: 2025-7-24
+ * Description: 以分为单位的定点金额类型
+ * History:
+ * <author>   <time>      <version>    <desc>
+ * sz        2025-7-24   1.0          初始文件
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+
+namespace TakeAwayPlatform
+{
+    // 金额，内部以 int64 分存储，对应数据库中的 DECIMAL(10,2) 列。
+    // 加减比较都是整数运算，只在与 JSON 交互时换算为元
+    class Money
+    {
+    public:
+        // DECIMAL(10,2) 能表示的最大金额（99999999.99 元）；外部输入超过它时拒绝，也保证解析时不会溢出
+        static constexpr int64_t MAX_CENTS = 9999999999;
+
+        constexpr Money() = default;
+
+        static constexpr Money fromCents(int64_t cents) { return Money(cents); }
+
+        // 按元换算，四舍五入到分
+        static Money fromYuan(double yuan) { return Money(std::llround(yuan * 100)); }
+
+        // 外部输入（JSON 数值）：非有限值或绝对值超过 MAX_CENTS 时返回 false
+        static bool fromYuan(double yuan, Money& out) {
+            if (!std::isfinite(yuan) || std::fabs(yuan) * 100 > static_cast<double>(MAX_CENTS)) {
+                return false;
+            }
+            out = fromYuan(yuan);
+            return true;
+        }
+
+        // 解析 "-12.3"、"45"、"0.05" 形式的十进制文本，超过两位的小数四舍五入。
+        // 绝对值超过 MAX_CENTS 时返回 false；每读一位都检查，累加值不超过 MAX_CENTS * 10 + 9，不会溢出
+        static bool parse(const std::string& text, Money& out) {
+            size_t pos = 0;
+            bool negative = false;
+            if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) {
+                negative = text[pos] == '-';
+                ++pos;
+            }
+
+            int64_t cents = 0;
+            int fraction = -1;     // 已读取的小数位数，-1 表示尚未遇到小数点
+            bool digits = false;
+            bool roundUp = false;
+            for (; pos < text.size(); ++pos) {
+                char c = text[pos];
+                if (c == '.' && fraction < 0) {
+                    fraction = 0;
+                    continue;
+                }
+                if (c < '0' || c > '9') {
+                    return false;
+                }
+
+                digits = true;
+                if (fraction < 0) {
+                    cents = cents * 10 + (c - '0');
+                } else if (fraction < 2) {
+                    cents = cents * 10 + (c - '0');
+                    ++fraction;
+                } else if (fraction == 2) {
+                    roundUp = c >= '5';
+                    ++fraction;
+                }
+                if (cents > MAX_CENTS) {
+                    return false;
+                }
+            }
+
+            if (!digits) {
+                return false;
+            }
+
+            for (int scale = fraction < 0 ? 0 : std::min(fraction, 2); scale < 2; ++scale) {
+                cents *= 10;
+            }
+            if (roundUp) {
+                ++cents;
+            }
+            if (cents > MAX_CENTS) {
+                return false;
+            }
+
+            out = Money(negative ? -cents : cents);
+            return true;
+        }
+
+        constexpr int64_t cents() const { return m_cents; }
+
+        double toYuan() const { return static_cast<double>(m_cents) / 100; }
+
+        // 输出 "123.45"，作为 DECIMAL 参数绑定时不经过浮点
+        std::string toString() const {
+            int64_t magnitude = std::llabs(m_cents);
+            std::string fraction = std::to_string(magnitude % 100);
+            if (fraction.size() < 2) {
+                fraction.insert(0, "0");
+            }
+            return (m_cents < 0 ? "-" : "") + std::to_string(magnitude / 100) + "." + fraction;
+        }
+
+        constexpr bool isPositive() const { return m_cents > 0; }
+
+        Money& operator+=(Money other) { m_cents += other.m_cents; return *this; }
+        Money& operator-=(Money other) { m_cents -= other.m_cents; return *this; }
+
+        friend constexpr Money operator+(Money a, Money b) { return Money(a.m_cents + b.m_cents); }
+        friend constexpr Money operator-(Money a, Money b) { return Money(a.m_cents - b.m_cents); }
+        friend constexpr bool operator==(Money a, Money b) { return a.m_cents == b.m_cents; }
+        friend constexpr bool operator!=(Money a, Money b) { return a.m_cents != b.m_cents; }
+        friend constexpr bool operator<(Money a, Money b) { return a.m_cents < b.m_cents; }
+        friend constexpr bool operator<=(Money a, Money b) { return a.m_cents <= b.m_cents; }
+        friend constexpr bool operator>(Money a, Money b) { return a.m_cents > b.m_cents; }
+        friend constexpr bool operator>=(Money a, Money b) { return a.m_cents >= b.m_cents; }
+
+    private:
+        explicit constexpr Money(int64_t cents) : m_cents(cents) {}
+
+        int64_t m_cents = 0;
+    };
+
+}
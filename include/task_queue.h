@@ -14,32 +14,65 @@ namespace TakeAwayPlatform
     public:
         using Task = std::function<void()>;
 
-        void push(Task task) {
+        // 关闭后拒绝新任务，返回 false
+        bool push(Task task) {
             {
                 std::lock_guard<std::mutex> lock(mtx);
+                if (closed) {
+                    return false;
+                }
                 tasks.push(std::move(task));
             }
             condition.notify_one();
+            return true;
         }
 
+        // 阻塞直到取到任务；队列关闭且已取空时返回空任务
         Task pop() {
             std::unique_lock<std::mutex> lock(mtx);
-            condition.wait(lock, [this] { return !tasks.empty(); });
+            condition.wait(lock, [this] { return !tasks.empty() || closed; });
             
+            if (tasks.empty()) {
+                return Task();
+            }
+
             Task task = std::move(tasks.front());
             tasks.pop();
             return task;
         }
 
+        // 关闭队列并唤醒所有等待的消费者，已入队的任务仍可被取出
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                closed = true;
+            }
+            condition.notify_all();
+        }
+
+        // 丢弃尚未开始的任务，返回丢弃数量
+        size_t clear() {
+            std::lock_guard<std::mutex> lock(mtx);
+            size_t dropped = tasks.size();
+            std::queue<Task>().swap(tasks);
+            return dropped;
+        }
+
         bool empty() const {
             std::lock_guard<std::mutex> lock(mtx);
             return tasks.empty();
         }
 
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(mtx);
+            return tasks.size();
+        }
+
     private:
         std::queue<Task> tasks;
+        bool closed = false;
         mutable std::mutex mtx;
         std::condition_variable condition;
     };
 
-} 
\ No newline at end of file
+} 
@@ -3,6 +3,8 @@
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include "task_queue.h"
 
 
@@ -12,43 +14,146 @@ namespace TakeAwayPlatform
     class ThreadPool 
     {
     public:
-        explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency()) 
-            : running(true) {
+        explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency())
+            : state(std::make_shared<State>()) {
+            state->exited.assign(thread_count, false);
             workers.reserve(thread_count);
             for (size_t index = 0; index < thread_count; ++index) {
-                workers.emplace_back([this] { worker_thread(); });
+                workers.emplace_back([state = state, index] { worker_thread(*state, index); });
             }
         }
 
         ~ThreadPool() {
-            running = false;
-            condition.notify_all();
+            shutdown();
+        }
+
+        // 关闭后（shutdown/drain）提交的任务被拒绝，返回 false
+        template<typename F>
+        bool enqueue(F&& task) {
+            {
+                std::lock_guard<std::mutex> lock(state->idleMtx);
+                ++state->outstandingTasks;
+            }
+
+            if (!state->taskQueue.push(std::forward<F>(task))) {
+                finish_tasks(*state, 1);
+                return false;
+            }
+            return true;
+        }
+
+        // 停止接收新任务，在 deadline 前执行完已排队和正在执行的任务。
+        // 超时则丢弃仍在排队的任务；再过 WORKER_EXIT_GRACE 仍在执行任务的工作线程被分离（见 abandoned()），
+        // 不会因为一个卡住的任务无限期阻塞关闭。返回是否全部完成
+        bool drain(std::chrono::steady_clock::time_point deadline) {
+            state->taskQueue.close();
+
+            bool drained;
+            {
+                std::unique_lock<std::mutex> lock(state->idleMtx);
+                drained = state->idleCv.wait_until(lock, deadline, [this] {
+                    return state->outstandingTasks == 0;
+                });
+            }
+
+            if (drained) {
+                shutdown();
+                return true;
+            }
+
+            size_t cleared = state->taskQueue.clear();
+            droppedTasks += cleared;
+            finish_tasks(*state, cleared);
+
+            // 空闲的工作线程在队列关闭后很快退出，只有仍在执行任务的线程会等满宽限期
+            {
+                std::unique_lock<std::mutex> lock(state->idleMtx);
+                state->idleCv.wait_for(lock, WORKER_EXIT_GRACE, [this] {
+                    return state->exitedCount == workers.size();
+                });
+            }
+
+            std::vector<bool> exited;
+            {
+                std::lock_guard<std::mutex> lock(state->idleMtx);
+                exited = state->exited;
+            }
+            for (size_t index = 0; index < workers.size(); ++index) {
+                if (!workers[index].joinable()) {
+                    continue;
+                }
+                if (exited[index]) {
+                    workers[index].join();
+                } else {
+                    // 最后手段：分离的线程只持有共享状态，任务结束后自行退出
+                    workers[index].detach();
+                    ++abandonedWorkers;
+                }
+            }
+            return false;
+        }
+
+        // 关闭队列并等待工作线程退出（会先执行完已排队的任务）
+        void shutdown() {
+            state->taskQueue.close();
             for (auto& worker : workers) {
                 if (worker.joinable()) worker.join();
             }
         }
 
-        template<typename F>
-        void enqueue(F&& task) {
-            taskQueue.push(std::forward<F>(task));
-            condition.notify_one();
+        size_t pending() const {
+            return state->taskQueue.size();
+        }
+
+        size_t dropped() const {
+            return droppedTasks;
+        }
+
+        // drain 超时后被分离的工作线程数（其任务在关闭时仍未结束）
+        size_t abandoned() const {
+            return abandonedWorkers;
         }
 
     private:
-        void worker_thread() {
-            while (running) {
-                auto task = taskQueue.pop();
-                if (task) task();
+        // 工作线程共享的状态；被分离的线程可能在线程池析构后才结束，因此由 shared_ptr 持有
+        struct State {
+            TaskQueue taskQueue;
+            std::mutex idleMtx;
+            std::condition_variable idleCv;
+            size_t outstandingTasks = 0;    // 已入队但尚未执行完的任务数
+            std::vector<bool> exited;       // 各工作线程是否已退出
+            size_t exitedCount = 0;
+        };
+
+        static constexpr std::chrono::milliseconds WORKER_EXIT_GRACE {200};
+
+        static void worker_thread(State& state, size_t index) {
+            while (auto task = state.taskQueue.pop()) {
+                task();
+                finish_tasks(state, 1);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(state.idleMtx);
+                state.exited[index] = true;
+                ++state.exitedCount;
             }
+            state.idleCv.notify_all();
+        }
+
+        static void finish_tasks(State& state, size_t count) {
+            {
+                std::lock_guard<std::mutex> lock(state.idleMtx);
+                state.outstandingTasks -= count;
+            }
+            state.idleCv.notify_all();
         }
 
 private:
+        std::shared_ptr<State> state;
         std::vector<std::thread> workers;
-        TaskQueue taskQueue;
-        std::atomic<bool> running;
-        std::condition_variable condition;
-        std::mutex mtx;
+        std::atomic<size_t> droppedTasks {0};
+        std::atomic<size_t> abandonedWorkers {0};
     };
 
 }
-
@@ -0,0 +1,17 @@
+-- 热点查询路径索引
+-- 迁移工具执行前检查表结构，已存在同名索引的库上跳过
+
+-- 订单历史：WHERE user_id = ? ORDER BY created_at DESC, order_id DESC
+CREATE INDEX idx_orders_user_created ON orders (user_id, created_at, order_id);
+
+-- 充值历史：WHERE user_id = ? ORDER BY created_at DESC, recharge_id DESC
+CREATE INDEX idx_recharge_user_created ON recharge_record (user_id, created_at, recharge_id);
+
+-- 商家菜单：WHERE merchant_id = ? AND status = ?
+CREATE INDEX idx_dishes_merchant_status ON dishes (merchant_id, status);
+
+-- 用户登录日志：WHERE user_id = ? ORDER BY created_at
+CREATE INDEX idx_log_records_user_created ON log_records (user_id, created_at);
+
+-- 登录、注册查重：WHERE user_name = ?
+CREATE INDEX idx_applicant_user_name ON applicant (user_name);
@@ -0,0 +1,8 @@
+-- 乐观并发控制的版本号：余额、库存的读改写以 version 为条件更新，冲突时重读重试
+-- 迁移工具执行前检查表结构，已存在同名列的库上跳过
+
+-- 充值：SELECT balance, version ... / UPDATE ... WHERE user_id = ? AND version = ?
+ALTER TABLE wallet ADD COLUMN version BIGINT NOT NULL DEFAULT 0;
+
+-- 非热点菜品的库存扣减：UPDATE ... WHERE dish_id = ? AND version = ?
+ALTER TABLE dishes ADD COLUMN version BIGINT NOT NULL DEFAULT 0;
@@ -0,0 +1,14 @@
+-- 注册和充值插入钱包、充值记录时不指定主键，由数据库自增分配；充值不对应订单交易，transaction_id 可为空
+-- MODIFY 可重复执行，已是目标定义的库上再次执行不改变表结构
+
+-- wallet_id、transaction_id 被其他表的外键引用，修改列定义期间关闭外键检查（只影响迁移所用的连接）
+SET FOREIGN_KEY_CHECKS = 0;
+
+-- 注册：INSERT INTO wallet (user_id, balance, ...) 不带 wallet_id
+ALTER TABLE wallet MODIFY COLUMN wallet_id INT NOT NULL AUTO_INCREMENT;
+
+-- 充值：INSERT INTO recharge_record (user_id, amount, status, ...) 不带 recharge_id 和 transaction_id
+ALTER TABLE recharge_record MODIFY COLUMN recharge_id INT NOT NULL AUTO_INCREMENT,
+    MODIFY COLUMN transaction_id INT NULL;
+
+SET FOREIGN_KEY_CHECKS = 1;
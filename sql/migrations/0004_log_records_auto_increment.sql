@@ -0,0 +1,4 @@
+-- 登录日志后写：LogAppender 的多行 INSERT 不带 log_id，由数据库自增分配
+-- 日志行数增长快，主键同时改为 BIGINT；MODIFY 可重复执行
+
+ALTER TABLE log_records MODIFY COLUMN log_id BIGINT NOT NULL AUTO_INCREMENT;
@@ -0,0 +1,8 @@
+-- 下单：INSERT INTO orders (order_number, user_id, ...) 不带 order_id，由数据库自增分配
+-- order_id 被 reviews、transactions 的外键引用，修改列定义期间关闭外键检查（只影响迁移所用的连接）
+
+SET FOREIGN_KEY_CHECKS = 0;
+
+ALTER TABLE orders MODIFY COLUMN order_id INT NOT NULL AUTO_INCREMENT;
+
+SET FOREIGN_KEY_CHECKS = 1;
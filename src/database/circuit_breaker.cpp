@@ -0,0 +1,116 @@
+#include <iostream>
+#include <algorithm>
+
+#include "circuit_breaker.h"
+
+
+namespace TakeAwayPlatform
+{
+    CircuitBreaker::CircuitBreaker(const CircuitBreakerOptions& options)
+        : options(options)
+    {
+        this->options.failureThreshold = std::max(this->options.failureThreshold, 1);
+        this->options.baseBackoffMs = std::max(this->options.baseBackoffMs, 1);
+        this->options.maxBackoffMs = std::max(this->options.maxBackoffMs, this->options.baseBackoffMs);
+    }
+
+    bool CircuitBreaker::allow(bool& probe)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        probe = false;
+        const auto now = std::chrono::steady_clock::now();
+        switch (state) {
+            case State::CLOSED:
+                return true;
+
+            case State::OPEN:
+            case State::HALF_OPEN:
+            default:
+                // 退避到期：放行这一次作为探测，其余请求在探测结束前继续被拒绝；
+                // 探测迟迟没有结果（maxBackoffMs 内未上报）时再放行一次
+                if (now >= retryAt) {
+                    state = State::HALF_OPEN;
+                    retryAt = now + std::chrono::milliseconds(options.maxBackoffMs);
+                    probe = true;
+                    return true;
+                }
+                ++rejected;
+                return false;
+        }
+    }
+
+    void CircuitBreaker::release_probe()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (state == State::HALF_OPEN) {
+            state = State::OPEN;
+            retryAt = std::chrono::steady_clock::now();
+        }
+    }
+
+    void CircuitBreaker::on_success()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (state != State::CLOSED) {
+            std::cout << "Database circuit breaker closed after " << consecutiveTrips << " trips" << std::endl;
+        }
+        state = State::CLOSED;
+        failures = 0;
+        consecutiveTrips = 0;
+    }
+
+    void CircuitBreaker::on_failure()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        ++failures;
+        if (state == State::HALF_OPEN || (state == State::CLOSED && failures >= options.failureThreshold)) {
+            ++trips;
+            ++consecutiveTrips;
+            auto backoff = next_backoff();
+            retryAt = std::chrono::steady_clock::now() + backoff;
+
+            if (state == State::CLOSED) {
+                std::cerr << "Database circuit breaker opened, retry in " << backoff.count() << "ms" << std::endl;
+            }
+            state = State::OPEN;
+        }
+    }
+
+    bool CircuitBreaker::is_open() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return state != State::CLOSED;
+    }
+
+    Json::Value CircuitBreaker::stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        Json::Value result;
+        result["state"] = state == State::CLOSED ? "closed" : state == State::OPEN ? "open" : "half_open";
+        result["consecutive_failures"] = failures;
+        result["trips"] = static_cast<Json::UInt64>(trips);
+        result["rejected"] = static_cast<Json::UInt64>(rejected);
+        if (state == State::OPEN) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                retryAt - std::chrono::steady_clock::now()).count();
+            result["retry_in_ms"] = static_cast<Json::Int64>(std::max<int64_t>(remaining, 0));
+        }
+        return result;
+    }
+
+    std::chrono::milliseconds CircuitBreaker::next_backoff()
+    {
+        const int shift = std::min(consecutiveTrips - 1, 20);
+        const int64_t ceiling = std::min<int64_t>(static_cast<int64_t>(options.baseBackoffMs) << shift,
+                                                  options.maxBackoffMs);
+
+        std::uniform_int_distribution<int64_t> jitter(ceiling / 2, ceiling);
+        return std::chrono::milliseconds(jitter(random));
+    }
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <random>
+
+#include "common.h"
+
+namespace TakeAwayPlatform
+{
+    // 熔断参数（config.json 中 database 节的 breaker_* 项）
+    struct CircuitBreakerOptions {
+        int failureThreshold = 3;       // 连续建连失败该次数后熔断
+        int baseBackoffMs = 200;        // 首次熔断的退避时长
+        int maxBackoffMs = 10000;       // 退避上限
+    };
+
+    // 连接池前的熔断器：数据库不可用时直接拒绝借用，不再让每个请求各自尝试建连。
+    // 熔断后按指数退避（带随机抖动，避免多个进程同时重连）到期时只放行一次探测，
+    // 探测成功即恢复，失败则退避时长加倍
+    class CircuitBreaker
+    {
+    public:
+        explicit CircuitBreaker(const CircuitBreakerOptions& options);
+
+        // 本次是否可以尝试连接数据库；熔断期间返回 false。
+        // 退避到期放行的那一次为探测（probe 置为 true），调用方必须以 on_success / on_failure 上报结果，
+        // 得不出结果时调用 release_probe
+        bool allow(bool& probe);
+
+        // 探测没有接触数据库就结束（连接池已关闭、等待连接超时）：回到熔断状态并允许立即再次探测
+        void release_probe();
+
+        // 建连或校验成功
+        void on_success();
+
+        // 建连或校验失败
+        void on_failure();
+
+        bool is_open() const;
+
+        Json::Value stats() const;
+
+    private:
+        enum class State { CLOSED, OPEN, HALF_OPEN };
+
+        // 本次熔断的退避时长：base * 2^(trips-1)，上限 maxBackoffMs，在 [1/2, 1] 倍之间抖动
+        std::chrono::milliseconds next_backoff();
+
+    private:
+        CircuitBreakerOptions options;
+
+        mutable std::mutex mutex;
+        State state = State::CLOSED;
+        int failures = 0;               // 连续失败次数
+        int consecutiveTrips = 0;       // 恢复前的连续熔断次数，决定退避时长
+        std::chrono::steady_clock::time_point retryAt;
+        std::mt19937 random {std::random_device{}()};
+
+        uint64_t trips = 0;
+        uint64_t rejected = 0;
+    };
+
+}
@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <thread>
+#include <functional>
+
+#include "db_bench.h"
+
+
+namespace TakeAwayPlatform
+{
+    namespace
+    {
+        bool is_select(const std::string& sql)
+        {
+            size_t index = 0;
+            while (index < sql.size() && std::isspace(static_cast<unsigned char>(sql[index]))) {
+                ++index;
+            }
+
+            static const char keyword[] = "SELECT";
+            for (size_t position = 0; position < sizeof(keyword) - 1; ++position, ++index) {
+                if (index >= sql.size() || std::toupper(static_cast<unsigned char>(sql[index])) != keyword[position]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // 已排序样本的分位数（最近秩）
+        int64_t percentile(const std::vector<int64_t>& sorted, double quantile)
+        {
+            if (sorted.empty()) {
+                return 0;
+            }
+            const size_t rank = static_cast<size_t>(std::ceil(quantile * sorted.size()));
+            return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+        }
+
+        struct WorkerStats {
+            std::vector<int64_t> latencies;     // 计时阶段每条语句的耗时（微秒）
+            uint64_t errors = 0;
+        };
+
+        // 每个连接一个线程循环执行 operation(db, worker, iteration)，统计计时阶段的吞吐和延迟分位数
+        void run_workers(std::vector<std::unique_ptr<DatabaseHandler>>& handlers, const DbBenchOptions& options,
+                         const std::function<bool(DatabaseHandler&, size_t, size_t)>& operation,
+                         DbBenchResult& result)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            const auto measureFrom = start + std::chrono::seconds(options.warmUpSec);
+            const auto deadline = measureFrom + std::chrono::seconds(options.durationSec);
+
+            std::vector<WorkerStats> stats(handlers.size());
+            std::vector<std::thread> workers;
+            for (size_t worker = 0; worker < handlers.size(); ++worker) {
+                workers.emplace_back([&, worker] {
+                    DatabaseHandler& db = *handlers[worker];
+                    WorkerStats& own = stats[worker];
+
+                    for (size_t iteration = 0; ; ++iteration) {
+                        const auto begin = std::chrono::steady_clock::now();
+                        if (begin >= deadline) {
+                            break;
+                        }
+                        const bool ok = operation(db, worker, iteration);
+                        const auto end = std::chrono::steady_clock::now();
+
+                        if (begin >= measureFrom) {
+                            own.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count());
+                            if (!ok) {
+                                ++own.errors;
+                            }
+                        }
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+
+            std::vector<int64_t> latencies;
+            for (auto& own : stats) {
+                latencies.insert(latencies.end(), own.latencies.begin(), own.latencies.end());
+                result.errors += own.errors;
+            }
+            std::sort(latencies.begin(), latencies.end());
+
+            result.ok = true;
+            result.statements = latencies.size();
+            result.throughput = options.durationSec > 0 ? static_cast<double>(latencies.size()) / options.durationSec : 0;
+            result.p50Us = percentile(latencies, 0.50);
+            result.p95Us = percentile(latencies, 0.95);
+            result.p99Us = percentile(latencies, 0.99);
+            result.maxUs = latencies.empty() ? 0 : latencies.back();
+        }
+
+        // 连接在计时开始前全部建立，建连耗时不计入结果；任一连接失败返回 false
+        bool open_handlers(const DBConfig& config, int threads, std::vector<std::unique_ptr<DatabaseHandler>>& handlers)
+        {
+            for (int index = 0; index < threads; ++index) {
+                handlers.push_back(std::make_unique<DatabaseHandler>(config));
+                if (!handlers.back()->is_connected()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        const char* const SQL_CREATE_CONTENTION =
+            "CREATE TABLE bench_contention ("
+            "id INT NOT NULL PRIMARY KEY, "
+            "balance DECIMAL(10,2) NOT NULL, "
+            "version BIGINT NOT NULL DEFAULT 0)";
+
+        const char* const SQL_DROP_CONTENTION = "DROP TABLE IF EXISTS bench_contention";
+
+        const char* const SQL_ADD_CONTENTION =
+            "UPDATE bench_contention SET balance = balance + 0.01, version = version + 1 WHERE id = ?";
+
+        const char* const SQL_SELECT_CONTENTION = "SELECT balance, version FROM bench_contention WHERE id = ?";
+
+        const char* const SQL_CAS_CONTENTION =
+            "UPDATE bench_contention SET balance = CAST(? AS DECIMAL(10,2)), version = version + 1 "
+            "WHERE id = ? AND version = ?";
+
+        const char* const SQL_CREATE_DECODE =
+            "CREATE TABLE bench_decode ("
+            "recharge_id INT NOT NULL PRIMARY KEY, "
+            "user_id BIGINT NOT NULL, "
+            "amount DECIMAL(10,2) NOT NULL, "
+            "transaction_id INT NOT NULL, "
+            "status VARCHAR(20) NOT NULL, "
+            "paid_at DATETIME NOT NULL, "
+            "created_at DATETIME NOT NULL)";
+
+        const char* const SQL_DROP_DECODE = "DROP TABLE IF EXISTS bench_decode";
+
+        const char* const SQL_SELECT_DECODE =
+            "SELECT recharge_id, user_id, amount, transaction_id, status, paid_at, created_at FROM bench_decode";
+
+        // 每条 INSERT 写入的行数
+        constexpr int DECODE_INSERT_BATCH = 500;
+
+        // 与 RechargeRecord 相同的列和解码方式
+        struct DecodeRow {
+            int recharge_id;
+            int64_t user_id;
+            Money amount;
+            int transaction_id;
+            std::string status;
+            DateTime paid_at;
+            DateTime created_at;
+
+            struct Columns {
+                int recharge_id, user_id, amount, transaction_id, status, paid_at, created_at;
+                explicit Columns(const ColumnIndex& index)
+                    : recharge_id(index["recharge_id"]), user_id(index["user_id"]), amount(index["amount"]),
+                      transaction_id(index["transaction_id"]), status(index["status"]),
+                      paid_at(index["paid_at"]), created_at(index["created_at"]) {
+                }
+            };
+
+            static DecodeRow fromRow(const mysqlx::Row& row, const Columns& columns)
+            {
+                DecodeRow decoded {};
+                RowField::read(row, columns.recharge_id, decoded.recharge_id);
+                RowField::read(row, columns.user_id, decoded.user_id);
+                RowField::read(row, columns.amount, decoded.amount);
+                RowField::read(row, columns.transaction_id, decoded.transaction_id);
+                RowField::read(row, columns.status, decoded.status);
+                RowField::read(row, columns.paid_at, decoded.paid_at);
+                RowField::read(row, columns.created_at, decoded.created_at);
+                return decoded;
+            }
+        };
+    }
+
+    Json::Value DbBenchResult::toJson() const
+    {
+        Json::Value json;
+        json["backend"] = backend;
+        json["ok"] = ok;
+        json["threads"] = threads;
+        json["statements"] = static_cast<Json::UInt64>(statements);
+        json["errors"] = static_cast<Json::UInt64>(errors);
+        json["throughput"] = std::round(throughput * 10) / 10;
+        json["p50_us"] = static_cast<Json::Int64>(p50Us);
+        json["p95_us"] = static_cast<Json::Int64>(p95Us);
+        json["p99_us"] = static_cast<Json::Int64>(p99Us);
+        json["max_us"] = static_cast<Json::Int64>(maxUs);
+        if (!decoder.empty()) {
+            json["decoder"] = decoder;
+            json["rows"] = static_cast<Json::UInt64>(rows);
+        }
+        if (!strategy.empty()) {
+            json["strategy"] = strategy;
+            json["retries"] = static_cast<Json::UInt64>(retries);
+            json["lost_updates"] = static_cast<Json::Int64>(lostUpdates);
+        }
+        return json;
+    }
+
+    DbBenchResult run_db_benchmark(const DBConfig& config, const std::vector<QueryTemplate>& mix,
+                                   const DbBenchOptions& options)
+    {
+        DbBenchResult result;
+        result.backend = config.backend;
+        result.threads = std::max(options.threads, 1);
+
+        std::vector<const QueryTemplate*> queries;
+        for (const auto& item : mix) {
+            if (is_select(item.sql)) {
+                queries.push_back(&item);
+            }
+        }
+        if (queries.empty()) {
+            return result;
+        }
+
+        std::vector<std::unique_ptr<DatabaseHandler>> handlers;
+        if (!open_handlers(config, result.threads, handlers)) {
+            return result;
+        }
+
+        run_workers(handlers, options, [&](DatabaseHandler& db, size_t worker, size_t iteration) {
+            const QueryTemplate& query = *queries[(worker + iteration) % queries.size()];
+            return db.query(query.sql, query.sampleParams).isArray();
+        }, result);
+        return result;
+    }
+
+    DbBenchResult run_contention_benchmark(const DBConfig& config, ContentionStrategy strategy,
+                                           const DbBenchOptions& options)
+    {
+        DbBenchResult result;
+        result.backend = config.backend;
+        result.strategy = strategy == ContentionStrategy::CAS ? "cas" : "locking";
+        result.threads = std::max(options.threads, 1);
+        const int64_t rows = std::max(options.contentionRows, 1);
+
+        std::vector<std::unique_ptr<DatabaseHandler>> handlers;
+        if (!open_handlers(config, result.threads, handlers)) {
+            return result;
+        }
+
+        // 每轮重建临时表，余额从 0 开始
+        DatabaseHandler& admin = *handlers.front();
+        admin.execute(SQL_DROP_CONTENTION, {});
+        if (admin.execute(SQL_CREATE_CONTENTION, {}) < 0) {
+            return result;
+        }
+        // id 从 1 开始：没有 AUTO_INCREMENT 的整数主键取 0 时，内存后端按自增处理
+        for (int64_t id = 1; id <= rows; ++id) {
+            if (admin.execute("INSERT INTO bench_contention (id, balance, version) VALUES (?, 0.00, 0)", {id}) <= 0) {
+                admin.execute(SQL_DROP_CONTENTION, {});
+                return result;
+            }
+        }
+
+        // 预热阶段的写入也计入余额，核对时按全部成功次数计算
+        std::vector<uint64_t> applied(handlers.size(), 0);
+        std::vector<uint64_t> retries(handlers.size(), 0);
+
+        run_workers(handlers, options, [&](DatabaseHandler& db, size_t worker, size_t iteration) {
+            const int64_t id = static_cast<int64_t>((worker + iteration) % rows) + 1;
+
+            if (strategy == ContentionStrategy::LOCKING) {
+                // 原充值写法：更新后回读余额再提交，回读的往返期间一直持有行锁
+                if (!db.begin()) {
+                    return false;
+                }
+                if (db.execute(SQL_ADD_CONTENTION, {id}) <= 0 ||
+                    !db.query("SELECT balance FROM bench_contention WHERE id = ?", {id}).isArray()) {
+                    db.rollback();
+                    return false;
+                }
+                if (!db.commit()) {
+                    return false;
+                }
+                ++applied[worker];
+                return true;
+            }
+
+            CasResult outcome = db.compare_and_swap(SQL_SELECT_CONTENTION, {id},
+                [&](const Json::Value& row, std::vector<BatchStatement>& writes) {
+                    Money balance;
+                    Money::parse(row["balance"].asString(), balance);
+                    balance += Money::fromCents(1);
+                    writes.push_back({SQL_CAS_CONTENTION, {balance.toString(), id, row["version"].asInt64()}});
+                    return true;
+                });
+            retries[worker] += std::max(db.last_cas_attempts() - 1, 0);
+            if (outcome != CasResult::APPLIED) {
+                return false;
+            }
+            ++applied[worker];
+            return true;
+        }, result);
+
+        uint64_t expected = 0;
+        for (size_t worker = 0; worker < handlers.size(); ++worker) {
+            expected += applied[worker];
+            result.retries += retries[worker];
+        }
+
+        // 余额总和应等于成功次数（分），差额即丢失的更新
+        Json::Value total = admin.query("SELECT SUM(balance) AS total FROM bench_contention", {});
+        Money sum;
+        if (total.isArray() && !total.empty() && Money::parse(total[0]["total"].asString(), sum)) {
+            result.lostUpdates = static_cast<int64_t>(expected) - sum.cents();
+        } else {
+            result.ok = false;
+        }
+
+        admin.execute(SQL_DROP_CONTENTION, {});
+        return result;
+    }
+
+    DbBenchResult run_decode_benchmark(const DBConfig& config, DecodeStrategy strategy,
+                                       const DbBenchOptions& options)
+    {
+        DbBenchResult result;
+        result.backend = config.backend;
+        result.decoder = strategy == DecodeStrategy::QUERY_AS ? "query_as" : "parse_result";
+        result.threads = 1;
+        const int rows = std::max(options.decodeRows, 1);
+
+        std::vector<std::unique_ptr<DatabaseHandler>> handlers;
+        if (!open_handlers(config, 1, handlers)) {
+            return result;
+        }
+
+        // 每轮重建临时表，多行 INSERT 分批写入
+        DatabaseHandler& db = *handlers.front();
+        db.execute(SQL_DROP_DECODE, {});
+        if (db.execute(SQL_CREATE_DECODE, {}) < 0) {
+            return result;
+        }
+        for (int first = 0; first < rows; first += DECODE_INSERT_BATCH) {
+            const int count = std::min(DECODE_INSERT_BATCH, rows - first);
+            std::string sql = "INSERT INTO bench_decode (recharge_id, user_id, amount, transaction_id, status, "
+                              "paid_at, created_at) VALUES ";
+            SqlParams params;
+            for (int index = 0; index < count; ++index) {
+                const int id = first + index + 1;
+                sql += index ? ", (?, ?, ?, ?, 'completed', NOW(), NOW())" : "(?, ?, ?, ?, 'completed', NOW(), NOW())";
+                params.emplace_back(id);
+                params.emplace_back(static_cast<int64_t>(1000 + id % 97));
+                params.emplace_back(Money::fromCents(id * 37 % 100000).toString());
+                params.emplace_back(id);
+            }
+            if (db.execute(sql, params) != count) {
+                db.execute(SQL_DROP_DECODE, {});
+                return result;
+            }
+        }
+
+        run_workers(handlers, options, [&](DatabaseHandler& handler, size_t, size_t) {
+            if (strategy == DecodeStrategy::QUERY_AS) {
+                std::vector<DecodeRow> decoded;
+                decoded.reserve(rows);
+                return handler.query_as(SQL_SELECT_DECODE, {}, decoded) && decoded.size() == static_cast<size_t>(rows);
+            }
+            Json::Value decoded = handler.query(SQL_SELECT_DECODE, {});
+            return decoded.isArray() && decoded.size() == static_cast<Json::ArrayIndex>(rows);
+        }, result);
+        result.rows = rows;
+
+        db.execute(SQL_DROP_DECODE, {});
+        return result;
+    }
+
+}
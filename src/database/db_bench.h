@@ -0,0 +1,68 @@
+#pragma once
+
+#include "db_handler.h"
+
+namespace TakeAwayPlatform
+{
+    // 数据库基准参数（config.json 中 database 节的 bench_* 配置项）
+    struct DbBenchOptions {
+        int threads = 8;            // 并发数，每个线程独占一个 DatabaseHandler
+        int durationSec = 10;       // 计时阶段时长
+        int warmUpSec = 2;          // 预热阶段不计入结果，用于填满语句缓存和服务端缓冲池
+        int contentionRows = 1;     // 争用基准中被并发修改的热点行数
+        int decodeRows = 10000;     // 解码基准中每次查询返回的行数
+    };
+
+    // 争用基准中读改写的两种写法
+    enum class ContentionStrategy {
+        LOCKING,        // 事务内更新后回读再提交，行锁跨越应用往返
+        CAS             // DatabaseHandler::compare_and_swap，无锁读取、以版本号为条件写回
+    };
+
+    // 解码基准中结果集的两种解码方式
+    enum class DecodeStrategy {
+        PARSE_RESULT,   // DatabaseHandler::query，逐行构造 Json::Value（原写法）
+        QUERY_AS        // DatabaseHandler::query_as，按列下标直接解码到结构体
+    };
+
+    // 一个后端在查询组合上的结果
+    struct DbBenchResult {
+        std::string backend;
+        bool ok = false;            // 所有线程都建立了连接
+        int threads = 0;
+        uint64_t statements = 0;
+        uint64_t errors = 0;
+        double throughput = 0;      // 每秒语句数
+        int64_t p50Us = 0;
+        int64_t p95Us = 0;
+        int64_t p99Us = 0;
+        int64_t maxUs = 0;
+
+        // 仅争用基准
+        std::string strategy;
+        uint64_t retries = 0;       // 版本冲突后的重试次数
+        int64_t lostUpdates = 0;    // 成功次数与最终余额之差，非 0 说明有更新丢失
+
+        // 仅解码基准
+        std::string decoder;
+        uint64_t rows = 0;          // 每次查询返回的行数
+
+        Json::Value toJson() const;
+    };
+
+    // 以固定并发循环执行查询组合（各线程从不同模板开始轮转），统计吞吐和延迟分位数。
+    // 只执行其中的 SELECT 模板，不修改数据；后端由 config.backend 决定
+    DbBenchResult run_db_benchmark(const DBConfig& config, const std::vector<QueryTemplate>& mix,
+                                   const DbBenchOptions& options);
+
+    // 在临时表 bench_contention 的 contentionRows 个热点行上并发执行读改写（余额加 0.01），
+    // 统计吞吐、延迟、重试次数并核对余额总和。会建表写数据，只应在测试库上运行
+    DbBenchResult run_contention_benchmark(const DBConfig& config, ContentionStrategy strategy,
+                                           const DbBenchOptions& options);
+
+    // 在临时表 bench_decode 中写入 decodeRows 行（列与 recharge_record 相同），
+    // 单线程反复读取整个结果集，对比两种解码方式每次查询的耗时。会建表写数据，只应在测试库上运行
+    DbBenchResult run_decode_benchmark(const DBConfig& config, DecodeStrategy strategy,
+                                       const DbBenchOptions& options);
+
+}
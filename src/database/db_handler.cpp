@@ -1,6 +1,13 @@
 #include <iostream>
+#include <ctime>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <set>
+#include <mutex>
 
 #include "db_handler.h"
+#include "migration_runner.h"
 
 
 namespace TakeAwayPlatform
@@ -12,24 +19,324 @@ namespace TakeAwayPlatform
 
     Json::Value DatabaseHandler::query(const std::string& sql) 
     {
+        if (backend) {
+            return query(sql, SqlParams());
+        }
+
+        QueryTimer timer(sql, &lastActivity);
         try 
         {
-            std::cout << "DatabaseHandler::query sql:" << sql << std::endl;
-            std::cout.flush();
+            if (!session) {
+                lastError = "not connected";
+                timer.failed();
+                return Json::Value(Json::objectValue);
+            }
 
             mysqlx::SqlResult result = session->sql(sql).execute();
-            return parse_result(result);
+            Json::Value rows = parse_result(result);
+            if (!rows.isArray()) {
+                timer.failed();
+            }
+            return rows;
         } 
         catch (const mysqlx::Error& e) 
         {
             // 处理数据库错误
             std::cerr << "Database error: " << e.what() << std::endl;
+            lastError = e.what();
+            timer.failed();
+            return Json::Value(Json::objectValue);
+        }
+    }
+
+    Json::Value DatabaseHandler::query(const std::string& sql, const SqlParams& params)
+    {
+        QueryTimer timer(sql, &lastActivity);
+        try 
+        {
+            if (backend) {
+                StorageResult result;
+                if (!run_backend(sql, params, result)) {
+                    timer.failed();
+                    return Json::Value(Json::objectValue);
+                }
+                return parse_result(result);
+            }
+
+            if (!session) {
+                lastError = "not connected";
+                timer.failed();
+                return Json::Value(Json::objectValue);
+            }
+
+            mysqlx::SqlResult result = prepare(sql, params).execute();
+            Json::Value rows = parse_result(result);
+            if (!rows.isArray()) {
+                timer.failed();
+            }
+            return rows;
+        } 
+        catch (const mysqlx::Error& e) 
+        {
+            std::cerr << "Database error: " << e.what() << " sql: " << sql << std::endl;
+            lastError = e.what();
+            timer.failed();
+            statementCache.erase(sql);
             return Json::Value(Json::objectValue);
         }
     }
 
+    int64_t DatabaseHandler::execute(const std::string& sql, const SqlParams& params)
+    {
+        QueryTimer timer(sql, &lastActivity);
+        try 
+        {
+            if (backend) {
+                StorageResult result;
+                if (!run_backend(sql, params, result)) {
+                    timer.failed();
+                    return -1;
+                }
+                lastInsertId = result.lastInsertId;
+                return static_cast<int64_t>(result.affectedRows);
+            }
+
+            if (!session) {
+                lastError = "not connected";
+                timer.failed();
+                return -1;
+            }
+
+            mysqlx::SqlResult result = prepare(sql, params).execute();
+            lastInsertId = result.getAutoIncrementValue();
+            return static_cast<int64_t>(result.getAffectedItemsCount());
+        } 
+        catch (const mysqlx::Error& e) 
+        {
+            std::cerr << "Database error: " << e.what() << " sql: " << sql << std::endl;
+            lastError = e.what();
+            timer.failed();
+            statementCache.erase(sql);
+            return -1;
+        }
+    }
+
+    int64_t DatabaseHandler::execute_batch(const std::vector<BatchStatement>& statements)
+    {
+        const bool ownTransaction = !inTransaction;
+        if (ownTransaction && !begin()) {
+            return -1;
+        }
+
+        int64_t affected = 0;
+        for (const auto& statement : statements) {
+            int64_t rows = execute(statement.sql, statement.params);
+            if (rows < 0) {
+                if (ownTransaction) {
+                    rollback();
+                }
+                return -1;
+            }
+            affected += rows;
+        }
+
+        if (ownTransaction && !commit()) {
+            return -1;
+        }
+        return affected;
+    }
+
+    CasResult DatabaseHandler::compare_and_swap(const std::string& selectSql, const SqlParams& selectParams,
+                                                const CasCompute& compute, int maxAttempts)
+    {
+        lastCasAttempts = 0;
+        if (inTransaction) {
+            lastError = "compare_and_swap inside a transaction";
+            std::cerr << "Database error: " << lastError << std::endl;
+            return CasResult::FAILED;
+        }
+
+        thread_local std::minstd_rand jitter(std::random_device{}());
+        for (int attempt = 0; attempt < std::max(maxAttempts, 1); ++attempt) {
+            // 冲突的请求错开重读时间，避免同一批请求再次同时读到同一版本
+            if (attempt > 0) {
+                const int backoff = CAS_BACKOFF_US << std::min(attempt - 1, 6);
+                std::this_thread::sleep_for(std::chrono::microseconds(backoff / 2 + jitter() % backoff));
+            }
+            ++lastCasAttempts;
+
+            Json::Value rows = query(selectSql, selectParams);
+            if (!rows.isArray()) {
+                return CasResult::FAILED;
+            }
+            if (rows.empty()) {
+                return CasResult::NOT_FOUND;
+            }
+
+            std::vector<BatchStatement> writes;
+            if (!compute(rows[0], writes)) {
+                return CasResult::REJECTED;
+            }
+            if (writes.empty()) {
+                return CasResult::APPLIED;
+            }
+
+            // 只有一条写语句时自动提交，不需要显式事务
+            const bool ownTransaction = writes.size() > 1;
+            if (ownTransaction && !begin()) {
+                return CasResult::FAILED;
+            }
+
+            bool ok = true;
+            for (size_t index = 0; ok && index + 1 < writes.size(); ++index) {
+                ok = execute(writes[index].sql, writes[index].params) >= 0;
+            }
+            const int64_t swapped = ok ? execute(writes.back().sql, writes.back().params) : -1;
+
+            if (swapped > 0) {
+                return !ownTransaction || commit() ? CasResult::APPLIED : CasResult::FAILED;
+            }
+            if (ownTransaction) {
+                rollback();
+            }
+            if (swapped < 0) {
+                return CasResult::FAILED;
+            }
+        }
+        return CasResult::CONFLICT;
+    }
+
+    bool DatabaseHandler::begin()
+    {
+        if (backend && !inTransaction) {
+            std::string error;
+            if (!backend->begin(error)) {
+                std::cerr << "Database error: begin transaction failed: " << error << std::endl;
+                return false;
+            }
+            inTransaction = true;
+            return true;
+        }
+
+        try 
+        {
+            if (!session || inTransaction) {
+                return false;
+            }
+
+            session->startTransaction();
+            inTransaction = true;
+            return true;
+        } 
+        catch (const mysqlx::Error& e) 
+        {
+            std::cerr << "Database error: begin transaction failed: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    bool DatabaseHandler::commit()
+    {
+        if (!inTransaction) {
+            return false;
+        }
+        inTransaction = false;
+
+        if (backend) {
+            std::string error;
+            if (!backend->commit(error)) {
+                std::cerr << "Database error: commit failed: " << error << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        try 
+        {
+            session->commit();
+            return true;
+        } 
+        catch (const mysqlx::Error& e) 
+        {
+            std::cerr << "Database error: commit failed: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    bool DatabaseHandler::rollback()
+    {
+        if (!inTransaction) {
+            return false;
+        }
+        inTransaction = false;
+
+        if (backend) {
+            std::string error;
+            if (!backend->rollback(error)) {
+                std::cerr << "Database error: rollback failed: " << error << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        try 
+        {
+            session->rollback();
+            return true;
+        } 
+        catch (const mysqlx::Error& e) 
+        {
+            std::cerr << "Database error: rollback failed: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    PreparedStatement& DatabaseHandler::prepare(const std::string& sql, const SqlParams& params)
+    {
+        auto it = statementCache.find(sql);
+        if (it == statementCache.end()) {
+            // 模板数量有限，超出容量说明调用方拼接了变量，整体丢弃即可
+            if (statementCache.size() >= STATEMENT_CACHE_CAPACITY) {
+                statementCache.clear();
+            }
+
+            auto statement = std::make_unique<PreparedStatement>(session->sql(sql));
+            it = statementCache.emplace(sql, std::move(statement)).first;
+        }
+
+        PreparedStatement& statement = *it->second;
+        statement.clearBindings();
+        for (const auto& param : params) {
+            statement.bind(param);
+        }
+        return statement;
+    }
+
+    bool DatabaseHandler::check_alive(std::chrono::milliseconds window)
+    {
+        if (!session && !backend) {
+            return false;
+        }
+
+        if (idle_time() < window) {
+            return true;
+        }
+
+        if (!is_connected()) {
+            lastActivity = std::chrono::steady_clock::time_point();
+            return false;
+        }
+
+        lastActivity = std::chrono::steady_clock::now();
+        return true;
+    }
+
     bool DatabaseHandler::is_connected() const 
     {
+        if (backend) {
+            return backend->ping();
+        }
+
         if (!session) {
             return false;
         }
@@ -47,10 +354,14 @@ namespace TakeAwayPlatform
 
     void DatabaseHandler::reconnect() 
     {
+        statementCache.clear();
+        inTransaction = false;
+
         if (session) 
         {
             session->close();
         }
+        backend.reset();
         
         connect(dbConfig);
     }
@@ -58,30 +369,49 @@ namespace TakeAwayPlatform
     void DatabaseHandler::connect(const DBConfig& config)
     {
         dbConfig = config;
+
+        if (!config.backend.empty() && config.backend != "mysql") {
+            try 
+            {
+                backend = create_storage_backend(config);
+                lastActivity = std::chrono::steady_clock::now();
+                std::cout << ("Database backend " + config.backend + ": " + config.database + "\n");
+                std::cout.flush();
+            } 
+            catch (const std::exception& e) 
+            {
+                std::cerr << ("Database backend " + config.backend + " failed: " + e.what() + "\n");
+                backend.reset();
+                return;
+            }
+
+            if (!migrate_embedded(config)) {
+                backend.reset();
+            }
+            return;
+        }
         
         try 
         {
-            std::cout << "DatabaseHandler::connect host:" << config.host << std::endl;
-            std::cout << "DatabaseHandler::connect port:" << config.port << std::endl;
-            std::cout << "DatabaseHandler::connect user:" << config.user << std::endl;
-            std::cout << "DatabaseHandler::connect password:" << config.password << std::endl;
-            std::cout.flush();
-
             // 基于X Protocol，使用URI连接
             // 显示禁止ssl连接，因为MySQL 8.0默认不支持ssl连接
+            // 默认库随认证一起发送，省去单独的 USE 往返
             std::string uri = "mysqlx://" + config.user + ":" + config.password + 
                             "@" + config.host + ":" + std::to_string(config.port) + 
-                            "?ssl-mode=DISABLED";
+                            "/" + config.database + "?ssl-mode=DISABLED";
             session = std::make_unique<mysqlx::Session>(uri);
 
-            session->sql("USE " + config.database).execute();
+            lastActivity = std::chrono::steady_clock::now();
 
-            std::cout << "Database connection successful." << std::endl;
+            // 预热时多个连接并行建立，整行输出避免交错
+            std::cout << ("Database connection successful: " + config.user + "@" + config.host + ":"
+                          + std::to_string(config.port) + "/" + config.database + "\n");
             std::cout.flush();
         } 
         catch (const mysqlx::Error& e) 
         {
-            std::cerr << "Database connection failed: " << e.what() << std::endl;
+            std::cerr << ("Database connection failed: " + config.host + ":" + std::to_string(config.port)
+                          + ": " + e.what() + "\n");
             session.reset();
         }
     }
@@ -89,14 +419,190 @@ namespace TakeAwayPlatform
     Json::Value DatabaseHandler::parse_result(mysqlx::SqlResult& result) 
     {
         Json::Value json_result(Json::arrayValue);
-        
-        for(mysqlx::Row row : result.fetchAll()) 
+
+        QueryCursor cursor(std::move(result));
+        Json::Value json_row;
+        while (cursor.next(json_row)) {
+            json_result.append(std::move(json_row));
+        }
+
+        if (!cursor) {
+            return Json::Value(Json::objectValue);
+        }
+
+        return json_result;
+    }
+
+    Json::Value DatabaseHandler::parse_result(StorageResult& result)
+    {
+        Json::Value json_result(Json::arrayValue);
+
+        QueryCursor cursor(std::move(result.columns), std::move(result.rows));
+        Json::Value json_row;
+        while (cursor.next(json_row)) {
+            json_result.append(std::move(json_row));
+        }
+        return json_result;
+    }
+
+    bool DatabaseHandler::migrate_embedded(const DBConfig& config)
+    {
+        if (config.backend != "memory" && config.backend != "sqlite") {
+            return true;
+        }
+
+        // 同一个库的连接并行建立时，其余连接等待迁移完成后再开始使用
+        static std::mutex migratedMutex;
+        static std::set<std::string> migrated;
+
+        const std::string key = config.backend + ":" + (config.backend == "sqlite" ? config.sqliteFile : config.database);
+        std::lock_guard<std::mutex> lock(migratedMutex);
+        if (migrated.count(key)) {
+            return true;
+        }
+
+        const std::string directory = config.migrationsDir.empty() ? MigrationRunner::DEFAULT_DIRECTORY : config.migrationsDir;
+        if (MigrationRunner(*this, directory).migrate() < 0) {
+            std::cerr << ("Database backend " + config.backend + ": migrations in " + directory + " failed\n");
+            return false;
+        }
+
+        migrated.insert(key);
+        return true;
+    }
+
+    int DatabaseHandler::index_exists(const std::string& table, const std::string& index)
+    {
+        return schema_object_exists(true, table, index);
+    }
+
+    int DatabaseHandler::column_exists(const std::string& table, const std::string& column)
+    {
+        return schema_object_exists(false, table, column);
+    }
+
+    int DatabaseHandler::schema_object_exists(bool index, const std::string& table, const std::string& name)
+    {
+        if (backend) {
+            std::string error;
+            int found = index ? backend->index_exists(table, name, error) : backend->column_exists(table, name, error);
+            if (found < 0) {
+                lastError = error;
+            }
+            return found;
+        }
+
+        Json::Value rows = query(index ? SQL_INDEX_EXISTS : SQL_COLUMN_EXISTS, {table, name});
+        if (!rows.isArray()) {
+            return -1;
+        }
+        return !rows.empty() && rows[0]["found"].asInt64() > 0 ? 1 : 0;
+    }
+
+    bool DatabaseHandler::run_backend(const std::string& sql, const SqlParams& params, StorageResult& result)
+    {
+        std::string error;
+        if (!backend->execute(sql, params, result, error)) {
+            std::cerr << "Database error: " << error << " sql: " << sql << std::endl;
+            lastError = error;
+            return false;
+        }
+        return true;
+    }
+
+    QueryCursor DatabaseHandler::open_cursor(const std::string& sql, const SqlParams& params)
+    {
+        // 只计到结果开始返回为止，逐行读取的时间由调用方决定
+        QueryTimer timer(sql, &lastActivity);
+        try 
+        {
+            if (backend) {
+                StorageResult result;
+                if (!run_backend(sql, params, result)) {
+                    timer.failed();
+                    return QueryCursor();
+                }
+                return QueryCursor(std::move(result.columns), std::move(result.rows));
+            }
+
+            if (!session) {
+                lastError = "not connected";
+                timer.failed();
+                return QueryCursor();
+            }
+
+            return QueryCursor(prepare(sql, params).execute());
+        } 
+        catch (const mysqlx::Error& e) 
+        {
+            std::cerr << "Database error: " << e.what() << " sql: " << sql << std::endl;
+            lastError = e.what();
+            timer.failed();
+            statementCache.erase(sql);
+            return QueryCursor();
+        }
+    }
+
+    // ==================== QueryCursor ====================
+
+    QueryCursor::QueryCursor(mysqlx::SqlResult&& result)
+        : result(std::move(result)), ok(true), finished(false)
+    {
+        try 
+        {
+            if (!this->result.hasData()) {
+                finished = true;
+                return;
+            }
+
+            const unsigned count = this->result.getColumnCount();
+            columnNames.reserve(count);
+            columnTypes.reserve(count);
+            for (unsigned index = 0; index < count; ++index) {
+                const mysqlx::Column& column = this->result.getColumn(index);
+                columnNames.push_back(column.getColumnName());
+                columnTypes.push_back(column.getType());
+            }
+        } 
+        catch (const mysqlx::Error& e) 
         {
-            Json::Value json_row;
-            for(unsigned index = 0; index < row.colCount(); ++index) 
+            std::cerr << "Database error: " << e.what() << std::endl;
+            ok = false;
+            finished = true;
+        }
+    }
+
+    QueryCursor::QueryCursor(std::vector<std::string> columns, std::vector<mysqlx::Row> rows)
+        : buffered(std::move(rows)), fromBuffer(true), columnNames(std::move(columns)), ok(true), finished(false)
+    {
+        // 后端的值都已是基本类型，不会出现需要按列类型解码的 RAW
+        columnTypes.assign(columnNames.size(), mysqlx::Type::STRING);
+    }
+
+    bool QueryCursor::next(Json::Value& json_row)
+    {
+        if (finished) {
+            return false;
+        }
+
+        try 
+        {
+            mysqlx::Row row;
+            if (!fromBuffer) {
+                row = result.fetchOne();
+            } else if (bufferedNext < buffered.size()) {
+                row = std::move(buffered[bufferedNext++]);
+            }
+            if (!row) {
+                finished = true;
+                return false;
+            }
+
+            json_row = Json::Value(Json::objectValue);
+            for (unsigned index = 0; index < row.colCount(); ++index) 
             {
-                mysqlx::Value value = row[index];
-                std::string column_name = result.getColumn(index).getColumnName();
+                const mysqlx::Value& value = row[index];
+                const std::string& column_name = columnNames[index];
 
                 switch(value.getType()) 
                 {
@@ -124,14 +630,70 @@ namespace TakeAwayPlatform
                         json_row[column_name] = value.get<bool>();
                         break;
 
+                    case mysqlx::Value::RAW:
+                        json_row[column_name] = DatabaseHandler::format_raw(columnTypes[index], value);
+                        break;
+
                     default:
                         json_row[column_name] = "UNSUPPORTED_TYPE";
                 }
             }
 
-            json_result.append(json_row);
+            ++rowsRead;
+            return true;
+        } 
+        catch (const mysqlx::Error& e) 
+        {
+            std::cerr << "Database error: " << e.what() << std::endl;
+            ok = false;
+            finished = true;
+            return false;
         }
+    }
 
-        return json_result;
+    size_t QueryCursor::next_batch(Json::Value& rows, size_t maxRows)
+    {
+        size_t count = 0;
+        Json::Value row;
+        while (count < maxRows && next(row)) {
+            rows.append(std::move(row));
+            ++count;
+        }
+        return count;
+    }
+
+    Json::Value DatabaseHandler::format_raw(mysqlx::Type type, const mysqlx::Value& value)
+    {
+        switch (type) {
+            case mysqlx::Type::DECIMAL: {
+                Money money;
+                if (RawCodec::decodeDecimal(value.getRawBytes(), money)) {
+                    return money.toString();
+                }
+                break;
+            }
+
+            case mysqlx::Type::DATE:
+            case mysqlx::Type::DATETIME:
+            case mysqlx::Type::TIMESTAMP: {
+                DateTime time;
+                if (RawCodec::decodeDateTime(value.getRawBytes(), time)) {
+                    std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+                    std::tm local {};
+                    localtime_r(&seconds, &local);
+
+                    char buffer[20];
+                    const char* format = type == mysqlx::Type::DATE ? "%Y-%m-%d" : "%Y-%m-%d %H:%M:%S";
+                    std::strftime(buffer, sizeof(buffer), format, &local);
+                    return buffer;
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        return "UNSUPPORTED_TYPE";
     }
 }
\ No newline at end of file
@@ -1,32 +1,282 @@
 #pragma once
 
 #include "common.h"
+#include "row_decoder.h"
+#include "query_stats.h"
+#include "storage_backend.h"
+#include <iostream>
+#include <functional>
+#include <unordered_map>
 #include <mysqlx/xdevapi.h>
 
 namespace TakeAwayPlatform
 {
+    // 可重复执行的 SQL 语句：同一对象再次执行时由连接器在服务端预处理，
+    // 之后每次只发送参数，不再重新解析 SQL
+    class PreparedStatement : public mysqlx::SqlStatement
+    {
+    public:
+        explicit PreparedStatement(mysqlx::SqlStatement&& statement)
+            : mysqlx::SqlStatement(std::move(statement)) {}
+
+        // bind() 只会追加参数，复用前需清空上一次的绑定
+        void clearBindings() { get_impl()->clear_params(); }
+    };
+
+    // 批量执行中的一条语句
+    struct BatchStatement {
+        std::string sql;
+        SqlParams params;
+    };
+
+    // compare_and_swap 的结果
+    enum class CasResult {
+        APPLIED,        // 条件更新成功并已提交
+        NOT_FOUND,      // 读取不到目标行
+        REJECTED,       // compute 拒绝（余额、库存不足等）
+        CONFLICT,       // 重试次数用尽，每次读取后版本都已被其他请求修改
+        FAILED          // 语句执行失败
+    };
+
+    // 根据读到的当前行生成写语句，最后一条为以 version 为条件的更新；返回 false 表示拒绝修改
+    using CasCompute = std::function<bool(const Json::Value& row, std::vector<BatchStatement>& writes)>;
+
+    // 具名查询模板及一组示例参数，用于执行计划检查
+    struct QueryTemplate {
+        std::string name;
+        std::string sql;
+        SqlParams sampleParams;
+    };
+
+    // 流式结果游标：每次从连接上取一行（fetchOne）转换，不把整个结果集读入内存，
+    // 第一行到达即可处理。游标未读完之前，同一连接上不应执行其他语句。
+    // 存储后端返回的是完整结果，此时游标只是逐行遍历已有的行
+    class QueryCursor
+    {
+    public:
+        QueryCursor() = default;
+        explicit QueryCursor(mysqlx::SqlResult&& result);
+        QueryCursor(std::vector<std::string> columns, std::vector<mysqlx::Row> rows);
+
+        QueryCursor(QueryCursor&&) = default;
+        QueryCursor& operator=(QueryCursor&&) = default;
+
+        // 查询成功且读取过程中未出错
+        explicit operator bool() const { return ok; }
+
+        // 读取下一行到 row，读完或出错时返回 false
+        bool next(Json::Value& row);
+
+        // 向 rows 追加至多 maxRows 行，返回本批行数，0 表示读完或出错
+        size_t next_batch(Json::Value& rows, size_t maxRows);
+
+        // 已读取的行数
+        uint64_t rows_read() const { return rowsRead; }
+
+    private:
+        mysqlx::SqlResult result;
+        std::vector<mysqlx::Row> buffered;
+        size_t bufferedNext = 0;
+        bool fromBuffer = false;
+        std::vector<std::string> columnNames;   // 列信息每个结果集解析一次
+        std::vector<mysqlx::Type> columnTypes;
+        uint64_t rowsRead = 0;
+        bool ok = false;
+        bool finished = true;
+    };
 
     class DatabaseHandler 
     {
     public:
+        static constexpr int DEFAULT_CAS_ATTEMPTS = 5;
+
         DatabaseHandler(const DBConfig& config);
 
         Json::Value query(const std::string& sql);
 
+        // 参数化查询，sql 为含 '?' 占位符的模板，失败返回空对象
+        Json::Value query(const std::string& sql, const SqlParams& params);
+
+        // 类型化查询：结果直接解码进 T，不经过 Json::Value。
+        // T 需提供由 ColumnIndex 构造的 T::Columns 和 T::fromRow(row, columns)，失败返回 false
+        template <class T>
+        bool query_as(const std::string& sql, const SqlParams& params, std::vector<T>& out);
+
+        // 流式查询，用于大结果集（导出、全表扫描）；查询失败时游标为 false
+        QueryCursor open_cursor(const std::string& sql, const SqlParams& params);
+
+        // 参数化执行写语句，返回受影响行数，失败返回 -1
+        int64_t execute(const std::string& sql, const SqlParams& params);
+
+        // 最近一次 execute 产生的自增 ID
+        uint64_t last_insert_id() const { return lastInsertId; }
+
+        // 依次执行多条写语句并一次提交：不在事务中时自动开启事务，
+        // 任一语句失败即回滚。返回受影响行数之和，失败返回 -1
+        int64_t execute_batch(const std::vector<BatchStatement>& statements);
+
+        // 乐观并发的读改写，事务不跨越应用往返持有行锁：
+        // 不加锁读取 selectSql 的第一行（须包含 version 列），由 compute 生成写语句，
+        // 最后一条须为 "SET ..., version = version + 1 WHERE ... AND version = ?" 形式的条件更新。
+        // 多条写语句在一个短事务中执行，条件更新放在最后，行锁只持有到紧随其后的提交；
+        // 条件更新影响 0 行说明读取后版本已变化，回滚后退避重读，共尝试 maxAttempts 次。
+        // 不能在显式事务中调用：事务内的一致性读看不到其他事务提交的新版本
+        CasResult compare_and_swap(const std::string& selectSql, const SqlParams& selectParams,
+                                   const CasCompute& compute, int maxAttempts = DEFAULT_CAS_ATTEMPTS);
+
+        // 最近一次 compare_and_swap 的尝试次数
+        int last_cas_attempts() const { return lastCasAttempts; }
+
+        // 显式事务，失败返回 false；一般通过 TransactionScope 使用
+        bool begin();
+        bool commit();
+        bool rollback();
+        bool in_transaction() const { return inTransaction; }
+
+        // 执行 SELECT 1 探测连接
         bool is_connected() const;
 
+        // 最近 window 内成功执行过语句的连接直接视为可用，否则探测一次
+        bool check_alive(std::chrono::milliseconds window);
+
+        // 距最近一次成功执行语句的时长
+        std::chrono::steady_clock::duration idle_time() const {
+            return std::chrono::steady_clock::now() - lastActivity;
+        }
+
+        // 表 table 上是否已有名为 index 的索引 / 名为 column 的列，返回 1 存在、0 不存在、-1 查询失败。
+        // MySQL 查询 information_schema，其他后端查询自身的表结构
+        int index_exists(const std::string& table, const std::string& index);
+        int column_exists(const std::string& table, const std::string& column);
+
+        // 最近一次失败的 query/execute/open_cursor 的错误信息
+        const std::string& last_error() const { return lastError; }
+
         void reconnect();
 
         
     private:
+        friend class QueryCursor;
+
         void connect(const DBConfig& config);
 
+        // memory、sqlite 后端：进程内首次打开某个库时，在建表脚本之后执行迁移，与 MySQL 部署的 schema 一致
+        bool migrate_embedded(const DBConfig& config);
+
+        // index 为 true 时检查索引，否则检查列
+        int schema_object_exists(bool index, const std::string& table, const std::string& name);
+
         Json::Value parse_result(mysqlx::SqlResult& result);
+        Json::Value parse_result(StorageResult& result);
+
+        // 由存储后端执行一条语句，失败时记录错误信息
+        bool run_backend(const std::string& sql, const SqlParams& params, StorageResult& result);
+
+        // DECIMAL 输出为 "12.34"，DATE/DATETIME 输出为本地时间文本
+        static Json::Value format_raw(mysqlx::Type type, const mysqlx::Value& value);
+
+        // 取出（或创建并缓存）模板对应的语句，并绑定本次参数
+        PreparedStatement& prepare(const std::string& sql, const SqlParams& params);
 
 
     private:
         DBConfig dbConfig;
         std::unique_ptr<mysqlx::Session> session;
+        std::unique_ptr<StorageBackend> backend;     // 非 MySQL 后端，与 session 二选一
+
+        // 按 SQL 模板缓存的语句，依附于当前会话，重连时清空
+        static constexpr size_t STATEMENT_CACHE_CAPACITY = 64;
+
+        // 版本冲突后的首次退避，之后每次翻倍并加随机抖动
+        static constexpr int CAS_BACKOFF_US = 100;
+        std::unordered_map<std::string, std::unique_ptr<PreparedStatement>> statementCache;
+        uint64_t lastInsertId = 0;
+        int lastCasAttempts = 0;
+        bool inTransaction = false;
+        std::string lastError;
+        std::chrono::steady_clock::time_point lastActivity;     // 语句失败时清零
     };
 
-}
\ No newline at end of file
+    // 事务作用域：构造时开启事务，未 commit 即离开作用域（包括异常展开）时回滚
+    class TransactionScope
+    {
+    public:
+        explicit TransactionScope(DatabaseHandler& handler)
+            : handler(handler), active(handler.begin()) {}
+
+        ~TransactionScope() {
+            if (active) {
+                handler.rollback();
+            }
+        }
+
+        TransactionScope(const TransactionScope&) = delete;
+        TransactionScope& operator=(const TransactionScope&) = delete;
+
+        // 事务是否成功开启
+        explicit operator bool() const { return active; }
+
+        bool commit() {
+            if (!active) {
+                return false;
+            }
+            active = false;
+            return handler.commit();
+        }
+
+    private:
+        DatabaseHandler& handler;
+        bool active;
+    };
+
+
+    template <class T>
+    bool DatabaseHandler::query_as(const std::string& sql, const SqlParams& params, std::vector<T>& out)
+    {
+        QueryTimer timer(sql, &lastActivity);
+        try 
+        {
+            if (backend) {
+                StorageResult result;
+                if (!run_backend(sql, params, result)) {
+                    timer.failed();
+                    return false;
+                }
+
+                const typename T::Columns columns(ColumnIndex{result.columns});
+                for (const mysqlx::Row& row : result.rows) {
+                    out.push_back(T::fromRow(row, columns));
+                }
+                return true;
+            }
+
+            if (!session) {
+                lastError = "not connected";
+                timer.failed();
+                return false;
+            }
+
+            mysqlx::SqlResult result = prepare(sql, params).execute();
+            if (!result.hasData()) {
+                return true;
+            }
+
+            // 列下标每个结果集解析一次
+            const typename T::Columns columns(ColumnIndex{result});
+
+            for (mysqlx::Row row = result.fetchOne(); row; row = result.fetchOne()) {
+                out.push_back(T::fromRow(row, columns));
+            }
+            return true;
+        } 
+        catch (const mysqlx::Error& e) 
+        {
+            std::cerr << "Database error: " << e.what() << " sql: " << sql << std::endl;
+            lastError = e.what();
+            timer.failed();
+            statementCache.erase(sql);
+            return false;
+        }
+    }
+
+}
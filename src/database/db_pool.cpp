@@ -0,0 +1,471 @@
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "db_pool.h"
+
+
+namespace TakeAwayPlatform
+{
+    DBLease::DBLease(DBConnectionPool* pool, std::unique_ptr<DatabaseHandler> handler)
+        : pool(pool), handler(std::move(handler))
+    {
+    }
+
+    DBLease::DBLease(DBLease&& other) noexcept
+        : pool(other.pool), handler(std::move(other.handler))
+    {
+        other.pool = nullptr;
+    }
+
+    DBLease& DBLease::operator=(DBLease&& other) noexcept
+    {
+        if (this != &other) {
+            release();
+            pool = other.pool;
+            handler = std::move(other.handler);
+            other.pool = nullptr;
+        }
+        return *this;
+    }
+
+    DBLease::~DBLease()
+    {
+        release();
+    }
+
+    void DBLease::release()
+    {
+        if (pool && handler) {
+            pool->release(std::move(handler));
+        }
+        pool = nullptr;
+        handler.reset();
+    }
+
+    DBConnectionPool::DBConnectionPool(const DBConfig& config, const DBPoolOptions& options)
+        : dbConfig(config), options(options), breaker(options.breaker)
+    {
+        if (this->options.maxTotal < 1) {
+            this->options.maxTotal = 1;
+        }
+        if (this->options.minIdle > this->options.maxTotal) {
+            this->options.minIdle = this->options.maxTotal;
+        }
+    }
+
+    DBConnectionPool::~DBConnectionPool()
+    {
+        close();
+    }
+
+    void DBConnectionPool::warm_up(int ready)
+    {
+        std::lock_guard<std::mutex> warmUpLock(warmUpMutex);
+
+        // 回收上一轮已结束的预热线程（需在 poolMutex 外 join）
+        std::vector<std::thread> finished;
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            if (warmUpRunning == 0) {
+                finished.swap(warmUpThreads);
+            }
+        }
+        for (auto& thread : finished) {
+            thread.join();
+        }
+
+        std::unique_lock<std::mutex> lock(poolMutex);
+        if (closed) {
+            return;
+        }
+
+        if (warmUpRunning == 0) {
+            warmUpPending = std::max(0, std::min(options.minIdle, options.maxTotal) - total);
+            warmUpCreated = 0;
+
+            const int workers = std::min(std::max(options.warmUpConcurrency, 1), warmUpPending);
+            warmUpRunning = workers;
+            for (int index = 0; index < workers; ++index) {
+                warmUpThreads.emplace_back([this] { warm_up_worker(); });
+            }
+        }
+
+        const int target = ready < 0 ? options.minIdle : std::min(ready, options.minIdle);
+        warmUpCv.wait(lock, [this, target] {
+            return closed || warmUpRunning == 0 || warmUpCreated >= target;
+        });
+
+        if (!closed && options.keepaliveIntervalSec > 0 && !keepaliveThread.joinable()) {
+            keepaliveThread = std::thread([this] { keepalive_loop(); });
+        }
+    }
+
+    bool DBConnectionPool::warm_up_done() const
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        return warmUpRunning == 0;
+    }
+
+    bool DBConnectionPool::warm_up_reached() const
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        return warmUpRunning == 0 && total >= std::min(options.minIdle, options.maxTotal);
+    }
+
+    void DBConnectionPool::warm_up_worker()
+    {
+        std::unique_lock<std::mutex> lock(poolMutex);
+        while (!closed && warmUpPending > 0 && total < options.maxTotal) {
+            --warmUpPending;
+            ++total;
+            lock.unlock();
+
+            auto handler = create_handler();
+            if (handler) {
+                breaker.on_success();
+            } else {
+                breaker.on_failure();
+            }
+
+            lock.lock();
+            if (handler && !closed) {
+                idle.push_back(std::move(handler));
+                ++warmUpCreated;
+                available.notify_one();
+            } else {
+                --total;
+            }
+
+            // 数据库不可用时不再让其余连接各自等待建连超时，由保活线程退避重连
+            if (!handler && breaker.is_open()) {
+                warmUpPending = 0;
+            }
+            warmUpCv.notify_all();
+        }
+
+        if (--warmUpRunning == 0) {
+            warmUpPending = 0;
+        }
+        warmUpCv.notify_all();
+    }
+
+    DBLease DBConnectionPool::acquire()
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const auto deadline = start + std::chrono::milliseconds(options.acquireTimeoutMs);
+        ++acquireCount;
+
+        // 熔断期间直接失败，不再让每个请求各自等待建连超时
+        bool probe = false;
+        if (!breaker.allow(probe)) {
+            throw std::runtime_error("数据库暂不可用");
+        }
+
+        // 探测请求在每条出口上都要让熔断器得到结果：建连和校验会上报成功或失败，
+        // 其余出口（连接池关闭、等待超时）放弃本次探测，否则熔断器停在半开状态直到 maxBackoffMs 后
+        struct ProbeRelease {
+            CircuitBreaker& breaker;
+            bool pending;
+            ~ProbeRelease() {
+                if (pending) {
+                    breaker.release_probe();
+                }
+            }
+        } probeRelease {breaker, probe};
+
+        std::unique_lock<std::mutex> lock(poolMutex);
+        while (true) {
+            if (closed) {
+                throw std::runtime_error("数据库连接池已关闭");
+            }
+
+            if (!idle.empty()) {
+                // 后进先出：优先复用最近使用过的连接
+                auto handler = std::move(idle.back());
+                idle.pop_back();
+                ++leased;
+                peakLeased = std::max(peakLeased, leased);
+                lock.unlock();
+
+                // 探测必须真正访问一次数据库：即使关闭了借出校验也要校验，且不认最近活跃的连接
+                const bool validated = options.validateOnBorrow || probeRelease.pending;
+                const bool alive = !validated || validate(*handler, probeRelease.pending);
+                if (validated) {
+                    probeRelease.pending = false;
+                }
+                if (!alive) {
+                    ++discardedCount;
+                    lock.lock();
+                    --leased;
+                    --total;
+                    available.notify_one();
+
+                    // 数据库已判定不可用时不再逐个重连剩余的空闲连接
+                    if (breaker.is_open()) {
+                        throw std::runtime_error("数据库暂不可用");
+                    }
+                    continue;
+                }
+
+                record_wait(std::chrono::steady_clock::now() - start);
+                return DBLease(this, std::move(handler));
+            }
+
+            if (total < options.maxTotal) {
+                // 在锁外建立连接，避免握手期间阻塞其他借用者
+                ++total;
+                ++leased;
+                peakLeased = std::max(peakLeased, leased);
+                lock.unlock();
+
+                auto handler = create_handler();
+                probeRelease.pending = false;
+                if (!handler) {
+                    breaker.on_failure();
+                    lock.lock();
+                    --leased;
+                    --total;
+                    available.notify_one();
+                    throw std::runtime_error("无法建立数据库连接");
+                }
+                breaker.on_success();
+
+                record_wait(std::chrono::steady_clock::now() - start);
+                return DBLease(this, std::move(handler));
+            }
+
+            if (available.wait_until(lock, deadline) == std::cv_status::timeout &&
+                idle.empty() && total >= options.maxTotal) {
+                ++timeoutCount;
+                throw std::runtime_error("获取数据库连接超时");
+            }
+        }
+    }
+
+    void DBConnectionPool::release(std::unique_ptr<DatabaseHandler> handler)
+    {
+        // 不把未结束的事务带给下一个借用者
+        if (handler->in_transaction()) {
+            handler->rollback();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            --leased;
+            if (closed) {
+                --total;
+                return;
+            }
+            idle.push_back(std::move(handler));
+        }
+        available.notify_one();
+    }
+
+    void DBConnectionPool::close()
+    {
+        std::deque<std::unique_ptr<DatabaseHandler>> closing;
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            closed = true;
+            total -= static_cast<int>(idle.size());
+            closing.swap(idle);
+        }
+        available.notify_all();
+        warmUpCv.notify_all();
+        keepaliveCv.notify_all();
+
+        if (keepaliveThread.joinable()) {
+            keepaliveThread.join();
+        }
+
+        // 预热线程最多还在建立一个连接，建好后发现已关闭会自行丢弃
+        std::vector<std::thread> warmers;
+        {
+            std::lock_guard<std::mutex> warmUpLock(warmUpMutex);
+            warmers.swap(warmUpThreads);
+        }
+        for (auto& thread : warmers) {
+            thread.join();
+        }
+
+        // 在锁外关闭会话
+        closing.clear();
+    }
+
+    Json::Value DBConnectionPool::stats() const
+    {
+        Json::Value result;
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            result["idle"] = static_cast<int>(idle.size());
+            result["leased"] = leased;
+            result["total"] = total;
+            result["peak_leased"] = peakLeased;
+            result["utilization"] = static_cast<double>(leased) / options.maxTotal;
+            result["warming_up"] = warmUpRunning > 0;
+        }
+
+        uint64_t acquires = acquireCount;
+        result["min_idle"] = options.minIdle;
+        result["max_total"] = options.maxTotal;
+        result["acquire_count"] = static_cast<Json::UInt64>(acquires);
+        result["timeout_count"] = static_cast<Json::UInt64>(timeoutCount.load());
+        result["created_count"] = static_cast<Json::UInt64>(createdCount.load());
+        result["discarded_count"] = static_cast<Json::UInt64>(discardedCount.load());
+        result["keepalive_pings"] = static_cast<Json::UInt64>(pingCount.load());
+        result["breaker"] = breaker.stats();
+        result["avg_wait_us"] = acquires ? static_cast<double>(totalWaitMicros) / acquires : 0.0;
+        result["max_wait_us"] = static_cast<Json::UInt64>(maxWaitMicros.load());
+        return result;
+    }
+
+    std::unique_ptr<DatabaseHandler> DBConnectionPool::create_handler()
+    {
+        auto handler = std::make_unique<DatabaseHandler>(dbConfig);
+        if (!handler->is_connected()) {
+            return nullptr;
+        }
+
+        ++createdCount;
+        return handler;
+    }
+
+    bool DBConnectionPool::validate(DatabaseHandler& handler, bool force)
+    {
+        const auto window = std::chrono::milliseconds(force ? 0 : options.livenessWindowMs);
+        if (handler.check_alive(window)) {
+            breaker.on_success();
+            return true;
+        }
+
+        handler.reconnect();
+        if (handler.is_connected()) {
+            breaker.on_success();
+            return true;
+        }
+
+        breaker.on_failure();
+        return false;
+    }
+
+    void DBConnectionPool::record_wait(std::chrono::steady_clock::duration waited)
+    {
+        uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(waited).count();
+        totalWaitMicros += micros;
+
+        uint64_t currentMax = maxWaitMicros;
+        while (micros > currentMax && !maxWaitMicros.compare_exchange_weak(currentMax, micros)) {}
+    }
+
+    void DBConnectionPool::keepalive_loop()
+    {
+        // 熔断期间缩短检查间隔，退避到期后尽快由后台完成重连
+        const auto interval = std::chrono::seconds(options.keepaliveIntervalSec);
+        const auto recoveryInterval = std::chrono::milliseconds(options.breaker.baseBackoffMs);
+
+        std::unique_lock<std::mutex> lock(poolMutex);
+        while (!closed) {
+            keepaliveCv.wait_for(lock, breaker.is_open() ? recoveryInterval : interval, [this] { return closed; });
+            if (closed) {
+                return;
+            }
+
+            lock.unlock();
+            keepalive_once();
+            lock.lock();
+        }
+    }
+
+    void DBConnectionPool::keepalive_once()
+    {
+        const auto threshold = std::chrono::seconds(options.keepaliveIntervalSec);
+
+        if (breaker.is_open()) {
+            // 熔断中：退避到期时由后台建一个连接作为探测，请求线程继续快速失败
+            bool probe = false;
+            if (!breaker.allow(probe)) {
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(poolMutex);
+                if (closed || total >= options.maxTotal) {
+                    if (probe) {
+                        breaker.release_probe();
+                    }
+                    return;
+                }
+                ++total;
+            }
+
+            auto handler = create_handler();
+            if (handler) {
+                breaker.on_success();
+            } else {
+                breaker.on_failure();
+            }
+
+            std::lock_guard<std::mutex> lock(poolMutex);
+            if (!handler || closed) {
+                --total;
+                return;
+            }
+
+            idle.push_back(std::move(handler));
+            available.notify_one();
+            return;
+        }
+
+        // 取出空闲过久的连接在锁外探测，期间按借出计数，total 不变
+        std::vector<std::unique_ptr<DatabaseHandler>> stale;
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            for (auto it = idle.begin(); it != idle.end();) {
+                if ((*it)->idle_time() >= threshold) {
+                    stale.push_back(std::move(*it));
+                    it = idle.erase(it);
+                    ++leased;
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        int dropped = 0;
+        for (auto& handler : stale) {
+            ++pingCount;
+            if (!handler->check_alive(std::chrono::milliseconds(0))) {
+                handler->reconnect();
+                if (!handler->is_connected()) {
+                    breaker.on_failure();
+                    handler.reset();
+                    ++discardedCount;
+                    ++dropped;
+                    continue;
+                }
+            }
+            breaker.on_success();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            leased -= static_cast<int>(stale.size());
+            total -= dropped;
+            for (auto& handler : stale) {
+                if (handler && !closed) {
+                    idle.push_back(std::move(handler));
+                } else if (handler) {
+                    --total;
+                }
+            }
+        }
+        available.notify_all();
+
+        // 连接被丢弃后补足 minIdle
+        if (dropped > 0 && !breaker.is_open()) {
+            warm_up();
+        }
+    }
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+#include "common.h"
+#include "db_handler.h"
+#include "circuit_breaker.h"
+
+namespace TakeAwayPlatform
+{
+    class DBConnectionPool;
+
+    // 连接池参数（config.json 中 database 节）
+    struct DBPoolOptions {
+        int minIdle = 2;                // 预热及常驻的最少连接数
+        int maxTotal = 10;              // 已借出 + 空闲的连接总数上限
+        int acquireTimeoutMs = 3000;    // 连接耗尽时借用的最长等待
+        bool validateOnBorrow = true;   // 借出前检查连接是否可用
+        int livenessWindowMs = 5000;    // 该时长内用过的连接借出时不再探测
+        int keepaliveIntervalSec = 30;  // 空闲超过该时长的连接由后台线程探测，<= 0 关闭
+        int warmUpConcurrency = 8;      // 预热时同时建立的连接数
+        CircuitBreakerOptions breaker;
+    };
+
+    // 连接租约：离开作用域时自动把连接归还连接池
+    class DBLease
+    {
+    public:
+        DBLease() = default;
+        DBLease(DBLease&& other) noexcept;
+        DBLease& operator=(DBLease&& other) noexcept;
+        DBLease(const DBLease&) = delete;
+        DBLease& operator=(const DBLease&) = delete;
+        ~DBLease();
+
+        DatabaseHandler* operator->() const { return handler.get(); }
+        DatabaseHandler& operator*() const { return *handler; }
+        explicit operator bool() const { return static_cast<bool>(handler); }
+
+        // 提前归还连接
+        void release();
+
+    private:
+        friend class DBConnectionPool;
+        DBLease(DBConnectionPool* pool, std::unique_ptr<DatabaseHandler> handler);
+
+        DBConnectionPool* pool = nullptr;
+        std::unique_ptr<DatabaseHandler> handler;
+    };
+
+    class DBConnectionPool
+    {
+    public:
+        DBConnectionPool(const DBConfig& config, const DBPoolOptions& options);
+        ~DBConnectionPool();
+
+        // 以 warmUpConcurrency 个线程并行建立 minIdle 个连接并启动保活线程。
+        // ready 个连接建好（或全部尝试结束）即返回，其余在后台继续建立；ready < 0 时等待全部完成
+        void warm_up(int ready = -1);
+
+        // 预热的所有连接都已尝试建立（成功或失败）
+        bool warm_up_done() const;
+
+        // 预热已结束且连接数达到配置的 minIdle（热重启时据此决定能否接管）
+        bool warm_up_reached() const;
+
+        // 借用连接；池已耗尽时最多等待 acquireTimeoutMs，超时、无法建立连接或熔断中
+        // 抛出 std::runtime_error
+        DBLease acquire();
+
+        // 停止保活线程，关闭空闲连接，之后归还的连接直接销毁
+        void close();
+
+        // 等待时间与利用率统计
+        Json::Value stats() const;
+
+    private:
+        friend class DBLease;
+        void release(std::unique_ptr<DatabaseHandler> handler);
+
+        std::unique_ptr<DatabaseHandler> create_handler();
+
+        // 借出前校验（或重连），结果计入熔断器；force 时不认 livenessWindowMs 内的活跃记录，一定探测一次
+        bool validate(DatabaseHandler& handler, bool force);
+
+        // 预热线程：逐个领取待建连接，数据库熔断后放弃剩余的
+        void warm_up_worker();
+
+        void record_wait(std::chrono::steady_clock::duration waited);
+
+        // 保活：探测空闲过久的连接；熔断期间由这里做退避重连，恢复后补足 minIdle
+        void keepalive_loop();
+        void keepalive_once();
+
+    private:
+        DBConfig dbConfig;
+        DBPoolOptions options;
+
+        mutable std::mutex poolMutex;
+        std::condition_variable available;
+        std::deque<std::unique_ptr<DatabaseHandler>> idle;
+        int total = 0;          // 空闲 + 已借出
+        int leased = 0;
+        int peakLeased = 0;
+        bool closed = false;
+
+        CircuitBreaker breaker;
+
+        std::mutex warmUpMutex;             // 串行化 warm_up 调用
+        std::condition_variable warmUpCv;
+        std::vector<std::thread> warmUpThreads;
+        int warmUpPending = 0;              // 尚未领取的预热连接数
+        int warmUpRunning = 0;              // 仍在运行的预热线程数
+        int warmUpCreated = 0;              // 本轮预热已建好的连接数
+
+        std::condition_variable keepaliveCv;
+        std::thread keepaliveThread;
+
+        // 统计
+        std::atomic<uint64_t> acquireCount {0};
+        std::atomic<uint64_t> timeoutCount {0};
+        std::atomic<uint64_t> createdCount {0};
+        std::atomic<uint64_t> discardedCount {0};
+        std::atomic<uint64_t> pingCount {0};
+        std::atomic<uint64_t> totalWaitMicros {0};
+        std::atomic<uint64_t> maxWaitMicros {0};
+    };
+
+}
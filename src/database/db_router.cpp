@@ -0,0 +1,234 @@
+#include <iostream>
+#include <stdexcept>
+
+#include "db_router.h"
+
+
+namespace TakeAwayPlatform
+{
+    DBRouter::DBRouter(const DBConfig& primary, const std::vector<DBConfig>& replicas,
+                       const DBPoolOptions& poolOptions, const DBRouterOptions& options)
+        : options(options), primary(std::make_unique<DBConnectionPool>(primary, poolOptions))
+    {
+        for (const auto& config : replicas) {
+            auto replica = std::make_unique<Replica>();
+            replica->config = config;
+            replica->pool = std::make_unique<DBConnectionPool>(config, poolOptions);
+            this->replicas.push_back(std::move(replica));
+        }
+    }
+
+    DBRouter::~DBRouter()
+    {
+        close();
+    }
+
+    void DBRouter::warm_up(int ready)
+    {
+        primary->warm_up(ready);
+
+        for (auto& replica : replicas) {
+            replica->pool->warm_up(ready);
+            probe_lag(*replica);
+        }
+
+        if (!replicas.empty()) {
+            lagThread = std::thread([this] { lag_loop(); });
+        }
+    }
+
+    bool DBRouter::warm_up_done() const
+    {
+        if (!primary->warm_up_done()) {
+            return false;
+        }
+
+        for (const auto& replica : replicas) {
+            if (!replica->pool->warm_up_done()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool DBRouter::warm_up_reached() const
+    {
+        if (!primary->warm_up_reached()) {
+            return false;
+        }
+
+        for (const auto& replica : replicas) {
+            if (!replica->pool->warm_up_reached()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    DBLease DBRouter::acquire_write(int64_t user_id)
+    {
+        if (user_id != 0) {
+            pin(user_id);
+        }
+        return primary->acquire();
+    }
+
+    DBLease DBRouter::acquire_read(int64_t user_id)
+    {
+        if (user_id != 0 && is_pinned(user_id)) {
+            ++pinnedReads;
+            return primary->acquire();
+        }
+
+        // 从下一个从库开始轮询，跳过延迟超限或借不到连接的从库
+        const size_t count = replicas.size();
+        const size_t start = count ? nextReplica++ % count : 0;
+        for (size_t offset = 0; offset < count; ++offset) {
+            Replica& replica = *replicas[(start + offset) % count];
+
+            int64_t lag = replica.lagSec;
+            if (lag < 0 || lag > options.maxReplicaLagSec) {
+                continue;
+            }
+
+            try {
+                DBLease lease = replica.pool->acquire();
+                ++replica.reads;
+                ++replicaReads;
+                return lease;
+            } catch (const std::exception& e) {
+                std::cerr << "Replica " << replica.config.host << ":" << replica.config.port
+                          << " unavailable for read: " << e.what() << std::endl;
+            }
+        }
+
+        ++primaryReads;
+        return primary->acquire();
+    }
+
+    void DBRouter::close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(lagMutex);
+            if (closed) {
+                return;
+            }
+            closed = true;
+        }
+        lagCv.notify_all();
+
+        if (lagThread.joinable()) {
+            lagThread.join();
+        }
+
+        for (auto& replica : replicas) {
+            replica->pool->close();
+        }
+        primary->close();
+    }
+
+    Json::Value DBRouter::stats() const
+    {
+        Json::Value result = primary->stats();
+
+        Json::Value replicaStats(Json::arrayValue);
+        for (const auto& replica : replicas) {
+            Json::Value item = replica->pool->stats();
+            item["host"] = replica->config.host;
+            item["port"] = replica->config.port;
+            item["lag_sec"] = static_cast<Json::Int64>(replica->lagSec.load());
+            item["reads"] = static_cast<Json::UInt64>(replica->reads.load());
+            replicaStats.append(item);
+        }
+
+        result["replicas"] = replicaStats;
+        result["max_replica_lag_sec"] = options.maxReplicaLagSec;
+        result["read_pin_sec"] = options.readPinSec;
+        result["reads_primary"] = static_cast<Json::UInt64>(primaryReads.load());
+        result["reads_pinned"] = static_cast<Json::UInt64>(pinnedReads.load());
+        result["reads_replica"] = static_cast<Json::UInt64>(replicaReads.load());
+        return result;
+    }
+
+    bool DBRouter::is_pinned(int64_t user_id)
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+
+        auto it = pinnedUntil.find(user_id);
+        if (it == pinnedUntil.end()) {
+            return false;
+        }
+
+        if (std::chrono::steady_clock::now() >= it->second) {
+            pinnedUntil.erase(it);
+            return false;
+        }
+        return true;
+    }
+
+    void DBRouter::pin(int64_t user_id)
+    {
+        if (replicas.empty() || options.readPinSec <= 0) {
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+
+        std::lock_guard<std::mutex> lock(pinMutex);
+
+        // 顺带清理已过期的条目，避免表无限增长
+        if (pinnedUntil.size() >= PIN_PURGE_THRESHOLD) {
+            for (auto it = pinnedUntil.begin(); it != pinnedUntil.end();) {
+                it = now >= it->second ? pinnedUntil.erase(it) : std::next(it);
+            }
+        }
+
+        pinnedUntil[user_id] = now + std::chrono::seconds(options.readPinSec);
+    }
+
+    void DBRouter::lag_loop()
+    {
+        std::unique_lock<std::mutex> lock(lagMutex);
+        while (!lagCv.wait_for(lock, std::chrono::seconds(options.lagCheckIntervalSec), [this] { return closed; })) {
+            lock.unlock();
+            for (auto& replica : replicas) {
+                probe_lag(*replica);
+            }
+            lock.lock();
+        }
+    }
+
+    void DBRouter::probe_lag(Replica& replica)
+    {
+        int64_t lag = -1;
+
+        try {
+            DBLease lease = replica.pool->acquire();
+
+            // MySQL 8.0.22 起为 REPLICA/Source，旧版本为 SLAVE/Master
+            Json::Value status = lease->query("SHOW REPLICA STATUS");
+            const char* column = "Seconds_Behind_Source";
+            if (!status.isArray()) {
+                status = lease->query("SHOW SLAVE STATUS");
+                column = "Seconds_Behind_Master";
+            }
+
+            // 未配置复制或复制线程停止（延迟为 NULL）都视为不可用
+            if (status.isArray() && !status.empty() && status[0][column].isIntegral()) {
+                lag = status[0][column].asInt64();
+            }
+        } catch (const std::exception&) {
+            // 借不到连接同样视为不可用
+        }
+
+        auto usable = [this](int64_t value) { return value >= 0 && value <= options.maxReplicaLagSec; };
+
+        int64_t previous = replica.lagSec.exchange(lag);
+        if (usable(previous) != usable(lag)) {
+            std::cout << "Replica " << replica.config.host << ":" << replica.config.port
+                      << " lag changed: " << previous << "s -> " << lag << "s" << std::endl;
+            std::cout.flush();
+        }
+    }
+
+}
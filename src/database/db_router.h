@@ -0,0 +1,91 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "common.h"
+#include "db_pool.h"
+
+namespace TakeAwayPlatform
+{
+    // 读写分离参数（config.json 中 database 节）
+    struct DBRouterOptions {
+        int maxReplicaLagSec = 5;       // 延迟超过该值的从库不再接收读请求
+        int readPinSec = 5;             // 用户写入后该时长内的读请求固定走主库（仅在单进程模式下成立，见 pinnedUntil）
+        int lagCheckIntervalSec = 2;    // 从库延迟探测间隔
+    };
+
+    // 读写分离路由：写请求走主库，只读请求轮询延迟达标的从库。
+    // 主库和每个从库各有一个连接池；没有可用从库时读请求回落到主库
+    class DBRouter
+    {
+    public:
+        DBRouter(const DBConfig& primary, const std::vector<DBConfig>& replicas,
+                 const DBPoolOptions& poolOptions, const DBRouterOptions& options);
+        ~DBRouter();
+
+        // 预热各连接池（每个池建好 ready 个连接即返回，见 DBConnectionPool::warm_up），
+        // 探测一次从库延迟并启动后台探测线程
+        void warm_up(int ready = -1);
+
+        // 所有连接池的预热都已结束
+        bool warm_up_done() const;
+
+        // 所有连接池的预热都已结束且达到 minIdle
+        bool warm_up_reached() const;
+
+        // 借用主库连接；user_id 非 0 时该用户在 readPinSec 内的读请求固定走主库，
+        // 保证读到自己的写入
+        DBLease acquire_write(int64_t user_id = 0);
+
+        // 借用只读连接，user_id 处于写后固定期时返回主库连接
+        DBLease acquire_read(int64_t user_id = 0);
+
+        // 停止延迟探测并关闭所有连接池
+        void close();
+
+        // 各连接池统计、从库延迟和读路由计数
+        Json::Value stats() const;
+
+    private:
+        struct Replica {
+            DBConfig config;
+            std::unique_ptr<DBConnectionPool> pool;
+            std::atomic<int64_t> lagSec {-1};   // -1 表示未复制、复制中断或无法连接
+            std::atomic<uint64_t> reads {0};
+        };
+
+        bool is_pinned(int64_t user_id);
+        void pin(int64_t user_id);
+
+        void lag_loop();
+        void probe_lag(Replica& replica);
+
+    private:
+        static constexpr size_t PIN_PURGE_THRESHOLD = 4096;
+
+        DBRouterOptions options;
+        std::unique_ptr<DBConnectionPool> primary;
+        std::vector<std::unique_ptr<Replica>> replicas;
+        std::atomic<size_t> nextReplica {0};
+
+        // 写后固定：user_id -> 固定截止时间。表在进程内，prefork 模式下只对写入所在的 worker 生效，
+        // 同一用户的后续读请求落到其他 worker 时仍可能读到从库上的旧数据
+        std::mutex pinMutex;
+        std::unordered_map<int64_t, std::chrono::steady_clock::time_point> pinnedUntil;
+
+        std::mutex lagMutex;
+        std::condition_variable lagCv;
+        bool closed = false;
+        std::thread lagThread;
+
+        std::atomic<uint64_t> primaryReads {0};
+        std::atomic<uint64_t> pinnedReads {0};
+        std::atomic<uint64_t> replicaReads {0};
+    };
+
+}
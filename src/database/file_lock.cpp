@@ -0,0 +1,44 @@
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+#include "file_lock.h"
+
+
+namespace TakeAwayPlatform
+{
+    FileLock::FileLock(const std::string& path)
+    {
+        const std::string lockPath = path + ".lock";
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(lockPath).parent_path(), error);
+
+        fd = ::open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::cerr << "Cannot open lock file " << lockPath << ": " << std::strerror(errno) << std::endl;
+            return;
+        }
+
+        while (::flock(fd, LOCK_EX) != 0) {
+            if (errno != EINTR) {
+                std::cerr << "Cannot lock " << lockPath << ": " << std::strerror(errno) << std::endl;
+                ::close(fd);
+                fd = -1;
+                return;
+            }
+        }
+    }
+
+    FileLock::~FileLock()
+    {
+        // 关闭描述符即释放 flock
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+namespace TakeAwayPlatform
+{
+    // 对 "<path>.lock" 加 flock 排他锁，析构时释放。
+    // prefork 的 worker 共用同一个溢出文件：追加与回放（读取、写库、删除或改写）都在锁内进行，
+    // 两个进程不会重复回放同一批记录，回放也不会丢掉其他进程在读取之后追加的行。
+    // 锁文件不删除，删除与加锁之间存在竞争
+    class FileLock
+    {
+    public:
+        // 阻塞直到获得锁
+        explicit FileLock(const std::string& path);
+        ~FileLock();
+
+        FileLock(const FileLock&) = delete;
+        FileLock& operator=(const FileLock&) = delete;
+
+        // 锁文件无法打开时为 false，调用方照常读写，只失去跨进程互斥
+        bool locked() const { return fd >= 0; }
+
+    private:
+        int fd = -1;
+    };
+
+}
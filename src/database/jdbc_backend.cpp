@@ -0,0 +1,218 @@
+#ifdef TAKEAWAY_WITH_JDBC
+
+#include <cctype>
+#include <stdexcept>
+#include <cppconn/datatype.h>
+#include <cppconn/exception.h>
+#include <cppconn/resultset.h>
+#include <cppconn/resultset_metadata.h>
+
+#include "jdbc_backend.h"
+
+
+namespace TakeAwayPlatform
+{
+    namespace
+    {
+        bool is_insert(const std::string& sql)
+        {
+            size_t index = 0;
+            while (index < sql.size() && std::isspace(static_cast<unsigned char>(sql[index]))) {
+                ++index;
+            }
+
+            static const char keyword[] = "INSERT";
+            for (size_t position = 0; position < sizeof(keyword) - 1; ++position, ++index) {
+                if (index >= sql.size() || std::toupper(static_cast<unsigned char>(sql[index])) != keyword[position]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool is_integer(int type)
+        {
+            return type == sql::DataType::BIT || type == sql::DataType::TINYINT || type == sql::DataType::SMALLINT ||
+                   type == sql::DataType::MEDIUMINT || type == sql::DataType::INTEGER || type == sql::DataType::BIGINT ||
+                   type == sql::DataType::YEAR;
+        }
+    }
+
+    JdbcBackend::JdbcBackend(const DBConfig& config)
+    {
+        try
+        {
+            sql::mysql::MySQL_Driver* driver = sql::mysql::get_mysql_driver_instance();
+            connection.reset(driver->connect("tcp://" + config.host + ":" + std::to_string(config.classicPort),
+                                             config.user, config.password));
+            connection->setSchema(config.database);
+        }
+        catch (const sql::SQLException& e)
+        {
+            throw std::runtime_error(config.host + ":" + std::to_string(config.classicPort) + ": " + e.what());
+        }
+    }
+
+    JdbcBackend::~JdbcBackend()
+    {
+        // 语句依附于连接，先于连接释放
+        statements.clear();
+        if (connection) {
+            try {
+                connection->close();
+            } catch (const sql::SQLException&) {
+            }
+        }
+    }
+
+    sql::PreparedStatement& JdbcBackend::prepare(const std::string& sql, const SqlParams& params)
+    {
+        auto it = statements.find(sql);
+        if (it == statements.end()) {
+            if (statements.size() >= STATEMENT_CACHE_CAPACITY) {
+                statements.clear();
+            }
+
+            std::unique_ptr<sql::PreparedStatement> statement(connection->prepareStatement(sql));
+            it = statements.emplace(sql, std::move(statement)).first;
+        }
+
+        sql::PreparedStatement& statement = *it->second;
+        statement.clearParameters();
+        for (size_t index = 0; index < params.size(); ++index) {
+            const mysqlx::Value& value = params[index];
+            const unsigned position = static_cast<unsigned>(index + 1);
+            switch (value.getType()) {
+                case mysqlx::Value::VNULL:
+                    statement.setNull(position, sql::DataType::SQLNULL);
+                    break;
+                case mysqlx::Value::INT64:
+                    statement.setInt64(position, value.get<int64_t>());
+                    break;
+                case mysqlx::Value::UINT64:
+                    statement.setUInt64(position, value.get<uint64_t>());
+                    break;
+                case mysqlx::Value::BOOL:
+                    statement.setBoolean(position, value.get<bool>());
+                    break;
+                case mysqlx::Value::FLOAT:
+                case mysqlx::Value::DOUBLE:
+                    statement.setDouble(position, value.get<double>());
+                    break;
+                case mysqlx::Value::STRING:
+                    statement.setString(position, value.get<std::string>());
+                    break;
+                default:
+                    throw std::invalid_argument("Unsupported parameter type");
+            }
+        }
+        return statement;
+    }
+
+    bool JdbcBackend::execute(const std::string& sql, const SqlParams& params,
+                              StorageResult& result, std::string& error)
+    {
+        try
+        {
+            sql::PreparedStatement& statement = prepare(sql, params);
+            if (!statement.execute()) {
+                result.affectedRows = statement.getUpdateCount();
+
+                // 经典协议的预处理语句不返回自增值，只有 INSERT 需要多一次往返
+                if (result.affectedRows > 0 && is_insert(sql)) {
+                    StorageResult id;
+                    if (execute("SELECT LAST_INSERT_ID()", {}, id, error) && !id.rows.empty()) {
+                        result.lastInsertId = static_cast<uint64_t>(id.rows[0][0].get<int64_t>());
+                    }
+                }
+                return true;
+            }
+
+            std::unique_ptr<sql::ResultSet> rows(statement.getResultSet());
+            sql::ResultSetMetaData* meta = rows->getMetaData();
+
+            const unsigned count = meta->getColumnCount();
+            std::vector<int> types(count);
+            for (unsigned index = 0; index < count; ++index) {
+                result.columns.emplace_back(meta->getColumnLabel(index + 1));
+                types[index] = meta->getColumnType(index + 1);
+            }
+
+            while (rows->next()) {
+                mysqlx::Row row;
+                for (unsigned index = 0; index < count; ++index) {
+                    const unsigned column = index + 1;
+                    if (rows->isNull(column)) {
+                        row.set(index, mysqlx::Value());
+                    } else if (is_integer(types[index])) {
+                        row.set(index, mysqlx::Value(static_cast<int64_t>(rows->getInt64(column))));
+                    } else if (types[index] == sql::DataType::DOUBLE || types[index] == sql::DataType::REAL) {
+                        row.set(index, mysqlx::Value(static_cast<double>(rows->getDouble(column))));
+                    } else {
+                        row.set(index, std::string(rows->getString(column)));
+                    }
+                }
+                result.rows.push_back(std::move(row));
+            }
+            return true;
+        }
+        catch (const sql::SQLException& e)
+        {
+            error = e.what();
+            statements.erase(sql);
+            return false;
+        }
+        catch (const std::invalid_argument& e)
+        {
+            error = e.what();
+            return false;
+        }
+    }
+
+    bool JdbcBackend::begin(std::string& error)
+    {
+        try {
+            connection->setAutoCommit(false);
+            return true;
+        } catch (const sql::SQLException& e) {
+            error = e.what();
+            return false;
+        }
+    }
+
+    bool JdbcBackend::commit(std::string& error)
+    {
+        try {
+            connection->commit();
+            connection->setAutoCommit(true);
+            return true;
+        } catch (const sql::SQLException& e) {
+            error = e.what();
+            return false;
+        }
+    }
+
+    bool JdbcBackend::rollback(std::string& error)
+    {
+        try {
+            connection->rollback();
+            connection->setAutoCommit(true);
+            return true;
+        } catch (const sql::SQLException& e) {
+            error = e.what();
+            return false;
+        }
+    }
+
+    bool JdbcBackend::ping()
+    {
+        try {
+            return connection && connection->isValid();
+        } catch (const sql::SQLException&) {
+            return false;
+        }
+    }
+
+}
+
+#endif
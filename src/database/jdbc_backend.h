@@ -0,0 +1,49 @@
+#pragma once
+
+#ifdef TAKEAWAY_WITH_JDBC
+
+#include <unordered_map>
+#include <mysql_driver.h>
+#include <cppconn/connection.h>
+#include <cppconn/prepared_statement.h>
+
+#include "storage_backend.h"
+
+namespace TakeAwayPlatform
+{
+    // MySQL 经典协议后端（Connector/C++ 的 JDBC 风格接口，默认端口 3306）。
+    // 语句按 SQL 模板缓存为服务端预处理语句，与 X 协议路径的 PreparedStatement 缓存对应；
+    // 结果整体读入后交给 DatabaseHandler，DECIMAL 与 DATETIME 以服务端文本输出，格式与 X 协议路径一致
+    class JdbcBackend : public StorageBackend
+    {
+    public:
+        // 连接失败抛出 std::runtime_error
+        explicit JdbcBackend(const DBConfig& config);
+        ~JdbcBackend() override;
+
+        const char* name() const override { return "mysql_classic"; }
+
+        bool execute(const std::string& sql, const SqlParams& params,
+                     StorageResult& result, std::string& error) override;
+
+        bool begin(std::string& error) override;
+        bool commit(std::string& error) override;
+        bool rollback(std::string& error) override;
+
+        bool ping() override;
+
+    private:
+        // 取出（或创建并缓存）模板对应的语句，并绑定本次参数
+        sql::PreparedStatement& prepare(const std::string& sql, const SqlParams& params);
+
+    private:
+        // 模板数量有限，超出容量说明调用方拼接了变量，整体丢弃即可
+        static constexpr size_t STATEMENT_CACHE_CAPACITY = 64;
+
+        std::unique_ptr<sql::Connection> connection;
+        std::unordered_map<std::string, std::unique_ptr<sql::PreparedStatement>> statements;
+    };
+
+}
+
+#endif
@@ -0,0 +1,287 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <filesystem>
+
+#include "log_appender.h"
+#include "file_lock.h"
+
+
+namespace TakeAwayPlatform
+{
+    LogAppender::LogAppender(const DBConfig& config, const LogAppenderOptions& options)
+        : options(options), handler(config)
+    {
+        if (this->options.batchRows < 1) {
+            this->options.batchRows = 1;
+        }
+
+        std::error_code error;
+        hasSpill = std::filesystem::exists(this->options.spillPath, error);
+
+        flushThread = std::thread([this] { flush_loop(); });
+    }
+
+    LogAppender::~LogAppender()
+    {
+        stop();
+    }
+
+    void LogAppender::append(int64_t userId, const std::string& action, const std::string& status)
+    {
+        LogRecord record {userId, action, status, std::time(nullptr)};
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (!stopped && pending.size() < options.maxQueued) {
+                pending.push_back(std::move(record));
+                if (pending.size() >= options.batchRows) {
+                    queueCv.notify_one();
+                }
+                return;
+            }
+        }
+
+        // 队列已满或已停止：不阻塞请求，也不丢弃记录
+        spill({record});
+    }
+
+    void LogAppender::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (stopped) {
+                return;
+            }
+            stopped = true;
+        }
+        queueCv.notify_all();
+
+        if (flushThread.joinable()) {
+            flushThread.join();
+        }
+    }
+
+    Json::Value LogAppender::stats() const
+    {
+        Json::Value result;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            result["queued"] = static_cast<Json::UInt64>(pending.size());
+        }
+        result["written"] = static_cast<Json::UInt64>(written.load());
+        result["spilled"] = static_cast<Json::UInt64>(spilled.load());
+        result["replayed"] = static_cast<Json::UInt64>(replayed.load());
+        result["rejected"] = static_cast<Json::UInt64>(rejected.load());
+        result["failed_flushes"] = static_cast<Json::UInt64>(failedFlushes.load());
+        result["spill_pending"] = hasSpill.load();
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            result["last_error"] = lastError;
+        }
+        return result;
+    }
+
+    void LogAppender::record_error(const std::string& error)
+    {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        lastError = error;
+    }
+
+    std::string LogAppender::rejected_path() const
+    {
+        return options.spillPath + ".rejected";
+    }
+
+    void LogAppender::flush_loop()
+    {
+        const auto interval = std::chrono::milliseconds(options.flushIntervalMs);
+
+        while (true) {
+            std::vector<LogRecord> batch;
+            bool finished = false;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCv.wait_for(lock, interval, [this] {
+                    return stopped || pending.size() >= options.batchRows;
+                });
+
+                // 停止后一次取出全部剩余记录
+                const size_t count = stopped ? pending.size() : std::min(pending.size(), options.batchRows);
+                batch.assign(std::make_move_iterator(pending.begin()),
+                             std::make_move_iterator(pending.begin() + count));
+                pending.erase(pending.begin(), pending.begin() + count);
+                finished = stopped;
+            }
+
+            // 溢出文件中的记录更早，先回放以保持大致的时间顺序
+            if (hasSpill && available()) {
+                replay_spill();
+            }
+
+            if (!batch.empty()) {
+                const size_t done = available() ? write_batch(batch) : 0;
+                if (done < batch.size()) {
+                    spill(std::vector<LogRecord>(batch.begin() + done, batch.end()));
+                }
+            }
+
+            if (finished) {
+                return;
+            }
+        }
+    }
+
+    bool LogAppender::available() const
+    {
+        return std::chrono::steady_clock::now() >= retryAt;
+    }
+
+    size_t LogAppender::write_batch(const std::vector<LogRecord>& records)
+    {
+        size_t done = 0;
+        while (done < records.size()) {
+            const size_t count = std::min(options.batchRows, records.size() - done);
+
+            std::string sql = "INSERT INTO log_records (user_id, action_type, status, created_at) VALUES ";
+            SqlParams params;
+            params.reserve(count * 4);
+            for (size_t index = 0; index < count; ++index) {
+                const LogRecord& record = records[done + index];
+                sql += index ? ", (?, ?, ?, FROM_UNIXTIME(?))" : "(?, ?, ?, FROM_UNIXTIME(?))";
+                params.emplace_back(record.userId);
+                params.emplace_back(record.action);
+                params.emplace_back(record.status);
+                params.emplace_back(static_cast<int64_t>(record.createdAt));
+            }
+
+            if (handler.execute(sql, params) >= 0) {
+                written += count;
+                done += count;
+                continue;
+            }
+
+            ++failedFlushes;
+            record_error(handler.last_error());
+
+            // 连接正常说明是数据本身被拒绝（约束冲突、表结构不符等），重试无济于事：
+            // 该段移入 rejectedPath 留待排查，不再回放，也不阻塞后面的记录
+            if (handler.is_connected()) {
+                std::cerr << "Log appender: database rejected " << count << " records, moved to "
+                          << rejected_path() << ": " << handler.last_error() << std::endl;
+                reject(std::vector<LogRecord>(records.begin() + done, records.begin() + done + count));
+                done += count;
+                continue;
+            }
+
+            // 数据库不可用：重连失败时在 RETRY_INTERVAL_SEC 内不再尝试，新记录直接溢出
+            std::cerr << "Log appender: database unavailable, " << records.size() - done
+                      << " records go to the spill file: " << handler.last_error() << std::endl;
+            handler.reconnect();
+            if (!handler.is_connected()) {
+                retryAt = std::chrono::steady_clock::now() + std::chrono::seconds(RETRY_INTERVAL_SEC);
+            }
+            break;
+        }
+        return done;
+    }
+
+    void LogAppender::write_lines(std::ostream& out, std::vector<LogRecord>::const_iterator first,
+                                  std::vector<LogRecord>::const_iterator last)
+    {
+        // 每行一条记录：created_at \t user_id \t action \t status
+        for (; first != last; ++first) {
+            out << first->createdAt << '\t' << first->userId << '\t'
+                << first->action << '\t' << first->status << '\n';
+        }
+    }
+
+    void LogAppender::spill(const std::vector<LogRecord>& records)
+    {
+        std::lock_guard<std::mutex> lock(spillMutex);
+
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(options.spillPath).parent_path(), error);
+
+        // prefork 的 worker 共用溢出文件，追加与其他进程的回放互斥
+        FileLock fileLock(options.spillPath);
+        std::ofstream file(options.spillPath, std::ios::app);
+        write_lines(file, records.begin(), records.end());
+        file.flush();
+
+        if (!file) {
+            std::cerr << "Log appender: failed to spill " << records.size()
+                      << " records to " << options.spillPath << std::endl;
+            return;
+        }
+
+        spilled += records.size();
+        hasSpill = true;
+    }
+
+    void LogAppender::reject(const std::vector<LogRecord>& records)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(options.spillPath).parent_path(), error);
+
+        FileLock fileLock(rejected_path());
+        std::ofstream file(rejected_path(), std::ios::app);
+        write_lines(file, records.begin(), records.end());
+        file.flush();
+
+        if (!file) {
+            std::cerr << "Log appender: failed to keep " << records.size()
+                      << " rejected records in " << rejected_path() << ", dropped" << std::endl;
+        }
+        rejected += records.size();
+    }
+
+    void LogAppender::replay_spill()
+    {
+        std::lock_guard<std::mutex> lock(spillMutex);
+
+        // 读取、写库到删除或改写在文件锁内完成：其他 worker 不会重复回放同一批记录，
+        // 也不会在读取之后追加而被删除或被改写覆盖
+        FileLock fileLock(options.spillPath);
+
+        // 每轮最多读入 maxQueued 行，溢出文件再大也不会整体载入内存
+        std::ifstream file(options.spillPath);
+        std::vector<LogRecord> records;
+        std::string line;
+        while (records.size() < options.maxQueued && std::getline(file, line)) {
+            std::istringstream fields(line);
+            LogRecord record;
+            if (fields >> record.createdAt >> record.userId >> record.action >> record.status) {
+                records.push_back(std::move(record));
+            }
+        }
+
+        const size_t done = write_batch(records);
+        replayed += done;
+
+        const bool rest = file.peek() != std::ifstream::traits_type::eof();
+        if (done == records.size() && !rest) {
+            file.close();
+            std::remove(options.spillPath.c_str());
+            hasSpill = false;
+            return;
+        }
+
+        // 已写入的部分不再重放：未写入的记录和文件剩余部分写回溢出文件
+        if (done > 0) {
+            const std::string tmpPath = options.spillPath + ".tmp";
+            std::ofstream tmp(tmpPath, std::ios::trunc);
+            write_lines(tmp, records.begin() + done, records.end());
+            if (rest) {
+                tmp << file.rdbuf();
+            }
+            tmp.close();
+            file.close();
+            if (tmp) {
+                std::rename(tmpPath.c_str(), options.spillPath.c_str());
+            }
+        }
+    }
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <ctime>
+#include <chrono>
+#include <ostream>
+#include <vector>
+#include <condition_variable>
+
+#include "common.h"
+#include "db_handler.h"
+
+namespace TakeAwayPlatform
+{
+    // 后写日志参数（config.json 中 database 节的 log_* 项）
+    struct LogAppenderOptions {
+        int flushIntervalMs = 200;      // 最长攒批时间
+        size_t batchRows = 100;         // 攒够该行数立即刷新
+        size_t maxQueued = 10000;       // 内存中最多排队的行数，超出部分直接写入溢出文件
+        std::string spillPath = "/opt/TakeAwayPlatform/log/log_records.spill";
+    };
+
+    // 一条 log_records 记录，created_at 为事件发生时间而非落库时间
+    struct LogRecord {
+        int64_t userId;
+        std::string action;
+        std::string status;
+        std::time_t createdAt;
+    };
+
+    // log_records 的后写追加器：请求线程只把记录放入内存队列，
+    // 后台线程每 flushIntervalMs 或攒够 batchRows 行用一条多行 INSERT 写入。
+    // 数据库不可用时整批追加到溢出文件，恢复后先回放溢出文件再写新记录。
+    // prefork 的 worker 共用同一个溢出文件，追加和回放在文件锁（FileLock）内进行；
+    // stop() 刷新全部排队记录，应在排空阶段、关闭连接池之前调用
+    class LogAppender
+    {
+    public:
+        LogAppender(const DBConfig& config, const LogAppenderOptions& options);
+        ~LogAppender();
+
+        LogAppender(const LogAppender&) = delete;
+        LogAppender& operator=(const LogAppender&) = delete;
+
+        // 不等待落库；已停止时同步写入溢出文件
+        void append(int64_t userId, const std::string& action, const std::string& status);
+
+        // 停止后台线程并刷新剩余记录，写库失败的记录进入溢出文件
+        void stop();
+
+        // 排队、已写入、溢出、回放和被拒绝的行数，写库失败次数和最近一次错误
+        Json::Value stats() const;
+
+    private:
+        void flush_loop();
+
+        // 上次连接失败后的重试间隔已过
+        bool available() const;
+
+        // 按 batchRows 分段写入，返回已处理（写入或被拒绝）的前缀行数；
+        // 数据库不可用时停在第一段失败处
+        size_t write_batch(const std::vector<LogRecord>& records);
+
+        // 写库失败或队列已满时追加到溢出文件
+        void spill(const std::vector<LogRecord>& records);
+
+        // 被数据库拒绝的记录追加到 rejected_path()，不参与回放
+        void reject(const std::vector<LogRecord>& records);
+        std::string rejected_path() const;
+
+        void record_error(const std::string& error);
+
+        // 数据库恢复后回放溢出文件，全部写入后删除该文件
+        void replay_spill();
+
+        static void write_lines(std::ostream& out, std::vector<LogRecord>::const_iterator first,
+                                std::vector<LogRecord>::const_iterator last);
+
+    private:
+        static constexpr int RETRY_INTERVAL_SEC = 5;
+
+        LogAppenderOptions options;
+        DatabaseHandler handler;    // 只由后台线程使用（stop 之后由调用线程使用）
+        std::thread flushThread;
+        std::chrono::steady_clock::time_point retryAt;     // 只由后台线程读写
+
+        mutable std::mutex queueMutex;
+        std::condition_variable queueCv;
+        std::deque<LogRecord> pending;
+        bool stopped = false;
+
+        std::mutex spillMutex;
+        std::atomic<bool> hasSpill {false};
+
+        std::atomic<uint64_t> written {0};
+        std::atomic<uint64_t> spilled {0};
+        std::atomic<uint64_t> replayed {0};
+        std::atomic<uint64_t> rejected {0};
+        std::atomic<uint64_t> failedFlushes {0};
+
+        mutable std::mutex errorMutex;
+        std::string lastError;
+    };
+
+}
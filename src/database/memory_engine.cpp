@@ -0,0 +1,1985 @@
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "memory_engine.h"
+
+
+namespace TakeAwayPlatform
+{
+    namespace
+    {
+        using Key = std::vector<Cell>;
+
+        std::string lower(const std::string& text)
+        {
+            std::string out(text);
+            for (char& ch : out) {
+                ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+            }
+            return out;
+        }
+
+        // 同一索引列的值都已转换为列类型，只需额外处理 NULL（排在最前）
+        int compare_key_cell(const Cell& a, const Cell& b)
+        {
+            if (a.is_null() || b.is_null()) {
+                return (a.is_null() ? 0 : 1) - (b.is_null() ? 0 : 1);
+            }
+            return CellOps::compare(a, b);
+        }
+
+        int compare_keys(const Key& a, const Key& b)
+        {
+            const size_t count = std::min(a.size(), b.size());
+            for (size_t index = 0; index < count; ++index) {
+                if (int result = compare_key_cell(a[index], b[index])) {
+                    return result;
+                }
+            }
+            return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+        }
+
+        bool same_cell(const Cell& a, const Cell& b)
+        {
+            if (a.kind != b.kind) {
+                return false;
+            }
+            switch (a.kind) {
+                case Cell::NUL:
+                    return true;
+                case Cell::TEXT:
+                    return a.text == b.text;
+                case Cell::DOUBLE:
+                    return a.real == b.real;
+                default:
+                    return a.number == b.number;
+            }
+        }
+
+        struct EntryLess {
+            bool operator()(const std::pair<Key, int64_t>& a, const std::pair<Key, int64_t>& b) const {
+                const int result = compare_keys(a.first, b.first);
+                return result != 0 ? result < 0 : a.second < b.second;
+            }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key& key) const {
+                size_t hash = 0;
+                for (const Cell& cell : key) {
+                    size_t part = 0;
+                    switch (cell.kind) {
+                        case Cell::TEXT: part = std::hash<std::string>()(cell.text); break;
+                        case Cell::DOUBLE: part = std::hash<double>()(cell.real); break;
+                        default: part = std::hash<int64_t>()(cell.number); break;
+                    }
+                    hash = hash * 31 + part;
+                }
+                return hash;
+            }
+        };
+
+        struct KeyEqual {
+            bool operator()(const Key& a, const Key& b) const {
+                if (a.size() != b.size()) {
+                    return false;
+                }
+                for (size_t index = 0; index < a.size(); ++index) {
+                    if (!same_cell(a[index], b[index])) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        };
+
+        bool has_null(const Key& key)
+        {
+            return std::any_of(key.begin(), key.end(), [](const Cell& cell) { return cell.is_null(); });
+        }
+
+        std::string key_text(const Key& key)
+        {
+            std::string text;
+            for (size_t index = 0; index < key.size(); ++index) {
+                text += (index ? "-" : "") + CellOps::to_string(key[index]);
+            }
+            return text;
+        }
+
+        // NOT NULL 列在 ALTER TABLE ADD COLUMN 时给已有行填充的隐式默认值
+        Cell implicit_default(Cell::Kind type)
+        {
+            switch (type) {
+                case Cell::INT: return Cell::integer(0);
+                case Cell::DOUBLE: return Cell::floating(0);
+                case Cell::DECIMAL: return Cell::decimal(Money());
+                case Cell::DATETIME: return Cell::datetime(0);
+                default: return Cell::string("");
+            }
+        }
+    }
+
+    // ==================== 表与索引 ====================
+
+    // 所有索引都维护 (键, 行号) 的有序集合；主键和唯一索引另有键到行号的哈希表
+    struct MemoryIndex {
+        IndexDef def;
+        std::vector<size_t> columns;
+        std::set<std::pair<Key, int64_t>, EntryLess> ordered;
+        std::unordered_map<Key, int64_t, KeyHash, KeyEqual> unique;
+    };
+
+    struct MemoryTable {
+        std::string name;
+        std::vector<ColumnDef> columns;
+        std::unordered_map<std::string, size_t> columnIndex;    // 小写列名 -> 下标
+        std::map<int64_t, std::vector<Cell>> rows;              // 行号 -> 行，全表扫描按插入顺序
+        std::vector<MemoryIndex> indexes;                       // 有主键时 indexes[0] 为主键
+        int autoColumn = -1;        // AUTO_INCREMENT 列；没有时为单列整数主键，省略时同样自动分配
+        int64_t autoIncrement = 1;
+        int64_t nextRowId = 1;
+
+        int column(const std::string& columnName) const
+        {
+            auto it = columnIndex.find(lower(columnName));
+            return it == columnIndex.end() ? -1 : static_cast<int>(it->second);
+        }
+
+        Key key(const MemoryIndex& index, const std::vector<Cell>& row) const
+        {
+            Key key;
+            key.reserve(index.columns.size());
+            for (size_t column : index.columns) {
+                key.push_back(row[column]);
+            }
+            return key;
+        }
+
+        void add_column(const ColumnDef& definition)
+        {
+            if (column(definition.name) >= 0) {
+                throw SqlError("Duplicate column name '" + definition.name + "'");
+            }
+
+            ColumnDef def = definition;
+            if (def.primaryKey) {
+                def.notNull = true;
+            }
+            if (def.hasDefault && !def.defaultNow) {
+                def.defaultValue = CellOps::coerce(def.defaultValue, def.type);
+            }
+
+            Cell fill;
+            if (def.hasDefault) {
+                fill = def.defaultNow ? Cell::datetime(std::time(nullptr)) : def.defaultValue;
+            } else if (def.notNull) {
+                fill = implicit_default(def.type);
+            }
+            for (auto& row : rows) {
+                row.second.push_back(fill);
+            }
+
+            columns.push_back(def);
+            columnIndex[lower(def.name)] = columns.size() - 1;
+            if (def.autoIncrement) {
+                autoColumn = static_cast<int>(columns.size() - 1);
+            }
+        }
+
+        // ALTER TABLE MODIFY：按新类型转换已有值并重建相关索引，任一行不满足新定义时抛出 SqlError，表不变
+        void modify_column(const ColumnDef& definition)
+        {
+            const int position = column(definition.name);
+            if (position < 0) {
+                throw SqlError("Unknown column '" + definition.name + "' in '" + name + "'");
+            }
+
+            ColumnDef def = definition;
+            bool keyed = false;
+            bool primary = false;
+            for (const auto& index : indexes) {
+                if (std::find(index.columns.begin(), index.columns.end(), position) != index.columns.end()) {
+                    keyed = true;
+                    primary = primary || index.def.primary;
+                }
+            }
+            if (def.primaryKey && !primary) {
+                throw SqlError("ALTER TABLE MODIFY ... PRIMARY KEY is not supported");
+            }
+            if (def.primaryKey || primary) {
+                def.notNull = true;
+            }
+            if (def.autoIncrement) {
+                for (size_t index = 0; index < columns.size(); ++index) {
+                    if (columns[index].autoIncrement && index != static_cast<size_t>(position)) {
+                        throw SqlError("Incorrect table definition; there can be only one auto column");
+                    }
+                }
+                if (!keyed) {
+                    throw SqlError("Incorrect table definition; auto column must be defined as a key");
+                }
+            }
+            if (def.hasDefault && !def.defaultNow) {
+                def.defaultValue = CellOps::coerce(def.defaultValue, def.type);
+            }
+
+            std::vector<Cell> converted;
+            converted.reserve(rows.size());
+            int64_t maxValue = 0;
+            for (const auto& row : rows) {
+                const Cell& value = row.second[position];
+                if (value.is_null()) {
+                    if (def.notNull) {
+                        throw SqlError("Invalid use of NULL value");
+                    }
+                    converted.push_back(value);
+                    continue;
+                }
+                converted.push_back(CellOps::coerce(value, def.type));
+                if (def.autoIncrement) {
+                    maxValue = std::max(maxValue, CellOps::coerce(converted.back(), Cell::INT).number);
+                }
+            }
+
+            // 先在副本上重建含该列的索引，唯一冲突时原索引不变
+            std::vector<MemoryIndex> rebuilt;
+            for (const auto& index : indexes) {
+                MemoryIndex copy;
+                copy.def = index.def;
+                copy.columns = index.columns;
+                if (std::find(index.columns.begin(), index.columns.end(), position) == index.columns.end()) {
+                    copy.ordered = index.ordered;
+                    copy.unique = index.unique;
+                } else {
+                    size_t item = 0;
+                    for (const auto& row : rows) {
+                        std::vector<Cell> values = row.second;
+                        values[position] = converted[item++];
+                        Key rowKey = key(copy, values);
+                        if (copy.def.unique && !has_null(rowKey) && !copy.unique.emplace(rowKey, row.first).second) {
+                            throw SqlError("Duplicate entry '" + key_text(rowKey) + "' for key '" + name + "." + copy.def.name + "'");
+                        }
+                        copy.ordered.emplace(std::move(rowKey), row.first);
+                    }
+                }
+                rebuilt.push_back(std::move(copy));
+            }
+
+            size_t item = 0;
+            for (auto& row : rows) {
+                row.second[position] = std::move(converted[item++]);
+            }
+            indexes = std::move(rebuilt);
+
+            columnIndex.erase(lower(columns[position].name));
+            columns[position] = def;
+            columnIndex[lower(def.name)] = static_cast<size_t>(position);
+
+            update_auto_column();
+            if (autoColumn == position) {
+                autoIncrement = std::max(autoIncrement, maxValue + 1);
+            }
+        }
+
+        // AUTO_INCREMENT 列优先，没有时取单列整数主键
+        void update_auto_column()
+        {
+            autoColumn = -1;
+            for (size_t index = 0; index < columns.size(); ++index) {
+                if (columns[index].autoIncrement) {
+                    autoColumn = static_cast<int>(index);
+                    return;
+                }
+            }
+            if (!indexes.empty() && indexes[0].def.primary && indexes[0].columns.size() == 1 &&
+                columns[indexes[0].columns[0]].type == Cell::INT) {
+                autoColumn = static_cast<int>(indexes[0].columns[0]);
+            }
+        }
+
+        void add_index(const IndexDef& def)
+        {
+            for (const auto& index : indexes) {
+                if (lower(index.def.name) == lower(def.name)) {
+                    throw SqlError("Duplicate key name '" + def.name + "'");
+                }
+            }
+
+            MemoryIndex index;
+            index.def = def;
+            for (const auto& columnName : def.columns) {
+                const int position = column(columnName);
+                if (position < 0) {
+                    throw SqlError("Key column '" + columnName + "' doesn't exist in table");
+                }
+                index.columns.push_back(static_cast<size_t>(position));
+                if (def.primary) {
+                    columns[position].notNull = true;
+                }
+            }
+
+            for (const auto& row : rows) {
+                Key rowKey = key(index, row.second);
+                if (def.unique && !has_null(rowKey) && !index.unique.emplace(rowKey, row.first).second) {
+                    throw SqlError("Duplicate entry '" + key_text(rowKey) + "' for key '" + name + "." + def.name + "'");
+                }
+                index.ordered.emplace(std::move(rowKey), row.first);
+            }
+
+            if (def.primary) {
+                indexes.insert(indexes.begin(), std::move(index));
+            } else {
+                indexes.push_back(std::move(index));
+            }
+        }
+
+        void check_unique(const std::vector<Cell>& row, int64_t rowId) const
+        {
+            for (const auto& index : indexes) {
+                if (!index.def.unique) {
+                    continue;
+                }
+                Key rowKey = key(index, row);
+                if (has_null(rowKey)) {
+                    continue;
+                }
+                auto it = index.unique.find(rowKey);
+                if (it != index.unique.end() && it->second != rowId) {
+                    throw SqlError("Duplicate entry '" + key_text(rowKey) + "' for key '" + name + "." + index.def.name + "'");
+                }
+            }
+        }
+
+        void index_add(MemoryIndex& index, Key rowKey, int64_t rowId)
+        {
+            if (index.def.unique && !has_null(rowKey)) {
+                index.unique[rowKey] = rowId;
+            }
+            index.ordered.emplace(std::move(rowKey), rowId);
+        }
+
+        void index_remove(MemoryIndex& index, const Key& rowKey, int64_t rowId)
+        {
+            if (index.def.unique && !has_null(rowKey)) {
+                auto it = index.unique.find(rowKey);
+                if (it != index.unique.end() && it->second == rowId) {
+                    index.unique.erase(it);
+                }
+            }
+            index.ordered.erase({rowKey, rowId});
+        }
+
+        // 唯一冲突时抛出 SqlError，表不变
+        void insert(int64_t rowId, std::vector<Cell> row)
+        {
+            check_unique(row, rowId);
+            for (auto& index : indexes) {
+                index_add(index, key(index, row), rowId);
+            }
+            rows.emplace(rowId, std::move(row));
+        }
+
+        // 只更新键发生变化的索引；唯一冲突时抛出 SqlError，原行不变
+        void replace(int64_t rowId, std::vector<Cell> row)
+        {
+            std::vector<Cell>& current = rows.at(rowId);
+            check_unique(row, rowId);
+            for (auto& index : indexes) {
+                Key before = key(index, current);
+                Key after = key(index, row);
+                if (!KeyEqual()(before, after)) {
+                    index_remove(index, before, rowId);
+                    index_add(index, std::move(after), rowId);
+                }
+            }
+            current = std::move(row);
+        }
+
+        void erase(int64_t rowId)
+        {
+            auto it = rows.find(rowId);
+            if (it == rows.end()) {
+                return;
+            }
+            for (auto& index : indexes) {
+                index_remove(index, key(index, it->second), rowId);
+            }
+            rows.erase(it);
+        }
+
+        // 回滚时恢复行镜像，不做唯一性检查
+        void restore(int64_t rowId, const std::vector<Cell>* row)
+        {
+            erase(rowId);
+            if (row) {
+                for (auto& index : indexes) {
+                    index_add(index, key(index, *row), rowId);
+                }
+                rows.emplace(rowId, *row);
+            }
+        }
+
+        // 键以 prefix 开头的行号，按索引顺序（reverse 时逆序）
+        std::vector<int64_t> range(const MemoryIndex& index, const Key& prefix, bool reverse) const
+        {
+            std::vector<int64_t> ids;
+            for (auto it = index.ordered.lower_bound({prefix, INT64_MIN}); it != index.ordered.end(); ++it) {
+                bool matched = true;
+                for (size_t position = 0; position < prefix.size(); ++position) {
+                    if (compare_key_cell(it->first[position], prefix[position]) != 0) {
+                        matched = false;
+                        break;
+                    }
+                }
+                if (!matched) {
+                    break;
+                }
+                ids.push_back(it->second);
+            }
+
+            if (reverse) {
+                std::reverse(ids.begin(), ids.end());
+            }
+            return ids;
+        }
+    };
+
+    namespace
+    {
+        using Tables = std::unordered_map<std::string, std::unique_ptr<MemoryTable>>;
+
+        MemoryTable& find_table(Tables& tables, const std::string& name)
+        {
+            auto it = tables.find(name);
+            if (it == tables.end()) {
+                throw SqlError("Table '" + name + "' doesn't exist");
+            }
+            return *it->second;
+        }
+
+        bool is_aggregate(const std::string& name)
+        {
+            return name == "COUNT" || name == "SUM" || name == "MIN" || name == "MAX" || name == "AVG";
+        }
+
+        const std::set<std::string> FUNCTIONS {
+            "NOW", "SYSDATE", "UNIX_TIMESTAMP", "FROM_UNIXTIME", "COALESCE", "IFNULL", "IF", "GREATEST",
+            "LEAST", "CONCAT", "LOWER", "UPPER", "ABS", "GET_LOCK", "RELEASE_LOCK"
+        };
+
+        // ==================== 名称解析 ====================
+
+        struct Binding {
+            const MemoryTable* table;
+            std::string name;       // 别名，没有别名时为表名
+        };
+
+        class Resolver
+        {
+        public:
+            Resolver(Tables& tables, Statement& st) : tables(tables), st(st) {}
+
+            void resolve()
+            {
+                switch (st.kind) {
+                    case Statement::SELECT:
+                        for (const auto& ref : st.from) {
+                            bindings.push_back({&find_table(tables, ref.table), ref.alias.empty() ? ref.table : ref.alias});
+                        }
+                        for (auto& item : st.items) {
+                            if (item.star) {
+                                if (!item.starTable.empty() && std::none_of(bindings.begin(), bindings.end(),
+                                        [&](const Binding& b) { return b.name == item.starTable; })) {
+                                    throw SqlError("Unknown table '" + item.starTable + "'");
+                                }
+                            } else {
+                                expression(*item.expr, true);
+                            }
+                        }
+                        for (auto& ref : st.from) {
+                            if (ref.on) {
+                                expression(*ref.on, false);
+                            }
+                        }
+                        if (st.where) {
+                            expression(*st.where, false);
+                        }
+                        for (auto& order : st.orderBy) {
+                            order_item(order);
+                        }
+                        constant(st.limit);
+                        constant(st.offset);
+                        break;
+
+                    case Statement::UPDATE:
+                    case Statement::DELETE: {
+                        const MemoryTable& table = find_table(tables, st.from[0].table);
+                        bindings.push_back({&table, st.from[0].alias.empty() ? st.from[0].table : st.from[0].alias});
+                        for (auto& assignment : st.assignments) {
+                            assignment.index = table.column(assignment.column);
+                            if (assignment.index < 0) {
+                                throw SqlError("Unknown column '" + assignment.column + "' in 'field list'");
+                            }
+                            expression(*assignment.value, false);
+                        }
+                        if (st.where) {
+                            expression(*st.where, false);
+                        }
+                        constant(st.limit);
+                        break;
+                    }
+
+                    case Statement::INSERT: {
+                        const MemoryTable& table = find_table(tables, st.table);
+                        std::set<int> seen;
+                        for (const auto& name : st.columns) {
+                            const int position = table.column(name);
+                            if (position < 0) {
+                                throw SqlError("Unknown column '" + name + "' in 'field list'");
+                            }
+                            if (!seen.insert(position).second) {
+                                throw SqlError("Column '" + name + "' specified twice");
+                            }
+                        }
+                        for (auto& row : st.values) {
+                            for (auto& value : row) {
+                                expression(*value, false);
+                            }
+                        }
+                        break;
+                    }
+
+                    default:
+                        break;
+                }
+            }
+
+        private:
+            void constant(const ExprPtr& expr)
+            {
+                if (expr) {
+                    std::vector<Binding> none;
+                    std::swap(none, bindings);
+                    expression(*expr, false);
+                    std::swap(none, bindings);
+                }
+            }
+
+            void order_item(OrderItem& order)
+            {
+                // 不是任何表的列时按结果列别名解析
+                Expr& expr = *order.expr;
+                if (expr.kind == Expr::COLUMN && expr.table.empty() &&
+                    std::none_of(bindings.begin(), bindings.end(),
+                                 [&](const Binding& b) { return b.table->column(expr.column) >= 0; })) {
+                    for (size_t index = 0; index < st.items.size(); ++index) {
+                        if (!st.items[index].star && lower(st.items[index].alias) == lower(expr.column)) {
+                            order.selectItem = static_cast<int>(index);
+                            return;
+                        }
+                    }
+                }
+                expression(expr, true);
+            }
+
+            void expression(Expr& expr, bool allowAggregate)
+            {
+                switch (expr.kind) {
+                    case Expr::COLUMN:
+                        column(expr);
+                        return;
+
+                    case Expr::FUNCTION:
+                        if (is_aggregate(expr.op)) {
+                            if (!allowAggregate) {
+                                throw SqlError("Invalid use of group function");
+                            }
+                            if (!expr.star && expr.args.size() != 1) {
+                                throw SqlError("Incorrect parameter count in the call to " + expr.op);
+                            }
+                            expr.aggregate = static_cast<int>(st.aggregateCount++);
+                            allowAggregate = false;
+                        } else if (!FUNCTIONS.count(expr.op)) {
+                            throw SqlError("FUNCTION " + expr.op + " does not exist");
+                        }
+                        break;
+
+                    default:
+                        break;
+                }
+
+                for (auto& arg : expr.args) {
+                    expression(*arg, allowAggregate);
+                }
+            }
+
+            void column(Expr& expr)
+            {
+                for (size_t index = 0; index < bindings.size(); ++index) {
+                    const Binding& binding = bindings[index];
+                    if (!expr.table.empty() && binding.name != expr.table) {
+                        continue;
+                    }
+
+                    const int position = binding.table->column(expr.column);
+                    if (position < 0) {
+                        continue;
+                    }
+                    if (expr.binding >= 0) {
+                        throw SqlError("Column '" + expr.column + "' in field list is ambiguous");
+                    }
+                    expr.binding = static_cast<int>(index);
+                    expr.index = position;
+                }
+
+                if (expr.binding < 0) {
+                    throw SqlError("Unknown column '" + expr.text + "' in 'field list'");
+                }
+            }
+
+        private:
+            Tables& tables;
+            Statement& st;
+            std::vector<Binding> bindings;
+        };
+
+        // ==================== 求值 ====================
+
+        struct Frame {
+            std::vector<const std::vector<Cell>*> rows;     // 每个 FROM 表的当前行，LEFT JOIN 未匹配时为空
+            const std::vector<Cell>* aggregates = nullptr;
+        };
+
+        struct Accumulator {
+            int64_t count = 0;
+            Cell value;
+        };
+
+        // SQL LIKE，大小写不敏感，支持 % _ 和 \ 转义
+        bool like(const std::string& text, const std::string& pattern)
+        {
+            size_t t = 0, p = 0, starP = std::string::npos, starT = 0;
+            auto same = [](char a, char b) {
+                return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+            };
+
+            while (t < text.size()) {
+                if (p < pattern.size() && pattern[p] == '%') {
+                    starP = p++;
+                    starT = t;
+                } else if (p < pattern.size() && pattern[p] == '\\' && p + 1 < pattern.size() && same(pattern[p + 1], text[t])) {
+                    p += 2;
+                    ++t;
+                } else if (p < pattern.size() && (pattern[p] == '_' || (pattern[p] != '\\' && same(pattern[p], text[t])))) {
+                    ++p;
+                    ++t;
+                } else if (starP != std::string::npos) {
+                    p = starP + 1;
+                    t = ++starT;
+                } else {
+                    return false;
+                }
+            }
+            while (p < pattern.size() && pattern[p] == '%') {
+                ++p;
+            }
+            return p == pattern.size();
+        }
+
+        Cell arithmetic(const std::string& op, const Cell& a, const Cell& b)
+        {
+            if (a.is_null() || b.is_null()) {
+                return Cell();
+            }
+
+            const bool integers = (a.kind == Cell::INT || a.kind == Cell::DATETIME) &&
+                                  (b.kind == Cell::INT || b.kind == Cell::DATETIME);
+
+            if (op == "DIV" || op == "%") {
+                const int64_t x = CellOps::coerce(a, Cell::INT).number;
+                const int64_t y = CellOps::coerce(b, Cell::INT).number;
+                if (y == 0) {
+                    return Cell();
+                }
+                return Cell::integer(op == "DIV" ? x / y : x % y);
+            }
+
+            if (op == "/") {
+                const double divisor = CellOps::to_double(b);
+                return divisor == 0 ? Cell() : Cell::floating(CellOps::to_double(a) / divisor);
+            }
+
+            if (integers) {
+                const int64_t x = a.number, y = b.number;
+                return Cell::integer(op == "+" ? x + y : op == "-" ? x - y : x * y);
+            }
+
+            // DECIMAL 与整数、DECIMAL 运算保持精确，涉及浮点或文本时按 DOUBLE
+            if ((a.kind == Cell::DECIMAL || b.kind == Cell::DECIMAL) && a.kind != Cell::DOUBLE && b.kind != Cell::DOUBLE &&
+                a.kind != Cell::TEXT && b.kind != Cell::TEXT) {
+                const int64_t x = CellOps::coerce(a, Cell::DECIMAL).number;
+                const int64_t y = CellOps::coerce(b, Cell::DECIMAL).number;
+                if (op == "+") {
+                    return Cell::decimal(Money::fromCents(x + y));
+                }
+                if (op == "-") {
+                    return Cell::decimal(Money::fromCents(x - y));
+                }
+                return Cell::decimal(Money::fromCents(std::llround(static_cast<double>(x) * y / 100)));
+            }
+
+            const double x = CellOps::to_double(a), y = CellOps::to_double(b);
+            return Cell::floating(op == "+" ? x + y : op == "-" ? x - y : x * y);
+        }
+
+        Cell boolean(bool value)
+        {
+            return Cell::integer(value ? 1 : 0);
+        }
+
+        // 表达式引用的最大 FROM 下标，不引用任何列时为 -1，聚合函数视为不可提前求值
+        int max_binding(const Expr& expr)
+        {
+            if (expr.kind == Expr::COLUMN) {
+                return expr.binding;
+            }
+            if (expr.aggregate >= 0) {
+                return INT_MAX;
+            }
+            int result = -1;
+            for (const auto& arg : expr.args) {
+                result = std::max(result, max_binding(*arg));
+            }
+            return result;
+        }
+
+        void conjuncts(const Expr* expr, std::vector<const Expr*>& out)
+        {
+            if (!expr) {
+                return;
+            }
+            if (expr->kind == Expr::BINARY && expr->op == "AND") {
+                conjuncts(expr->args[0].get(), out);
+                conjuncts(expr->args[1].get(), out);
+            } else {
+                out.push_back(expr);
+            }
+        }
+
+        void disjuncts(const Expr* expr, std::vector<const Expr*>& out)
+        {
+            if (expr->kind == Expr::BINARY && expr->op == "OR") {
+                disjuncts(expr->args[0].get(), out);
+                disjuncts(expr->args[1].get(), out);
+            } else {
+                out.push_back(expr);
+            }
+        }
+
+        void collect_aggregates(const Expr& expr, std::vector<const Expr*>& out)
+        {
+            if (expr.aggregate >= 0) {
+                out[expr.aggregate] = &expr;
+                return;
+            }
+            for (const auto& arg : expr.args) {
+                collect_aggregates(*arg, out);
+            }
+        }
+
+        Cell from_value(const mysqlx::Value& value)
+        {
+            switch (value.getType()) {
+                case mysqlx::Value::VNULL: return Cell();
+                case mysqlx::Value::INT64: return Cell::integer(value.get<int64_t>());
+                case mysqlx::Value::UINT64: return Cell::integer(static_cast<int64_t>(value.get<uint64_t>()));
+                case mysqlx::Value::FLOAT: return Cell::floating(value.get<float>());
+                case mysqlx::Value::DOUBLE: return Cell::floating(value.get<double>());
+                case mysqlx::Value::BOOL: return Cell::integer(value.get<bool>() ? 1 : 0);
+                case mysqlx::Value::STRING: return Cell::string(value.get<std::string>());
+                default: throw SqlError("Unsupported parameter type");
+            }
+        }
+
+        mysqlx::Value to_value(const Cell& cell)
+        {
+            switch (cell.kind) {
+                case Cell::NUL: return mysqlx::Value();
+                case Cell::INT: return mysqlx::Value(cell.number);
+                case Cell::DOUBLE: return mysqlx::Value(cell.real);
+                default: return mysqlx::Value(CellOps::to_string(cell));
+            }
+        }
+
+        // ==================== 执行 ====================
+
+        class Executor
+        {
+        public:
+            Executor(Tables& tables, const std::vector<Cell>& params)
+                : tables(tables), params(params), now(static_cast<int64_t>(std::time(nullptr))) {}
+
+            void run(const Statement& st, StorageResult& result, UndoLog& undo)
+            {
+                if (params.size() != st.paramCount) {
+                    throw SqlError("Expected " + std::to_string(st.paramCount) + " parameters, got " +
+                                   std::to_string(params.size()));
+                }
+
+                switch (st.kind) {
+                    case Statement::SELECT: select(st, result); break;
+                    case Statement::INSERT: insert(st, result, undo); break;
+                    case Statement::UPDATE: update(st, result, undo); break;
+                    case Statement::DELETE: remove(st, result, undo); break;
+                    case Statement::CREATE_TABLE: create_table(st); break;
+                    case Statement::CREATE_INDEX: find_table(tables, st.table).add_index(st.indexes[0]); break;
+                    case Statement::ALTER_TABLE: alter_table(st); break;
+                    case Statement::DROP_TABLE: drop_table(st); break;
+                    case Statement::SET: break;     // 内存库不检查外键，会话变量无需处理
+                }
+            }
+
+        private:
+            // ---------- 表达式 ----------
+
+            Cell eval(const Expr& expr, const Frame& frame) const
+            {
+                switch (expr.kind) {
+                    case Expr::LITERAL:
+                        return expr.value;
+
+                    case Expr::PARAM:
+                        return params[expr.param];
+
+                    case Expr::COLUMN: {
+                        const std::vector<Cell>* row = frame.rows[expr.binding];
+                        return row ? (*row)[expr.index] : Cell();
+                    }
+
+                    case Expr::UNARY: {
+                        const Cell value = eval(*expr.args[0], frame);
+                        if (value.is_null()) {
+                            return value;
+                        }
+                        if (expr.op == "NOT") {
+                            return boolean(!CellOps::truthy(value));
+                        }
+                        return arithmetic("-", Cell::integer(0), value.kind == Cell::TEXT ? CellOps::coerce(value, Cell::DOUBLE) : value);
+                    }
+
+                    case Expr::BINARY:
+                        return binary(expr, frame);
+
+                    case Expr::FUNCTION:
+                        return function(expr, frame);
+
+                    case Expr::CASE: {
+                        const bool simple = expr.op == "SIMPLE";
+                        const size_t first = simple ? 1 : 0;
+                        const Cell operand = simple ? eval(*expr.args[0], frame) : Cell();
+                        size_t index = first;
+                        for (; index + 1 < expr.args.size(); index += 2) {
+                            const Cell when = eval(*expr.args[index], frame);
+                            const bool matched = simple
+                                ? !operand.is_null() && !when.is_null() && CellOps::compare(operand, when) == 0
+                                : CellOps::truthy(when);
+                            if (matched) {
+                                return eval(*expr.args[index + 1], frame);
+                            }
+                        }
+                        return index < expr.args.size() ? eval(*expr.args[index], frame) : Cell();
+                    }
+
+                    case Expr::IN_LIST: {
+                        const Cell value = eval(*expr.args[0], frame);
+                        if (value.is_null()) {
+                            return value;
+                        }
+                        bool sawNull = false;
+                        for (size_t index = 1; index < expr.args.size(); ++index) {
+                            const Cell item = eval(*expr.args[index], frame);
+                            if (item.is_null()) {
+                                sawNull = true;
+                            } else if (CellOps::compare(value, item) == 0) {
+                                return boolean(!expr.negated);
+                            }
+                        }
+                        return sawNull ? Cell() : boolean(expr.negated);
+                    }
+
+                    case Expr::IS_NULL:
+                        return boolean(eval(*expr.args[0], frame).is_null() != expr.negated);
+
+                    case Expr::CAST:
+                        return CellOps::coerce(eval(*expr.args[0], frame), expr.castType);
+                }
+                return Cell();
+            }
+
+            Cell binary(const Expr& expr, const Frame& frame) const
+            {
+                const std::string& op = expr.op;
+
+                // 三值逻辑：FALSE AND NULL 为 FALSE，TRUE OR NULL 为 TRUE
+                if (op == "AND" || op == "OR") {
+                    const Cell left = eval(*expr.args[0], frame);
+                    const bool shortCircuit = op == "AND" ? !left.is_null() && !CellOps::truthy(left)
+                                                          : !left.is_null() && CellOps::truthy(left);
+                    if (shortCircuit) {
+                        return boolean(op == "OR");
+                    }
+                    const Cell right = eval(*expr.args[1], frame);
+                    if (!right.is_null() && CellOps::truthy(right) == (op == "OR")) {
+                        return boolean(op == "OR");
+                    }
+                    if (left.is_null() || right.is_null()) {
+                        return Cell();
+                    }
+                    return boolean(op == "AND");
+                }
+
+                const Cell left = eval(*expr.args[0], frame);
+                const Cell right = eval(*expr.args[1], frame);
+                if (left.is_null() || right.is_null()) {
+                    return Cell();
+                }
+
+                if (op == "LIKE") {
+                    return boolean(like(CellOps::to_string(left), CellOps::to_string(right)) != expr.negated);
+                }
+                if (op == "+" || op == "-" || op == "*" || op == "/" || op == "%" || op == "DIV") {
+                    return arithmetic(op, left, right);
+                }
+
+                const int result = CellOps::compare(left, right);
+                if (op == "=") return boolean(result == 0);
+                if (op == "<>") return boolean(result != 0);
+                if (op == "<") return boolean(result < 0);
+                if (op == "<=") return boolean(result <= 0);
+                if (op == ">") return boolean(result > 0);
+                return boolean(result >= 0);
+            }
+
+            Cell function(const Expr& expr, const Frame& frame) const
+            {
+                if (expr.aggregate >= 0) {
+                    if (!frame.aggregates) {
+                        throw SqlError("Invalid use of group function");
+                    }
+                    return (*frame.aggregates)[expr.aggregate];
+                }
+
+                const std::string& name = expr.op;
+                std::vector<Cell> args;
+                args.reserve(expr.args.size());
+                for (const auto& arg : expr.args) {
+                    args.push_back(eval(*arg, frame));
+                }
+
+                auto arity = [&](size_t low, size_t high) {
+                    if (args.size() < low || args.size() > high) {
+                        throw SqlError("Incorrect parameter count in the call to " + name);
+                    }
+                };
+
+                if (name == "NOW" || name == "SYSDATE") {
+                    return Cell::datetime(now);
+                }
+                if (name == "UNIX_TIMESTAMP") {
+                    arity(0, 1);
+                    if (args.empty()) {
+                        return Cell::integer(now);
+                    }
+                    return args[0].is_null() ? Cell() : Cell::integer(CellOps::coerce(args[0], Cell::DATETIME).number);
+                }
+                if (name == "FROM_UNIXTIME") {
+                    arity(1, 1);
+                    return args[0].is_null() ? Cell() : Cell::datetime(CellOps::coerce(args[0], Cell::INT).number);
+                }
+                if (name == "COALESCE" || name == "IFNULL") {
+                    for (const Cell& arg : args) {
+                        if (!arg.is_null()) {
+                            return arg;
+                        }
+                    }
+                    return Cell();
+                }
+                if (name == "IF") {
+                    arity(3, 3);
+                    return CellOps::truthy(args[0]) ? args[1] : args[2];
+                }
+                if (name == "GREATEST" || name == "LEAST") {
+                    arity(1, SIZE_MAX);
+                    Cell best = args[0];
+                    for (const Cell& arg : args) {
+                        if (arg.is_null()) {
+                            return Cell();
+                        }
+                        const int result = CellOps::compare(arg, best);
+                        if (name == "GREATEST" ? result > 0 : result < 0) {
+                            best = arg;
+                        }
+                    }
+                    return best;
+                }
+                if (name == "CONCAT") {
+                    std::string text;
+                    for (const Cell& arg : args) {
+                        if (arg.is_null()) {
+                            return Cell();
+                        }
+                        text += CellOps::to_string(arg);
+                    }
+                    return Cell::string(text);
+                }
+                if (name == "LOWER" || name == "UPPER") {
+                    arity(1, 1);
+                    if (args[0].is_null()) {
+                        return Cell();
+                    }
+                    std::string text = CellOps::to_string(args[0]);
+                    for (char& ch : text) {
+                        ch = static_cast<char>(name == "LOWER" ? std::tolower(static_cast<unsigned char>(ch))
+                                                               : std::toupper(static_cast<unsigned char>(ch)));
+                    }
+                    return Cell::string(text);
+                }
+                if (name == "ABS") {
+                    arity(1, 1);
+                    if (args[0].is_null() || CellOps::compare(args[0], Cell::integer(0)) >= 0) {
+                        return args[0];
+                    }
+                    return arithmetic("-", Cell::integer(0), args[0]);
+                }
+
+                // GET_LOCK / RELEASE_LOCK：语句已由库级锁串行化，直接视为成功
+                return Cell::integer(1);
+            }
+
+            void fold(const Expr& expr, Accumulator& acc, const Frame& frame) const
+            {
+                if (expr.star) {
+                    ++acc.count;
+                    return;
+                }
+
+                Cell value = eval(*expr.args[0], frame);
+                if (value.is_null()) {
+                    return;
+                }
+                ++acc.count;
+
+                if (expr.op == "SUM" || expr.op == "AVG") {
+                    if (value.kind == Cell::TEXT || value.kind == Cell::DATETIME) {
+                        value = CellOps::coerce(value, value.kind == Cell::TEXT ? Cell::DOUBLE : Cell::INT);
+                    }
+                    acc.value = acc.value.is_null() ? value : arithmetic("+", acc.value, value);
+                } else if (expr.op == "MIN" || expr.op == "MAX") {
+                    if (acc.value.is_null()) {
+                        acc.value = value;
+                    } else {
+                        const int result = CellOps::compare(value, acc.value);
+                        if (expr.op == "MIN" ? result < 0 : result > 0) {
+                            acc.value = value;
+                        }
+                    }
+                }
+            }
+
+            static Cell finish(const Expr& expr, const Accumulator& acc)
+            {
+                if (expr.op == "COUNT") {
+                    return Cell::integer(acc.count);
+                }
+                if (expr.op == "AVG") {
+                    return acc.count ? Cell::floating(CellOps::to_double(acc.value) / acc.count) : Cell();
+                }
+                return acc.value;
+            }
+
+            int64_t count_value(const ExprPtr& expr) const
+            {
+                if (!expr) {
+                    return -1;
+                }
+                const Cell value = CellOps::coerce(eval(*expr, Frame()), Cell::INT);
+                if (value.is_null() || value.number < 0) {
+                    throw SqlError("Incorrect arguments to LIMIT");
+                }
+                return value.number;
+            }
+
+            // ---------- 访问路径 ----------
+
+            // ORDER BY 全部是 binding 0 的列时，按 (列下标, 是否降序) 给出
+            static bool simple_order(const Statement& st, std::vector<std::pair<size_t, bool>>& order)
+            {
+                for (const auto& item : st.orderBy) {
+                    if (item.selectItem >= 0 || item.expr->kind != Expr::COLUMN || item.expr->binding != 0) {
+                        return false;
+                    }
+                    order.emplace_back(static_cast<size_t>(item.expr->index), item.desc);
+                }
+                return !order.empty();
+            }
+
+            // cond 中形如 列 = 表达式 的合取项：列属于第 level 个表，另一侧只引用之前的表。
+            // 值已转换为列类型；某个等值为 NULL 时没有任何行能满足，返回 false
+            bool equalities(const Expr* cond, size_t level, const MemoryTable& table, const Frame& frame,
+                            std::map<size_t, Cell>& bound) const
+            {
+                std::vector<const Expr*> items;
+                conjuncts(cond, items);
+
+                for (const Expr* item : items) {
+                    if (item->kind != Expr::BINARY || item->op != "=") {
+                        continue;
+                    }
+                    for (int side = 0; side < 2; ++side) {
+                        const Expr& column = *item->args[side];
+                        const Expr& other = *item->args[1 - side];
+                        if (column.kind != Expr::COLUMN || column.binding != static_cast<int>(level) ||
+                            max_binding(other) >= static_cast<int>(level)) {
+                            continue;
+                        }
+
+                        const Cell value = eval(other, frame);
+                        if (value.is_null()) {
+                            return false;
+                        }
+                        try {
+                            bound[column.index] = CellOps::coerce(value, table.columns[column.index].type);
+                        } catch (const SqlError&) {
+                            // 无法转换为列类型（如对整数列比较非数字文本），留给逐行过滤
+                        }
+                        break;
+                    }
+                }
+                return true;
+            }
+
+            // 选择访问路径，返回候选行号；ordered 表示候选行已按 order 排好
+            std::vector<int64_t> candidates(const Expr* cond, size_t level, const MemoryTable& table, const Frame& frame,
+                                            const std::vector<std::pair<size_t, bool>>* order, bool& ordered) const
+            {
+                ordered = false;
+
+                std::map<size_t, Cell> bound;
+                if (!equalities(cond, level, table, frame, bound)) {
+                    ordered = true;
+                    return {};
+                }
+
+                // 唯一索引全部列都有等值条件：哈希点查
+                for (const auto& index : table.indexes) {
+                    if (!index.def.unique || bound.empty()) {
+                        continue;
+                    }
+                    Key key;
+                    for (size_t column : index.columns) {
+                        auto it = bound.find(column);
+                        if (it == bound.end()) {
+                            break;
+                        }
+                        key.push_back(it->second);
+                    }
+                    if (key.size() == index.columns.size()) {
+                        ordered = true;
+                        auto it = index.unique.find(key);
+                        return it == index.unique.end() ? std::vector<int64_t>() : std::vector<int64_t> {it->second};
+                    }
+                }
+
+                // 等值前缀最长、且能顺带满足 ORDER BY 的有序索引
+                const MemoryIndex* best = nullptr;
+                size_t bestPrefix = 0;
+                bool bestOrdered = false, bestReverse = false;
+                int bestScore = 0;
+                for (const auto& index : table.indexes) {
+                    size_t prefix = 0;
+                    while (prefix < index.columns.size() && bound.count(index.columns[prefix])) {
+                        ++prefix;
+                    }
+
+                    bool matches = false, reverse = false;
+                    if (order && prefix + order->size() <= index.columns.size()) {
+                        matches = true;
+                        reverse = order->front().second;
+                        for (size_t position = 0; position < order->size(); ++position) {
+                            if (index.columns[prefix + position] != (*order)[position].first ||
+                                (*order)[position].second != reverse) {
+                                matches = false;
+                                break;
+                            }
+                        }
+                    }
+
+                    const int score = static_cast<int>(prefix) * 2 + (matches ? 1 : 0);
+                    if (score > bestScore) {
+                        best = &index;
+                        bestPrefix = prefix;
+                        bestOrdered = matches;
+                        bestReverse = reverse;
+                        bestScore = score;
+                    }
+                }
+
+                if (best) {
+                    Key prefix;
+                    for (size_t position = 0; position < bestPrefix; ++position) {
+                        prefix.push_back(bound[best->columns[position]]);
+                    }
+                    ordered = bestOrdered;
+                    return table.range(*best, prefix, bestReverse);
+                }
+
+                // a = ? OR b = ? OR ...：每一项都能走索引时合并各索引的结果
+                std::vector<int64_t> merged;
+                if (cond && union_candidates(*cond, level, table, frame, merged)) {
+                    return merged;
+                }
+
+                std::vector<int64_t> ids;
+                ids.reserve(table.rows.size());
+                for (const auto& row : table.rows) {
+                    ids.push_back(row.first);
+                }
+                return ids;
+            }
+
+            bool union_candidates(const Expr& cond, size_t level, const MemoryTable& table, const Frame& frame,
+                                  std::vector<int64_t>& out) const
+            {
+                std::vector<const Expr*> items;
+                disjuncts(&cond, items);
+                if (items.size() < 2) {
+                    return false;
+                }
+
+                std::set<int64_t> ids;
+                for (const Expr* item : items) {
+                    std::map<size_t, Cell> bound;
+                    if (!equalities(item, level, table, frame, bound)) {
+                        continue;       // 该项恒为假
+                    }
+                    if (bound.size() != 1) {
+                        return false;
+                    }
+
+                    const auto& entry = *bound.begin();
+                    const MemoryIndex* found = nullptr;
+                    for (const auto& index : table.indexes) {
+                        if (index.columns[0] == entry.first) {
+                            found = &index;
+                            break;
+                        }
+                    }
+                    if (!found) {
+                        return false;
+                    }
+                    for (int64_t id : table.range(*found, Key {entry.second}, false)) {
+                        ids.insert(id);
+                    }
+                }
+
+                out.assign(ids.begin(), ids.end());
+                return true;
+            }
+
+            // ---------- SELECT ----------
+
+            void select(const Statement& st, StorageResult& result)
+            {
+                std::vector<MemoryTable*> from;
+                for (const auto& ref : st.from) {
+                    from.push_back(&find_table(tables, ref.table));
+                }
+                auto bindingName = [&](size_t index) {
+                    return st.from[index].alias.empty() ? st.from[index].table : st.from[index].alias;
+                };
+
+                // 结果列
+                std::vector<size_t> itemColumn;
+                for (const auto& item : st.items) {
+                    itemColumn.push_back(result.columns.size());
+                    if (item.star) {
+                        for (size_t index = 0; index < from.size(); ++index) {
+                            if (item.starTable.empty() || bindingName(index) == item.starTable) {
+                                for (const auto& column : from[index]->columns) {
+                                    result.columns.push_back(column.name);
+                                }
+                            }
+                        }
+                    } else if (!item.alias.empty()) {
+                        result.columns.push_back(item.alias);
+                    } else {
+                        result.columns.push_back(item.expr->kind == Expr::COLUMN ? item.expr->column : item.expr->text);
+                    }
+                }
+
+                const int64_t limit = count_value(st.limit);
+                const int64_t offset = std::max<int64_t>(count_value(st.offset), 0);
+
+                std::vector<const Expr*> aggregates(st.aggregateCount, nullptr);
+                for (const auto& item : st.items) {
+                    if (item.expr) {
+                        collect_aggregates(*item.expr, aggregates);
+                    }
+                }
+                for (const auto& order : st.orderBy) {
+                    collect_aggregates(*order.expr, aggregates);
+                }
+                const bool aggregate = !aggregates.empty();
+                std::vector<Accumulator> accumulators(aggregates.size());
+
+                std::vector<std::pair<size_t, bool>> order;
+                const bool useOrder = !aggregate && simple_order(st, order);
+
+                Frame frame;
+                frame.rows.assign(from.size(), nullptr);
+
+                bool ordered = false;
+                std::vector<int64_t> ids;
+                if (!from.empty()) {
+                    ids = candidates(st.where.get(), 0, *from[0], frame, useOrder ? &order : nullptr, ordered);
+                }
+                const bool needSort = !aggregate && !st.orderBy.empty() && !ordered;
+
+                // 不需要排序时凑够 OFFSET + LIMIT 行即可停止
+                const size_t wanted = (!needSort && !aggregate && limit >= 0)
+                    ? static_cast<size_t>(offset + limit) : SIZE_MAX;
+
+                struct OutputRow {
+                    Key sortKey;
+                    std::vector<Cell> cells;
+                };
+                std::vector<OutputRow> output;
+                std::vector<const std::vector<Cell>*> firstMatch;
+
+                auto project = [&]() {
+                    std::vector<Cell> cells;
+                    cells.reserve(result.columns.size());
+                    for (const auto& item : st.items) {
+                        if (!item.star) {
+                            cells.push_back(eval(*item.expr, frame));
+                            continue;
+                        }
+                        for (size_t index = 0; index < from.size(); ++index) {
+                            if (!item.starTable.empty() && bindingName(index) != item.starTable) {
+                                continue;
+                            }
+                            const std::vector<Cell>* row = frame.rows[index];
+                            for (size_t column = 0; column < from[index]->columns.size(); ++column) {
+                                cells.push_back(row ? (*row)[column] : Cell());
+                            }
+                        }
+                    }
+                    return cells;
+                };
+
+                std::function<bool()> emit = [&]() {
+                    if (st.where && !CellOps::truthy(eval(*st.where, frame))) {
+                        return true;
+                    }
+
+                    if (aggregate) {
+                        if (firstMatch.empty()) {
+                            firstMatch = frame.rows;
+                        }
+                        for (size_t index = 0; index < aggregates.size(); ++index) {
+                            fold(*aggregates[index], accumulators[index], frame);
+                        }
+                        return true;
+                    }
+
+                    OutputRow row;
+                    row.cells = project();
+                    if (needSort) {
+                        for (const auto& item : st.orderBy) {
+                            row.sortKey.push_back(item.selectItem >= 0 ? row.cells[itemColumn[item.selectItem]]
+                                                                       : eval(*item.expr, frame));
+                        }
+                    }
+                    output.push_back(std::move(row));
+                    return output.size() < wanted;
+                };
+
+                if (from.empty()) {
+                    emit();
+                } else {
+                    for (int64_t id : ids) {
+                        auto it = from[0]->rows.find(id);
+                        if (it == from[0]->rows.end()) {
+                            continue;
+                        }
+                        frame.rows[0] = &it->second;
+                        if (!join(st, from, 1, frame, emit)) {
+                            break;
+                        }
+                    }
+                }
+
+                if (aggregate) {
+                    std::vector<Cell> finals;
+                    for (size_t index = 0; index < aggregates.size(); ++index) {
+                        finals.push_back(finish(*aggregates[index], accumulators[index]));
+                    }
+                    frame.rows = firstMatch.empty() ? std::vector<const std::vector<Cell>*>(from.size(), nullptr) : firstMatch;
+                    frame.aggregates = &finals;
+                    output.push_back({Key(), project()});
+                    frame.aggregates = nullptr;
+                }
+
+                if (needSort) {
+                    std::stable_sort(output.begin(), output.end(), [&](const OutputRow& a, const OutputRow& b) {
+                        for (size_t index = 0; index < st.orderBy.size(); ++index) {
+                            int result = compare_key_cell(a.sortKey[index], b.sortKey[index]);
+                            if (result != 0) {
+                                return st.orderBy[index].desc ? result > 0 : result < 0;
+                            }
+                        }
+                        return false;
+                    });
+                }
+
+                const size_t begin = std::min(static_cast<size_t>(offset), output.size());
+                const size_t end = limit >= 0 ? std::min(begin + static_cast<size_t>(limit), output.size()) : output.size();
+
+                result.rows.reserve(end - begin);
+                for (size_t index = begin; index < end; ++index) {
+                    mysqlx::Row row;
+                    const auto& cells = output[index].cells;
+                    for (size_t column = 0; column < cells.size(); ++column) {
+                        row.set(static_cast<mysqlx::col_count_t>(column), to_value(cells[column]));
+                    }
+                    result.rows.push_back(std::move(row));
+                }
+            }
+
+            // 嵌套循环连接；ON 中有 列 = 之前表的表达式 且该列有索引时按索引查找
+            bool join(const Statement& st, const std::vector<MemoryTable*>& from, size_t level, Frame& frame,
+                      const std::function<bool()>& emit) const
+            {
+                if (level == from.size()) {
+                    return emit();
+                }
+
+                const TableRef& ref = st.from[level];
+                const MemoryTable& table = *from[level];
+
+                bool ordered = false;
+                bool matched = false;
+                for (int64_t id : candidates(ref.on.get(), level, table, frame, nullptr, ordered)) {
+                    frame.rows[level] = &table.rows.at(id);
+                    if (ref.on && !CellOps::truthy(eval(*ref.on, frame))) {
+                        continue;
+                    }
+                    matched = true;
+                    if (!join(st, from, level + 1, frame, emit)) {
+                        frame.rows[level] = nullptr;
+                        return false;
+                    }
+                }
+                frame.rows[level] = nullptr;
+
+                if (!matched && ref.left) {
+                    return join(st, from, level + 1, frame, emit);
+                }
+                return true;
+            }
+
+            // ---------- INSERT / UPDATE / DELETE ----------
+
+            static Cell store(const ColumnDef& column, const Cell& value, bool provided)
+            {
+                if (value.is_null()) {
+                    if (column.notNull) {
+                        throw SqlError(provided ? "Column '" + column.name + "' cannot be null"
+                                                : "Field '" + column.name + "' doesn't have a default value");
+                    }
+                    return value;
+                }
+
+                try {
+                    return CellOps::coerce(value, column.type);
+                } catch (const SqlError& e) {
+                    throw SqlError(std::string(e.what()) + " for column '" + column.name + "'");
+                }
+            }
+
+            void insert(const Statement& st, StorageResult& result, UndoLog& undo)
+            {
+                MemoryTable& table = find_table(tables, st.table);
+
+                std::vector<size_t> targets;
+                if (st.columns.empty()) {
+                    for (size_t index = 0; index < table.columns.size(); ++index) {
+                        targets.push_back(index);
+                    }
+                } else {
+                    for (const auto& name : st.columns) {
+                        targets.push_back(static_cast<size_t>(table.column(name)));
+                    }
+                }
+
+                const Frame frame;
+                for (size_t rowNumber = 0; rowNumber < st.values.size(); ++rowNumber) {
+                    const auto& values = st.values[rowNumber];
+                    if (values.size() != targets.size()) {
+                        throw SqlError("Column count doesn't match value count at row " + std::to_string(rowNumber + 1));
+                    }
+
+                    std::vector<Cell> row(table.columns.size());
+                    std::vector<bool> provided(table.columns.size(), false);
+                    for (size_t index = 0; index < targets.size(); ++index) {
+                        row[targets[index]] = eval(*values[index], frame);
+                        provided[targets[index]] = true;
+                    }
+
+                    for (size_t index = 0; index < table.columns.size(); ++index) {
+                        const ColumnDef& column = table.columns[index];
+                        if (!provided[index] && column.hasDefault) {
+                            row[index] = column.defaultNow ? Cell::datetime(now) : column.defaultValue;
+                        }
+                    }
+
+                    if (table.autoColumn >= 0) {
+                        Cell& value = row[table.autoColumn];
+                        const int64_t given = value.is_null() ? 0 : CellOps::coerce(value, Cell::INT).number;
+                        if (given == 0) {
+                            value = Cell::integer(table.autoIncrement++);
+                            if (result.lastInsertId == 0) {
+                                result.lastInsertId = static_cast<uint64_t>(value.number);
+                            }
+                        } else if (given >= table.autoIncrement) {
+                            table.autoIncrement = given + 1;
+                        }
+                    }
+
+                    for (size_t index = 0; index < table.columns.size(); ++index) {
+                        row[index] = store(table.columns[index], row[index], provided[index]);
+                    }
+
+                    const int64_t rowId = table.nextRowId++;
+                    table.insert(rowId, std::move(row));
+                    undo.push_back({table.name, rowId, false, {}});
+                }
+
+                result.affectedRows = st.values.size();
+            }
+
+            // WHERE（及 LIMIT）命中的行号
+            std::vector<int64_t> matching_rows(const Statement& st, MemoryTable& table) const
+            {
+                Frame frame;
+                frame.rows.assign(1, nullptr);
+
+                const int64_t limit = count_value(st.limit);
+                bool ordered = false;
+                std::vector<int64_t> ids;
+                for (int64_t id : candidates(st.where.get(), 0, table, frame, nullptr, ordered)) {
+                    if (limit >= 0 && ids.size() >= static_cast<size_t>(limit)) {
+                        break;
+                    }
+                    frame.rows[0] = &table.rows.at(id);
+                    if (!st.where || CellOps::truthy(eval(*st.where, frame))) {
+                        ids.push_back(id);
+                    }
+                }
+                return ids;
+            }
+
+            void update(const Statement& st, StorageResult& result, UndoLog& undo)
+            {
+                MemoryTable& table = find_table(tables, st.from[0].table);
+
+                Frame frame;
+                frame.rows.assign(1, nullptr);
+
+                for (int64_t id : matching_rows(st, table)) {
+                    const std::vector<Cell>& current = table.rows.at(id);
+                    std::vector<Cell> updated = current;
+                    std::vector<bool> assigned(table.columns.size(), false);
+
+                    // 单表 UPDATE 按从左到右的顺序赋值，后面的表达式看到前面赋过的新值
+                    frame.rows[0] = &updated;
+                    for (const auto& assignment : st.assignments) {
+                        const ColumnDef& column = table.columns[assignment.index];
+                        updated[assignment.index] = store(column, eval(*assignment.value, frame), true);
+                        assigned[assignment.index] = true;
+                    }
+
+                    bool changed = false;
+                    for (size_t index = 0; index < updated.size() && !changed; ++index) {
+                        changed = !same_cell(updated[index], current[index]);
+                    }
+                    if (!changed) {
+                        continue;
+                    }
+
+                    for (size_t index = 0; index < table.columns.size(); ++index) {
+                        if (table.columns[index].onUpdateNow && !assigned[index]) {
+                            updated[index] = Cell::datetime(now);
+                        }
+                    }
+
+                    undo.push_back({table.name, id, true, current});
+                    table.replace(id, std::move(updated));
+                    ++result.affectedRows;
+                }
+            }
+
+            void remove(const Statement& st, StorageResult& result, UndoLog& undo)
+            {
+                MemoryTable& table = find_table(tables, st.from[0].table);
+
+                for (int64_t id : matching_rows(st, table)) {
+                    undo.push_back({table.name, id, true, table.rows.at(id)});
+                    table.erase(id);
+                    ++result.affectedRows;
+                }
+            }
+
+            // ---------- DDL ----------
+
+            void create_table(const Statement& st)
+            {
+                if (tables.count(st.table)) {
+                    if (st.ifExists) {
+                        return;
+                    }
+                    throw SqlError("Table '" + st.table + "' already exists");
+                }
+
+                auto table = std::make_unique<MemoryTable>();
+                table->name = st.table;
+                table->autoIncrement = std::max<int64_t>(st.autoIncrement, 1);
+
+                IndexDef primary;
+                primary.name = "PRIMARY";
+                primary.primary = primary.unique = true;
+
+                for (const auto& column : st.columnDefs) {
+                    table->add_column(column);
+                    if (column.primaryKey) {
+                        primary.columns.push_back(column.name);
+                    }
+                }
+                for (const auto& index : st.indexes) {
+                    if (index.primary) {
+                        primary.columns = index.columns;
+                    }
+                }
+                if (!primary.columns.empty()) {
+                    table->add_index(primary);
+                }
+
+                for (const auto& column : st.columnDefs) {
+                    if (column.unique && !column.primaryKey) {
+                        IndexDef index;
+                        index.name = column.name;
+                        index.columns = {column.name};
+                        index.unique = true;
+                        table->add_index(index);
+                    }
+                }
+                for (auto index : st.indexes) {
+                    if (index.primary) {
+                        continue;
+                    }
+                    if (index.name.empty()) {
+                        index.name = index.columns[0];
+                    }
+                    table->add_index(index);
+                }
+
+                table->update_auto_column();
+
+                tables.emplace(st.table, std::move(table));
+            }
+
+            void alter_table(const Statement& st)
+            {
+                MemoryTable& table = find_table(tables, st.table);
+
+                for (const auto& action : st.actions) {
+                    switch (action.kind) {
+                        case AlterAction::ADD_COLUMN:
+                            table.add_column(action.column);
+                            break;
+
+                        case AlterAction::MODIFY_COLUMN:
+                            table.modify_column(action.column);
+                            break;
+
+                        case AlterAction::ADD_INDEX: {
+                            IndexDef index = action.index;
+                            if (index.name.empty()) {
+                                index.name = index.columns[0];
+                            }
+                            table.add_index(index);
+                            break;
+                        }
+
+                        case AlterAction::DROP_INDEX: {
+                            auto it = std::find_if(table.indexes.begin(), table.indexes.end(), [&](const MemoryIndex& index) {
+                                return lower(index.def.name) == lower(action.index.name);
+                            });
+                            if (it == table.indexes.end()) {
+                                throw SqlError("Can't DROP '" + action.index.name + "'; check that column/key exists");
+                            }
+                            table.indexes.erase(it);
+                            break;
+                        }
+                    }
+                }
+            }
+
+            void drop_table(const Statement& st)
+            {
+                if (!tables.erase(st.table) && !st.ifExists) {
+                    throw SqlError("Unknown table '" + st.table + "'");
+                }
+            }
+
+        private:
+            Tables& tables;
+            const std::vector<Cell>& params;
+            const int64_t now;
+        };
+
+        bool is_query(const std::string& sql)
+        {
+            size_t index = 0;
+            while (index < sql.size() && (std::isspace(static_cast<unsigned char>(sql[index])) || sql[index] == '(')) {
+                ++index;
+            }
+            return sql.size() - index >= 6 && lower(sql.substr(index, 6)) == "select";
+        }
+
+        bool is_ddl(const Statement& st)
+        {
+            return st.kind == Statement::CREATE_TABLE || st.kind == Statement::CREATE_INDEX ||
+                   st.kind == Statement::ALTER_TABLE || st.kind == Statement::DROP_TABLE;
+        }
+    }
+
+    // ==================== MemoryDatabase ====================
+
+    std::shared_ptr<MemoryDatabase> MemoryDatabase::open(const std::string& name, const std::string& schemaFile)
+    {
+        // 库在进程内一直保留，连接池重连时不会丢失数据
+        static std::mutex registryMutex;
+        static std::unordered_map<std::string, std::shared_ptr<MemoryDatabase>> registry;
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto& database = registry[name];
+        if (!database) {
+            auto created = std::make_shared<MemoryDatabase>();
+            if (!schemaFile.empty()) {
+                std::ifstream file(schemaFile);
+                if (!file) {
+                    throw std::runtime_error("Cannot open schema file " + schemaFile);
+                }
+                std::stringstream script;
+                script << file.rdbuf();
+                created->execute_script(script.str());
+            }
+            database = created;
+            std::cout << "Memory database " << name << " created with " << database->tables.size() << " tables" << std::endl;
+        }
+        return database;
+    }
+
+    MemoryDatabase::MemoryDatabase() = default;
+
+    MemoryDatabase::~MemoryDatabase() = default;
+
+    void MemoryDatabase::execute(const std::string& sql, const SqlParams& params, StorageResult& result, UndoLog* undo)
+    {
+        std::vector<Cell> cells;
+        cells.reserve(params.size());
+        for (const auto& param : params) {
+            cells.push_back(from_value(param));
+        }
+
+        if (is_query(sql)) {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto st = statement(sql);
+            run(*st, cells, result, undo);
+        } else {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            auto st = statement(sql);
+            run(*st, cells, result, undo);
+        }
+    }
+
+    void MemoryDatabase::execute_script(const std::string& script)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for (auto& parsed : parse_script(script)) {
+            Resolver(tables, *parsed).resolve();
+            StorageResult result;
+            run(*parsed, {}, result, nullptr);
+        }
+    }
+
+    void MemoryDatabase::rollback(const UndoLog& undo)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for (auto it = undo.rbegin(); it != undo.rend(); ++it) {
+            auto table = tables.find(it->table);
+            if (table != tables.end()) {
+                table->second->restore(it->rowId, it->existed ? &it->row : nullptr);
+            }
+        }
+    }
+
+    bool MemoryDatabase::has_index(const std::string& table, const std::string& index)
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = tables.find(table);
+        if (it == tables.end()) {
+            return false;
+        }
+        return std::any_of(it->second->indexes.begin(), it->second->indexes.end(), [&](const MemoryIndex& entry) {
+            return lower(entry.def.name) == lower(index);
+        });
+    }
+
+    bool MemoryDatabase::has_column(const std::string& table, const std::string& column)
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = tables.find(table);
+        return it != tables.end() && it->second->column(column) >= 0;
+    }
+
+    std::shared_ptr<const Statement> MemoryDatabase::statement(const std::string& sql)
+    {
+        {
+            std::lock_guard<std::mutex> lock(statementMutex);
+            auto it = statements.find(sql);
+            if (it != statements.end()) {
+                return it->second;
+            }
+        }
+
+        std::unique_ptr<Statement> parsed = parse_statement(sql);
+        Resolver(tables, *parsed).resolve();
+        std::shared_ptr<const Statement> st = std::move(parsed);
+
+        // 列下标在解析时确定，DDL 后缓存整体失效，DDL 本身不缓存
+        if (!is_ddl(*st)) {
+            std::lock_guard<std::mutex> lock(statementMutex);
+            if (statements.size() >= STATEMENT_CACHE_CAPACITY) {
+                statements.clear();
+            }
+            statements.emplace(sql, st);
+        }
+        return st;
+    }
+
+    void MemoryDatabase::run(const Statement& st, const std::vector<Cell>& params, StorageResult& result, UndoLog* undo)
+    {
+        // 单条语句失败时撤销它已做的修改
+        UndoLog local;
+        try {
+            Executor(tables, params).run(st, result, local);
+        } catch (...) {
+            for (auto it = local.rbegin(); it != local.rend(); ++it) {
+                tables.at(it->table)->restore(it->rowId, it->existed ? &it->row : nullptr);
+            }
+            throw;
+        }
+
+        if (is_ddl(st)) {
+            std::lock_guard<std::mutex> lock(statementMutex);
+            statements.clear();
+        }
+        if (undo) {
+            undo->insert(undo->end(), local.begin(), local.end());
+        }
+    }
+
+    // ==================== MemoryBackend ====================
+
+    MemoryBackend::MemoryBackend(std::shared_ptr<MemoryDatabase> database)
+        : database(std::move(database))
+    {
+    }
+
+    MemoryBackend::~MemoryBackend()
+    {
+        // 与关闭 MySQL 会话一致：未提交的事务回滚
+        if (inTransaction) {
+            database->rollback(undo);
+        }
+    }
+
+    bool MemoryBackend::execute(const std::string& sql, const SqlParams& params,
+                                StorageResult& result, std::string& error)
+    {
+        try {
+            database->execute(sql, params, result, inTransaction ? &undo : nullptr);
+            return true;
+        } catch (const std::exception& e) {
+            error = e.what();
+            return false;
+        }
+    }
+
+    int MemoryBackend::index_exists(const std::string& table, const std::string& index, std::string&)
+    {
+        return database->has_index(table, index) ? 1 : 0;
+    }
+
+    int MemoryBackend::column_exists(const std::string& table, const std::string& column, std::string&)
+    {
+        return database->has_column(table, column) ? 1 : 0;
+    }
+
+    bool MemoryBackend::begin(std::string& error)
+    {
+        if (inTransaction) {
+            error = "transaction already started";
+            return false;
+        }
+        inTransaction = true;
+        undo.clear();
+        return true;
+    }
+
+    bool MemoryBackend::commit(std::string& error)
+    {
+        if (!inTransaction) {
+            error = "no transaction";
+            return false;
+        }
+        inTransaction = false;
+        undo.clear();
+        return true;
+    }
+
+    bool MemoryBackend::rollback(std::string& error)
+    {
+        if (!inTransaction) {
+            error = "no transaction";
+            return false;
+        }
+        inTransaction = false;
+        database->rollback(undo);
+        undo.clear();
+        return true;
+    }
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "storage_backend.h"
+#include "memory_sql.h"
+
+namespace TakeAwayPlatform
+{
+    struct MemoryTable;
+
+    // 事务回滚用的行镜像，existed 为 false 表示该行在修改前不存在
+    struct UndoEntry {
+        std::string table;
+        int64_t rowId = 0;
+        bool existed = false;
+        std::vector<Cell> row;
+    };
+    using UndoLog = std::vector<UndoEntry>;
+
+    // 进程内的表存储，用于压测和无网络环境下的性能测试。
+    // 支持 create_tables.sql 的建表语句和 UserManager、RestServer 使用的语句形状：
+    // 单表及 JOIN 查询、WHERE / ORDER BY / LIMIT、COUNT(CASE ...) 等聚合、多行 INSERT、UPDATE、DELETE，
+    // 以及 CREATE INDEX / ALTER TABLE（迁移脚本）。主键和唯一索引带哈希表做点查和唯一性检查，
+    // 所有索引另有有序结构，等值前缀 + ORDER BY 与索引列一致时按索引顺序读取并在 LIMIT 处提前结束。
+    // 语句之间用读写锁串行化，单条语句原子。外键、触发器、GROUP BY 和子查询不支持。
+    //
+    // 事务的隔离性弱于 MySQL 的任何隔离级别，只能用于压测和单机环境，不能用来验证并发正确性：
+    //   - 事务只提供回滚：每条语句执行后立即生效，未提交的修改对其他会话可见（脏读）；
+    //   - 没有行锁，SELECT ... FOR UPDATE / LOCK IN SHARE MODE 只解析不加锁，
+    //     两个事务可以交替修改同一行；
+    //   - 回滚按行镜像把本事务改过的行恢复为修改前的值，其间其他会话对这些行的修改被覆盖（丢失更新）；
+    //   - DDL 不记入回滚日志，与 MySQL 的隐式提交一致。
+    // 因此并发的读改写必须以条件更新保证正确（DatabaseHandler::compare_and_swap 的版本号），
+    // 不能依赖事务隔离；依赖隔离级别的逻辑需在 MySQL 上验证
+    class MemoryDatabase
+    {
+    public:
+        // 同名库在进程内共享，首次打开时执行 schemaFile 中的建表脚本（为空时建空库）
+        static std::shared_ptr<MemoryDatabase> open(const std::string& name, const std::string& schemaFile);
+
+        MemoryDatabase();
+        ~MemoryDatabase();
+
+        // 执行一条语句，失败抛出 SqlError 且不留下部分修改；undo 非空时追加本语句的行镜像
+        void execute(const std::string& sql, const SqlParams& params, StorageResult& result, UndoLog* undo);
+
+        // 执行以 ';' 分隔的脚本（建表脚本、迁移脚本）
+        void execute_script(const std::string& script);
+
+        // 按 undo 逆序恢复行镜像
+        void rollback(const UndoLog& undo);
+
+        // 表不存在时视为不存在；索引名和列名不区分大小写，与 MySQL 一致
+        bool has_index(const std::string& table, const std::string& index);
+        bool has_column(const std::string& table, const std::string& column);
+
+    private:
+        using TableMap = std::unordered_map<std::string, std::unique_ptr<MemoryTable>>;
+
+        // 取出（或解析并缓存）语句；调用方需持有 mutex
+        std::shared_ptr<const Statement> statement(const std::string& sql);
+
+        void run(const Statement& st, const std::vector<Cell>& params, StorageResult& result, UndoLog* undo);
+
+    private:
+        // 语句模板数量有限，超出容量说明调用方拼接了变量，整体丢弃即可
+        static constexpr size_t STATEMENT_CACHE_CAPACITY = 256;
+
+        std::shared_mutex mutex;        // 查询共享，写语句和 DDL 独占
+        TableMap tables;
+
+        std::mutex statementMutex;
+        std::unordered_map<std::string, std::shared_ptr<const Statement>> statements;
+    };
+
+    // 一个 DatabaseHandler 对应的内存库会话；begin 之后的修改记入回滚日志，隔离性见 MemoryDatabase
+    class MemoryBackend : public StorageBackend
+    {
+    public:
+        explicit MemoryBackend(std::shared_ptr<MemoryDatabase> database);
+        ~MemoryBackend() override;
+
+        const char* name() const override { return "memory"; }
+
+        bool execute(const std::string& sql, const SqlParams& params,
+                     StorageResult& result, std::string& error) override;
+
+        bool begin(std::string& error) override;
+        bool commit(std::string& error) override;
+        bool rollback(std::string& error) override;
+
+        bool ping() override { return true; }
+
+        int index_exists(const std::string& table, const std::string& index, std::string& error) override;
+        int column_exists(const std::string& table, const std::string& column, std::string& error) override;
+
+    private:
+        std::shared_ptr<MemoryDatabase> database;
+        UndoLog undo;
+        bool inTransaction = false;
+    };
+
+}
@@ -0,0 +1,1400 @@
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <set>
+
+#include "memory_sql.h"
+
+
+namespace TakeAwayPlatform
+{
+    // ==================== CellOps ====================
+
+    namespace CellOps
+    {
+        namespace
+        {
+            bool parse_datetime(const std::string& text, int64_t& out)
+            {
+                std::tm local {};
+                if (std::sscanf(text.c_str(), "%d-%d-%d %d:%d:%d", &local.tm_year, &local.tm_mon,
+                                &local.tm_mday, &local.tm_hour, &local.tm_min, &local.tm_sec) < 3) {
+                    return false;
+                }
+                local.tm_year -= 1900;
+                local.tm_mon -= 1;
+                local.tm_isdst = -1;
+                out = static_cast<int64_t>(std::mktime(&local));
+                return true;
+            }
+
+            int64_t to_seconds(const Cell& value)
+            {
+                switch (value.kind) {
+                    case Cell::TEXT: {
+                        int64_t seconds = 0;
+                        if (!parse_datetime(value.text, seconds)) {
+                            throw SqlError("Incorrect datetime value: '" + value.text + "'");
+                        }
+                        return seconds;
+                    }
+                    case Cell::DOUBLE:
+                        return static_cast<int64_t>(value.real);
+                    case Cell::DECIMAL:
+                        return value.number / 100;
+                    default:
+                        return value.number;
+                }
+            }
+
+            bool to_money(const Cell& value, Money& out)
+            {
+                switch (value.kind) {
+                    case Cell::DECIMAL:
+                        out = Money::fromCents(value.number);
+                        return true;
+                    case Cell::INT:
+                        out = Money::fromCents(value.number * 100);
+                        return true;
+                    case Cell::TEXT:
+                        return Money::parse(value.text, out);
+                    default:
+                        return false;
+                }
+            }
+
+            template <class T>
+            int three_way(T a, T b)
+            {
+                return a < b ? -1 : (b < a ? 1 : 0);
+            }
+        }
+
+        int compare(const Cell& a, const Cell& b)
+        {
+            if (a.kind == Cell::DATETIME || b.kind == Cell::DATETIME) {
+                return three_way(to_seconds(a), to_seconds(b));
+            }
+
+            if (a.kind == Cell::TEXT && b.kind == Cell::TEXT) {
+                return three_way(a.text.compare(b.text), 0);
+            }
+
+            if (a.kind == Cell::DECIMAL || b.kind == Cell::DECIMAL) {
+                Money x, y;
+                if (to_money(a, x) && to_money(b, y)) {
+                    return three_way(x.cents(), y.cents());
+                }
+            }
+
+            if (a.kind == Cell::INT && b.kind == Cell::INT) {
+                return three_way(a.number, b.number);
+            }
+            return three_way(to_double(a), to_double(b));
+        }
+
+        Cell coerce(const Cell& value, Cell::Kind kind)
+        {
+            if (value.is_null() || value.kind == kind) {
+                return value;
+            }
+
+            switch (kind) {
+                case Cell::INT:
+                    if (value.kind == Cell::TEXT) {
+                        char* end = nullptr;
+                        const double number = std::strtod(value.text.c_str(), &end);
+                        if (value.text.empty() || *end != '\0') {
+                            throw SqlError("Incorrect integer value: '" + value.text + "'");
+                        }
+                        return Cell::integer(std::llround(number));
+                    }
+                    if (value.kind == Cell::DECIMAL) {
+                        return Cell::integer(std::llround(value.number / 100.0));
+                    }
+                    if (value.kind == Cell::DOUBLE) {
+                        return Cell::integer(std::llround(value.real));
+                    }
+                    return Cell::integer(value.number);
+
+                case Cell::DOUBLE:
+                    return Cell::floating(to_double(value));
+
+                case Cell::DECIMAL: {
+                    Money money;
+                    if (value.kind == Cell::DOUBLE) {
+                        return Cell::decimal(Money::fromYuan(value.real));
+                    }
+                    if (!to_money(value, money)) {
+                        throw SqlError("Incorrect decimal value: '" + to_string(value) + "'");
+                    }
+                    return Cell::decimal(money);
+                }
+
+                case Cell::DATETIME:
+                    return Cell::datetime(to_seconds(value));
+
+                case Cell::TEXT:
+                    return Cell::string(to_string(value));
+
+                default:
+                    return value;
+            }
+        }
+
+        bool truthy(const Cell& value)
+        {
+            switch (value.kind) {
+                case Cell::NUL:
+                    return false;
+                case Cell::DOUBLE:
+                case Cell::TEXT:
+                    return to_double(value) != 0;
+                default:
+                    return value.number != 0;
+            }
+        }
+
+        double to_double(const Cell& value)
+        {
+            switch (value.kind) {
+                case Cell::DOUBLE:
+                    return value.real;
+                case Cell::DECIMAL:
+                    return value.number / 100.0;
+                case Cell::TEXT:
+                    return std::strtod(value.text.c_str(), nullptr);
+                case Cell::NUL:
+                    return 0;
+                default:
+                    return static_cast<double>(value.number);
+            }
+        }
+
+        std::string format_datetime(int64_t seconds)
+        {
+            std::time_t time = static_cast<std::time_t>(seconds);
+            std::tm local {};
+            localtime_r(&time, &local);
+
+            char buffer[20];
+            std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+            return buffer;
+        }
+
+        std::string to_string(const Cell& value)
+        {
+            switch (value.kind) {
+                case Cell::NUL:
+                    return "NULL";
+                case Cell::INT:
+                    return std::to_string(value.number);
+                case Cell::DOUBLE: {
+                    char buffer[32];
+                    std::snprintf(buffer, sizeof(buffer), "%.15g", value.real);
+                    return buffer;
+                }
+                case Cell::DECIMAL:
+                    return Money::fromCents(value.number).toString();
+                case Cell::DATETIME:
+                    return format_datetime(value.number);
+                default:
+                    return value.text;
+            }
+        }
+    }
+
+    // ==================== 词法分析 ====================
+
+    namespace
+    {
+        struct Token {
+            enum Kind { IDENT, QUOTED_IDENT, NUMBER, STRING, SYMBOL, PARAM, END };
+
+            Kind kind = END;
+            std::string text;       // 标识符原文、字符串内容（已去转义）、运算符
+            std::string upper;      // IDENT 的大写形式，用于匹配关键字
+            size_t begin = 0;
+            size_t end = 0;
+        };
+
+        bool identifier_char(char ch)
+        {
+            return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' || ch == '$'
+                || static_cast<unsigned char>(ch) >= 0x80;
+        }
+
+        std::vector<Token> tokenize(const std::string& sql)
+        {
+            std::vector<Token> tokens;
+            size_t index = 0;
+
+            while (index < sql.size()) {
+                const char ch = sql[index];
+                const char next = index + 1 < sql.size() ? sql[index + 1] : '\0';
+
+                if (std::isspace(static_cast<unsigned char>(ch))) {
+                    ++index;
+                    continue;
+                }
+
+                // 注释
+                if ((ch == '-' && next == '-') || ch == '#') {
+                    while (index < sql.size() && sql[index] != '\n') {
+                        ++index;
+                    }
+                    continue;
+                }
+                if (ch == '/' && next == '*') {
+                    const size_t close = sql.find("*/", index + 2);
+                    index = close == std::string::npos ? sql.size() : close + 2;
+                    continue;
+                }
+
+                Token token;
+                token.begin = index;
+
+                if (identifier_char(ch) && !std::isdigit(static_cast<unsigned char>(ch))) {
+                    while (index < sql.size() && identifier_char(sql[index])) {
+                        ++index;
+                    }
+                    token.kind = Token::IDENT;
+                    token.text = sql.substr(token.begin, index - token.begin);
+                    for (char c : token.text) {
+                        token.upper += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+                    }
+                } else if (ch == '`') {
+                    ++index;
+                    while (index < sql.size()) {
+                        if (sql[index] == '`') {
+                            if (index + 1 < sql.size() && sql[index + 1] == '`') {
+                                token.text += '`';
+                                index += 2;
+                                continue;
+                            }
+                            break;
+                        }
+                        token.text += sql[index++];
+                    }
+                    if (index >= sql.size()) {
+                        throw SqlError("Unterminated identifier");
+                    }
+                    ++index;
+                    token.kind = Token::QUOTED_IDENT;
+                } else if (std::isdigit(static_cast<unsigned char>(ch)) ||
+                           (ch == '.' && std::isdigit(static_cast<unsigned char>(next)))) {
+                    while (index < sql.size() && (std::isdigit(static_cast<unsigned char>(sql[index])) || sql[index] == '.')) {
+                        ++index;
+                    }
+                    if (index < sql.size() && (sql[index] == 'e' || sql[index] == 'E')) {
+                        ++index;
+                        if (index < sql.size() && (sql[index] == '+' || sql[index] == '-')) {
+                            ++index;
+                        }
+                        while (index < sql.size() && std::isdigit(static_cast<unsigned char>(sql[index]))) {
+                            ++index;
+                        }
+                    }
+                    token.kind = Token::NUMBER;
+                    token.text = sql.substr(token.begin, index - token.begin);
+                } else if (ch == '\'' || ch == '"') {
+                    ++index;
+                    bool closed = false;
+                    while (index < sql.size()) {
+                        const char c = sql[index];
+                        if (c == '\\' && index + 1 < sql.size()) {
+                            const char escaped = sql[index + 1];
+                            token.text += escaped == 'n' ? '\n' : escaped == 't' ? '\t' : escaped == '0' ? '\0' : escaped;
+                            index += 2;
+                        } else if (c == ch) {
+                            if (index + 1 < sql.size() && sql[index + 1] == ch) {
+                                token.text += ch;
+                                index += 2;
+                            } else {
+                                ++index;
+                                closed = true;
+                                break;
+                            }
+                        } else {
+                            token.text += c;
+                            ++index;
+                        }
+                    }
+                    if (!closed) {
+                        throw SqlError("Unterminated string literal");
+                    }
+                    token.kind = Token::STRING;
+                } else if (ch == '?') {
+                    ++index;
+                    token.kind = Token::PARAM;
+                    token.text = "?";
+                } else {
+                    static const char* const TWO_CHAR[] = {"<=", ">=", "<>", "!="};
+                    token.kind = Token::SYMBOL;
+                    for (const char* symbol : TWO_CHAR) {
+                        if (ch == symbol[0] && next == symbol[1]) {
+                            token.text = symbol;
+                        }
+                    }
+                    if (token.text.empty()) {
+                        if (!std::strchr("(),.;*=<>+-/%", ch)) {
+                            throw SqlError(std::string("Unexpected character '") + ch + "'");
+                        }
+                        token.text = std::string(1, ch);
+                    }
+                    index += token.text.size();
+                }
+
+                token.end = index;
+                tokens.push_back(std::move(token));
+            }
+
+            Token end;
+            end.begin = end.end = sql.size();
+            tokens.push_back(end);
+            return tokens;
+        }
+
+        // ==================== 语法分析 ====================
+
+        ExprPtr clone(const Expr& source)
+        {
+            auto copy = std::make_unique<Expr>();
+            copy->kind = source.kind;
+            copy->op = source.op;
+            copy->value = source.value;
+            copy->param = source.param;
+            copy->table = source.table;
+            copy->column = source.column;
+            copy->negated = source.negated;
+            copy->star = source.star;
+            copy->castType = source.castType;
+            copy->text = source.text;
+            for (const auto& arg : source.args) {
+                copy->args.push_back(clone(*arg));
+            }
+            return copy;
+        }
+
+        // 不能用作表别名、列别名的关键字
+        const std::set<std::string> RESERVED {
+            "FROM", "WHERE", "ORDER", "GROUP", "HAVING", "LIMIT", "OFFSET", "LEFT", "RIGHT", "INNER",
+            "OUTER", "CROSS", "JOIN", "ON", "USING", "AS", "SET", "VALUES", "FOR", "LOCK", "UNION",
+            "AND", "OR", "NOT", "ASC", "DESC"
+        };
+
+        class Parser
+        {
+        public:
+            explicit Parser(const std::string& sql) : sql(sql), tokens(tokenize(sql)) {}
+
+            std::unique_ptr<Statement> statement()
+            {
+                auto st = std::make_unique<Statement>();
+                params = 0;
+
+                if (accept("SELECT")) {
+                    parse_select(*st);
+                } else if (accept("INSERT")) {
+                    parse_insert(*st);
+                } else if (accept("UPDATE")) {
+                    parse_update(*st);
+                } else if (accept("DELETE")) {
+                    parse_delete(*st);
+                } else if (accept("CREATE")) {
+                    parse_create(*st);
+                } else if (accept("ALTER")) {
+                    parse_alter(*st);
+                } else if (accept("DROP")) {
+                    parse_drop(*st);
+                } else if (accept("SET")) {
+                    parse_set(*st);
+                } else {
+                    throw SqlError("Unsupported statement near '" + near() + "'");
+                }
+
+                st->paramCount = params;
+                return st;
+            }
+
+            // 跳过语句间的 ';'，已到结尾时返回 true
+            bool finished()
+            {
+                while (accept(";")) {
+                }
+                return peek().kind == Token::END;
+            }
+
+            void expect_separator()
+            {
+                if (!accept(";") && peek().kind != Token::END) {
+                    throw SqlError("Syntax error near '" + near() + "'");
+                }
+            }
+
+        private:
+            const Token& peek(size_t ahead = 0) const
+            {
+                return tokens[std::min(position + ahead, tokens.size() - 1)];
+            }
+
+            std::string near() const
+            {
+                const Token& token = peek();
+                return token.kind == Token::END ? "end of statement" : sql.substr(token.begin, 40);
+            }
+
+            static bool matches(const Token& token, const char* word)
+            {
+                if (std::isalpha(static_cast<unsigned char>(word[0]))) {
+                    return token.kind == Token::IDENT && token.upper == word;
+                }
+                return token.kind == Token::SYMBOL && token.text == word;
+            }
+
+            bool accept(const char* word)
+            {
+                if (matches(peek(), word)) {
+                    ++position;
+                    return true;
+                }
+                return false;
+            }
+
+            void expect(const char* word)
+            {
+                if (!accept(word)) {
+                    throw SqlError(std::string("Expected '") + word + "' near '" + near() + "'");
+                }
+            }
+
+            std::string identifier()
+            {
+                const Token& token = peek();
+                if (token.kind != Token::IDENT && token.kind != Token::QUOTED_IDENT) {
+                    throw SqlError("Expected identifier near '" + near() + "'");
+                }
+                ++position;
+                return token.text;
+            }
+
+            // 可选的别名：AS name，或紧跟的非关键字标识符
+            std::string alias()
+            {
+                if (accept("AS")) {
+                    if (peek().kind == Token::STRING) {
+                        return tokens[position++].text;
+                    }
+                    return identifier();
+                }
+
+                const Token& token = peek();
+                if ((token.kind == Token::IDENT && !RESERVED.count(token.upper)) || token.kind == Token::QUOTED_IDENT) {
+                    ++position;
+                    return token.text;
+                }
+                return "";
+            }
+
+            // 跳过一对括号及其内容
+            void skip_parens()
+            {
+                expect("(");
+                int depth = 1;
+                while (depth > 0) {
+                    if (peek().kind == Token::END) {
+                        throw SqlError("Unbalanced parentheses");
+                    }
+                    if (matches(peek(), "(")) {
+                        ++depth;
+                    } else if (matches(peek(), ")")) {
+                        --depth;
+                    }
+                    ++position;
+                }
+            }
+
+            std::vector<std::string> index_columns()
+            {
+                std::vector<std::string> columns;
+                expect("(");
+                do {
+                    columns.push_back(identifier());
+                    if (matches(peek(), "(")) {
+                        skip_parens();      // 前缀长度
+                    }
+                    if (!accept("ASC")) {
+                        accept("DESC");
+                    }
+                } while (accept(","));
+                expect(")");
+                return columns;
+            }
+
+            // ---------- SELECT ----------
+
+            void parse_select(Statement& st)
+            {
+                st.kind = Statement::SELECT;
+                if (matches(peek(), "DISTINCT")) {
+                    throw SqlError("SELECT DISTINCT is not supported");
+                }
+
+                do {
+                    SelectItem item;
+                    if (accept("*")) {
+                        item.star = true;
+                    } else if ((peek().kind == Token::IDENT || peek().kind == Token::QUOTED_IDENT) &&
+                               matches(peek(1), ".") && matches(peek(2), "*")) {
+                        item.star = true;
+                        item.starTable = identifier();
+                        position += 2;
+                    } else {
+                        item.expr = expression();
+                        item.alias = alias();
+                    }
+                    st.items.push_back(std::move(item));
+                } while (accept(","));
+
+                if (accept("FROM")) {
+                    table_refs(st.from);
+                }
+                if (accept("WHERE")) {
+                    st.where = expression();
+                }
+                if (matches(peek(), "GROUP") || matches(peek(), "HAVING") || matches(peek(), "UNION")) {
+                    throw SqlError(peek().upper + " is not supported");
+                }
+                order_by(st);
+                limit(st);
+
+                if (accept("FOR")) {
+                    if (!accept("UPDATE")) {
+                        expect("SHARE");
+                    }
+                } else if (accept("LOCK")) {
+                    expect("IN");
+                    expect("SHARE");
+                    expect("MODE");
+                }
+            }
+
+            void table_refs(std::vector<TableRef>& from)
+            {
+                from.push_back(table_ref());
+
+                while (true) {
+                    TableRef ref;
+                    if (accept(",")) {
+                        from.push_back(table_ref());
+                        continue;
+                    }
+
+                    if (accept("LEFT")) {
+                        accept("OUTER");
+                        expect("JOIN");
+                        ref = table_ref();
+                        ref.left = true;
+                    } else if (accept("INNER") || accept("CROSS")) {
+                        expect("JOIN");
+                        ref = table_ref();
+                    } else if (accept("JOIN")) {
+                        ref = table_ref();
+                    } else if (matches(peek(), "RIGHT")) {
+                        throw SqlError("RIGHT JOIN is not supported");
+                    } else {
+                        break;
+                    }
+
+                    if (accept("ON")) {
+                        ref.on = expression();
+                    } else if (ref.left) {
+                        throw SqlError("LEFT JOIN requires ON");
+                    }
+                    from.push_back(std::move(ref));
+                }
+            }
+
+            TableRef table_ref()
+            {
+                TableRef ref;
+                ref.table = identifier();
+                ref.alias = alias();
+                return ref;
+            }
+
+            void order_by(Statement& st)
+            {
+                if (!accept("ORDER")) {
+                    return;
+                }
+                expect("BY");
+                do {
+                    OrderItem item;
+                    item.expr = expression();
+                    if (accept("DESC")) {
+                        item.desc = true;
+                    } else {
+                        accept("ASC");
+                    }
+                    st.orderBy.push_back(std::move(item));
+                } while (accept(","));
+            }
+
+            void limit(Statement& st)
+            {
+                if (!accept("LIMIT")) {
+                    return;
+                }
+                ExprPtr first = expression();
+                if (accept(",")) {
+                    st.offset = std::move(first);
+                    st.limit = expression();
+                } else {
+                    st.limit = std::move(first);
+                    if (accept("OFFSET")) {
+                        st.offset = expression();
+                    }
+                }
+            }
+
+            // ---------- INSERT / UPDATE / DELETE ----------
+
+            void parse_insert(Statement& st)
+            {
+                st.kind = Statement::INSERT;
+                if (matches(peek(), "IGNORE")) {
+                    throw SqlError("INSERT IGNORE is not supported");
+                }
+                expect("INTO");
+                st.table = identifier();
+
+                if (accept("(")) {
+                    do {
+                        st.columns.push_back(identifier());
+                    } while (accept(","));
+                    expect(")");
+                }
+
+                if (!accept("VALUES")) {
+                    expect("VALUE");
+                }
+                do {
+                    std::vector<ExprPtr> row;
+                    expect("(");
+                    do {
+                        row.push_back(expression());
+                    } while (accept(","));
+                    expect(")");
+                    st.values.push_back(std::move(row));
+                } while (accept(","));
+
+                if (matches(peek(), "ON")) {
+                    throw SqlError("ON DUPLICATE KEY UPDATE is not supported");
+                }
+            }
+
+            void parse_update(Statement& st)
+            {
+                st.kind = Statement::UPDATE;
+                st.from.push_back(table_ref());
+                expect("SET");
+
+                do {
+                    Assignment assignment;
+                    assignment.column = identifier();
+                    if (accept(".")) {
+                        assignment.column = identifier();
+                    }
+                    expect("=");
+                    assignment.value = expression();
+                    st.assignments.push_back(std::move(assignment));
+                } while (accept(","));
+
+                if (accept("WHERE")) {
+                    st.where = expression();
+                }
+                limit(st);
+            }
+
+            void parse_delete(Statement& st)
+            {
+                st.kind = Statement::DELETE;
+                expect("FROM");
+                st.from.push_back(table_ref());
+                if (accept("WHERE")) {
+                    st.where = expression();
+                }
+                limit(st);
+            }
+
+            // ---------- DDL ----------
+
+            void parse_create(Statement& st)
+            {
+                const bool unique = accept("UNIQUE");
+                if (accept("INDEX") || accept("KEY")) {
+                    st.kind = Statement::CREATE_INDEX;
+                    IndexDef index;
+                    index.name = identifier();
+                    index.unique = unique;
+                    expect("ON");
+                    st.table = identifier();
+                    index.columns = index_columns();
+                    st.indexes.push_back(std::move(index));
+                    return;
+                }
+                if (unique) {
+                    throw SqlError("Expected INDEX near '" + near() + "'");
+                }
+
+                expect("TABLE");
+                st.kind = Statement::CREATE_TABLE;
+                if (accept("IF")) {
+                    expect("NOT");
+                    expect("EXISTS");
+                    st.ifExists = true;
+                }
+                st.table = identifier();
+
+                expect("(");
+                do {
+                    table_element(st);
+                } while (accept(","));
+                expect(")");
+
+                // 表选项：只关心 AUTO_INCREMENT 初始值
+                while (peek().kind != Token::END && !matches(peek(), ";")) {
+                    if (accept("AUTO_INCREMENT")) {
+                        accept("=");
+                        st.autoIncrement = std::stoll(peek().text);
+                    }
+                    ++position;
+                }
+            }
+
+            void table_element(Statement& st)
+            {
+                if (accept("CONSTRAINT")) {
+                    if (!matches(peek(), "PRIMARY") && !matches(peek(), "UNIQUE") &&
+                        !matches(peek(), "FOREIGN") && !matches(peek(), "CHECK")) {
+                        identifier();
+                    }
+                }
+
+                if (accept("PRIMARY")) {
+                    expect("KEY");
+                    IndexDef index;
+                    index.name = "PRIMARY";
+                    index.primary = index.unique = true;
+                    index.columns = index_columns();
+                    st.indexes.push_back(std::move(index));
+                } else if (accept("UNIQUE")) {
+                    if (!accept("KEY")) {
+                        accept("INDEX");
+                    }
+                    IndexDef index;
+                    index.unique = true;
+                    if (!matches(peek(), "(")) {
+                        index.name = identifier();
+                    }
+                    index.columns = index_columns();
+                    st.indexes.push_back(std::move(index));
+                } else if (accept("INDEX") || accept("KEY")) {
+                    IndexDef index;
+                    if (!matches(peek(), "(")) {
+                        index.name = identifier();
+                    }
+                    index.columns = index_columns();
+                    st.indexes.push_back(std::move(index));
+                } else if (accept("FOREIGN")) {
+                    // 外键不做检查
+                    expect("KEY");
+                    if (!matches(peek(), "(")) {
+                        identifier();
+                    }
+                    skip_parens();
+                    expect("REFERENCES");
+                    identifier();
+                    skip_parens();
+                    // ON DELETE / ON UPDATE 动作：CASCADE、RESTRICT、SET NULL、NO ACTION ...
+                    while (accept("ON")) {
+                        ++position;
+                        if (accept("SET") || accept("NO")) {
+                            ++position;
+                        } else {
+                            ++position;
+                        }
+                    }
+                } else if (accept("CHECK")) {
+                    skip_parens();
+                } else {
+                    st.columnDefs.push_back(column_def());
+                }
+            }
+
+            ColumnDef column_def()
+            {
+                ColumnDef column;
+                column.name = identifier();
+                column.type = data_type();
+
+                // ALTER TABLE 中列定义之后可跟 AFTER / FIRST，由调用方处理
+                while (peek().kind != Token::END && !matches(peek(), ",") && !matches(peek(), ")") &&
+                       !matches(peek(), "AFTER") && !matches(peek(), "FIRST")) {
+                    if (accept("NOT")) {
+                        expect("NULL");
+                        column.notNull = true;
+                    } else if (accept("NULL")) {
+                        column.notNull = false;
+                    } else if (accept("DEFAULT")) {
+                        column.hasDefault = true;
+                        if (accept("CURRENT_TIMESTAMP") || accept("NOW")) {
+                            column.defaultNow = true;
+                            if (accept("(")) {
+                                expect(")");
+                            }
+                        } else {
+                            ExprPtr value = unary();
+                            if (value->kind == Expr::UNARY && value->args[0]->kind == Expr::LITERAL) {
+                                column.defaultValue = value->args[0]->value;
+                                column.defaultValue.number = -column.defaultValue.number;
+                                column.defaultValue.real = -column.defaultValue.real;
+                            } else if (value->kind == Expr::LITERAL) {
+                                column.defaultValue = value->value;
+                            } else {
+                                throw SqlError("Unsupported DEFAULT for column '" + column.name + "'");
+                            }
+                        }
+                    } else if (accept("AUTO_INCREMENT")) {
+                        column.autoIncrement = true;
+                    } else if (accept("PRIMARY")) {
+                        expect("KEY");
+                        column.primaryKey = true;
+                        column.notNull = true;
+                    } else if (accept("UNIQUE")) {
+                        accept("KEY");
+                        column.unique = true;
+                    } else if (accept("ON")) {
+                        expect("UPDATE");
+                        if (!accept("CURRENT_TIMESTAMP")) {
+                            expect("NOW");
+                        }
+                        if (accept("(")) {
+                            expect(")");
+                        }
+                        column.onUpdateNow = true;
+                    } else if (accept("COMMENT")) {
+                        ++position;
+                    } else if (accept("CHARACTER")) {
+                        expect("SET");
+                        ++position;
+                    } else if (accept("CHARSET") || accept("COLLATE")) {
+                        ++position;
+                    } else if (accept("REFERENCES")) {
+                        identifier();
+                        skip_parens();
+                    } else {
+                        throw SqlError("Unsupported column attribute near '" + near() + "'");
+                    }
+                }
+                return column;
+            }
+
+            Cell::Kind data_type()
+            {
+                const Token& token = peek();
+                if (token.kind != Token::IDENT) {
+                    throw SqlError("Expected data type near '" + near() + "'");
+                }
+                const std::string name = token.upper;
+                ++position;
+
+                if (name == "DOUBLE") {
+                    accept("PRECISION");
+                }
+                if (matches(peek(), "(")) {
+                    skip_parens();
+                }
+                while (accept("UNSIGNED") || accept("SIGNED") || accept("ZEROFILL") || accept("INTEGER")) {
+                }
+
+                static const std::set<std::string> INTEGER_TYPES {
+                    "INT", "INTEGER", "BIGINT", "TINYINT", "SMALLINT", "MEDIUMINT", "BOOL", "BOOLEAN",
+                    "BIT", "YEAR", "SIGNED", "UNSIGNED"
+                };
+                if (INTEGER_TYPES.count(name)) {
+                    return Cell::INT;
+                }
+                if (name == "DECIMAL" || name == "NUMERIC" || name == "DEC") {
+                    return Cell::DECIMAL;
+                }
+                if (name == "DOUBLE" || name == "FLOAT" || name == "REAL") {
+                    return Cell::DOUBLE;
+                }
+                if (name == "DATETIME" || name == "TIMESTAMP" || name == "DATE") {
+                    return Cell::DATETIME;
+                }
+                return Cell::TEXT;
+            }
+
+            void parse_alter(Statement& st)
+            {
+                st.kind = Statement::ALTER_TABLE;
+                expect("TABLE");
+                st.table = identifier();
+
+                do {
+                    AlterAction action;
+                    if (accept("ADD")) {
+                        if (accept("CONSTRAINT") && !matches(peek(), "UNIQUE")) {
+                            identifier();
+                        }
+                        if (accept("UNIQUE")) {
+                            if (!accept("INDEX")) {
+                                accept("KEY");
+                            }
+                            action.kind = AlterAction::ADD_INDEX;
+                            action.index.unique = true;
+                            if (!matches(peek(), "(")) {
+                                action.index.name = identifier();
+                            }
+                            action.index.columns = index_columns();
+                        } else if (accept("INDEX") || accept("KEY")) {
+                            action.kind = AlterAction::ADD_INDEX;
+                            if (!matches(peek(), "(")) {
+                                action.index.name = identifier();
+                            }
+                            action.index.columns = index_columns();
+                        } else if (matches(peek(), "PRIMARY") || matches(peek(), "FOREIGN")) {
+                            throw SqlError("ALTER TABLE ADD " + peek().upper + " is not supported");
+                        } else {
+                            accept("COLUMN");
+                            action.kind = AlterAction::ADD_COLUMN;
+                            action.column = column_def();
+                            if (accept("AFTER")) {
+                                identifier();
+                            } else {
+                                accept("FIRST");
+                            }
+                        }
+                    } else if (accept("MODIFY")) {
+                        accept("COLUMN");
+                        action.kind = AlterAction::MODIFY_COLUMN;
+                        action.column = column_def();
+                        if (accept("AFTER")) {
+                            identifier();
+                        } else {
+                            accept("FIRST");
+                        }
+                    } else if (accept("DROP")) {
+                        if (!accept("INDEX")) {
+                            expect("KEY");
+                        }
+                        action.kind = AlterAction::DROP_INDEX;
+                        action.index.name = identifier();
+                    } else {
+                        throw SqlError("Unsupported ALTER TABLE near '" + near() + "'");
+                    }
+                    st.actions.push_back(std::move(action));
+                } while (accept(","));
+            }
+
+            void parse_drop(Statement& st)
+            {
+                st.kind = Statement::DROP_TABLE;
+                expect("TABLE");
+                if (accept("IF")) {
+                    expect("EXISTS");
+                    st.ifExists = true;
+                }
+                st.table = identifier();
+            }
+
+            void parse_set(Statement& st)
+            {
+                st.kind = Statement::SET;
+                do {
+                    Assignment assignment;
+                    assignment.column = identifier();
+                    expect("=");
+                    assignment.value = expression();
+                    st.assignments.push_back(std::move(assignment));
+                } while (accept(","));
+            }
+
+            // ---------- 表达式 ----------
+
+            ExprPtr make(Expr::Kind kind, const std::string& op, size_t begin)
+            {
+                auto expr = std::make_unique<Expr>();
+                expr->kind = kind;
+                expr->op = op;
+                expr->text = sql.substr(begin, tokens[position - 1].end - begin);
+                return expr;
+            }
+
+            ExprPtr binary(const std::string& op, ExprPtr left, ExprPtr right, size_t begin)
+            {
+                ExprPtr expr = make(Expr::BINARY, op, begin);
+                expr->args.push_back(std::move(left));
+                expr->args.push_back(std::move(right));
+                return expr;
+            }
+
+            ExprPtr expression()
+            {
+                const size_t begin = peek().begin;
+                ExprPtr left = conjunction();
+                while (accept("OR")) {
+                    left = binary("OR", std::move(left), conjunction(), begin);
+                }
+                return left;
+            }
+
+            ExprPtr conjunction()
+            {
+                const size_t begin = peek().begin;
+                ExprPtr left = negation();
+                while (accept("AND")) {
+                    left = binary("AND", std::move(left), negation(), begin);
+                }
+                return left;
+            }
+
+            ExprPtr negation()
+            {
+                const size_t begin = peek().begin;
+                if (accept("NOT")) {
+                    ExprPtr operand = negation();
+                    ExprPtr expr = make(Expr::UNARY, "NOT", begin);
+                    expr->args.push_back(std::move(operand));
+                    return expr;
+                }
+                return comparison();
+            }
+
+            ExprPtr comparison()
+            {
+                const size_t begin = peek().begin;
+                ExprPtr left = additive();
+
+                while (true) {
+                    static const char* const OPERATORS[] = {"=", "<>", "!=", "<=", ">=", "<", ">"};
+                    bool matched = false;
+                    for (const char* op : OPERATORS) {
+                        if (accept(op)) {
+                            left = binary(std::strcmp(op, "!=") == 0 ? "<>" : op, std::move(left), additive(), begin);
+                            matched = true;
+                            break;
+                        }
+                    }
+                    if (matched) {
+                        continue;
+                    }
+
+                    if (accept("IS")) {
+                        const bool negated = accept("NOT");
+                        expect("NULL");
+                        ExprPtr expr = make(Expr::IS_NULL, "IS", begin);
+                        expr->negated = negated;
+                        expr->args.push_back(std::move(left));
+                        left = std::move(expr);
+                        continue;
+                    }
+
+                    const bool negated = matches(peek(), "NOT") &&
+                        (matches(peek(1), "IN") || matches(peek(1), "LIKE") || matches(peek(1), "BETWEEN"));
+                    if (negated) {
+                        ++position;
+                    }
+
+                    if (accept("IN")) {
+                        expect("(");
+                        if (matches(peek(), "SELECT")) {
+                            throw SqlError("Subqueries are not supported");
+                        }
+                        ExprPtr expr = std::make_unique<Expr>();
+                        expr->kind = Expr::IN_LIST;
+                        expr->negated = negated;
+                        expr->args.push_back(std::move(left));
+                        do {
+                            expr->args.push_back(expression());
+                        } while (accept(","));
+                        expect(")");
+                        expr->text = sql.substr(begin, tokens[position - 1].end - begin);
+                        left = std::move(expr);
+                    } else if (accept("LIKE")) {
+                        left = binary("LIKE", std::move(left), additive(), begin);
+                        left->negated = negated;
+                    } else if (accept("BETWEEN")) {
+                        ExprPtr low = additive();
+                        expect("AND");
+                        ExprPtr high = additive();
+
+                        // x BETWEEN a AND b 改写为 x >= a AND x <= b，x 只求值一次无关紧要
+                        ExprPtr copy = clone(*left);
+                        ExprPtr range = binary("AND", binary(">=", std::move(left), std::move(low), begin),
+                                               binary("<=", std::move(copy), std::move(high), begin), begin);
+                        if (negated) {
+                            ExprPtr expr = make(Expr::UNARY, "NOT", begin);
+                            expr->args.push_back(std::move(range));
+                            range = std::move(expr);
+                        }
+                        left = std::move(range);
+                    } else if (negated) {
+                        throw SqlError("Syntax error near '" + near() + "'");
+                    } else {
+                        break;
+                    }
+                }
+                return left;
+            }
+
+            ExprPtr additive()
+            {
+                const size_t begin = peek().begin;
+                ExprPtr left = multiplicative();
+                while (true) {
+                    if (accept("+")) {
+                        left = binary("+", std::move(left), multiplicative(), begin);
+                    } else if (accept("-")) {
+                        left = binary("-", std::move(left), multiplicative(), begin);
+                    } else {
+                        return left;
+                    }
+                }
+            }
+
+            ExprPtr multiplicative()
+            {
+                const size_t begin = peek().begin;
+                ExprPtr left = unary();
+                while (true) {
+                    if (accept("*")) {
+                        left = binary("*", std::move(left), unary(), begin);
+                    } else if (accept("/")) {
+                        left = binary("/", std::move(left), unary(), begin);
+                    } else if (accept("%") || accept("MOD")) {
+                        left = binary("%", std::move(left), unary(), begin);
+                    } else if (accept("DIV")) {
+                        left = binary("DIV", std::move(left), unary(), begin);
+                    } else {
+                        return left;
+                    }
+                }
+            }
+
+            ExprPtr unary()
+            {
+                const size_t begin = peek().begin;
+                if (accept("-")) {
+                    ExprPtr operand = unary();
+                    ExprPtr expr = make(Expr::UNARY, "-", begin);
+                    expr->args.push_back(std::move(operand));
+                    return expr;
+                }
+                if (accept("+")) {
+                    return unary();
+                }
+                return primary();
+            }
+
+            ExprPtr primary()
+            {
+                const Token& token = peek();
+                const size_t begin = token.begin;
+
+                switch (token.kind) {
+                    case Token::NUMBER: {
+                        ++position;
+                        ExprPtr expr = make(Expr::LITERAL, "", begin);
+                        expr->value = number_literal(token.text);
+                        return expr;
+                    }
+
+                    case Token::STRING: {
+                        ++position;
+                        ExprPtr expr = make(Expr::LITERAL, "", begin);
+                        expr->value = Cell::string(token.text);
+                        return expr;
+                    }
+
+                    case Token::PARAM: {
+                        ++position;
+                        ExprPtr expr = make(Expr::PARAM, "", begin);
+                        expr->param = params++;
+                        return expr;
+                    }
+
+                    case Token::SYMBOL:
+                        if (accept("(")) {
+                            if (matches(peek(), "SELECT")) {
+                                throw SqlError("Subqueries are not supported");
+                            }
+                            ExprPtr expr = expression();
+                            expect(")");
+                            return expr;
+                        }
+                        break;
+
+                    case Token::IDENT:
+                    case Token::QUOTED_IDENT:
+                        return identifier_expression();
+
+                    default:
+                        break;
+                }
+
+                throw SqlError("Syntax error near '" + near() + "'");
+            }
+
+            ExprPtr identifier_expression()
+            {
+                const Token& token = peek();
+                const size_t begin = token.begin;
+
+                if (token.kind == Token::IDENT) {
+                    if (accept("NULL")) {
+                        return make(Expr::LITERAL, "", begin);
+                    }
+                    if (accept("TRUE") || accept("FALSE")) {
+                        ExprPtr expr = make(Expr::LITERAL, "", begin);
+                        expr->value = Cell::integer(token.upper == "TRUE" ? 1 : 0);
+                        return expr;
+                    }
+                    if (token.upper == "CURRENT_TIMESTAMP" && !matches(peek(1), "(")) {
+                        ++position;
+                        return make(Expr::FUNCTION, "NOW", begin);
+                    }
+                    if (accept("CASE")) {
+                        return case_expression(begin);
+                    }
+                    if (token.upper == "CAST" && matches(peek(1), "(")) {
+                        position += 2;
+                        ExprPtr operand = expression();
+                        expect("AS");
+                        const Cell::Kind type = data_type();
+                        expect(")");
+                        ExprPtr expr = make(Expr::CAST, "CAST", begin);
+                        expr->castType = type;
+                        expr->args.push_back(std::move(operand));
+                        return expr;
+                    }
+                }
+
+                if (token.kind == Token::IDENT && matches(peek(1), "(")) {
+                    const std::string name = token.upper;
+                    position += 2;
+
+                    ExprPtr expr = std::make_unique<Expr>();
+                    expr->kind = Expr::FUNCTION;
+                    expr->op = name;
+                    if (name == "COUNT" && accept("*")) {
+                        expr->star = true;
+                    } else if (!matches(peek(), ")")) {
+                        if (matches(peek(), "DISTINCT")) {
+                            throw SqlError("DISTINCT aggregates are not supported");
+                        }
+                        do {
+                            expr->args.push_back(expression());
+                        } while (accept(","));
+                    }
+                    expect(")");
+                    expr->text = sql.substr(begin, tokens[position - 1].end - begin);
+                    return expr;
+                }
+
+                std::string first = identifier();
+                ExprPtr expr = std::make_unique<Expr>();
+                expr->kind = Expr::COLUMN;
+                if (accept(".")) {
+                    expr->table = std::move(first);
+                    expr->column = identifier();
+                } else {
+                    expr->column = std::move(first);
+                }
+                expr->text = sql.substr(begin, tokens[position - 1].end - begin);
+                return expr;
+            }
+
+            ExprPtr case_expression(size_t begin)
+            {
+                auto expr = std::make_unique<Expr>();
+                expr->kind = Expr::CASE;
+                if (!matches(peek(), "WHEN")) {
+                    expr->op = "SIMPLE";
+                    expr->args.push_back(expression());
+                }
+
+                expect("WHEN");
+                do {
+                    expr->args.push_back(expression());
+                    expect("THEN");
+                    expr->args.push_back(expression());
+                } while (accept("WHEN"));
+
+                if (accept("ELSE")) {
+                    expr->args.push_back(expression());
+                }
+                expect("END");
+                expr->text = sql.substr(begin, tokens[position - 1].end - begin);
+                return expr;
+            }
+
+            static Cell number_literal(const std::string& text)
+            {
+                const size_t dot = text.find('.');
+                if (text.find_first_of("eE") != std::string::npos ||
+                    (dot != std::string::npos && text.size() - dot - 1 > 2)) {
+                    return Cell::floating(std::strtod(text.c_str(), nullptr));
+                }
+
+                if (dot != std::string::npos) {
+                    Money money;
+                    Money::parse(text, money);
+                    return Cell::decimal(money);
+                }
+
+                errno = 0;
+                const long long value = std::strtoll(text.c_str(), nullptr, 10);
+                if (errno == ERANGE) {
+                    return Cell::floating(std::strtod(text.c_str(), nullptr));
+                }
+                return Cell::integer(value);
+            }
+
+        private:
+            const std::string& sql;
+            std::vector<Token> tokens;
+            size_t position = 0;
+            size_t params = 0;
+        };
+    }
+
+    std::unique_ptr<Statement> parse_statement(const std::string& sql)
+    {
+        Parser parser(sql);
+        auto st = parser.statement();
+        if (!parser.finished()) {
+            throw SqlError("Only one statement is allowed");
+        }
+        return st;
+    }
+
+    std::vector<std::unique_ptr<Statement>> parse_script(const std::string& script)
+    {
+        std::vector<std::unique_ptr<Statement>> statements;
+        Parser parser(script);
+        while (!parser.finished()) {
+            statements.push_back(parser.statement());
+            parser.expect_separator();
+        }
+        return statements;
+    }
+
+}
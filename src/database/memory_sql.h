@@ -0,0 +1,173 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "money.h"
+
+namespace TakeAwayPlatform
+{
+    // 内存引擎中的值。DECIMAL 按分保存（两位小数），DATETIME 按 Unix 秒保存，
+    // 输出时再格式化为与 MySQL 连接一致的文本
+    struct Cell {
+        enum Kind { NUL, INT, DOUBLE, DECIMAL, TEXT, DATETIME };
+
+        Kind kind = NUL;
+        int64_t number = 0;     // INT、DECIMAL（分）、DATETIME（秒）
+        double real = 0;        // DOUBLE
+        std::string text;       // TEXT
+
+        static Cell integer(int64_t value) { Cell cell; cell.kind = INT; cell.number = value; return cell; }
+        static Cell decimal(Money value) { Cell cell; cell.kind = DECIMAL; cell.number = value.cents(); return cell; }
+        static Cell floating(double value) { Cell cell; cell.kind = DOUBLE; cell.real = value; return cell; }
+        static Cell string(std::string value) { Cell cell; cell.kind = TEXT; cell.text = std::move(value); return cell; }
+        static Cell datetime(int64_t seconds) { Cell cell; cell.kind = DATETIME; cell.number = seconds; return cell; }
+
+        bool is_null() const { return kind == NUL; }
+    };
+
+    // 语法错误、不支持的语句或约束冲突，由后端转换为错误信息
+    class SqlError : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    namespace CellOps
+    {
+        // 按 MySQL 的隐式转换比较两个非 NULL 值：任一侧为 DATETIME 或 DECIMAL 时按该类型比较，
+        // 文本与数字按数字比较
+        int compare(const Cell& a, const Cell& b);
+
+        // 转换为列类型，无法转换时抛出 SqlError
+        Cell coerce(const Cell& value, Cell::Kind kind);
+
+        // 作为条件的真值，NULL 为 false
+        bool truthy(const Cell& value);
+
+        double to_double(const Cell& value);
+
+        // 本地时间文本，与 DatabaseHandler 对 DATETIME 列的输出格式一致
+        std::string format_datetime(int64_t seconds);
+
+        // 用于错误信息和结果列名的文本形式
+        std::string to_string(const Cell& value);
+    }
+
+    struct Expr;
+    using ExprPtr = std::unique_ptr<Expr>;
+
+    struct Expr {
+        enum Kind { LITERAL, PARAM, COLUMN, UNARY, BINARY, FUNCTION, CASE, IN_LIST, IS_NULL, CAST };
+
+        Kind kind = LITERAL;
+        std::string op;             // 运算符或函数名（大写）
+        Cell value;                 // LITERAL
+        size_t param = 0;           // PARAM：第几个 '?'
+        std::string table;          // COLUMN：限定名，可为空
+        std::string column;         // COLUMN：列名
+        bool negated = false;       // NOT IN、IS NOT NULL
+        bool star = false;          // COUNT(*)
+        Cell::Kind castType = Cell::TEXT;
+        std::vector<ExprPtr> args;  // CASE 依次为 WHEN、THEN ...，ELSE 在最后
+        std::string text;           // 原文，无别名时作为结果列名
+
+        // 由执行器解析
+        int binding = -1;           // COLUMN：FROM 中第几个表
+        int index = -1;             // COLUMN：列下标
+        int aggregate = -1;         // 聚合函数在累加器中的下标
+    };
+
+    struct ColumnDef {
+        std::string name;
+        Cell::Kind type = Cell::TEXT;
+        bool notNull = false;
+        bool autoIncrement = false;
+        bool primaryKey = false;
+        bool unique = false;
+        bool hasDefault = false;
+        bool defaultNow = false;    // DEFAULT CURRENT_TIMESTAMP
+        bool onUpdateNow = false;   // ON UPDATE CURRENT_TIMESTAMP
+        Cell defaultValue;
+    };
+
+    struct IndexDef {
+        std::string name;
+        std::vector<std::string> columns;
+        bool unique = false;
+        bool primary = false;
+    };
+
+    struct TableRef {
+        std::string table;
+        std::string alias;
+        bool left = false;          // LEFT JOIN，未匹配时补 NULL 行
+        ExprPtr on;
+    };
+
+    struct SelectItem {
+        ExprPtr expr;
+        std::string alias;
+        bool star = false;          // * 或 t.*
+        std::string starTable;
+    };
+
+    struct OrderItem {
+        ExprPtr expr;
+        bool desc = false;
+        int selectItem = -1;        // 按结果列别名排序时为 items 下标，由执行器解析
+    };
+
+    struct Assignment {
+        std::string column;
+        int index = -1;
+        ExprPtr value;
+    };
+
+    struct AlterAction {
+        enum Kind { ADD_COLUMN, MODIFY_COLUMN, ADD_INDEX, DROP_INDEX };
+
+        Kind kind = ADD_COLUMN;
+        ColumnDef column;
+        IndexDef index;
+    };
+
+    // 解析后的语句。SELECT/UPDATE/DELETE 的目标表为 from[0]，INSERT 与 DDL 的目标表为 table；
+    // SET 为会话变量赋值（迁移脚本中的 SET FOREIGN_KEY_CHECKS），变量与值在 assignments 中
+    struct Statement {
+        enum Kind { SELECT, INSERT, UPDATE, DELETE, CREATE_TABLE, CREATE_INDEX, ALTER_TABLE, DROP_TABLE, SET };
+
+        Kind kind = SELECT;
+        size_t paramCount = 0;
+
+        std::vector<SelectItem> items;
+        std::vector<TableRef> from;
+        ExprPtr where;
+        std::vector<OrderItem> orderBy;
+        ExprPtr limit;
+        ExprPtr offset;
+
+        std::string table;
+        std::vector<std::string> columns;               // INSERT 列清单
+        std::vector<std::vector<ExprPtr>> values;       // INSERT 各行
+        std::vector<Assignment> assignments;            // UPDATE SET，会话变量 SET
+
+        bool ifExists = false;                          // IF [NOT] EXISTS
+        std::vector<ColumnDef> columnDefs;
+        std::vector<IndexDef> indexes;                  // CREATE TABLE 中的键，CREATE INDEX 的索引
+        std::vector<AlterAction> actions;
+        int64_t autoIncrement = 0;                      // 表选项 AUTO_INCREMENT=N
+
+        // 由执行器填写
+        size_t aggregateCount = 0;
+    };
+
+    // 解析单条语句（允许末尾的 ';'），不支持的语法抛出 SqlError
+    std::unique_ptr<Statement> parse_statement(const std::string& sql);
+
+    // 解析以 ';' 分隔的脚本，"--" 与 "/* */" 注释被忽略
+    std::vector<std::unique_ptr<Statement>> parse_script(const std::string& script);
+
+}
@@ -0,0 +1,282 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+#include "migration_runner.h"
+#include "memory_sql.h"
+
+
+namespace TakeAwayPlatform
+{
+    namespace
+    {
+        const std::string SQL_CREATE_VERSION_TABLE =
+            "CREATE TABLE IF NOT EXISTS schema_migrations ("
+            "version INT NOT NULL PRIMARY KEY, "
+            "name VARCHAR(255) NOT NULL, "
+            "applied_at DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP)";
+
+        const std::string SQL_SELECT_VERSIONS = "SELECT version FROM schema_migrations";
+
+        const std::string SQL_INSERT_VERSION = "INSERT INTO schema_migrations (version, name) VALUES (?, ?)";
+
+        const std::string SQL_GET_LOCK = "SELECT GET_LOCK(?, ?) AS locked";
+
+        const std::string SQL_RELEASE_LOCK = "SELECT RELEASE_LOCK(?) AS released";
+
+        const char* MIGRATION_LOCK = "takeaway_schema_migrations";
+    }
+
+    MigrationRunner::MigrationRunner(DatabaseHandler& db, const std::string& directory)
+        : db(db), directory(directory)
+    {
+    }
+
+    int MigrationRunner::migrate()
+    {
+        Json::Value locked = db.query(SQL_GET_LOCK, {MIGRATION_LOCK, LOCK_TIMEOUT_SEC});
+        if (!locked.isArray() || locked.empty() || locked[0]["locked"].asInt() != 1) {
+            std::cerr << "Migration: failed to acquire lock " << MIGRATION_LOCK << std::endl;
+            return -1;
+        }
+
+        int count = 0;
+        std::set<int> applied;
+        if (!ensure_version_table() || !load_applied(applied)) {
+            count = -1;
+        } else {
+            // 拿到锁之后重新读取已应用版本，其他进程可能刚刚执行完
+            for (const auto& migration : scan()) {
+                if (applied.count(migration.version)) {
+                    continue;
+                }
+
+                if (!apply(migration)) {
+                    count = -1;
+                    break;
+                }
+                ++count;
+            }
+        }
+
+        db.query(SQL_RELEASE_LOCK, {MIGRATION_LOCK});
+        return count;
+    }
+
+    std::vector<int> MigrationRunner::pending()
+    {
+        std::vector<int> versions;
+        std::set<int> applied;
+        if (!ensure_version_table() || !load_applied(applied)) {
+            return versions;
+        }
+
+        for (const auto& migration : scan()) {
+            if (!applied.count(migration.version)) {
+                versions.push_back(migration.version);
+            }
+        }
+        return versions;
+    }
+
+    bool MigrationRunner::check_query_plans(DatabaseHandler& db, const std::vector<QueryTemplate>& templates)
+    {
+        bool ok = true;
+        for (const auto& item : templates) {
+            Json::Value plan = db.query("EXPLAIN " + item.sql, item.sampleParams);
+            if (!plan.isArray()) {
+                std::cerr << "EXPLAIN failed: " << item.name << ": " << db.last_error() << std::endl;
+                ok = false;
+                continue;
+            }
+
+            for (const auto& step : plan) {
+                if (step["type"].asString() == "ALL") {
+                    std::cerr << "Full table scan on " << step["table"].asString()
+                              << " in " << item.name << ": " << item.sql << std::endl;
+                    ok = false;
+                }
+            }
+        }
+
+        std::cout << "Checked " << templates.size() << " query plans: " << (ok ? "OK" : "FAILED") << std::endl;
+        return ok;
+    }
+
+    std::vector<MigrationRunner::Migration> MigrationRunner::scan() const
+    {
+        std::vector<Migration> migrations;
+
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            const std::filesystem::path& path = entry.path();
+            if (path.extension() != ".sql") {
+                continue;
+            }
+
+            // 文件名以版本号开头：0001_hot_path_indexes.sql
+            const std::string name = path.stem().string();
+            size_t digits = 0;
+            while (digits < name.size() && std::isdigit(static_cast<unsigned char>(name[digits]))) {
+                ++digits;
+            }
+            if (digits == 0) {
+                continue;
+            }
+
+            migrations.push_back({std::stoi(name.substr(0, digits)), name, path.string()});
+        }
+
+        if (error) {
+            std::cerr << "Migration: cannot read " << directory << ": " << error.message() << std::endl;
+        }
+
+        std::sort(migrations.begin(), migrations.end(), [](const Migration& a, const Migration& b) {
+            return a.version < b.version;
+        });
+        return migrations;
+    }
+
+    bool MigrationRunner::ensure_version_table()
+    {
+        return db.execute(SQL_CREATE_VERSION_TABLE, {}) >= 0;
+    }
+
+    bool MigrationRunner::load_applied(std::set<int>& applied)
+    {
+        Json::Value rows = db.query(SQL_SELECT_VERSIONS, {});
+        if (!rows.isArray()) {
+            return false;
+        }
+
+        for (const auto& row : rows) {
+            applied.insert(row["version"].asInt());
+        }
+        return true;
+    }
+
+    bool MigrationRunner::apply(const Migration& migration)
+    {
+        std::ifstream file(migration.path);
+        if (!file) {
+            std::cerr << "Migration: cannot open " << migration.path << std::endl;
+            return false;
+        }
+
+        std::stringstream script;
+        script << file.rdbuf();
+
+        std::cout << "Applying migration " << migration.name << std::endl;
+
+        // MySQL 的 DDL 会隐式提交，迁移无法整体回滚：中途失败时已执行的语句保留，
+        // 修复后重新执行时先检查表结构，已存在的索引和列跳过
+        for (const auto& statement : split_statements(script.str())) {
+            const int applied = already_applied(statement);
+            if (applied < 0) {
+                std::cerr << "Migration " << migration.name << " failed: " << db.last_error() << std::endl;
+                return false;
+            }
+            if (applied > 0) {
+                std::cout << "Migration " << migration.name << ": already applied, skipped: " << statement << std::endl;
+                continue;
+            }
+
+            if (db.execute(statement, {}) < 0) {
+                std::cerr << "Migration " << migration.name << " failed: " << db.last_error() << std::endl;
+                return false;
+            }
+        }
+
+        return db.execute(SQL_INSERT_VERSION, {migration.version, migration.name}) > 0;
+    }
+
+    int MigrationRunner::already_applied(const std::string& statement)
+    {
+        std::unique_ptr<Statement> st;
+        try {
+            st = parse_statement(statement);
+        } catch (const SqlError&) {
+            return 0;
+        }
+
+        // 每个对象的期望状态：true 为应当存在
+        std::vector<std::pair<int, bool>> checks;
+        if (st->kind == Statement::CREATE_INDEX) {
+            checks.emplace_back(db.index_exists(st->table, st->indexes[0].name), true);
+        } else if (st->kind == Statement::ALTER_TABLE) {
+            for (const auto& action : st->actions) {
+                switch (action.kind) {
+                    case AlterAction::ADD_COLUMN:
+                        checks.emplace_back(db.column_exists(st->table, action.column.name), true);
+                        break;
+                    case AlterAction::ADD_INDEX:
+                        checks.emplace_back(db.index_exists(st->table, action.index.name), true);
+                        break;
+                    case AlterAction::DROP_INDEX:
+                        checks.emplace_back(db.index_exists(st->table, action.index.name), false);
+                        break;
+                    default:
+                        return 0;
+                }
+            }
+        }
+        if (checks.empty()) {
+            return 0;
+        }
+
+        size_t done = 0;
+        for (const auto& [found, wanted] : checks) {
+            if (found < 0) {
+                return -1;
+            }
+            if ((found > 0) == wanted) {
+                ++done;
+            }
+        }
+        if (done == 0) {
+            return 0;
+        }
+        if (done < checks.size()) {
+            std::cerr << "Migration statement partially applied, fix the schema by hand: " << statement << std::endl;
+            return -1;
+        }
+        return 1;
+    }
+
+    std::vector<std::string> MigrationRunner::split_statements(const std::string& script)
+    {
+        std::vector<std::string> statements;
+        std::istringstream lines(script);
+        std::string line;
+        std::string current;
+
+        while (std::getline(lines, line)) {
+            const size_t start = line.find_first_not_of(" \t\r");
+            if (start == std::string::npos || line.compare(start, 2, "--") == 0) {
+                continue;
+            }
+
+            current += line;
+            current += '\n';
+
+            size_t end;
+            while ((end = current.find(';')) != std::string::npos) {
+                std::string statement = current.substr(0, end);
+                current.erase(0, end + 1);
+                const size_t first = statement.find_first_not_of(" \t\r\n");
+                if (first != std::string::npos) {
+                    statements.push_back(statement.substr(first));
+                }
+            }
+        }
+
+        if (current.find_first_not_of(" \t\r\n") != std::string::npos) {
+            statements.push_back(current);
+        }
+        return statements;
+    }
+
+}
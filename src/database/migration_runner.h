@@ -0,0 +1,61 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "db_handler.h"
+
+namespace TakeAwayPlatform
+{
+    // 版本化 schema 迁移：directory 下的 NNNN_描述.sql 按版本号顺序执行，
+    // 已执行的版本记录在 schema_migrations 表中，每个版本只执行一次。
+    // 多个进程同时启动时用 GET_LOCK 串行化，只有一个进程真正执行迁移。
+    // create_tables.sql 只保留初始 schema，之后的结构变化都只写在迁移脚本中
+    class MigrationRunner
+    {
+    public:
+        static constexpr const char* DEFAULT_DIRECTORY = "/opt/TakeAwayPlatform/sql/migrations";
+
+        MigrationRunner(DatabaseHandler& db, const std::string& directory);
+
+        // 执行全部未应用的迁移，返回本次应用的版本数，失败返回 -1（之前的版本保持已应用）
+        int migrate();
+
+        // 未应用的版本号
+        std::vector<int> pending();
+
+        // 对每个查询模板执行 EXPLAIN，任一表的访问方式为全表扫描（type = ALL）时
+        // 输出该模板并返回 false。应在数据量接近生产的库上运行，空表上优化器的选择没有参考价值
+        static bool check_query_plans(DatabaseHandler& db, const std::vector<QueryTemplate>& templates);
+
+    private:
+        struct Migration {
+            int version;
+            std::string name;
+            std::string path;
+        };
+
+        // 目录中的迁移文件，按版本号升序
+        std::vector<Migration> scan() const;
+
+        bool ensure_version_table();
+        bool load_applied(std::set<int>& applied);
+        bool apply(const Migration& migration);
+
+        // 语句要创建的索引、列已经存在（要删除的索引已经不存在）时返回 1，需要执行返回 0，
+        // 部分已应用或检查失败返回 -1。只识别 CREATE INDEX 和 ALTER TABLE ADD/DROP，其余语句总是执行
+        int already_applied(const std::string& statement);
+
+        // 按 ';' 拆分脚本并去掉 "--" 注释行；迁移脚本中的字符串字面量不能含 ';'
+        static std::vector<std::string> split_statements(const std::string& script);
+
+    private:
+        static constexpr int LOCK_TIMEOUT_SEC = 60;
+
+        DatabaseHandler& db;
+        std::string directory;
+    };
+
+}
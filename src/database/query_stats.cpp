@@ -0,0 +1,265 @@
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <regex>
+#include <vector>
+
+#include "query_stats.h"
+
+
+namespace TakeAwayPlatform
+{
+    QueryStats& QueryStats::instance()
+    {
+        static QueryStats stats;
+        return stats;
+    }
+
+    void QueryStats::configure(const SlowQueryOptions& options)
+    {
+        thresholdMs = options.thresholdMs;
+        sampleEvery = std::max(options.sampleEvery, 1);
+
+        std::lock_guard<std::mutex> lock(logMutex);
+        if (logFile.is_open()) {
+            logFile.close();
+        }
+        if (!options.logPath.empty()) {
+            logFile.open(options.logPath, std::ios::app);
+            if (!logFile) {
+                std::cerr << "Slow query log " << options.logPath << " cannot be opened, using stderr" << std::endl;
+            }
+        }
+    }
+
+    void QueryStats::record(const std::string& sql, std::chrono::nanoseconds latency, bool ok)
+    {
+        const int64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+
+        Entry& entry = entry_for(sql);
+
+        ++entry.count;
+        if (!ok) {
+            ++entry.errors;
+        }
+        entry.totalUs += latencyUs;
+
+        uint64_t previous = entry.maxUs;
+        while (static_cast<uint64_t>(latencyUs) > previous
+               && !entry.maxUs.compare_exchange_weak(previous, latencyUs)) {
+        }
+
+        const auto bound = std::lower_bound(BUCKET_BOUNDS_US.begin(), BUCKET_BOUNDS_US.end(), latencyUs);
+        ++entry.buckets[bound - BUCKET_BOUNDS_US.begin()];
+
+        const int threshold = thresholdMs;
+        if (threshold > 0 && latencyUs >= threshold * 1000LL) {
+            // 每个模板的第 1、1 + N、1 + 2N ... 条慢查询写入日志
+            if (entry.slow++ % sampleEvery == 0) {
+                log_slow(entry.shape, latencyUs, ok);
+            }
+        }
+    }
+
+    Json::Value QueryStats::snapshot(int top) const
+    {
+        std::vector<std::pair<const std::string*, const Entry*>> items;
+        std::shared_lock<std::shared_mutex> lock(mutex);
+
+        items.reserve(entries.size());
+        for (const auto& item : entries) {
+            items.emplace_back(&item.first, item.second.get());
+        }
+        std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) {
+            return a.second->totalUs.load() > b.second->totalUs.load();
+        });
+        if (top > 0 && items.size() > static_cast<size_t>(top)) {
+            items.resize(top);
+        }
+
+        Json::Value bounds(Json::arrayValue);
+        for (int64_t bound : BUCKET_BOUNDS_US) {
+            bounds.append(static_cast<Json::Int64>(bound));
+        }
+
+        Json::Value queries(Json::arrayValue);
+        for (const auto& item : items) {
+            const Entry& entry = *item.second;
+            const uint64_t count = entry.count;
+
+            Json::Value query;
+            query["sql"] = *item.first;
+            query["count"] = static_cast<Json::UInt64>(count);
+            query["errors"] = static_cast<Json::UInt64>(entry.errors.load());
+            query["slow"] = static_cast<Json::UInt64>(entry.slow.load());
+            query["total_ms"] = entry.totalUs / 1000.0;
+            query["avg_us"] = count ? static_cast<Json::UInt64>(entry.totalUs / count) : 0;
+            query["max_us"] = static_cast<Json::UInt64>(entry.maxUs.load());
+            query["p50_us"] = static_cast<Json::Int64>(percentile_us(entry, 0.50));
+            query["p95_us"] = static_cast<Json::Int64>(percentile_us(entry, 0.95));
+            query["p99_us"] = static_cast<Json::Int64>(percentile_us(entry, 0.99));
+
+            Json::Value buckets(Json::arrayValue);
+            for (const auto& bucket : entry.buckets) {
+                buckets.append(static_cast<Json::UInt64>(bucket.load()));
+            }
+            query["histogram"] = buckets;
+            queries.append(query);
+        }
+
+        Json::Value result;
+        result["slow_query_ms"] = thresholdMs.load();
+        result["bucket_bounds_us"] = bounds;
+        result["queries"] = queries;
+        return result;
+    }
+
+    void QueryStats::reset()
+    {
+        // 只清零计数：并发的 record 可能仍持有条目的引用，不能释放
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for (auto& item : entries) {
+            Entry& entry = *item.second;
+            entry.count = 0;
+            entry.errors = 0;
+            entry.totalUs = 0;
+            entry.maxUs = 0;
+            entry.slow = 0;
+            for (auto& bucket : entry.buckets) {
+                bucket = 0;
+            }
+        }
+    }
+
+    std::string QueryStats::normalize(const std::string& sql)
+    {
+        std::string out;
+        out.reserve(sql.size());
+
+        auto identifierChar = [](char ch) {
+            return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' || ch == '$';
+        };
+
+        for (size_t index = 0; index < sql.size();) {
+            const char ch = sql[index];
+
+            if (std::isspace(static_cast<unsigned char>(ch))) {
+                if (!out.empty() && out.back() != ' ') {
+                    out += ' ';
+                }
+                ++index;
+            } else if (ch == '\'' || ch == '"') {
+                // 字符串字面量，支持 \ 转义和重复引号
+                ++index;
+                while (index < sql.size()) {
+                    if (sql[index] == '\\') {
+                        index += 2;
+                    } else if (sql[index] == ch) {
+                        if (index + 1 < sql.size() && sql[index + 1] == ch) {
+                            index += 2;
+                        } else {
+                            ++index;
+                            break;
+                        }
+                    } else {
+                        ++index;
+                    }
+                }
+                out += '?';
+            } else if (ch == '`') {
+                // 反引号标识符原样保留
+                const size_t end = sql.find('`', index + 1);
+                const size_t stop = end == std::string::npos ? sql.size() : end + 1;
+                out.append(sql, index, stop - index);
+                index = stop;
+            } else if (std::isdigit(static_cast<unsigned char>(ch)) && (out.empty() || !identifierChar(out.back()))) {
+                while (index < sql.size() && (std::isalnum(static_cast<unsigned char>(sql[index])) || sql[index] == '.')) {
+                    ++index;
+                }
+                out += '?';
+            } else {
+                out += ch;
+                ++index;
+            }
+        }
+
+        while (!out.empty() && out.back() == ' ') {
+            out.pop_back();
+        }
+
+        // IN (?, ?, ?) -> IN (...)
+        static const std::regex inList(R"(\bIN \(\?(?: ?, ?\?)*\))", std::regex::icase);
+        out = std::regex_replace(out, inList, "IN (...)");
+
+        // 多行 VALUES：与第一行相同的后续行折叠为 ", ..."
+        static const std::regex valuesRows(R"((\bVALUES ?(\([^()]*(?:\([^()]*\)[^()]*)*\)))(?: ?, ?\2)+)", std::regex::icase);
+        out = std::regex_replace(out, valuesRows, "$1, ...");
+
+        return out;
+    }
+
+    QueryStats::Entry& QueryStats::entry_for(const std::string& sql)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = aliases.find(sql);
+            if (it != aliases.end()) {
+                return *it->second;
+            }
+        }
+
+        std::string shape = normalize(sql);
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (entries.size() >= MAX_SHAPES && !entries.count(shape)) {
+            shape = OVERFLOW_SHAPE;
+        }
+
+        auto& entry = entries[shape];
+        if (!entry) {
+            entry = std::make_unique<Entry>();
+            entry->shape = shape;
+        }
+        if (aliases.size() < MAX_ALIASES) {
+            aliases.emplace(sql, entry.get());
+        }
+        return *entry;
+    }
+
+    void QueryStats::log_slow(const std::string& shape, int64_t latencyUs, bool ok)
+    {
+        std::time_t now = std::time(nullptr);
+        std::tm local {};
+        localtime_r(&now, &local);
+        char timestamp[20];
+        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &local);
+
+        // 只记录语句形状，不记录参数（可能含密码哈希、手机号等）
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::ostream& out = logFile.is_open() ? static_cast<std::ostream&>(logFile) : std::cerr;
+        out << timestamp << " slow query " << latencyUs / 1000.0 << "ms"
+            << (ok ? "" : " (failed)") << ": " << shape << std::endl;
+    }
+
+    int64_t QueryStats::percentile_us(const Entry& entry, double quantile)
+    {
+        const uint64_t count = entry.count;
+        if (count == 0) {
+            return 0;
+        }
+
+        const uint64_t rank = static_cast<uint64_t>(quantile * count + 0.5);
+        uint64_t seen = 0;
+        for (size_t index = 0; index < BUCKET_BOUNDS_US.size(); ++index) {
+            seen += entry.buckets[index];
+            if (seen >= rank) {
+                return BUCKET_BOUNDS_US[index];
+            }
+        }
+
+        // 落在最后一个桶，以最大值代替上界
+        return static_cast<int64_t>(entry.maxUs.load());
+    }
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <fstream>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "common.h"
+
+namespace TakeAwayPlatform
+{
+    // 慢查询日志参数（config.json 中 database 节）
+    struct SlowQueryOptions {
+        int thresholdMs = 200;          // 超过该耗时记为慢查询，<= 0 关闭慢查询日志
+        int sampleEvery = 1;            // 每个模板每 N 条慢查询记录一条
+        std::string logPath;            // 为空时写 std::cerr
+    };
+
+    // 按 SQL 形状（字面量替换为 ?、空白折叠）统计的执行次数、错误数和耗时分布，进程内所有
+    // DatabaseHandler 共用。参数化模板本身就是形状，只有拼接了字面量的旧式 SQL 需要归一化
+    class QueryStats
+    {
+    public:
+        static QueryStats& instance();
+
+        void configure(const SlowQueryOptions& options);
+
+        void record(const std::string& sql, std::chrono::nanoseconds latency, bool ok);
+
+        // 按累计耗时降序的前 top 个形状，top <= 0 时全部返回
+        Json::Value snapshot(int top = 0) const;
+
+        void reset();
+
+        // 字面量（字符串、数字）替换为 ?，IN 列表和多行 VALUES 折叠为一项，连续空白折叠为一个空格
+        static std::string normalize(const std::string& sql);
+
+    private:
+        QueryStats() = default;
+
+        // 直方图桶上界（微秒），最后一个桶收纳更慢的查询
+        static constexpr std::array<int64_t, 13> BUCKET_BOUNDS_US {
+            100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000, 5000000
+        };
+
+        struct Entry {
+            std::string shape;
+            std::atomic<uint64_t> count {0};
+            std::atomic<uint64_t> errors {0};
+            std::atomic<uint64_t> totalUs {0};
+            std::atomic<uint64_t> maxUs {0};
+            std::atomic<uint64_t> slow {0};
+            std::array<std::atomic<uint64_t>, BUCKET_BOUNDS_US.size() + 1> buckets {};
+        };
+
+        Entry& entry_for(const std::string& sql);
+
+        void log_slow(const std::string& shape, int64_t latencyUs, bool ok);
+
+        // 由直方图估计分位数（所在桶的上界）
+        static int64_t percentile_us(const Entry& entry, double quantile);
+
+    private:
+        // 原始 SQL 到形状的映射只缓存有限条，超出后每次重新归一化
+        static constexpr size_t MAX_ALIASES = 4096;
+
+        // 形状数量上限，超出后新形状都计入 OVERFLOW_SHAPE
+        static constexpr size_t MAX_SHAPES = 1024;
+        static constexpr const char* OVERFLOW_SHAPE = "(other)";
+
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, std::unique_ptr<Entry>> entries;     // 形状 -> 统计
+        std::unordered_map<std::string, Entry*> aliases;    // 原始 SQL -> 所属形状的统计
+
+        std::atomic<int> thresholdMs {200};
+        std::atomic<int> sampleEvery {1};
+        std::mutex logMutex;
+        std::ofstream logFile;
+    };
+
+    // 计时一次语句执行，析构时计入 QueryStats；执行失败时调用 failed()。
+    // activity 非空时，成功后写入完成时刻，失败时清零（下次借出前需重新探活）
+    class QueryTimer
+    {
+    public:
+        explicit QueryTimer(const std::string& sql, std::chrono::steady_clock::time_point* activity = nullptr)
+            : sql(sql), activity(activity), start(std::chrono::steady_clock::now()) {}
+
+        ~QueryTimer() {
+            const auto end = std::chrono::steady_clock::now();
+            if (activity) {
+                *activity = ok ? end : std::chrono::steady_clock::time_point();
+            }
+            QueryStats::instance().record(sql, end - start, ok);
+        }
+
+        QueryTimer(const QueryTimer&) = delete;
+        QueryTimer& operator=(const QueryTimer&) = delete;
+
+        void failed() { ok = false; }
+
+    private:
+        const std::string& sql;
+        std::chrono::steady_clock::time_point* activity;
+        std::chrono::steady_clock::time_point start;
+        bool ok = true;
+    };
+
+}
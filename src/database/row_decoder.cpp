@@ -0,0 +1,289 @@
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include "row_decoder.h"
+
+
+namespace TakeAwayPlatform
+{
+    ColumnIndex::ColumnIndex(mysqlx::SqlResult& result)
+    {
+        const auto count = result.getColumnCount();
+        names.reserve(count);
+        for (unsigned index = 0; index < count; ++index) {
+            names.emplace_back(result.getColumn(index).getColumnName());
+        }
+    }
+
+    int ColumnIndex::operator[](const char* name) const
+    {
+        for (size_t index = 0; index < names.size(); ++index) {
+            if (std::strcmp(names[index].c_str(), name) == 0) {
+                return static_cast<int>(index);
+            }
+        }
+        return -1;
+    }
+
+    namespace RawCodec
+    {
+        bool decodeDecimal(const mysqlx::bytes& raw, Money& out)
+        {
+            if (raw.size() < 2) {
+                return false;
+            }
+
+            const unsigned scale = raw.begin()[0];
+            int64_t unscaled = 0;
+            bool negative = false;
+            bool terminated = false;
+
+            for (size_t index = 1; index < raw.size() && !terminated; ++index) {
+                const unsigned nibbles[2] = {
+                    static_cast<unsigned>(raw.begin()[index] >> 4),
+                    static_cast<unsigned>(raw.begin()[index] & 0x0f)
+                };
+
+                for (unsigned nibble : nibbles) {
+                    if (nibble <= 9) {
+                        unscaled = unscaled * 10 + nibble;
+                    } else if (nibble == 0x0c || nibble == 0x0d) {
+                        negative = nibble == 0x0d;
+                        terminated = true;
+                        break;
+                    } else {
+                        return false;
+                    }
+                }
+            }
+
+            if (!terminated) {
+                return false;
+            }
+
+            // 统一换算到两位小数，多出的位四舍五入
+            int64_t cents = unscaled;
+            if (scale < 2) {
+                for (unsigned s = scale; s < 2; ++s) {
+                    cents *= 10;
+                }
+            } else {
+                for (unsigned s = 2; s < scale; ++s) {
+                    const bool roundUp = s + 1 == scale && cents % 10 >= 5;
+                    cents = cents / 10 + (roundUp ? 1 : 0);
+                }
+            }
+
+            out = Money::fromCents(negative ? -cents : cents);
+            return true;
+        }
+
+        bool decodeDateTime(const mysqlx::bytes& raw, DateTime& out)
+        {
+            uint64_t fields[7] = {0, 0, 0, 0, 0, 0, 0};
+            size_t count = 0;
+            uint64_t current = 0;
+            unsigned shift = 0;
+
+            for (size_t index = 0; index < raw.size() && count < 7; ++index) {
+                const auto byte = raw.begin()[index];
+                current |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if (byte & 0x80) {
+                    shift += 7;
+                    continue;
+                }
+
+                fields[count++] = current;
+                current = 0;
+                shift = 0;
+            }
+
+            if (count < 3) {
+                return false;
+            }
+
+            std::tm local {};
+            local.tm_year = static_cast<int>(fields[0]) - 1900;
+            local.tm_mon = static_cast<int>(fields[1]) - 1;
+            local.tm_mday = static_cast<int>(fields[2]);
+            local.tm_hour = static_cast<int>(fields[3]);
+            local.tm_min = static_cast<int>(fields[4]);
+            local.tm_sec = static_cast<int>(fields[5]);
+            local.tm_isdst = -1;
+
+            const std::time_t seconds = std::mktime(&local);
+            if (seconds == static_cast<std::time_t>(-1)) {
+                return false;
+            }
+
+            out = std::chrono::system_clock::from_time_t(seconds) + std::chrono::microseconds(fields[6]);
+            return true;
+        }
+    }
+
+    namespace RowField
+    {
+        namespace
+        {
+            const mysqlx::Value* cell(const mysqlx::Row& row, int column)
+            {
+                if (column < 0 || static_cast<unsigned>(column) >= row.colCount()) {
+                    return nullptr;
+                }
+
+                const mysqlx::Value& value = row[column];
+                return value.isNull() ? nullptr : &value;
+            }
+        }
+
+        bool read(const mysqlx::Row& row, int column, int64_t& out)
+        {
+            const mysqlx::Value* value = cell(row, column);
+            if (!value) {
+                return false;
+            }
+
+            switch (value->getType()) {
+                case mysqlx::Value::INT64:
+                    out = value->get<int64_t>();
+                    return true;
+                case mysqlx::Value::UINT64:
+                    out = static_cast<int64_t>(value->get<uint64_t>());
+                    return true;
+                case mysqlx::Value::BOOL:
+                    out = value->get<bool>() ? 1 : 0;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        bool read(const mysqlx::Row& row, int column, int& out)
+        {
+            int64_t wide = 0;
+            if (!read(row, column, wide)) {
+                return false;
+            }
+
+            out = static_cast<int>(wide);
+            return true;
+        }
+
+        bool read(const mysqlx::Row& row, int column, double& out)
+        {
+            const mysqlx::Value* value = cell(row, column);
+            if (!value) {
+                return false;
+            }
+
+            switch (value->getType()) {
+                case mysqlx::Value::DOUBLE:
+                    out = value->get<double>();
+                    return true;
+                case mysqlx::Value::FLOAT:
+                    out = value->get<float>();
+                    return true;
+                case mysqlx::Value::INT64:
+                    out = static_cast<double>(value->get<int64_t>());
+                    return true;
+                case mysqlx::Value::UINT64:
+                    out = static_cast<double>(value->get<uint64_t>());
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        bool read(const mysqlx::Row& row, int column, bool& out)
+        {
+            const mysqlx::Value* value = cell(row, column);
+            if (!value) {
+                return false;
+            }
+
+            switch (value->getType()) {
+                case mysqlx::Value::BOOL:
+                    out = value->get<bool>();
+                    return true;
+                case mysqlx::Value::INT64:
+                    out = value->get<int64_t>() != 0;
+                    return true;
+                case mysqlx::Value::UINT64:
+                    out = value->get<uint64_t>() != 0;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        bool read(const mysqlx::Row& row, int column, std::string& out)
+        {
+            const mysqlx::Value* value = cell(row, column);
+            if (!value || value->getType() != mysqlx::Value::STRING) {
+                return false;
+            }
+
+            out = value->get<std::string>();
+            return true;
+        }
+
+        bool read(const mysqlx::Row& row, int column, Money& out)
+        {
+            const mysqlx::Value* value = cell(row, column);
+            if (!value) {
+                return false;
+            }
+
+            switch (value->getType()) {
+                case mysqlx::Value::RAW:
+                    return RawCodec::decodeDecimal(value->getRawBytes(), out);
+                case mysqlx::Value::INT64:
+                    out = Money::fromCents(value->get<int64_t>() * 100);
+                    return true;
+                case mysqlx::Value::UINT64:
+                    out = Money::fromCents(static_cast<int64_t>(value->get<uint64_t>()) * 100);
+                    return true;
+                case mysqlx::Value::DOUBLE:
+                    out = Money::fromYuan(value->get<double>());
+                    return true;
+                case mysqlx::Value::STRING:
+                    return Money::parse(value->get<std::string>(), out);
+                default:
+                    return false;
+            }
+        }
+
+        bool read(const mysqlx::Row& row, int column, DateTime& out)
+        {
+            const mysqlx::Value* value = cell(row, column);
+            if (!value) {
+                return false;
+            }
+
+            switch (value->getType()) {
+                case mysqlx::Value::RAW:
+                    return RawCodec::decodeDateTime(value->getRawBytes(), out);
+                case mysqlx::Value::INT64:
+                    out = std::chrono::system_clock::from_time_t(value->get<int64_t>());
+                    return true;
+                case mysqlx::Value::STRING: {
+                    std::tm local {};
+                    const std::string text = value->get<std::string>();
+                    if (std::sscanf(text.c_str(), "%d-%d-%d %d:%d:%d", &local.tm_year, &local.tm_mon,
+                                    &local.tm_mday, &local.tm_hour, &local.tm_min, &local.tm_sec) < 3) {
+                        return false;
+                    }
+                    local.tm_year -= 1900;
+                    local.tm_mon -= 1;
+                    local.tm_isdst = -1;
+                    out = std::chrono::system_clock::from_time_t(std::mktime(&local));
+                    return true;
+                }
+                default:
+                    return false;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <mysqlx/xdevapi.h>
+
+#include "money.h"
+
+
+namespace TakeAwayPlatform
+{
+    // DATETIME 列对应的时间点（按服务器本地时间解释）
+    using DateTime = std::chrono::system_clock::time_point;
+
+    // X 协议原始编码解码
+    namespace RawCodec
+    {
+        // DECIMAL：首字节为小数位数，其后为压缩 BCD，末尾半字节为符号（0xc 正，0xd 负）
+        bool decodeDecimal(const mysqlx::bytes& raw, Money& out);
+
+        // DATETIME/DATE：依次为年、月、日、时、分、秒、微秒的 varint，时间部分可省略
+        bool decodeDateTime(const mysqlx::bytes& raw, DateTime& out);
+    }
+
+    // 结果集列名到列下标的映射，每个结果集只解析一次，
+    // 逐行解码时直接按下标取值
+    class ColumnIndex
+    {
+    public:
+        explicit ColumnIndex(mysqlx::SqlResult& result);
+        explicit ColumnIndex(std::vector<std::string> names) : names(std::move(names)) {}
+
+        // 列不存在时返回 -1
+        int operator[](const char* name) const;
+
+    private:
+        std::vector<std::string> names;
+    };
+
+    // 单元格读取：列不存在、值为 NULL 或类型不匹配时保持 out 不变并返回 false。
+    // 数值直接从 mysqlx::Value 取出，不经过字符串
+    namespace RowField
+    {
+        bool read(const mysqlx::Row& row, int column, int64_t& out);
+        bool read(const mysqlx::Row& row, int column, int& out);
+        bool read(const mysqlx::Row& row, int column, double& out);
+        bool read(const mysqlx::Row& row, int column, bool& out);
+        bool read(const mysqlx::Row& row, int column, std::string& out);
+        bool read(const mysqlx::Row& row, int column, Money& out);
+        bool read(const mysqlx::Row& row, int column, DateTime& out);
+    }
+
+}
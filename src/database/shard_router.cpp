@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+
+#include "shard_router.h"
+
+
+namespace TakeAwayPlatform
+{
+    ShardRouter::ShardRouter(std::vector<ShardSpec> shards, int virtualNodes, bool dedicated)
+        : shards(std::move(shards)), dedicated(dedicated)
+    {
+        if (this->shards.empty()) {
+            throw std::invalid_argument("ShardRouter requires at least one shard");
+        }
+
+        for (size_t index = 0; index < this->shards.size(); ++index) {
+            const ShardSpec& shard = this->shards[index];
+            const int nodes = virtualNodes * std::max(shard.weight, 1);
+            for (int node = 0; node < nodes; ++node) {
+                std::string key = shard.name + "#" + std::to_string(node);
+                ring[hash(key.data(), key.size())] = index;
+            }
+        }
+    }
+
+    size_t ShardRouter::shard_index(int64_t user_id) const
+    {
+        // 按小端序逐字节序列化后再哈希，分片位置不随主机字节序变化
+        unsigned char key[sizeof(user_id)];
+        for (size_t index = 0; index < sizeof(key); ++index) {
+            key[index] = static_cast<unsigned char>(static_cast<uint64_t>(user_id) >> (8 * index));
+        }
+        const uint64_t point = hash(key, sizeof(key));
+
+        // 顺时针找到第一个虚拟节点，越过末尾则回到环首
+        auto it = ring.lower_bound(point);
+        if (it == ring.end()) {
+            it = ring.begin();
+        }
+        return it->second;
+    }
+
+    DBRouter& ShardRouter::shard_for(int64_t user_id)
+    {
+        return *shards[shard_index(user_id)].router;
+    }
+
+    Json::Value ShardRouter::scatter(const std::string& sql, const SqlParams& params)
+    {
+        std::vector<std::future<Json::Value>> pending;
+        pending.reserve(shards.size());
+
+        for (auto& shard : shards) {
+            pending.push_back(std::async(std::launch::async, [&shard, &sql, &params] {
+                DBLease lease = shard.router->acquire_read();
+                return lease->query(sql, params);
+            }));
+        }
+
+        Json::Value merged(Json::arrayValue);
+        for (size_t index = 0; index < pending.size(); ++index) {
+            Json::Value rows = pending[index].get();
+            if (!rows.isArray()) {
+                throw std::runtime_error("分片 " + shards[index].name + " 查询失败");
+            }
+
+            for (auto& row : rows) {
+                row["_shard"] = shards[index].name;
+                merged.append(std::move(row));
+            }
+        }
+
+        return merged;
+    }
+
+    void ShardRouter::warm_up(int ready)
+    {
+        if (!dedicated) {
+            return;
+        }
+
+        for (auto& shard : shards) {
+            shard.router->warm_up(ready);
+        }
+    }
+
+    bool ShardRouter::warm_up_done() const
+    {
+        if (!dedicated) {
+            return true;
+        }
+
+        for (const auto& shard : shards) {
+            if (!shard.router->warm_up_done()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ShardRouter::warm_up_reached() const
+    {
+        if (!dedicated) {
+            return true;
+        }
+
+        for (const auto& shard : shards) {
+            if (!shard.router->warm_up_reached()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void ShardRouter::close()
+    {
+        if (!dedicated) {
+            return;
+        }
+
+        for (auto& shard : shards) {
+            shard.router->close();
+        }
+    }
+
+    Json::Value ShardRouter::stats() const
+    {
+        std::vector<size_t> nodes(shards.size(), 0);
+        for (const auto& entry : ring) {
+            ++nodes[entry.second];
+        }
+
+        Json::Value result;
+        result["enabled"] = dedicated;
+        result["virtual_nodes"] = static_cast<Json::UInt64>(ring.size());
+
+        Json::Value items(Json::arrayValue);
+        for (size_t index = 0; index < shards.size(); ++index) {
+            Json::Value item;
+            item["name"] = shards[index].name;
+            item["weight"] = shards[index].weight;
+            item["ring_share"] = static_cast<double>(nodes[index]) / ring.size();
+            if (dedicated) {
+                item["pool"] = shards[index].router->stats();
+            }
+            items.append(item);
+        }
+        result["shards"] = items;
+        return result;
+    }
+
+    uint64_t ShardRouter::hash(const void* data, size_t size)
+    {
+        // FNV-1a 64：对给定字节序列的结果与编译器和平台无关；调用方负责以固定字节序传入整数键，
+        // 同一 user_id 在所有进程和版本中才会落在同一分片
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        uint64_t value = 14695981039346656037ULL;
+        for (size_t index = 0; index < size; ++index) {
+            value ^= bytes[index];
+            value *= 1099511628211ULL;
+        }
+
+        // FNV 对相邻整数的低位扩散较弱，再做一次混合
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        return value;
+    }
+
+}
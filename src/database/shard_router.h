@@ -0,0 +1,66 @@
+#pragma once
+
+#include <map>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "db_router.h"
+
+namespace TakeAwayPlatform
+{
+    // 按 user_id 借用分片连接：(user_id, 是否写) -> 租约，未启用分片时返回空租约
+    using ShardLeaseProvider = std::function<DBLease(int64_t user_id, bool write)>;
+
+    // 一个分片：主库（及其从库）由各自的 DBRouter 管理
+    struct ShardSpec {
+        std::string name;       // 参与哈希，改名等同于迁移该分片的数据
+        int weight = 1;         // 虚拟节点倍数
+        std::shared_ptr<DBRouter> router;
+    };
+
+    // 按 user_id 分片：orders、transactions、wallet、recharge_record 按用户落在一致性哈希环上的分片，
+    // 增减分片时只有相邻区间的用户需要迁移。
+    // 未配置分片时环上只有全局库一个分片，enabled() 为 false，调用方直接使用全局库
+    class ShardRouter
+    {
+    public:
+        // dedicated 为 true 表示分片是独立配置的库，需要由本类预热和关闭
+        ShardRouter(std::vector<ShardSpec> shards, int virtualNodes, bool dedicated);
+
+        bool enabled() const { return dedicated; }
+
+        size_t shard_count() const { return shards.size(); }
+
+        // user_id 所在分片的下标
+        size_t shard_index(int64_t user_id) const;
+
+        // user_id 所在分片的读写路由
+        DBRouter& shard_for(int64_t user_id);
+
+        const std::vector<ShardSpec>& specs() const { return shards; }
+
+        // 跨分片查询：在所有分片的只读连接上并行执行同一语句，合并结果行，
+        // 每行附加 "_shard" 字段标明来源。任一分片失败时抛出 std::runtime_error
+        Json::Value scatter(const std::string& sql, const SqlParams& params);
+
+        void warm_up(int ready = -1);
+        bool warm_up_done() const;
+        bool warm_up_reached() const;
+        void close();
+
+        // 各分片的连接池统计及哈希环上的虚拟节点占比
+        Json::Value stats() const;
+
+    private:
+        static uint64_t hash(const void* data, size_t size);
+
+    private:
+        std::vector<ShardSpec> shards;
+        std::map<uint64_t, size_t> ring;    // 虚拟节点哈希 -> 分片下标
+        bool dedicated;
+    };
+
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+
+#include "shared_stock_table.h"
+
+
+namespace TakeAwayPlatform
+{
+    // 持有共享互斥锁；上一个持有者（崩溃的 worker）未释放时恢复锁的一致性
+    class SharedStockTable::Lock
+    {
+    public:
+        explicit Lock(pthread_mutex_t* mutex) : m_mutex(mutex) {
+            if (pthread_mutex_lock(m_mutex) == EOWNERDEAD) {
+                pthread_mutex_consistent(m_mutex);
+            }
+        }
+
+        ~Lock() {
+            pthread_mutex_unlock(m_mutex);
+        }
+
+    private:
+        pthread_mutex_t* m_mutex;
+    };
+
+    namespace
+    {
+        size_t home_slot(int64_t dishId, size_t capacity)
+        {
+            return static_cast<size_t>(static_cast<uint64_t>(dishId) * 0x9E3779B97F4A7C15ULL >> 32) % capacity;
+        }
+    }
+
+    SharedStockTable* SharedStockTable::create(size_t capacity)
+    {
+        static_assert(std::atomic<int64_t>::is_always_lock_free, "shared counters need lock-free atomics");
+
+        size_t bytes = sizeof(Header) + capacity * sizeof(Slot);
+        void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            std::cerr << "Cannot create shared stock table: " << std::strerror(errno) << std::endl;
+            return nullptr;
+        }
+
+        // 匿名映射已清零，所有槽位初始即为空，计数器为 0
+        Header* header = static_cast<Header*>(memory);
+        header->capacity = capacity;
+        header->count = 0;
+
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&header->mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        // 映射随进程存在，master 和 worker 退出时由内核回收
+        SharedStockTable* table = new SharedStockTable();
+        table->m_header = header;
+        return table;
+    }
+
+    SharedStockTable::Slot* SharedStockTable::slots() const
+    {
+        return reinterpret_cast<Slot*>(m_header + 1);
+    }
+
+    StockCounter* SharedStockTable::find(int64_t dishId) const
+    {
+        const size_t capacity = m_header->capacity;
+        const size_t index = home_slot(dishId, capacity);
+
+        for (size_t probe = 0; probe < capacity; ++probe) {
+            Slot& slot = slots()[(index + probe) % capacity];
+            const int64_t current = slot.dishId.load(std::memory_order_acquire);
+            if (current == EMPTY) {
+                return nullptr;
+            }
+            if (current == dishId) {
+                return &slot.counter;
+            }
+        }
+        return nullptr;
+    }
+
+    StockCounter* SharedStockTable::attach(int64_t dishId, int64_t stock)
+    {
+        if (dishId == EMPTY) {
+            return nullptr;
+        }
+
+        Lock lock(&m_header->mutex);
+
+        const size_t capacity = m_header->capacity;
+        const size_t index = home_slot(dishId, capacity);
+
+        for (size_t probe = 0; probe < capacity; ++probe) {
+            Slot& slot = slots()[(index + probe) % capacity];
+            const int64_t current = slot.dishId.load(std::memory_order_relaxed);
+            if (current == dishId) {
+                return &slot.counter;
+            }
+            if (current == EMPTY) {
+                slot.counter.available.store(stock, std::memory_order_relaxed);
+                slot.dishId.store(dishId, std::memory_order_release);
+                ++m_header->count;
+                return &slot.counter;
+            }
+        }
+
+        std::cerr << "Shared stock table is full, capacity: " << capacity << std::endl;
+        return nullptr;
+    }
+
+    size_t SharedStockTable::size() const
+    {
+        return m_header->count.load();
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <pthread.h>
+
+namespace TakeAwayPlatform
+{
+    // 一个热点菜品的库存计数器。按缓存行对齐，不同菜品的计数器互不干扰；
+    // 统计计数也按菜品分开，避免全局计数器成为新的热点
+    struct alignas(64) StockCounter {
+        std::atomic<int64_t> available {0};     // 内存中的可售库存
+        std::atomic<int64_t> unflushed {0};     // 尚未写回数据库的销量增量（撤销时可为负）
+        std::atomic<uint64_t> reserved {0};
+        std::atomic<uint64_t> soldOut {0};
+    };
+
+    // prefork 模式下各 worker 共用的热点库存计数器，基于匿名共享内存的定长开放寻址表。
+    // 由 master 在 fork 之前创建，所有 worker 在同一组计数器上预留，合计不会超过载入时的库存；
+    // 菜品只增不删，查找无锁，新增菜品在进程间互斥锁下进行
+    class SharedStockTable
+    {
+    public:
+        // 创建共享映射，失败返回 nullptr
+        static SharedStockTable* create(size_t capacity);
+
+        // 菜品的计数器，不存在时返回 nullptr
+        StockCounter* find(int64_t dishId) const;
+
+        // 菜品的计数器，不存在时以 stock 作为可售库存创建；已存在时忽略 stock，
+        // 以先载入的 worker 为准。表满时返回 nullptr
+        StockCounter* attach(int64_t dishId, int64_t stock);
+
+        // 按槽位顺序访问每个已有菜品的计数器
+        template <typename Visitor>
+        void for_each(Visitor&& visit) const
+        {
+            for (size_t index = 0; index < m_header->capacity; ++index) {
+                Slot& slot = slots()[index];
+                const int64_t dishId = slot.dishId.load(std::memory_order_acquire);
+                if (dishId != EMPTY) {
+                    visit(dishId, slot.counter);
+                }
+            }
+        }
+
+        size_t size() const;
+
+    private:
+        // 菜品编号从 1 开始，0 表示空槽位
+        static constexpr int64_t EMPTY = 0;
+
+        struct Slot {
+            std::atomic<int64_t> dishId;    // 计数器初始化完成后才发布
+            StockCounter counter;
+        };
+
+        struct Header {
+            pthread_mutex_t mutex;   // PTHREAD_PROCESS_SHARED + ROBUST，worker 崩溃时可恢复
+            size_t capacity;
+            std::atomic<size_t> count;
+        };
+
+        class Lock;
+
+        SharedStockTable() = default;
+
+        Slot* slots() const;
+
+    private:
+        Header* m_header = nullptr;
+    };
+}
@@ -0,0 +1,847 @@
+#ifdef TAKEAWAY_WITH_SQLITE
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+#include "sqlite_backend.h"
+#include "memory_sql.h"
+
+
+namespace TakeAwayPlatform
+{
+    namespace
+    {
+        // ==================== 自定义函数 ====================
+
+        void sql_now(sqlite3_context* context, int, sqlite3_value**)
+        {
+            const std::string text = CellOps::format_datetime(static_cast<int64_t>(std::time(nullptr)));
+            sqlite3_result_text(context, text.c_str(), -1, SQLITE_TRANSIENT);
+        }
+
+        void sql_from_unixtime(sqlite3_context* context, int, sqlite3_value** args)
+        {
+            if (sqlite3_value_type(args[0]) == SQLITE_NULL) {
+                sqlite3_result_null(context);
+                return;
+            }
+            const std::string text = CellOps::format_datetime(sqlite3_value_int64(args[0]));
+            sqlite3_result_text(context, text.c_str(), -1, SQLITE_TRANSIENT);
+        }
+
+        void sql_unix_timestamp(sqlite3_context* context, int argc, sqlite3_value** args)
+        {
+            if (argc == 0) {
+                sqlite3_result_int64(context, static_cast<int64_t>(std::time(nullptr)));
+                return;
+            }
+            if (sqlite3_value_type(args[0]) == SQLITE_NULL) {
+                sqlite3_result_null(context);
+                return;
+            }
+
+            const char* text = reinterpret_cast<const char*>(sqlite3_value_text(args[0]));
+            try {
+                sqlite3_result_int64(context, CellOps::coerce(Cell::string(text ? text : ""), Cell::DATETIME).number);
+            } catch (const SqlError&) {
+                sqlite3_result_null(context);
+            }
+        }
+
+        void register_functions(sqlite3* db)
+        {
+            sqlite3_create_function(db, "NOW", 0, SQLITE_UTF8, nullptr, sql_now, nullptr, nullptr);
+            sqlite3_create_function(db, "SYSDATE", 0, SQLITE_UTF8, nullptr, sql_now, nullptr, nullptr);
+            sqlite3_create_function(db, "FROM_UNIXTIME", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr,
+                                    sql_from_unixtime, nullptr, nullptr);
+            sqlite3_create_function(db, "UNIX_TIMESTAMP", 0, SQLITE_UTF8, nullptr, sql_unix_timestamp, nullptr, nullptr);
+            sqlite3_create_function(db, "UNIX_TIMESTAMP", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr,
+                                    sql_unix_timestamp, nullptr, nullptr);
+        }
+
+        // ==================== DDL 转换 ====================
+
+        std::string quote(const std::string& name)
+        {
+            return "\"" + name + "\"";
+        }
+
+        std::string literal(const Cell& value)
+        {
+            if (value.is_null()) {
+                return "NULL";
+            }
+            if (value.kind == Cell::INT || value.kind == Cell::DOUBLE || value.kind == Cell::DECIMAL) {
+                return CellOps::to_string(value);
+            }
+
+            std::string text = "'";
+            for (char ch : CellOps::to_string(value)) {
+                text += ch == '\'' ? "''" : std::string(1, ch);
+            }
+            return text + "'";
+        }
+
+        // 声明类型决定结果格式：DECIMAL 列按两位小数文本输出，与 MySQL 连接一致
+        const char* column_type(Cell::Kind type)
+        {
+            switch (type) {
+                case Cell::INT: return "INTEGER";
+                case Cell::DOUBLE: return "REAL";
+                case Cell::DECIMAL: return "DECIMAL";
+                case Cell::DATETIME: return "DATETIME";
+                default: return "TEXT";
+            }
+        }
+
+        const char* LOCAL_NOW = "(datetime('now', 'localtime'))";
+
+        // SQLite 的索引名在库内唯一，MySQL 只在表内唯一，统一加表名前缀
+        std::string index_name(const std::string& table, const IndexDef& index)
+        {
+            return table + "_" + (index.name.empty() ? index.columns[0] : index.name);
+        }
+
+        std::string create_index(const std::string& table, const IndexDef& index, bool ifNotExists)
+        {
+            std::string sql = std::string("CREATE ") + (index.unique ? "UNIQUE " : "") + "INDEX " +
+                              (ifNotExists ? "IF NOT EXISTS " : "") + quote(index_name(table, index)) +
+                              " ON " + quote(table) + " (";
+            for (size_t position = 0; position < index.columns.size(); ++position) {
+                sql += (position ? ", " : "") + quote(index.columns[position]);
+            }
+            return sql + ")";
+        }
+
+        // ALTER TABLE ADD COLUMN 的默认值必须是常量，NOT NULL 列另需隐式默认值
+        std::string added_column(const ColumnDef& column)
+        {
+            std::string sql = quote(column.name) + " " + column_type(column.type);
+            if (column.notNull) {
+                sql += " NOT NULL";
+            }
+
+            if (column.hasDefault && column.defaultNow) {
+                sql += " DEFAULT " + literal(Cell::string(CellOps::format_datetime(std::time(nullptr))));
+            } else if (column.hasDefault) {
+                sql += " DEFAULT " + literal(CellOps::coerce(column.defaultValue, column.type));
+            } else if (column.notNull) {
+                switch (column.type) {
+                    case Cell::TEXT: sql += " DEFAULT ''"; break;
+                    case Cell::DATETIME: sql += " DEFAULT '1970-01-01 00:00:00'"; break;
+                    default: sql += " DEFAULT 0"; break;
+                }
+            }
+            return sql;
+        }
+
+        // 把一条 MySQL DDL 转换为 SQLite 语句序列；ifNotExists 用于可重复执行的建表脚本
+        std::vector<std::string> translate(const Statement& st, bool ifNotExists)
+        {
+            std::vector<std::string> out;
+
+            switch (st.kind) {
+                case Statement::CREATE_TABLE: {
+                    ifNotExists = ifNotExists || st.ifExists;
+
+                    std::vector<std::string> primary;
+                    for (const auto& column : st.columnDefs) {
+                        if (column.primaryKey) {
+                            primary.push_back(column.name);
+                        }
+                    }
+                    for (const auto& index : st.indexes) {
+                        if (index.primary) {
+                            primary = index.columns;
+                        }
+                    }
+
+                    // 单列整数主键写成 INTEGER PRIMARY KEY，即 rowid，省略时自动分配
+                    bool rowidKey = false;
+                    bool autoIncrement = false;
+                    std::string sql = std::string("CREATE TABLE ") + (ifNotExists ? "IF NOT EXISTS " : "") + quote(st.table) + " (";
+                    for (size_t position = 0; position < st.columnDefs.size(); ++position) {
+                        const ColumnDef& column = st.columnDefs[position];
+                        sql += (position ? ", " : "") + quote(column.name);
+
+                        if (primary.size() == 1 && primary[0] == column.name && column.type == Cell::INT) {
+                            sql += " INTEGER PRIMARY KEY";
+                            if (column.autoIncrement) {
+                                sql += " AUTOINCREMENT";
+                                autoIncrement = true;
+                            }
+                            rowidKey = true;
+                            continue;
+                        }
+
+                        sql += std::string(" ") + column_type(column.type);
+                        if (column.notNull || column.primaryKey) {
+                            sql += " NOT NULL";
+                        }
+                        if (column.hasDefault) {
+                            sql += " DEFAULT " + (column.defaultNow ? std::string(LOCAL_NOW)
+                                                                    : literal(CellOps::coerce(column.defaultValue, column.type)));
+                        }
+                    }
+                    if (!primary.empty() && !rowidKey) {
+                        sql += ", PRIMARY KEY (";
+                        for (size_t position = 0; position < primary.size(); ++position) {
+                            sql += (position ? ", " : "") + quote(primary[position]);
+                        }
+                        sql += ")";
+                    }
+                    out.push_back(sql + ")");
+
+                    // 表选项 AUTO_INCREMENT=N：首次建表时设置自增起点
+                    if (autoIncrement && st.autoIncrement > 1) {
+                        out.push_back("INSERT INTO sqlite_sequence (name, seq) SELECT '" + st.table + "', " +
+                                      std::to_string(st.autoIncrement - 1) +
+                                      " WHERE NOT EXISTS (SELECT 1 FROM sqlite_sequence WHERE name = '" + st.table + "')");
+                    }
+
+                    for (const auto& column : st.columnDefs) {
+                        if (column.unique && !column.primaryKey) {
+                            IndexDef index;
+                            index.columns = {column.name};
+                            index.unique = true;
+                            out.push_back(create_index(st.table, index, ifNotExists));
+                        }
+                    }
+                    for (const auto& index : st.indexes) {
+                        if (!index.primary) {
+                            out.push_back(create_index(st.table, index, ifNotExists));
+                        }
+                    }
+
+                    // ON UPDATE CURRENT_TIMESTAMP：语句未显式修改该列时由触发器补上
+                    for (const auto& column : st.columnDefs) {
+                        if (column.onUpdateNow) {
+                            out.push_back("CREATE TRIGGER " + std::string(ifNotExists ? "IF NOT EXISTS " : "") +
+                                          quote(st.table + "_" + column.name + "_on_update") + " AFTER UPDATE ON " +
+                                          quote(st.table) + " FOR EACH ROW WHEN NEW." + quote(column.name) + " IS OLD." +
+                                          quote(column.name) + " BEGIN UPDATE " + quote(st.table) + " SET " +
+                                          quote(column.name) + " = " + LOCAL_NOW + " WHERE rowid = NEW.rowid; END");
+                        }
+                    }
+                    break;
+                }
+
+                case Statement::CREATE_INDEX:
+                    out.push_back(create_index(st.table, st.indexes[0], ifNotExists));
+                    break;
+
+                case Statement::ALTER_TABLE:
+                    for (const auto& action : st.actions) {
+                        switch (action.kind) {
+                            case AlterAction::ADD_COLUMN:
+                                out.push_back("ALTER TABLE " + quote(st.table) + " ADD COLUMN " + added_column(action.column));
+                                break;
+                            case AlterAction::ADD_INDEX:
+                                out.push_back(create_index(st.table, action.index, ifNotExists));
+                                break;
+                            case AlterAction::DROP_INDEX:
+                                out.push_back("DROP INDEX " + quote(index_name(st.table, action.index)));
+                                break;
+                            case AlterAction::MODIFY_COLUMN:
+                                break;      // SQLite 不能修改列定义，由 execute_ddl 重建表
+                        }
+                    }
+                    break;
+
+                case Statement::DROP_TABLE:
+                    out.push_back("DROP TABLE " + std::string(st.ifExists ? "IF EXISTS " : "") + quote(st.table));
+                    break;
+
+                // 建表时不生成外键，SET FOREIGN_KEY_CHECKS 等会话变量无需处理
+                case Statement::SET:
+                    break;
+
+                default:
+                    throw SqlError("Not a DDL statement");
+            }
+            return out;
+        }
+
+        bool is_ddl(const std::string& sql)
+        {
+            size_t index = 0;
+            while (index < sql.size() && std::isspace(static_cast<unsigned char>(sql[index]))) {
+                ++index;
+            }
+
+            std::string keyword;
+            while (index < sql.size() && std::isalpha(static_cast<unsigned char>(sql[index]))) {
+                keyword += static_cast<char>(std::toupper(static_cast<unsigned char>(sql[index++])));
+            }
+            return keyword == "CREATE" || keyword == "ALTER" || keyword == "DROP" || keyword == "SET";
+        }
+
+        bool is_decimal(const char* declared)
+        {
+            return declared && (sqlite3_strnicmp(declared, "DECIMAL", 7) == 0 || sqlite3_strnicmp(declared, "NUMERIC", 7) == 0);
+        }
+    }
+
+    // ==================== SqliteBackend ====================
+
+    SqliteBackend::SqliteBackend(const std::string& path, const std::string& schemaFile)
+        : path(path)
+    {
+        const std::filesystem::path parent = std::filesystem::path(path).parent_path();
+        if (!parent.empty()) {
+            std::error_code ignored;
+            std::filesystem::create_directories(parent, ignored);
+        }
+
+        const int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+        if (sqlite3_open_v2(path.c_str(), &db, flags, nullptr) != SQLITE_OK) {
+            const std::string message = db ? sqlite3_errmsg(db) : "out of memory";
+            sqlite3_close(db);
+            throw std::runtime_error("Cannot open " + path + ": " + message);
+        }
+
+        // 写冲突时等待而不是立即返回 SQLITE_BUSY；WAL 下 NORMAL 同步只在检查点 fsync
+        sqlite3_busy_timeout(db, 5000);
+        register_functions(db);
+        sqlite3_create_function(db, "GET_LOCK", 2, SQLITE_UTF8, this, sql_get_lock, nullptr, nullptr);
+        sqlite3_create_function(db, "RELEASE_LOCK", 1, SQLITE_UTF8, this, sql_release_lock, nullptr, nullptr);
+
+        std::string error;
+        if (!exec("PRAGMA journal_mode = WAL", error) || !exec("PRAGMA synchronous = NORMAL", error)) {
+            sqlite3_close(db);
+            throw std::runtime_error("Cannot configure " + path + ": " + error);
+        }
+
+        try {
+            load_schema(path, schemaFile);
+        } catch (...) {
+            sqlite3_close(db);
+            throw;
+        }
+    }
+
+    SqliteBackend::~SqliteBackend()
+    {
+        for (auto& entry : statements) {
+            sqlite3_finalize(entry.second);
+        }
+        // 未提交的事务在关闭连接时回滚，持有的命名锁随之释放，与 MySQL 会话结束一致
+        sqlite3_close(db);
+        for (auto& entry : namedLocks) {
+            ::close(entry.second.fd);
+        }
+    }
+
+    // ==================== 命名锁 ====================
+
+    void SqliteBackend::sql_get_lock(sqlite3_context* context, int, sqlite3_value** args)
+    {
+        auto* backend = static_cast<SqliteBackend*>(sqlite3_user_data(context));
+        const char* name = reinterpret_cast<const char*>(sqlite3_value_text(args[0]));
+        if (!name || sqlite3_value_type(args[1]) == SQLITE_NULL) {
+            sqlite3_result_null(context);
+            return;
+        }
+
+        const int result = backend->get_lock(name, sqlite3_value_double(args[1]));
+        if (result < 0) {
+            sqlite3_result_null(context);
+        } else {
+            sqlite3_result_int(context, result);
+        }
+    }
+
+    void SqliteBackend::sql_release_lock(sqlite3_context* context, int, sqlite3_value** args)
+    {
+        auto* backend = static_cast<SqliteBackend*>(sqlite3_user_data(context));
+        const char* name = reinterpret_cast<const char*>(sqlite3_value_text(args[0]));
+        const int result = name ? backend->release_lock(name) : -1;
+        if (result < 0) {
+            sqlite3_result_null(context);
+        } else {
+            sqlite3_result_int(context, result);
+        }
+    }
+
+    std::string SqliteBackend::lock_path(const std::string& name) const
+    {
+        // 锁名可以是任意文本，文件名中只保留安全字符；锁文件不删除，删除与加锁之间存在竞争
+        std::string file = path + ".lock-";
+        for (unsigned char ch : name) {
+            file += std::isalnum(ch) || ch == '_' || ch == '-' || ch == '.' ? static_cast<char>(ch) : '_';
+        }
+        return file;
+    }
+
+    int SqliteBackend::get_lock(const std::string& name, double timeoutSec)
+    {
+        // 与 MySQL 一致，同一会话可重复获取，释放相同次数后才真正释放
+        auto held = namedLocks.find(name);
+        if (held != namedLocks.end()) {
+            ++held->second.count;
+            return 1;
+        }
+
+        const int fd = ::open(lock_path(name).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return -1;
+        }
+
+        // flock 按打开的文件描述归属，同一进程内的两个连接之间同样互斥；负的超时表示一直等待
+        const auto deadline = std::chrono::steady_clock::now() +
+                              std::chrono::milliseconds(static_cast<int64_t>(std::max(timeoutSec, 0.0) * 1000));
+        while (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            if (errno != EWOULDBLOCK && errno != EINTR) {
+                ::close(fd);
+                return -1;
+            }
+            if (timeoutSec >= 0 && std::chrono::steady_clock::now() >= deadline) {
+                ::close(fd);
+                return 0;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(LOCK_POLL_INTERVAL_MS));
+        }
+
+        namedLocks[name] = {fd, 1};
+        return 1;
+    }
+
+    int SqliteBackend::release_lock(const std::string& name)
+    {
+        auto held = namedLocks.find(name);
+        if (held != namedLocks.end()) {
+            if (--held->second.count == 0) {
+                ::close(held->second.fd);
+                namedLocks.erase(held);
+            }
+            return 1;
+        }
+
+        // 未持有：被其他会话持有时返回 0，无人持有时返回 NULL，与 MySQL 一致
+        const int fd = ::open(lock_path(name).c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) {
+            return -1;
+        }
+        const bool free = ::flock(fd, LOCK_EX | LOCK_NB) == 0;
+        ::close(fd);
+        return free ? -1 : 0;
+    }
+
+    void SqliteBackend::load_schema(const std::string& path, const std::string& schemaFile)
+    {
+        static std::mutex loadedMutex;
+        static std::set<std::string> loaded;
+
+        std::lock_guard<std::mutex> lock(loadedMutex);
+        if (schemaFile.empty() || loaded.count(path)) {
+            return;
+        }
+
+        std::ifstream file(schemaFile);
+        if (!file) {
+            throw std::runtime_error("Cannot open schema file " + schemaFile);
+        }
+        std::stringstream script;
+        script << file.rdbuf();
+
+        // 全部语句带 IF NOT EXISTS，已有的库重复执行不受影响
+        std::string error;
+        if (!exec("BEGIN IMMEDIATE", error)) {
+            throw std::runtime_error("Schema load failed: " + error);
+        }
+        try {
+            for (const auto& st : parse_script(script.str())) {
+                for (const auto& sql : translate(*st, true)) {
+                    if (!exec(sql, error)) {
+                        throw std::runtime_error(error + " sql: " + sql);
+                    }
+                }
+            }
+        } catch (const std::exception& e) {
+            exec("ROLLBACK", error);
+            throw std::runtime_error(std::string("Schema load failed: ") + e.what());
+        }
+        if (!exec("COMMIT", error)) {
+            throw std::runtime_error("Schema load failed: " + error);
+        }
+
+        loaded.insert(path);
+    }
+
+    bool SqliteBackend::execute(const std::string& sql, const SqlParams& params,
+                                StorageResult& result, std::string& error)
+    {
+        if (is_ddl(sql)) {
+            return execute_ddl(sql, error);
+        }
+
+        sqlite3_stmt* stmt = prepare(sql, error);
+        if (!stmt) {
+            return false;
+        }
+
+        int rc = SQLITE_OK;
+        for (size_t index = 0; index < params.size() && rc == SQLITE_OK; ++index) {
+            const mysqlx::Value& value = params[index];
+            const int position = static_cast<int>(index + 1);
+            switch (value.getType()) {
+                case mysqlx::Value::VNULL:
+                    rc = sqlite3_bind_null(stmt, position);
+                    break;
+                case mysqlx::Value::INT64:
+                    rc = sqlite3_bind_int64(stmt, position, value.get<int64_t>());
+                    break;
+                case mysqlx::Value::UINT64:
+                    rc = sqlite3_bind_int64(stmt, position, static_cast<sqlite3_int64>(value.get<uint64_t>()));
+                    break;
+                case mysqlx::Value::BOOL:
+                    rc = sqlite3_bind_int(stmt, position, value.get<bool>() ? 1 : 0);
+                    break;
+                case mysqlx::Value::FLOAT:
+                case mysqlx::Value::DOUBLE:
+                    rc = sqlite3_bind_double(stmt, position, value.get<double>());
+                    break;
+                case mysqlx::Value::STRING: {
+                    const std::string text = value.get<std::string>();
+                    rc = sqlite3_bind_text(stmt, position, text.data(), static_cast<int>(text.size()), SQLITE_TRANSIENT);
+                    break;
+                }
+                default:
+                    error = "Unsupported parameter type";
+                    sqlite3_clear_bindings(stmt);
+                    return false;
+            }
+        }
+
+        if (rc != SQLITE_OK) {
+            error = sqlite3_errmsg(db);
+            sqlite3_clear_bindings(stmt);
+            return false;
+        }
+
+        // 列信息每次执行取一次，DECIMAL 列按声明类型格式化
+        const int columnCount = sqlite3_column_count(stmt);
+        std::vector<bool> decimal(columnCount, false);
+        for (int column = 0; column < columnCount; ++column) {
+            result.columns.emplace_back(sqlite3_column_name(stmt, column));
+            decimal[column] = is_decimal(sqlite3_column_decltype(stmt, column));
+        }
+
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            mysqlx::Row row;
+            for (int column = 0; column < columnCount; ++column) {
+                const auto position = static_cast<mysqlx::col_count_t>(column);
+                switch (sqlite3_column_type(stmt, column)) {
+                    case SQLITE_NULL:
+                        row.set(position, mysqlx::Value());
+                        break;
+                    case SQLITE_INTEGER:
+                        if (decimal[column]) {
+                            row.set(position, Money::fromCents(sqlite3_column_int64(stmt, column) * 100).toString());
+                        } else {
+                            row.set(position, mysqlx::Value(static_cast<int64_t>(sqlite3_column_int64(stmt, column))));
+                        }
+                        break;
+                    case SQLITE_FLOAT:
+                        if (decimal[column]) {
+                            row.set(position, Money::fromYuan(sqlite3_column_double(stmt, column)).toString());
+                        } else {
+                            row.set(position, mysqlx::Value(sqlite3_column_double(stmt, column)));
+                        }
+                        break;
+                    default: {
+                        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+                        row.set(position, std::string(text, static_cast<size_t>(sqlite3_column_bytes(stmt, column))));
+                        break;
+                    }
+                }
+            }
+            result.rows.push_back(std::move(row));
+        }
+
+        const bool ok = rc == SQLITE_DONE;
+        if (!ok) {
+            error = sqlite3_errmsg(db);
+        } else if (columnCount == 0) {
+            result.affectedRows = static_cast<uint64_t>(sqlite3_changes(db));
+            // 与 MySQL 一致取本条语句生成的第一个 ID；多行插入的 rowid 连续分配
+            if (result.affectedRows > 0 && sqlite3_strnicmp(sqlite3_sql(stmt), "INSERT", 6) == 0) {
+                result.lastInsertId = static_cast<uint64_t>(sqlite3_last_insert_rowid(db)) - result.affectedRows + 1;
+            }
+        }
+
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        return ok;
+    }
+
+    bool SqliteBackend::execute_ddl(const std::string& sql, std::string& error)
+    {
+        std::unique_ptr<Statement> st;
+        std::vector<std::string> statements;
+        try {
+            st = parse_statement(sql);
+            statements = translate(*st, false);
+        } catch (const SqlError& e) {
+            error = e.what();
+            return false;
+        }
+
+        // 表结构变化后已编译的语句会自动重新编译，缓存无需清理
+        for (const auto& statement : statements) {
+            if (!exec(statement, error)) {
+                return false;
+            }
+        }
+
+        for (const auto& action : st->actions) {
+            if (action.kind == AlterAction::MODIFY_COLUMN && !modify_column(st->table, action.column, error)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 按 SQLite 文档的做法重建表：新建表、复制数据、删除旧表、改名，再按原文重建索引和触发器。
+    // 在保存点内执行，失败时表不变
+    bool SqliteBackend::modify_column(const std::string& table, const ColumnDef& column, std::string& error)
+    {
+        std::vector<std::vector<std::string>> info;
+        std::vector<std::vector<std::string>> master;
+        std::vector<std::vector<std::string>> objects;
+        if (!query_text("SELECT name, type, \"notnull\", dflt_value, pk FROM pragma_table_info(?) ORDER BY cid",
+                        {table}, info, error) ||
+            !query_text("SELECT sql FROM sqlite_master WHERE type = 'table' AND name = ?", {table}, master, error) ||
+            !query_text("SELECT sql FROM sqlite_master WHERE type IN ('index', 'trigger') AND tbl_name = ? AND sql IS NOT NULL",
+                        {table}, objects, error)) {
+            return false;
+        }
+        if (info.empty() || master.empty()) {
+            error = "Table '" + table + "' doesn't exist";
+            return false;
+        }
+
+        size_t keyColumns = 0;
+        bool found = false;
+        for (const auto& row : info) {
+            keyColumns += row[4] != "0" ? 1 : 0;
+            found = found || sqlite3_stricmp(row[0].c_str(), column.name.c_str()) == 0;
+        }
+        if (!found) {
+            error = "Unknown column '" + column.name + "' in '" + table + "'";
+            return false;
+        }
+        const bool autoIncrement = master[0][0].find("AUTOINCREMENT") != std::string::npos;
+
+        // 列定义沿用 table_info 的声明类型、非空约束和默认值原文，只替换被修改的列
+        std::vector<std::string> names;
+        std::vector<std::string> primary(keyColumns);
+        const std::string rebuilt = table + "__rebuild";
+        std::string sql = "CREATE TABLE " + quote(rebuilt) + " (";
+        for (const auto& row : info) {
+            const bool modified = sqlite3_stricmp(row[0].c_str(), column.name.c_str()) == 0;
+            const bool rowidKey = keyColumns == 1 && row[4] != "0" && sqlite3_stricmp(row[1].c_str(), "INTEGER") == 0;
+            const std::string name = modified ? column.name : row[0];
+            sql += (names.empty() ? "" : ", ") + quote(name);
+            names.push_back(name);
+
+            if (modified && column.primaryKey && row[4] == "0") {
+                error = "ALTER TABLE MODIFY ... PRIMARY KEY is not supported";
+                return false;
+            }
+            if (modified && column.autoIncrement && !(rowidKey && column.type == Cell::INT)) {
+                error = "AUTO_INCREMENT requires a single integer primary key";
+                return false;
+            }
+
+            if (rowidKey && (!modified || column.type == Cell::INT)) {
+                sql += " INTEGER PRIMARY KEY";
+                if (modified ? column.autoIncrement : autoIncrement) {
+                    sql += " AUTOINCREMENT";
+                }
+                continue;
+            }
+            if (row[4] != "0") {
+                primary[std::stoul(row[4]) - 1] = name;
+            }
+
+            if (modified) {
+                sql += std::string(" ") + column_type(column.type);
+                if (column.notNull || row[4] != "0") {
+                    sql += " NOT NULL";
+                }
+                if (column.hasDefault) {
+                    sql += " DEFAULT " + (column.defaultNow ? std::string(LOCAL_NOW)
+                                                            : literal(CellOps::coerce(column.defaultValue, column.type)));
+                }
+            } else {
+                sql += " " + row[1] + (row[2] != "0" ? " NOT NULL" : "");
+                // table_info 给出的默认值是去掉外层括号的表达式原文，重新加上括号
+                if (!row[3].empty()) {
+                    sql += " DEFAULT (" + row[3] + ")";
+                }
+            }
+        }
+        primary.erase(std::remove(primary.begin(), primary.end(), std::string()), primary.end());
+        if (!primary.empty()) {
+            sql += ", PRIMARY KEY (";
+            for (size_t position = 0; position < primary.size(); ++position) {
+                sql += (position ? ", " : "") + quote(primary[position]);
+            }
+            sql += ")";
+        }
+        sql += ")";
+
+        std::string list;
+        for (const auto& name : names) {
+            list += (list.empty() ? "" : ", ") + quote(name);
+        }
+
+        std::vector<std::string> steps = {
+            "SAVEPOINT modify_column",
+            sql,
+            "INSERT INTO " + quote(rebuilt) + " (" + list + ") SELECT " + list + " FROM " + quote(table),
+            "DROP TABLE " + quote(table),
+            "ALTER TABLE " + quote(rebuilt) + " RENAME TO " + quote(table),
+        };
+        for (const auto& row : objects) {
+            steps.push_back(row[0]);
+        }
+
+        for (const auto& step : steps) {
+            if (!exec(step, error)) {
+                std::string ignored;
+                exec("ROLLBACK TO modify_column", ignored);
+                exec("RELEASE modify_column", ignored);
+                return false;
+            }
+        }
+        return exec("RELEASE modify_column", error);
+    }
+
+    sqlite3_stmt* SqliteBackend::prepare(const std::string& sql, std::string& error)
+    {
+        auto it = statements.find(sql);
+        if (it != statements.end()) {
+            return it->second;
+        }
+
+        if (statements.size() >= STATEMENT_CACHE_CAPACITY) {
+            for (auto& entry : statements) {
+                sqlite3_finalize(entry.second);
+            }
+            statements.clear();
+        }
+
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v3(db, sql.c_str(), static_cast<int>(sql.size()), SQLITE_PREPARE_PERSISTENT,
+                               &stmt, nullptr) != SQLITE_OK) {
+            error = sqlite3_errmsg(db);
+            sqlite3_finalize(stmt);
+            return nullptr;
+        }
+
+        statements.emplace(sql, stmt);
+        return stmt;
+    }
+
+    bool SqliteBackend::exec(const std::string& sql, std::string& error)
+    {
+        char* message = nullptr;
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &message) != SQLITE_OK) {
+            error = message ? message : sqlite3_errmsg(db);
+            sqlite3_free(message);
+            return false;
+        }
+        return true;
+    }
+
+    // 事务开始即取得写锁，避免读锁升级为写锁时与其他连接互相等待
+    bool SqliteBackend::begin(std::string& error)
+    {
+        return exec("BEGIN IMMEDIATE", error);
+    }
+
+    bool SqliteBackend::commit(std::string& error)
+    {
+        return exec("COMMIT", error);
+    }
+
+    bool SqliteBackend::rollback(std::string& error)
+    {
+        return exec("ROLLBACK", error);
+    }
+
+    bool SqliteBackend::ping()
+    {
+        std::string error;
+        return exec("SELECT 1", error);
+    }
+
+    int SqliteBackend::index_exists(const std::string& table, const std::string& index, std::string& error)
+    {
+        IndexDef def;
+        def.name = index;
+        return exists("SELECT 1 FROM sqlite_master WHERE type = 'index' AND name = ? COLLATE NOCASE",
+                      {index_name(table, def)}, error);
+    }
+
+    int SqliteBackend::column_exists(const std::string& table, const std::string& column, std::string& error)
+    {
+        return exists("SELECT 1 FROM pragma_table_info(?) WHERE name = ? COLLATE NOCASE", {table, column}, error);
+    }
+
+    int SqliteBackend::exists(const std::string& sql, const std::vector<std::string>& params, std::string& error)
+    {
+        std::vector<std::vector<std::string>> rows;
+        if (!query_text(sql, params, rows, error)) {
+            return -1;
+        }
+        return rows.empty() ? 0 : 1;
+    }
+
+    bool SqliteBackend::query_text(const std::string& sql, const std::vector<std::string>& params,
+                                   std::vector<std::vector<std::string>>& rows, std::string& error)
+    {
+        sqlite3_stmt* stmt = prepare(sql, error);
+        if (!stmt) {
+            return false;
+        }
+        for (size_t index = 0; index < params.size(); ++index) {
+            sqlite3_bind_text(stmt, static_cast<int>(index + 1), params[index].c_str(), -1, SQLITE_TRANSIENT);
+        }
+
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            std::vector<std::string> row;
+            for (int column = 0; column < sqlite3_column_count(stmt); ++column) {
+                const unsigned char* text = sqlite3_column_text(stmt, column);
+                row.emplace_back(text ? reinterpret_cast<const char*>(text) : "");
+            }
+            rows.push_back(std::move(row));
+        }
+        if (rc != SQLITE_DONE) {
+            error = sqlite3_errmsg(db);
+        }
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        return rc == SQLITE_DONE;
+    }
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+#pragma once
+
+#ifdef TAKEAWAY_WITH_SQLITE
+
+#include <unordered_map>
+#include <sqlite3.h>
+
+#include "storage_backend.h"
+
+namespace TakeAwayPlatform
+{
+    struct ColumnDef;
+
+    // 嵌入式 SQLite 后端，用于单机部署和没有 MySQL 的性能回归环境。
+    // 连接以 WAL 模式打开，读不阻塞写；每个 DatabaseHandler 持有独立连接，
+    // 连接池保证同一时刻只有一个线程使用它，因此以无互斥（NOMUTEX）方式打开。
+    // 业务语句原样执行，NOW、FROM_UNIXTIME 等 MySQL 函数注册为自定义函数；
+    // DDL 先按 MySQL 语法解析再生成 SQLite 语句，建表脚本和迁移脚本与 MySQL 共用
+    class SqliteBackend : public StorageBackend
+    {
+    public:
+        // 打开失败抛出 std::runtime_error。进程内首次打开某个文件时执行 schemaFile（可重复执行）
+        SqliteBackend(const std::string& path, const std::string& schemaFile);
+        ~SqliteBackend() override;
+
+        const char* name() const override { return "sqlite"; }
+
+        bool execute(const std::string& sql, const SqlParams& params,
+                     StorageResult& result, std::string& error) override;
+
+        bool begin(std::string& error) override;
+        bool commit(std::string& error) override;
+        bool rollback(std::string& error) override;
+
+        bool ping() override;
+
+        int index_exists(const std::string& table, const std::string& index, std::string& error) override;
+        int column_exists(const std::string& table, const std::string& column, std::string& error) override;
+
+    private:
+        // 执行一条带文本参数的查询，返回是否有结果行，失败返回 -1
+        int exists(const std::string& sql, const std::vector<std::string>& params, std::string& error);
+
+        // 执行一条带文本参数的查询，结果按文本取出（NULL 为空串）
+        bool query_text(const std::string& sql, const std::vector<std::string>& params,
+                        std::vector<std::vector<std::string>>& rows, std::string& error);
+
+        // 取出（或编译并缓存）模板对应的语句
+        sqlite3_stmt* prepare(const std::string& sql, std::string& error);
+
+        bool execute_ddl(const std::string& sql, std::string& error);
+
+        // ALTER TABLE MODIFY：SQLite 不支持修改列定义，重建整张表
+        bool modify_column(const std::string& table, const ColumnDef& column, std::string& error);
+
+        bool exec(const std::string& sql, std::string& error);
+
+        void load_schema(const std::string& path, const std::string& schemaFile);
+
+        // GET_LOCK / RELEASE_LOCK：迁移在多个进程同时启动时靠它串行化，SQLite 没有对应机制，
+        // 改为对 "<数据库文件>.lock-<锁名>" 加 flock，进程退出或连接关闭时由内核释放
+        static void sql_get_lock(sqlite3_context* context, int argc, sqlite3_value** args);
+        static void sql_release_lock(sqlite3_context* context, int argc, sqlite3_value** args);
+
+        std::string lock_path(const std::string& name) const;
+
+        // 返回 1 为获得、0 为超时、-1 为出错（SQL 中为 NULL）
+        int get_lock(const std::string& name, double timeoutSec);
+
+        // 返回 1 为已释放、0 为由其他会话持有、-1 为无人持有或出错（SQL 中为 NULL）
+        int release_lock(const std::string& name);
+
+    private:
+        // 模板数量有限，超出容量说明调用方拼接了变量，整体丢弃即可
+        static constexpr size_t STATEMENT_CACHE_CAPACITY = 64;
+
+        static constexpr int LOCK_POLL_INTERVAL_MS = 50;
+
+        struct NamedLock {
+            int fd = -1;
+            int count = 0;      // 同一连接重复获取的次数
+        };
+
+        std::string path;
+        sqlite3* db = nullptr;
+        std::unordered_map<std::string, sqlite3_stmt*> statements;
+        std::unordered_map<std::string, NamedLock> namedLocks;
+    };
+
+}
+
+#endif
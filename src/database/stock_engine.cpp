@@ -0,0 +1,398 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <filesystem>
+
+#include "stock_engine.h"
+#include "file_lock.h"
+
+
+namespace TakeAwayPlatform
+{
+    namespace
+    {
+        // status 写在最前：MySQL 按顺序求值 SET 子句，放在 stock 之前才能与其他后端一样读到旧库存。
+        // 增量更新不需要重试，但仍递增 version，使并发的条件更新能发现这次修改
+        const char* const APPLY_DELTA_SQL =
+            "UPDATE dishes SET status = CASE WHEN stock - ? <= 0 THEN 'sold_out' ELSE 'available' END, "
+            "stock = stock - ?, sales_count = COALESCE(sales_count, 0) + ?, updated_at = NOW(), "
+            "version = version + 1 WHERE dish_id = ?";
+
+        const char* const SELECT_STOCK_SQL =
+            "SELECT stock, version FROM dishes WHERE dish_id = ?";
+
+        const char* const CAS_STOCK_SQL =
+            "UPDATE dishes SET stock = ?, status = ?, sales_count = COALESCE(sales_count, 0) + ?, "
+            "updated_at = NOW(), version = version + 1 WHERE dish_id = ? AND version = ?";
+    }
+
+    StockEngine::StockEngine(const DBConfig& config, const StockEngineOptions& options)
+        : options(options), handler(config)
+    {
+        std::error_code error;
+        hasSpill = std::filesystem::exists(this->options.spillPath, error);
+
+        // 首次载入在开始接收请求之前完成，此后冷路径对数据库的修改不会漏算
+        if (!load()) {
+            std::cerr << "Stock engine: initial load failed, hot dishes go through SQL until the database recovers"
+                      << std::endl;
+        }
+
+        flushThread = std::thread([this] { flush_loop(); });
+    }
+
+    StockEngine::~StockEngine()
+    {
+        stop();
+    }
+
+    StockCounter* StockEngine::counter(int64_t dishId) const
+    {
+        // 共享模式下其他 worker 已载入的菜品同样在计数器上预留，
+        // 否则本进程载入之前走 SQL 扣减的数量不会计入共享库存
+        if (options.sharedTable) {
+            return sharedActive.load(std::memory_order_acquire) ? options.sharedTable->find(dishId) : nullptr;
+        }
+
+        const HotMap* map = hotMap.load(std::memory_order_acquire);
+        if (!map) {
+            return nullptr;
+        }
+        auto it = map->find(dishId);
+        return it == map->end() ? nullptr : it->second.get();
+    }
+
+    StockReservation StockEngine::reserve(int64_t dishId, int quantity)
+    {
+        StockCounter* found = counter(dishId);
+        if (!found) {
+            return StockReservation::NOT_HOT;
+        }
+
+        StockCounter& stock = *found;
+        int64_t current = stock.available.load(std::memory_order_relaxed);
+        do {
+            if (current < quantity) {
+                stock.soldOut.fetch_add(1, std::memory_order_relaxed);
+                return StockReservation::SOLD_OUT;
+            }
+        } while (!stock.available.compare_exchange_weak(current, current - quantity,
+                                                        std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        stock.unflushed.fetch_add(quantity, std::memory_order_relaxed);
+        stock.reserved.fetch_add(1, std::memory_order_relaxed);
+        return StockReservation::RESERVED;
+    }
+
+    void StockEngine::release(int64_t dishId, int quantity)
+    {
+        StockCounter* found = counter(dishId);
+        if (!found) {
+            return;
+        }
+
+        found->available.fetch_add(quantity, std::memory_order_relaxed);
+        found->unflushed.fetch_sub(quantity, std::memory_order_relaxed);
+    }
+
+    int64_t StockEngine::reserve_in_db(DatabaseHandler& db, int64_t dishId, int quantity)
+    {
+        CasResult result = db.compare_and_swap(SELECT_STOCK_SQL, {dishId},
+            [&](const Json::Value& dish, std::vector<BatchStatement>& writes) {
+                const int64_t stock = dish["stock"].asInt64();
+                if (stock < quantity) {
+                    return false;
+                }
+                const int64_t remaining = stock - quantity;
+                writes.push_back({CAS_STOCK_SQL, {remaining, remaining > 0 ? "available" : "sold_out", quantity,
+                                                  dishId, dish["version"].asInt64()}});
+                return true;
+            });
+
+        switch (result) {
+            case CasResult::APPLIED:
+                return 1;
+            case CasResult::REJECTED:
+            case CasResult::NOT_FOUND:
+                return 0;
+            default:
+                return -1;
+        }
+    }
+
+    bool StockEngine::release_in_db(DatabaseHandler& db, int64_t dishId, int quantity)
+    {
+        return db.execute(APPLY_DELTA_SQL, {-quantity, -quantity, -quantity, dishId}) >= 0;
+    }
+
+    void StockEngine::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(stopMutex);
+            if (stopped) {
+                return;
+            }
+            stopped = true;
+        }
+
+        // 之后的预留走 SQL，后台线程最后一轮写回的增量即为全部增量
+        // （共享模式下为本进程预留的全部增量，其余 worker 停止时各自写回）
+        hotMap.store(nullptr, std::memory_order_release);
+        sharedActive.store(false, std::memory_order_release);
+        stopCv.notify_all();
+
+        if (flushThread.joinable()) {
+            flushThread.join();
+        }
+    }
+
+    Json::Value StockEngine::stats() const
+    {
+        Json::Value result;
+        uint64_t reservedCount = 0;
+        uint64_t soldOutCount = 0;
+        int64_t unflushedUnits = 0;
+
+        auto add = [&](int64_t, const StockCounter& stock) {
+            reservedCount += stock.reserved.load(std::memory_order_relaxed);
+            soldOutCount += stock.soldOut.load(std::memory_order_relaxed);
+            unflushedUnits += stock.unflushed.load(std::memory_order_relaxed);
+        };
+
+        // 共享模式下为所有 worker 的合计
+        size_t hotDishes = 0;
+        const HotMap* map = hotMap.load(std::memory_order_acquire);
+        if (options.sharedTable) {
+            options.sharedTable->for_each(add);
+            hotDishes = options.sharedTable->size();
+        } else if (map) {
+            for (const auto& [dishId, stock] : *map) {
+                add(dishId, *stock);
+            }
+            hotDishes = map->size();
+        }
+
+        result["loaded"] = options.sharedTable ? sharedActive.load() && hotDishes > 0 : map != nullptr;
+        result["shared"] = options.sharedTable != nullptr;
+        result["hot_dishes"] = static_cast<Json::UInt64>(hotDishes);
+        result["reserved"] = static_cast<Json::UInt64>(reservedCount);
+        result["sold_out"] = static_cast<Json::UInt64>(soldOutCount);
+        result["unflushed_units"] = static_cast<Json::Int64>(unflushedUnits);
+        result["flushes"] = static_cast<Json::UInt64>(flushes.load());
+        result["flushed_units"] = static_cast<Json::Int64>(flushedUnits.load());
+        result["spilled_units"] = static_cast<Json::Int64>(spilledUnits.load());
+        result["replayed_units"] = static_cast<Json::Int64>(replayedUnits.load());
+        result["spill_pending"] = hasSpill.load();
+        return result;
+    }
+
+    void StockEngine::flush_loop()
+    {
+        const auto interval = std::chrono::milliseconds(options.flushIntervalMs);
+
+        while (true) {
+            bool finished = false;
+            {
+                std::unique_lock<std::mutex> lock(stopMutex);
+                stopCv.wait_for(lock, interval, [this] { return stopped; });
+                finished = stopped;
+            }
+
+            if (!loaded) {
+                if (!finished && available()) {
+                    load();
+                }
+            } else if (hasSpill && available()) {
+                replay_spill();
+            }
+
+            // 共享模式下本进程载入之前也可能在其他 worker 登记的计数器上预留过
+            if (loaded || options.sharedTable) {
+                flush();
+            }
+
+            if (finished) {
+                return;
+            }
+        }
+    }
+
+    bool StockEngine::available() const
+    {
+        return std::chrono::steady_clock::now() >= retryAt;
+    }
+
+    bool StockEngine::load()
+    {
+        // 上次运行未写回的增量必须先落库，否则载入的库存偏多
+        if (hasSpill && !replay_spill()) {
+            return false;
+        }
+
+        auto map = std::make_unique<HotMap>();
+        auto collect = [&](const Json::Value& rows) {
+            if (!rows.isArray()) {
+                return false;
+            }
+            for (const auto& row : rows) {
+                // 共享表中已有的菜品沿用其计数器：先载入的 worker 已在上面预留，数据库中的库存尚未扣减
+                if (options.sharedTable) {
+                    options.sharedTable->attach(row["dish_id"].asInt64(), row["stock"].asInt64());
+                    continue;
+                }
+                auto stock = std::make_unique<StockCounter>();
+                stock->available = row["stock"].asInt64();
+                map->emplace(row["dish_id"].asInt64(), std::move(stock));
+            }
+            return true;
+        };
+
+        bool ok = true;
+        if (!options.hotDishes.empty()) {
+            std::string sql = "SELECT dish_id, stock FROM dishes WHERE dish_id IN (";
+            SqlParams params;
+            for (size_t index = 0; index < options.hotDishes.size(); ++index) {
+                sql += index ? ", ?" : "?";
+                params.emplace_back(options.hotDishes[index]);
+            }
+            sql += ")";
+            ok = collect(handler.query(sql, params));
+        }
+        if (ok && options.hotTopN > 0) {
+            ok = collect(handler.query("SELECT dish_id, stock FROM dishes ORDER BY sales_count DESC LIMIT ?",
+                                       {options.hotTopN}));
+        }
+
+        if (!ok) {
+            handler.reconnect();
+            if (!handler.is_connected()) {
+                retryAt = std::chrono::steady_clock::now() + std::chrono::seconds(RETRY_INTERVAL_SEC);
+            }
+            return false;
+        }
+
+        loaded = true;
+        if (!options.sharedTable) {
+            ownedMap = std::move(map);
+            hotMap.store(ownedMap.get(), std::memory_order_release);
+        }
+        return true;
+    }
+
+    void StockEngine::flush()
+    {
+        std::vector<std::pair<int64_t, int64_t>> deltas;
+        int64_t units = 0;
+        auto take = [&](int64_t dishId, StockCounter& stock) {
+            const int64_t delta = stock.unflushed.exchange(0, std::memory_order_relaxed);
+            if (delta != 0) {
+                deltas.emplace_back(dishId, delta);
+                units += delta;
+            }
+        };
+
+        // 共享模式下各 worker 的后台线程都可以取走任一菜品的增量，exchange 保证每个增量只写回一次
+        if (options.sharedTable) {
+            options.sharedTable->for_each(take);
+        } else {
+            for (const auto& [dishId, stock] : *ownedMap) {
+                take(dishId, *stock);
+            }
+        }
+        if (deltas.empty()) {
+            return;
+        }
+
+        if (available() && write_deltas(deltas)) {
+            ++flushes;
+            flushedUnits += units;
+            return;
+        }
+        spill(deltas);
+    }
+
+    bool StockEngine::write_deltas(const std::vector<std::pair<int64_t, int64_t>>& deltas)
+    {
+        std::vector<BatchStatement> statements;
+        statements.reserve(deltas.size());
+        for (const auto& [dishId, delta] : deltas) {
+            statements.push_back({APPLY_DELTA_SQL, {delta, delta, delta, dishId}});
+        }
+
+        if (handler.execute_batch(statements) >= 0) {
+            return true;
+        }
+
+        // 与登录日志不同，库存增量被拒绝时也不能丢弃，进入溢出文件等待人工处理或下次回放
+        std::cerr << "Stock engine: failed to write deltas for " << deltas.size()
+                  << " dishes: " << handler.last_error() << std::endl;
+        if (!handler.is_connected()) {
+            handler.reconnect();
+            if (!handler.is_connected()) {
+                retryAt = std::chrono::steady_clock::now() + std::chrono::seconds(RETRY_INTERVAL_SEC);
+            }
+        }
+        return false;
+    }
+
+    void StockEngine::spill(const std::vector<std::pair<int64_t, int64_t>>& deltas)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(options.spillPath).parent_path(), error);
+
+        // 每行一个增量：dish_id \t delta，同一菜品可出现多次，回放时累加
+        FileLock lock(options.spillPath);
+        std::ofstream file(options.spillPath, std::ios::app);
+        int64_t units = 0;
+        for (const auto& [dishId, delta] : deltas) {
+            file << dishId << '\t' << delta << '\n';
+            units += delta;
+        }
+        file.flush();
+
+        if (!file) {
+            std::cerr << "Stock engine: failed to spill deltas for " << deltas.size()
+                      << " dishes to " << options.spillPath << std::endl;
+            return;
+        }
+
+        spilledUnits += units;
+        hasSpill = true;
+    }
+
+    bool StockEngine::replay_spill()
+    {
+        // 读取、写库到删除在文件锁内完成：其他 worker 不会重复回放，也不会在读取之后追加而被一并删除
+        FileLock lock(options.spillPath);
+
+        std::unordered_map<int64_t, int64_t> totals;
+        {
+            std::ifstream file(options.spillPath);
+            int64_t dishId = 0;
+            int64_t delta = 0;
+            while (file >> dishId >> delta) {
+                totals[dishId] += delta;
+            }
+        }
+
+        std::vector<std::pair<int64_t, int64_t>> deltas;
+        int64_t units = 0;
+        for (const auto& [dishId, delta] : totals) {
+            if (delta != 0) {
+                deltas.emplace_back(dishId, delta);
+                units += delta;
+            }
+        }
+
+        // 整个文件在一个事务里回放，成功后删除，不会出现部分回放
+        if (!deltas.empty() && (!available() || !write_deltas(deltas))) {
+            return false;
+        }
+
+        std::remove(options.spillPath.c_str());
+        replayedUnits += units;
+        hasSpill = false;
+        return true;
+    }
+
+}
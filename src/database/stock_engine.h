@@ -0,0 +1,120 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "common.h"
+#include "db_handler.h"
+#include "shared_stock_table.h"
+
+namespace TakeAwayPlatform
+{
+    // 热点库存参数（config.json 中 database 节的 stock_* 项）
+    struct StockEngineOptions {
+        std::vector<int64_t> hotDishes;     // 固定的热点菜品
+        int hotTopN = 0;                    // 另按 sales_count 取前 N 个菜品作为热点，0 为不取
+        int flushIntervalMs = 200;          // 增量落库间隔
+        std::string spillPath = "/opt/TakeAwayPlatform/log/stock_deltas.spill";
+        SharedStockTable* sharedTable = nullptr;    // prefork 模式下各 worker 共用的计数器，为空时计数器在进程内
+    };
+
+    // 预留结果；NOT_HOT 表示该菜品不在内存中，由调用方走 SQL 扣减
+    enum class StockReservation {
+        RESERVED,
+        SOLD_OUT,
+        NOT_HOT
+    };
+
+    // 热点菜品的库存引擎：启动时从 dishes 载入热点菜品的库存，
+    // 下单在内存计数器上做无锁预留（CAS），不再争抢同一行的行锁；
+    // 后台线程每 flushIntervalMs 把累计的销量增量在一个事务里批量写回 stock / sales_count。
+    // 写库失败的增量追加到溢出文件，重启或数据库恢复后先回放再载入库存，保证与数据库对账一致；
+    // 非热点菜品仍由 reserve_in_db / release_in_db 直接扣减数据库。
+    // 多个 worker 进程各自载入库存会各自卖出全部库存，因此 prefork 模式下计数器放在
+    // options.sharedTable 中：先载入的 worker 决定初始库存，所有 worker 在同一组计数器上预留，
+    // 任一 worker 的后台线程都可以写回增量。溢出文件在各进程间以文件锁互斥。
+    // stop() 写回全部增量，应在排空阶段、关闭连接池之前调用
+    class StockEngine
+    {
+    public:
+        StockEngine(const DBConfig& config, const StockEngineOptions& options);
+        ~StockEngine();
+
+        StockEngine(const StockEngine&) = delete;
+        StockEngine& operator=(const StockEngine&) = delete;
+
+        // 预留 quantity 份库存，不等待落库；库存载入前及已停止时返回 NOT_HOT
+        StockReservation reserve(int64_t dishId, int quantity);
+
+        // 撤销 reserve 成功的预留（下单失败、取消订单）
+        void release(int64_t dishId, int quantity);
+
+        // 非热点菜品：库存充足时以版本号为条件扣减数据库库存，
+        // 返回 1 为预留成功、0 为库存不足（或菜品不存在）、-1 为执行失败或版本冲突重试用尽
+        static int64_t reserve_in_db(DatabaseHandler& db, int64_t dishId, int quantity);
+        static bool release_in_db(DatabaseHandler& db, int64_t dishId, int quantity);
+
+        // 停止后台线程并写回剩余增量，写库失败的增量进入溢出文件
+        void stop();
+
+        // 热点菜品数、预留/售罄次数、写回与溢出的增量
+        Json::Value stats() const;
+
+    private:
+        // 载入后不再增删，请求线程无锁读取
+        using HotMap = std::unordered_map<int64_t, std::unique_ptr<StockCounter>>;
+
+        // 菜品的计数器；未载入、已停止或不是热点菜品时返回 nullptr
+        StockCounter* counter(int64_t dishId) const;
+
+        void flush_loop();
+
+        // 上次连接失败后的重试间隔已过
+        bool available() const;
+
+        // 回放溢出文件后载入热点菜品库存，成功后发布 hotMap（共享模式下登记到共享表）
+        bool load();
+
+        // 取出全部增量并写回，失败时增量进入溢出文件
+        void flush();
+
+        // 在一个事务里写回增量，失败返回 false
+        bool write_deltas(const std::vector<std::pair<int64_t, int64_t>>& deltas);
+
+        void spill(const std::vector<std::pair<int64_t, int64_t>>& deltas);
+
+        // 数据库恢复后回放溢出文件，全部写入后删除该文件
+        bool replay_spill();
+
+    private:
+        static constexpr int RETRY_INTERVAL_SEC = 5;
+
+        StockEngineOptions options;
+        DatabaseHandler handler;    // 只由后台线程使用（stop 之后由调用线程使用）
+        std::thread flushThread;
+        std::chrono::steady_clock::time_point retryAt;     // 只由后台线程读写
+
+        bool loaded = false;                                // 只由后台线程读写
+        std::unique_ptr<HotMap> ownedMap;                   // 只由后台线程创建
+        std::atomic<const HotMap*> hotMap {nullptr};        // 载入完成后发布，停止时撤回
+        std::atomic<bool> sharedActive {true};              // 共享模式下停止时撤回
+
+        std::mutex stopMutex;
+        std::condition_variable stopCv;
+        bool stopped = false;
+
+        std::atomic<bool> hasSpill {false};
+
+        std::atomic<uint64_t> flushes {0};
+        std::atomic<int64_t> flushedUnits {0};
+        std::atomic<int64_t> spilledUnits {0};
+        std::atomic<int64_t> replayedUnits {0};
+    };
+
+}
@@ -0,0 +1,63 @@
+#include <stdexcept>
+
+#include "storage_backend.h"
+#include "memory_engine.h"
+#include "sqlite_backend.h"
+#include "jdbc_backend.h"
+
+
+namespace TakeAwayPlatform
+{
+    namespace
+    {
+        int count_found(StorageBackend& backend, const char* sql, const std::string& table,
+                        const std::string& name, std::string& error)
+        {
+            StorageResult result;
+            if (!backend.execute(sql, {table, name}, result, error)) {
+                return -1;
+            }
+            return !result.rows.empty() && result.rows[0][0].get<int64_t>() > 0 ? 1 : 0;
+        }
+    }
+
+    int StorageBackend::index_exists(const std::string& table, const std::string& index, std::string& error)
+    {
+        return count_found(*this, SQL_INDEX_EXISTS, table, index, error);
+    }
+
+    int StorageBackend::column_exists(const std::string& table, const std::string& column, std::string& error)
+    {
+        return count_found(*this, SQL_COLUMN_EXISTS, table, column, error);
+    }
+
+    std::unique_ptr<StorageBackend> create_storage_backend(const DBConfig& config)
+    {
+        if (config.backend.empty() || config.backend == "mysql") {
+            return nullptr;
+        }
+
+        if (config.backend == "memory") {
+            return std::make_unique<MemoryBackend>(MemoryDatabase::open(config.database, config.schemaFile));
+        }
+
+        if (config.backend == "mysql_classic") {
+#ifdef TAKEAWAY_WITH_JDBC
+            return std::make_unique<JdbcBackend>(config);
+#else
+            throw std::runtime_error("Storage backend mysql_classic is not built in (libmysqlcppconn not found at configure time)");
+#endif
+        }
+
+        if (config.backend == "sqlite") {
+#ifdef TAKEAWAY_WITH_SQLITE
+            return std::make_unique<SqliteBackend>(config.sqliteFile, config.schemaFile);
+#else
+            throw std::runtime_error("Storage backend sqlite is not built in (SQLite3 not found at configure time)");
+#endif
+        }
+
+        throw std::runtime_error("Unknown storage backend: " + config.backend);
+    }
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <mysqlx/xdevapi.h>
+
+#include "common.h"
+
+namespace TakeAwayPlatform
+{
+    // 按位置绑定到 '?' 占位符的参数
+    using SqlParams = std::vector<mysqlx::Value>;
+
+    // information_schema 中的存在性检查，参数为 (表名, 索引名/列名)；MySQL 协议的连接共用
+    constexpr const char* SQL_INDEX_EXISTS =
+        "SELECT COUNT(*) AS found FROM information_schema.STATISTICS "
+        "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ? AND INDEX_NAME = ?";
+    constexpr const char* SQL_COLUMN_EXISTS =
+        "SELECT COUNT(*) AS found FROM information_schema.COLUMNS "
+        "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = ? AND COLUMN_NAME = ?";
+
+    // 一条语句的完整结果；非查询语句的 columns 为空
+    struct StorageResult {
+        std::vector<std::string> columns;
+        std::vector<mysqlx::Row> rows;
+        uint64_t affectedRows = 0;
+        uint64_t lastInsertId = 0;
+    };
+
+    // 存储后端。DatabaseHandler 默认直接使用 MySQL X 会话（服务端预处理语句、流式游标），
+    // 配置了其他后端（config.json 中 database.backend）时语句改由后端执行，
+    // 上层的 query/execute/query_as/open_cursor 与事务接口不变。
+    // 每个 DatabaseHandler 持有一个后端实例，不需要线程安全；失败时返回 false 并写入 error
+    class StorageBackend
+    {
+    public:
+        virtual ~StorageBackend() = default;
+
+        virtual const char* name() const = 0;
+
+        virtual bool execute(const std::string& sql, const SqlParams& params,
+                             StorageResult& result, std::string& error) = 0;
+
+        virtual bool begin(std::string& error) = 0;
+        virtual bool commit(std::string& error) = 0;
+        virtual bool rollback(std::string& error) = 0;
+
+        virtual bool ping() = 0;
+
+        // 表 table 上是否已有名为 index 的索引 / 名为 column 的列，返回 1 存在、0 不存在、-1 失败。
+        // 供 MigrationRunner 在执行 DDL 前判断是否已应用；默认实现查询 information_schema，适用于 MySQL 协议的后端
+        virtual int index_exists(const std::string& table, const std::string& index, std::string& error);
+        virtual int column_exists(const std::string& table, const std::string& column, std::string& error);
+    };
+
+    // 按 config.backend 创建后端："mysql" 返回 nullptr（由 DatabaseHandler 直接连接），
+    // "mysql_classic" 为经典协议（编译时找到 libmysqlcppconn 才可用），"memory" 为进程内存储，
+    // "sqlite" 为嵌入式 SQLite（编译时找到 SQLite3 才可用）。
+    // 未知或未编译的后端、打开失败时抛出 std::runtime_error
+    std::unique_ptr<StorageBackend> create_storage_backend(const DBConfig& config);
+
+}
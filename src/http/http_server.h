@@ -0,0 +1,38 @@
+#pragma once
+
+#include <unistd.h>
+#include <httplib.h>
+
+
+namespace TakeAwayPlatform
+{
+    // 在 httplib::Server 基础上增加监听套接字的接管/移交能力，用于热重启
+    class HttpServer : public httplib::Server
+    {
+    public:
+        // 接管一个已处于 listen 状态的套接字，之后调用 listen_after_bind() 开始 accept
+        bool adopt_listener(int fd)
+        {
+            if (fd < 0 || svr_sock_ != INVALID_SOCKET) {
+                return false;
+            }
+
+            svr_sock_ = fd;
+            return true;
+        }
+
+        // 当前监听套接字，未监听时返回 -1
+        int listener_fd() const
+        {
+            return svr_sock_;
+        }
+
+        // 退出 accept 循环但不 shutdown 监听套接字，使其在新进程中继续可用。
+        // 返回原套接字，由调用方在 accept 循环退出后关闭
+        int release_listener()
+        {
+            return svr_sock_.exchange(INVALID_SOCKET);
+        }
+    };
+
+}
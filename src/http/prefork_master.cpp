@@ -0,0 +1,184 @@
+#include <iostream>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <chrono>
+#include <csignal>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "prefork_master.h"
+
+
+namespace TakeAwayPlatform
+{
+    PreforkMaster::PreforkMaster(int workerCount, int port, int stopTimeoutSec)
+        : workerCount(workerCount), port(port), stopTimeoutSec(stopTimeoutSec),
+          workers(workerCount, -1), startedAt(workerCount, 0)
+    {
+    }
+
+    PreforkMaster::~PreforkMaster()
+    {
+        if (listenFd >= 0) {
+            ::close(listenFd);
+        }
+    }
+
+    int PreforkMaster::run(const WorkerMain& workerMain, const std::atomic<bool>& running)
+    {
+        listenFd = bind_listener();
+        if (listenFd < 0) {
+            return 1;
+        }
+
+        std::cout << "Prefork master " << ::getpid() << " listening on port " << port
+                  << ", starting " << workerCount << " workers." << std::endl;
+        std::cout.flush();
+
+        for (size_t slot = 0; slot < workers.size(); ++slot) {
+            spawn(slot, workerMain);
+        }
+
+        while (running) {
+            reap(workerMain, running);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        stop_workers();
+
+        std::cout << "Prefork master exiting." << std::endl;
+        std::cout.flush();
+        return 0;
+    }
+
+    int PreforkMaster::bind_listener()
+    {
+        // 非阻塞：多个 worker 被同一连接唤醒时，抢不到的 accept 立即返回 EAGAIN 而不是阻塞
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            std::cerr << "Failed to create listen socket: " << std::strerror(errno) << std::endl;
+            return -1;
+        }
+
+        int yes = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+            std::cerr << "Failed to start server on port " << port << ": " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    void PreforkMaster::spawn(size_t slot, const WorkerMain& workerMain)
+    {
+        std::cout.flush();
+
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            std::cerr << "Failed to fork worker: " << std::strerror(errno) << std::endl;
+            return;
+        }
+
+        if (pid == 0) {
+            int code = workerMain(listenFd);
+            std::cout.flush();
+            std::exit(code);
+        }
+
+        workers[slot] = pid;
+        startedAt[slot] = std::time(nullptr);
+
+        std::cout << "Worker " << pid << " started in slot " << slot << "." << std::endl;
+        std::cout.flush();
+    }
+
+    void PreforkMaster::reap(const WorkerMain& workerMain, const std::atomic<bool>& running)
+    {
+        int status;
+        pid_t pid;
+        while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0) {
+            for (size_t slot = 0; slot < workers.size(); ++slot) {
+                if (workers[slot] != pid) {
+                    continue;
+                }
+
+                if (WIFSIGNALED(status)) {
+                    std::cerr << "Worker " << pid << " killed by signal " << WTERMSIG(status) << std::endl;
+                } else {
+                    std::cerr << "Worker " << pid << " exited with code " << WEXITSTATUS(status) << std::endl;
+                }
+
+                workers[slot] = -1;
+                if (!running) {
+                    break;
+                }
+
+                if (std::time(nullptr) - startedAt[slot] < MIN_WORKER_UPTIME_SEC) {
+                    std::this_thread::sleep_for(std::chrono::seconds(MIN_WORKER_UPTIME_SEC));
+                }
+                spawn(slot, workerMain);
+                break;
+            }
+        }
+    }
+
+    void PreforkMaster::stop_workers()
+    {
+        for (pid_t pid : workers) {
+            if (pid > 0) {
+                ::kill(pid, SIGTERM);
+            }
+        }
+
+        // worker 收到 SIGTERM 后自行排空，超时仍未退出的强制结束
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(stopTimeoutSec);
+        size_t alive = workers.size();
+        while (alive > 0) {
+            alive = 0;
+            for (pid_t& pid : workers) {
+                if (pid <= 0) {
+                    continue;
+                }
+
+                int status;
+                pid_t ret = ::waitpid(pid, &status, WNOHANG);
+                if (ret == pid || (ret < 0 && errno == ECHILD)) {
+                    pid = -1;
+                } else {
+                    ++alive;
+                }
+            }
+
+            if (alive == 0) {
+                break;
+            }
+
+            if (std::chrono::steady_clock::now() >= deadline) {
+                std::cerr << "Warning: " << alive << " workers did not exit within timeout, killing." << std::endl;
+                for (pid_t& pid : workers) {
+                    if (pid > 0) {
+                        ::kill(pid, SIGKILL);
+                        ::waitpid(pid, nullptr, 0);
+                        pid = -1;
+                    }
+                }
+                break;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+
+}
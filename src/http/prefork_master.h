@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <ctime>
+#include <functional>
+#include <vector>
+#include <sys/types.h>
+
+
+namespace TakeAwayPlatform
+{
+    // prefork 模式的 master：绑定端口后 fork 出 N 个互不共享状态的 worker，
+    // 每个 worker 拥有自己的线程池、数据库连接池和缓存，共享同一个监听套接字。
+    // master 不处理请求，只负责监督：worker 异常退出时重新拉起
+    class PreforkMaster
+    {
+    public:
+        // worker 入口，参数为共享监听套接字，返回值作为 worker 进程退出码
+        using WorkerMain = std::function<int(int listenFd)>;
+
+        PreforkMaster(int workerCount, int port, int stopTimeoutSec);
+        ~PreforkMaster();
+
+        // 阻塞直到 running 变为 false，随后通知所有 worker 排空退出
+        int run(const WorkerMain& workerMain, const std::atomic<bool>& running);
+
+    private:
+        int bind_listener();
+        void spawn(size_t slot, const WorkerMain& workerMain);
+        void reap(const WorkerMain& workerMain, const std::atomic<bool>& running);
+        void stop_workers();
+
+    private:
+        // 启动后很快退出的 worker 视为启动失败，重启前退避，避免 fork 风暴
+        static constexpr int MIN_WORKER_UPTIME_SEC = 1;
+
+        int workerCount;
+        int port;
+        int stopTimeoutSec;
+        int listenFd {-1};
+        std::vector<pid_t> workers;
+        std::vector<std::time_t> startedAt;
+    };
+
+}
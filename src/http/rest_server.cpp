@@ -1,13 +1,83 @@
 #include <iostream>
+#include <algorithm>
 #include <thread>
+#include <future>
+#include <random>
+#include <cstdio>
+#include <ctime>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "rest_server.h"
+#include "socket_handoff.h"
 #include "../user/user.h"
 
 
 namespace TakeAwayPlatform
 {
-    RestServer::RestServer(const std::string& configPath) : threadPool(std::thread::hardware_concurrency()) 
+    namespace
+    {
+        // 金额参数：字符串按十进制精确解析，数字按元四舍五入到分；无法解析或超出 DECIMAL(10,2) 范围时为 0，由调用方按非正金额拒绝
+        Money money_param(const Json::Value& params, const char* key)
+        {
+            const Json::Value& value = params[key];
+            Money amount;
+            if (value.isString()) {
+                Money::parse(value.asString(), amount);
+            } else if (value.isNumeric()) {
+                Money::fromYuan(value.asDouble(), amount);
+            }
+            return amount;
+        }
+
+        // 逐字节比较全部内容，耗时不随第一个不同字节的位置变化
+        bool same_secret(const std::string& given, const std::string& expected)
+        {
+            if (given.size() != expected.size()) {
+                return false;
+            }
+            unsigned char diff = 0;
+            for (size_t index = 0; index < given.size(); ++index) {
+                diff |= static_cast<unsigned char>(given[index] ^ expected[index]);
+            }
+            return diff == 0;
+        }
+
+        const std::string SQL_INSERT_ORDER =
+            "INSERT INTO orders (order_number, user_id, merchant_id, total_amount, status, delivery_address, "
+            "contact_phone, items, created_at, updated_at) "
+            "VALUES (?, ?, ?, CAST(? AS DECIMAL(10,2)), 'unpaid', ?, ?, ?, NOW(), NOW())";
+
+        std::string next_order_number(int64_t user_id)
+        {
+            // 下单时间（秒）+ 用户 ID 后六位 + 四位随机数，同一用户同一秒内的订单靠随机数区分
+            thread_local std::minstd_rand random(std::random_device{}());
+            const std::time_t now = std::time(nullptr);
+            std::tm local {};
+            localtime_r(&now, &local);
+
+            char text[32];
+            std::strftime(text, sizeof(text), "%Y%m%d%H%M%S", &local);
+            char suffix[16];
+            std::snprintf(suffix, sizeof(suffix), "%06lld%04u", static_cast<long long>(user_id % 1000000),
+                          static_cast<unsigned>(random() % 10000));
+            return std::string(text) + suffix;
+        }
+
+        void deny(httplib::Response& res, int status, const std::string& message)
+        {
+            Json::Value error;
+            error["success"] = false;
+            error["message"] = message;
+            error["timestamp"] = static_cast<int64_t>(std::time(nullptr));
+            res.set_content(error.toStyledString(), "application/json");
+            res.status = status;
+        }
+    }
+
+    RestServer::RestServer(const std::string& configPath, SharedStockTable* sharedStock)
+        : threadPool(std::thread::hardware_concurrency()), sharedStock(sharedStock)
     {
         std::cout << "RestServer starting." << std::endl;
         std::cout.flush();
@@ -17,9 +87,18 @@ namespace TakeAwayPlatform
         std::cout << "RestServer load config success." << std::endl;
         std::cout.flush();
         
-        // 初始化数据库连接池
+        handoffPath = config["server"].get("handoff_path", "").asString();
+        drainTimeoutSec = config["server"].get("drain_timeout", 10).asInt();
+        unixSocketPath = config["server"].get("unix_socket", "").asString();
+        unixSocketMode = static_cast<mode_t>(std::stoi(config["server"].get("unix_socket_mode", "0660").asString(), nullptr, 8));
+        listenTcp = config["server"].get("listen_tcp", true).asBool() || unixSocketPath.empty();
+        adminToken = config["server"].get("admin_token", "").asString();
+
+        // 初始化数据库连接池（热重启时在接管监听套接字之前完成预热）
         init_db_pool(config["database"]);
 
+        register_batch_routes();
+
         std::cout << "RestServer instance created." << std::endl;
         std::cout.flush();
     }
@@ -29,37 +108,156 @@ namespace TakeAwayPlatform
         stop();
     }
 
-    void RestServer::start(int port) 
+    void RestServer::start(int port, bool takeover) 
     {
         if (isRunning) {
             std::cerr << "Server is already running." << std::endl;
             std::cout.flush();
             return;
         }
+
+        int channel = -1;
+        int listenFd = -1;
+        if (takeover && !handoffPath.empty()) {
+            // 构造时只等到 warm_up_min_ready；接管后旧进程立即开始排空，必须先把连接池预热到 min_idle
+            if (!wait_warm_up_reached(HANDOFF_TIMEOUT_SEC)) {
+                throw std::runtime_error("hot restart aborted: connection pools did not reach min_idle");
+            }
+
+            channel = SocketHandoff::connect_control(handoffPath);
+            if (channel >= 0 && !SocketHandoff::peer_is_trusted(channel)) {
+                ::close(channel);
+                channel = -1;
+            }
+            if (channel >= 0) {
+                listenFd = SocketHandoff::recv_fd(channel, HANDOFF_TIMEOUT_SEC);
+            }
+
+            if (listenFd < 0) {
+                std::cerr << "Hot restart takeover failed, falling back to cold start." << std::endl;
+                if (channel >= 0) {
+                    ::close(channel);
+                    channel = -1;
+                }
+            }
+        }
         
         isRunning = true;
         stopRequested = false;
+        drained = false;
         
         // 成员变量保存线程
-        serverThread = std::thread([this, port] {
-            this->run_server(port);
+        serverThread = std::thread([this, port, listenFd] {
+            this->run_server(port, listenFd);
         });
         
-        std::cout << "Server starting on port " << port << "..." << std::endl;
+        if (listenFd >= 0) {
+            std::cout << "Server took over listener from previous process." << std::endl;
+        } else {
+            std::cout << "Server starting on port " << port << "..." << std::endl;
+        }
         std::cout.flush();
+
+        if (channel >= 0) {
+            complete_takeover(channel);
+        }
+
+        if (listenTcp && !unixSocketPath.empty()) {
+            unixServerThread = std::thread([this] { run_unix_server(); });
+        }
+
+        if (!unixSocketPath.empty()) {
+            HttpServer& unixListener = listenTcp ? unixServer : server;
+            unixListener.wait_until_ready();
+            ::chmod(unixSocketPath.c_str(), unixSocketMode);
+        }
+
+        start_handoff_listener();
     }
 
-    void RestServer::run_server(int port) 
+    void RestServer::start_on_listener(int listenFd)
+    {
+        if (isRunning) {
+            std::cerr << "Server is already running." << std::endl;
+            std::cout.flush();
+            return;
+        }
+
+        // prefork worker：监听套接字由 master 创建并与其他 worker 共享，
+        // 热重启和 Unix 域套接字只在单进程模式下启用
+        sharedListener = true;
+        handoffPath.clear();
+        unixSocketPath.clear();
+        listenTcp = true;
+
+        isRunning = true;
+        stopRequested = false;
+        drained = false;
+
+        serverThread = std::thread([this, listenFd] {
+            this->run_server(0, listenFd);
+        });
+
+        std::cout << "Worker " << ::getpid() << " accepting on shared listener." << std::endl;
+        std::cout.flush();
+    }
+
+    void RestServer::run_unix_server()
+    {
+        try
+        {
+            // 与 TCP 监听共用同一套路由，供本机 nginx 等反向代理绕过 TCP 协议栈
+            setup_routes(unixServer);
+            unixServer.set_address_family(AF_UNIX);
+
+            // 残留的套接字文件来自已退出的进程
+            ::unlink(unixSocketPath.c_str());
+
+            std::cout << "HTTP server listening on unix socket " << unixSocketPath << std::endl;
+            std::cout.flush();
+
+            if (!unixServer.listen(unixSocketPath, 80) && !stopRequested) {
+                std::cerr << "Failed to listen on unix socket " << unixSocketPath << std::endl;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Unix socket server error: " << e.what() << std::endl;
+        }
+    }
+
+    void RestServer::run_server(int port, int listenFd) 
     {
         try 
         {
             // 设置路由
-            setup_routes();
-            
-            std::cout << "HTTP server listening on port " << port << std::endl;
-            std::cout.flush();
+            setup_routes(server);
+
+            // 启用热重启或共享监听套接字时 accept 循环需要周期性醒来，
+            // 才能在放弃监听套接字后及时退出
+            if (!handoffPath.empty() || sharedListener) {
+                server.set_idle_interval(0, 200000);
+            }
+
+            bool listened;
+            if (listenFd >= 0) {
+                std::cout << "HTTP server accepting on inherited socket " << listenFd << std::endl;
+                std::cout.flush();
+                listened = server.adopt_listener(listenFd) && server.listen_after_bind();
+            } else if (!listenTcp) {
+                // 仅监听 Unix 域套接字（本机反向代理）
+                std::cout << "HTTP server listening on unix socket " << unixSocketPath << std::endl;
+                std::cout.flush();
+                server.set_address_family(AF_UNIX);
+                ::unlink(unixSocketPath.c_str());
+                listened = server.listen(unixSocketPath, 80);
+            } else {
+                std::cout << "HTTP server listening on port " << port << std::endl;
+                std::cout.flush();
+                listened = server.listen("0.0.0.0", port);
+            }
 
-            if (!server.listen("0.0.0.0", port)) {
+            if (!listened && !handedOff) {
                 std::cerr << "Failed to start server on port " << port << std::endl;
             }
             
@@ -75,56 +273,221 @@ namespace TakeAwayPlatform
         isRunning = false;
         
         // 通知等待的线程
-        stopCv.notify_one();
+        stopCv.notify_all();
         std::cout << "Server worker thread exiting." << std::endl;
         std::cout.flush();
     }
 
-    void RestServer::stop() 
+    bool RestServer::wait_warm_up_reached(int timeoutSec)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSec);
+        while (!(dbRouter->warm_up_reached() && shardRouter->warm_up_reached())) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        return true;
+    }
+
+    void RestServer::complete_takeover(int channel)
     {
-        if (!isRunning) {
-            std::cout << "Server already stop." << std::endl;
+        server.wait_until_ready();
+
+        if (server.is_running() && SocketHandoff::send_message(channel, SocketHandoff::READY_MESSAGE)) {
+            std::cout << "Hot restart: notified previous process to drain." << std::endl;
+        } else {
+            std::cerr << "Hot restart: failed to notify previous process." << std::endl;
+        }
+        std::cout.flush();
+
+        ::close(channel);
+    }
+
+    void RestServer::start_handoff_listener()
+    {
+        if (handoffPath.empty()) {
+            return;
+        }
+
+        controlFd = SocketHandoff::listen_control(handoffPath);
+        if (controlFd < 0) {
+            std::cerr << "Hot restart disabled: cannot listen on " << handoffPath << std::endl;
+            return;
+        }
+
+        handoffThread = std::thread([this] { handoff_loop(); });
+    }
+
+    void RestServer::stop_handoff_listener()
+    {
+        if (controlFd < 0) {
+            return;
+        }
+
+        // shutdown 唤醒阻塞在 accept 上的控制线程
+        ::shutdown(controlFd, SHUT_RDWR);
+        if (handoffThread.joinable()) {
+            handoffThread.join();
+        }
+        ::close(controlFd);
+        controlFd = -1;
+
+        // 移交之后控制通道路径已属于新进程
+        if (!handedOff) {
+            ::unlink(handoffPath.c_str());
+        }
+    }
+
+    void RestServer::handoff_loop()
+    {
+        while (!stopRequested) {
+            int channel = ::accept4(controlFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (channel < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+
+            // 只向同一用户的进程交出监听套接字
+            if (!SocketHandoff::peer_is_trusted(channel)) {
+                ::close(channel);
+                continue;
+            }
+
+            std::cout << "Hot restart: new process connected, handing off listener." << std::endl;
             std::cout.flush();
+
+            bool ready = SocketHandoff::send_fd(channel, server.listener_fd()) &&
+                         SocketHandoff::wait_message(channel, SocketHandoff::READY_MESSAGE, HANDOFF_TIMEOUT_SEC);
+            ::close(channel);
+
+            if (ready) {
+                drain_after_handoff();
+                break;
+            }
+
+            std::cerr << "Hot restart: new process did not become ready, keep serving." << std::endl;
+        }
+    }
+
+    void RestServer::drain_after_handoff()
+    {
+        handedOff = true;
+        stopRequested = true;
+
+        // 只退出本进程的 accept 循环，监听套接字本身仍由新进程使用，因此不能 shutdown
+        int listenFd = server.release_listener();
+
+        // accept 循环退出后 httplib 会等待工作线程处理完在途请求
+        {
+            std::unique_lock<std::mutex> lock(stopMtx);
+            stopCv.wait(lock, [this] { return !isRunning; });
+        }
+
+        if (listenFd >= 0) {
+            ::close(listenFd);
+        }
+
+        std::cout << "Hot restart: in-flight requests drained, previous process exiting." << std::endl;
+        std::cout.flush();
+    }
+
+    void RestServer::stop() 
+    {
+        // main 和析构函数都会调用 stop，只排空一次
+        if (drained.exchange(true)) {
             return;
         }
-        
-        std::cout << "Requesting server stop..." << std::endl;
+
+        const auto drainStart = std::chrono::steady_clock::now();
+        const auto deadline = drainStart + std::chrono::seconds(drainTimeoutSec);
+
+        std::cout << "Draining server, in-flight requests: " << inFlightRequests
+                  << ", queued tasks: " << threadPool.pending() << std::endl;
         std::cout.flush();
+
         stopRequested = true;
-        
-        // 通知服务器停止
-        server.stop();
-        
-        // 等待服务器实际停止
-        std::unique_lock<std::mutex> lock(stopMtx);
-        if (stopCv.wait_for(lock, std::chrono::seconds(5), [this] {
-            return !isRunning;
-        }))
+        stop_handoff_listener();
+
+        // 1. 停止 accept：httplib 退出 accept 循环后会等待在途请求处理完毕
+        // 共享的监听套接字不能 shutdown，否则其他 worker 也无法继续 accept
+        int releasedFd = -1;
+        if (sharedListener) {
+            releasedFd = server.release_listener();
+        } else if (isRunning) {
+            server.stop();
+        }
+
+        if (unixServerThread.joinable()) {
+            unixServer.stop();
+            unixServerThread.join();
+        }
+
         {
-            if (serverThread.joinable()) 
-            {
-                serverThread.join();
+            std::unique_lock<std::mutex> lock(stopMtx);
+            if (stopCv.wait_until(lock, deadline, [this] { return !isRunning; })) {
+                if (serverThread.joinable()) {
+                    serverThread.join();
+                }
+            } else {
+                std::cerr << "Warning: Server did not stop within timeout, in-flight requests: "
+                          << inFlightRequests << std::endl;
+                if (serverThread.joinable()) {
+                    serverThread.detach(); // 最后手段，避免死锁
+                }
             }
+        }
 
-            std::cout << "Server stopped successfully." << std::endl;
-            std::cout.flush();
-        } 
-        else 
-        {
-            std::cerr << "Warning: Server did not stop within timeout." << std::endl;
-            std::cout.flush();
+        if (releasedFd >= 0) {
+            ::close(releasedFd);
+        }
 
-            if (serverThread.joinable()) 
-            {
-                serverThread.detach(); // 最后手段，避免死锁
+        // 2. 执行完线程池中已排队的任务
+        if (!threadPool.drain(deadline)) {
+            std::cerr << "Warning: Drain deadline exceeded, dropped queued tasks: " << threadPool.dropped()
+                      << ", abandoned workers still running tasks: " << threadPool.abandoned() << std::endl;
+        }
+
+        // 3. 刷新尚未落库的异步写入（日志、批量插入等）
+        std::vector<std::pair<std::string, std::function<void()>>> hooks;
+        {
+            std::lock_guard<std::mutex> lock(drainHookMutex);
+            hooks.swap(drainHooks);
+        }
+        for (auto& hook : hooks) {
+            try {
+                hook.second();
+            } catch (const std::exception& e) {
+                std::cerr << "Drain hook " << hook.first << " failed: " << e.what() << std::endl;
             }
         }
 
-        // 清理数据库连接池
-        std::lock_guard<std::mutex> dbLock(dbPoolMutex);
-        while (!dbPool.empty()) {
-            dbPool.pop();
+        // 4. 最后关闭数据库连接
+        shardRouter->close();
+        dbRouter->close();
+
+        if (!unixSocketPath.empty() && !handedOff) {
+            ::unlink(unixSocketPath.c_str());
         }
+
+        lastDrainMillis = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - drainStart).count();
+
+        std::cout << "Server stopped successfully. drain_ms=" << lastDrainMillis << std::endl;
+        std::cout.flush();
+    }
+
+    void RestServer::add_drain_hook(const std::string& name, std::function<void()> hook)
+    {
+        std::lock_guard<std::mutex> lock(drainHookMutex);
+        drainHooks.emplace_back(name, std::move(hook));
+    }
+
+    int64_t RestServer::drain_millis() const
+    {
+        return lastDrainMillis;
     }
 
     bool RestServer::is_running() const 
@@ -132,73 +495,286 @@ namespace TakeAwayPlatform
         return isRunning;
     }
 
+    bool RestServer::is_handed_off() const 
+    { 
+        return handedOff;
+    }
+
     void RestServer::init_db_pool(const Json::Value& config) 
     {
-        std::cout << "host: " << config["host"].asString() << std::endl;
-        std::cout << "port: " << config["port"].asInt() << std::endl;
-        std::cout << "user: " << config["user"].asString() << std::endl;
-        std::cout << "password: " << config["password"].asString() << std::endl;
-        std::cout << "name: " << config["name"].asString() << std::endl;
+        std::cout << "database: " << config["user"].asString() << "@" << config["host"].asString() << ":"
+                  << config["port"].asInt() << "/" << config["name"].asString() << std::endl;
         std::cout.flush();
         
-        int pool_size = config.get("pool_size", 10).asInt();
-
-        dbConfig.push_back({
-            config["host"].asString(),
-            config["port"].asInt(),
-            config["user"].asString(),
-            config["password"].asString(),
-            config["name"].asString()
-        });
+        SlowQueryOptions slowQueries;
+        slowQueries.thresholdMs = config.get("slow_query_ms", slowQueries.thresholdMs).asInt();
+        slowQueries.sampleEvery = config.get("slow_query_sample_every", slowQueries.sampleEvery).asInt();
+        slowQueries.logPath = config.get("slow_query_log", "").asString();
+        QueryStats::instance().configure(slowQueries);
+
+        // dbConfig[0] 为主库，其后为从库
+        dbConfig.push_back(load_db_config(config, config));
+        for (const auto& replica : config["replicas"]) {
+            dbConfig.push_back(load_db_config(replica, config));
+        }
+
+        // pool_size 为旧配置项，未配置 max_total 时作为连接总数上限
+        DBPoolOptions options;
+        options.maxTotal = config.get("max_total", config.get("pool_size", 10)).asInt();
+        options.minIdle = config.get("min_idle", options.maxTotal).asInt();
+        options.acquireTimeoutMs = config.get("acquire_timeout_ms", 3000).asInt();
+        options.validateOnBorrow = config.get("validate_on_borrow", true).asBool();
+        options.livenessWindowMs = config.get("liveness_window_ms", 5000).asInt();
+        options.keepaliveIntervalSec = config.get("keepalive_interval_sec", 30).asInt();
+        options.breaker.failureThreshold = config.get("breaker_failure_threshold", 3).asInt();
+        options.breaker.baseBackoffMs = config.get("breaker_base_backoff_ms", 200).asInt();
+        options.breaker.maxBackoffMs = config.get("breaker_max_backoff_ms", 10000).asInt();
+        options.warmUpConcurrency = config.get("warm_up_concurrency", options.warmUpConcurrency).asInt();
+
+        // 并行的只读子请求各占一个连接，留出大部分连接给其他请求
+        batchParallelism = std::clamp(options.maxTotal / 3, 1, MAX_BATCH_PARALLELISM);
+
+        // 每个连接池建好 warm_up_min_ready 个连接即开始服务，其余连接在后台并行建立，
+        // 全部完成前 /health 返回 503
+        const int warmUpReady = config.get("warm_up_min_ready", 1).asInt();
+
+        DBRouterOptions routerOptions;
+        routerOptions.maxReplicaLagSec = config.get("max_replica_lag_sec", routerOptions.maxReplicaLagSec).asInt();
+        routerOptions.readPinSec = config.get("read_pin_sec", routerOptions.readPinSec).asInt();
+        routerOptions.lagCheckIntervalSec = config.get("lag_check_interval_sec", routerOptions.lagCheckIntervalSec).asInt();
+
+        std::vector<DBConfig> replicas(dbConfig.begin() + 1, dbConfig.end());
+        dbRouter = std::make_shared<DBRouter>(dbConfig[0], replicas, options, routerOptions);
+        dbRouter->warm_up(warmUpReady);
+
+        // 分片库（orders、transactions、wallet、recharge_record）；未配置时全部落在全局库
+        std::vector<ShardSpec> shards;
+        for (const auto& entry : config["shards"]) {
+            ShardSpec shard;
+            shard.name = entry.get("name", "shard" + std::to_string(shards.size())).asString();
+            shard.weight = entry.get("weight", 1).asInt();
+
+            std::vector<DBConfig> shardReplicas;
+            for (const auto& replica : entry["replicas"]) {
+                shardReplicas.push_back(load_db_config(replica, entry));
+            }
+            shard.router = std::make_shared<DBRouter>(load_db_config(entry, config), shardReplicas, options, routerOptions);
+            shards.push_back(std::move(shard));
+        }
+
+        const bool dedicatedShards = !shards.empty();
+        if (!dedicatedShards) {
+            shards.push_back({"global", 1, dbRouter});
+        }
+        shardRouter = std::make_unique<ShardRouter>(std::move(shards), config.get("shard_virtual_nodes", 128).asInt(), dedicatedShards);
+        shardRouter->warm_up(warmUpReady);
 
-        for (int index = 0; index < pool_size; ++index) {
-            dbPool.push(create_db_handler());
+        // 启动时在全局库和各分片主库上执行未应用的迁移，失败则拒绝启动；
+        // 不自动迁移时检查是否有未应用的迁移：充值、库存的条件写入依赖迁移后的表结构（version 列、自增主键），
+        // 在旧表结构上每次都会失败，因此同样拒绝启动
+        {
+            const bool migrateOnStart = config.get("migrate_on_start", false).asBool();
+            const std::string directory = config.get("migrations_dir", MigrationRunner::DEFAULT_DIRECTORY).asString();
+
+            std::vector<std::shared_ptr<DBRouter>> targets {dbRouter};
+            if (dedicatedShards) {
+                for (const auto& shard : shardRouter->specs()) {
+                    targets.push_back(shard.router);
+                }
+            }
+
+            for (const auto& target : targets) {
+                DBLease lease;
+                try {
+                    lease = target->acquire_write();
+                } catch (const std::exception& e) {
+                    // 只做检查时数据库暂不可用不阻止启动，与连接池的其他启动行为一致
+                    if (migrateOnStart) {
+                        throw;
+                    }
+                    std::cerr << "Cannot check schema migrations: " << e.what() << std::endl;
+                    continue;
+                }
+
+                if (migrateOnStart) {
+                    if (MigrationRunner(*lease, directory).migrate() < 0) {
+                        throw std::runtime_error("Schema migration failed");
+                    }
+                    continue;
+                }
+
+                const std::vector<int> pending = MigrationRunner(*lease, directory).pending();
+                if (!pending.empty()) {
+                    throw std::runtime_error("Schema has " + std::to_string(pending.size()) +
+                                             " pending migrations (first: " + std::to_string(pending[0]) +
+                                             "), run --migrate or enable migrate_on_start");
+                }
+            }
+        }
+
+        // 登录日志后写，排空阶段在关闭连接池之前刷新
+        LogAppenderOptions logOptions;
+        logOptions.flushIntervalMs = config.get("log_flush_interval_ms", logOptions.flushIntervalMs).asInt();
+        logOptions.batchRows = config.get("log_batch_rows", static_cast<Json::UInt64>(logOptions.batchRows)).asUInt64();
+        logOptions.maxQueued = config.get("log_max_queued", static_cast<Json::UInt64>(logOptions.maxQueued)).asUInt64();
+        logOptions.spillPath = config.get("log_spill_path", logOptions.spillPath).asString();
+        logAppender = std::make_unique<LogAppender>(dbConfig[0], logOptions);
+        add_drain_hook("log_appender", [this] { logAppender->stop(); });
+
+        // 热点菜品库存在内存中预留，定期批量写回 dishes
+        StockEngineOptions stockOptions;
+        for (const auto& dishId : config["stock_hot_dishes"]) {
+            stockOptions.hotDishes.push_back(dishId.asInt64());
         }
+        stockOptions.hotTopN = config.get("stock_hot_top_n", stockOptions.hotTopN).asInt();
+        stockOptions.flushIntervalMs = config.get("stock_flush_interval_ms", stockOptions.flushIntervalMs).asInt();
+        stockOptions.spillPath = config.get("stock_spill_path", stockOptions.spillPath).asString();
+        stockOptions.sharedTable = sharedStock;
+        stockEngine = std::make_unique<StockEngine>(dbConfig[0], stockOptions);
+        add_drain_hook("stock_engine", [this] { stockEngine->stop(); });
+    }
+
+    DBLease RestServer::acquire_db_handler(int64_t user_id) 
+    {
+        return dbRouter->acquire_write(user_id);
     }
 
-    std::unique_ptr<DatabaseHandler> RestServer::create_db_handler() 
+    DBLease RestServer::acquire_read_handler(int64_t user_id) 
     {
-        return std::make_unique<DatabaseHandler>(dbConfig[0]);
+        return dbRouter->acquire_read(user_id);
     }
 
-    std::unique_ptr<DatabaseHandler> RestServer::acquire_db_handler() 
+    DBLease RestServer::acquire_shard_handler(int64_t user_id, bool write) 
     {
-        std::lock_guard<std::mutex> lock(dbPoolMutex);
-        if (dbPool.empty()) {
-            return create_db_handler();
+        if (!shardRouter->enabled()) {
+            return DBLease();
         }
-        
-        auto handler = std::move(dbPool.front());
-        dbPool.pop();
-        return handler;
+
+        DBRouter& shard = shardRouter->shard_for(user_id);
+        return write ? shard.acquire_write(user_id) : shard.acquire_read(user_id);
     }
 
-    void RestServer::release_db_handler(std::unique_ptr<DatabaseHandler> handler) 
+    ShardLeaseProvider RestServer::shard_leases() 
     {
-        std::lock_guard<std::mutex> lock(dbPoolMutex);
-        dbPool.push(std::move(handler));
+        if (!shardRouter->enabled()) {
+            return nullptr;
+        }
+
+        return [this](int64_t user_id, bool write) {
+            return acquire_shard_handler(user_id, write);
+        };
     }
 
-    void RestServer::setup_routes() 
+    void RestServer::setup_routes(HttpServer& srv) 
     {
+        // 在途请求计数：路由前 +1，响应写出后 -1。
+        // 解析失败的请求不经过路由但仍会写响应，用线程局部标记避免误减
+        static thread_local bool requestTracked = false;
+
+        srv.set_pre_routing_handler([this](const httplib::Request&, httplib::Response&) {
+            requestTracked = true;
+            ++inFlightRequests;
+            return httplib::Server::HandlerResponse::Unhandled;
+        });
+
+        srv.set_logger([this](const httplib::Request&, const httplib::Response&) {
+            if (requestTracked) {
+                requestTracked = false;
+                --inFlightRequests;
+            }
+        });
+
         // 设置路由
-        server.Get("/", [](const httplib::Request&, httplib::Response& res) {
+        srv.Get("/", [](const httplib::Request&, httplib::Response& res) {
             res.set_content("TakeAwayPlatform is running!", "text/plain");
         });
         
-        server.Get("/health", [this](const httplib::Request&, httplib::Response& res) {
+        srv.Get("/health", [this](const httplib::Request&, httplib::Response& res) {
             if (this->is_running() && !this->stopRequested) {
-                res.set_content("OK", "text/plain");
+                if (dbRouter->warm_up_done() && shardRouter->warm_up_done()) {
+                    res.set_content("OK", "text/plain");
+                } else {
+                    res.set_content("WARMING_UP", "text/plain");
+                    res.status = 503;
+                }
             } else {
                 res.set_content("SHUTTING_DOWN", "text/plain");
                 res.status = 503; // Service Unavailable
             }
         });
 
+        // 连接池状态：等待时间、利用率、超时次数
+        srv.Get("/admin/db/pool", [this](const httplib::Request& req, httplib::Response& res) {
+            if (!authorize_admin(req, res)) {
+                return;
+            }
+            Json::Value stats = dbRouter->stats();
+            stats["log_appender"] = logAppender->stats();
+            stats["stock_engine"] = stockEngine->stats();
+            res.set_content(stats.toStyledString(), "application/json");
+        });
+
+        // 按 SQL 形状统计的执行次数、错误数和耗时分布，top 限制返回条数（按累计耗时）
+        srv.Get("/admin/db/queries", [this](const httplib::Request& req, httplib::Response& res) {
+            if (!authorize_admin(req, res)) {
+                return;
+            }
+            int top = req.has_param("top") ? std::atoi(req.get_param_value("top").c_str()) : 0;
+            res.set_content(QueryStats::instance().snapshot(top).toStyledString(), "application/json");
+        });
+
+        srv.Post("/admin/db/queries/reset", [this](const httplib::Request& req, httplib::Response& res) {
+            if (!authorize_admin(req, res)) {
+                return;
+            }
+            QueryStats::instance().reset();
+            res.set_content("{\"status\":\"reset\"}", "application/json");
+        });
+
+        // 分片哈希环及各分片连接池
+        srv.Get("/admin/shards", [this](const httplib::Request& req, httplib::Response& res) {
+            if (!authorize_admin(req, res)) {
+                return;
+            }
+            res.set_content(shardRouter->stats().toStyledString(), "application/json");
+        });
+
+        // 跨分片查询最近订单：各分片取前 limit 条，合并后按创建时间重新排序截断
+        srv.Get("/admin/orders/recent", [this](const httplib::Request& req, httplib::Response& res) {
+            if (!authorize_admin(req, res)) {
+                return;
+            }
+            try {
+                int limit = req.has_param("limit") ? std::stoi(req.get_param_value("limit")) : 20;
+                limit = std::max(1, std::min(limit, 200));
+
+                Json::Value rows = shardRouter->scatter(
+                    "SELECT order_id, order_number, user_id, merchant_id, total_amount, status, created_at "
+                    "FROM orders ORDER BY created_at DESC LIMIT ?", {limit});
+
+                std::vector<Json::Value> orders(rows.begin(), rows.end());
+                std::sort(orders.begin(), orders.end(), [](const Json::Value& a, const Json::Value& b) {
+                    return a["created_at"].asString() > b["created_at"].asString();
+                });
+                if (orders.size() > static_cast<size_t>(limit)) {
+                    orders.resize(limit);
+                }
+
+                Json::Value result(Json::arrayValue);
+                for (auto& order : orders) {
+                    result.append(std::move(order));
+                }
+                res.set_content(result.toStyledString(), "application/json");
+            } catch (const std::exception& e) {
+                res.set_content("服务器错误: " + std::string(e.what()), "text/plain");
+                res.status = 500;
+            }
+        });
+
         // ==================== 用户相关接口 ====================
         
         // 用户注册
-        server.Post("/api/user/register", [this](const httplib::Request& req, httplib::Response& res) {
+        srv.Post("/api/user/register", [this](const httplib::Request& req, httplib::Response& res) {
             try {
                 Json::Value requestData = parse_json(req.body);
                 
@@ -208,7 +784,7 @@ namespace TakeAwayPlatform
                 std::string phone = requestData.get("phone", "").asString();
                 
                 auto db_handler = acquire_db_handler();
-                UserManager userManager(std::move(db_handler));
+                UserManager userManager(std::move(db_handler), shard_leases(), logAppender.get());
                 
                 Json::Value result = userManager.registerUser(username, password, email, phone);
                 res.set_content(result.toStyledString(), "application/json");
@@ -224,7 +800,7 @@ namespace TakeAwayPlatform
         });
         
         // 用户登录
-        server.Post("/api/user/login", [this](const httplib::Request& req, httplib::Response& res) {
+        srv.Post("/api/user/login", [this](const httplib::Request& req, httplib::Response& res) {
             try {
                 Json::Value requestData = parse_json(req.body);
                 
@@ -232,7 +808,7 @@ namespace TakeAwayPlatform
                 std::string password = requestData.get("password", "").asString();
                 
                 auto db_handler = acquire_db_handler();
-                UserManager userManager(std::move(db_handler));
+                UserManager userManager(std::move(db_handler), shard_leases(), logAppender.get());
                 
                 Json::Value result = userManager.loginUser(username, password);
                 res.set_content(result.toStyledString(), "application/json");
@@ -248,7 +824,7 @@ namespace TakeAwayPlatform
         });
 
         // 用户退出
-        server.Post("/api/user/logout", [this](const httplib::Request& req, httplib::Response& res) {
+        srv.Post("/api/user/logout", [this](const httplib::Request& req, httplib::Response& res) {
             try {
                 std::string authHeader = req.get_header_value("Authorization");
                 if (authHeader.empty()) {
@@ -274,8 +850,8 @@ namespace TakeAwayPlatform
 
                 g_userSession.destroySession(authHeader);
 
-                auto db_handler = acquire_db_handler();
-                UserManager userManager(std::move(db_handler));
+                auto db_handler = acquire_db_handler(user_id);
+                UserManager userManager(std::move(db_handler), shard_leases(), logAppender.get());
                 
                 Json::Value result = userManager.logoutUser(user_id);
                 res.set_content(result.toStyledString(), "application/json");
@@ -291,7 +867,7 @@ namespace TakeAwayPlatform
         });
 
         // 获取用户信息
-        server.Get("/api/user/info", [this](const httplib::Request& req, httplib::Response& res) {
+        srv.Get("/api/user/info", [this](const httplib::Request& req, httplib::Response& res) {
             try {
                 std::string authHeader = req.get_header_value("Authorization");
                 if (authHeader.empty()) {
@@ -315,8 +891,8 @@ namespace TakeAwayPlatform
                     return;
                 }
 
-                auto db_handler = acquire_db_handler();
-                UserManager userManager(std::move(db_handler));
+                auto db_handler = acquire_read_handler(user_id);
+                UserManager userManager(std::move(db_handler), shard_leases(), logAppender.get());
                 
                 Json::Value result = userManager.getUserInfo(user_id);
                 res.set_content(result.toStyledString(), "application/json");
@@ -332,7 +908,7 @@ namespace TakeAwayPlatform
         });
 
         // 获取钱包信息
-        server.Get("/api/user/wallet", [this](const httplib::Request& req, httplib::Response& res) {
+        srv.Get("/api/user/wallet", [this](const httplib::Request& req, httplib::Response& res) {
             try {
                 std::string authHeader = req.get_header_value("Authorization");
                 if (authHeader.empty()) {
@@ -356,8 +932,8 @@ namespace TakeAwayPlatform
                     return;
                 }
 
-                auto db_handler = acquire_db_handler();
-                UserManager userManager(std::move(db_handler));
+                auto db_handler = acquire_read_handler(user_id);
+                UserManager userManager(std::move(db_handler), shard_leases(), logAppender.get());
                 
                 Json::Value result = userManager.getWalletInfo(user_id);
                 res.set_content(result.toStyledString(), "application/json");
@@ -373,7 +949,7 @@ namespace TakeAwayPlatform
         });
 
         // 账户充值
-        server.Post("/api/user/recharge", [this](const httplib::Request& req, httplib::Response& res) {
+        srv.Post("/api/user/recharge", [this](const httplib::Request& req, httplib::Response& res) {
             try {
                 std::string authHeader = req.get_header_value("Authorization");
                 if (authHeader.empty()) {
@@ -398,10 +974,10 @@ namespace TakeAwayPlatform
                 }
 
                 Json::Value requestData = parse_json(req.body);
-                double amount = requestData.get("amount", 0.0).asDouble();
+                Money amount = money_param(requestData, "amount");
 
-                auto db_handler = acquire_db_handler();
-                UserManager userManager(std::move(db_handler));
+                auto db_handler = acquire_db_handler(user_id);
+                UserManager userManager(std::move(db_handler), shard_leases(), logAppender.get());
                 
                 Json::Value result = userManager.rechargeBalance(user_id, amount);
                 res.set_content(result.toStyledString(), "application/json");
@@ -417,7 +993,7 @@ namespace TakeAwayPlatform
         });
 
         // 获取订单历史
-        server.Get("/api/user/orders", [this](const httplib::Request& req, httplib::Response& res) {
+        srv.Get("/api/user/orders", [this](const httplib::Request& req, httplib::Response& res) {
             try {
                 std::string authHeader = req.get_header_value("Authorization");
                 if (authHeader.empty()) {
@@ -451,11 +1027,12 @@ namespace TakeAwayPlatform
                 if (req.has_param("page_size")) {
                     page_size = std::stoi(req.get_param_value("page_size"));
                 }
+                std::string cursor = req.get_param_value("cursor");
 
-                auto db_handler = acquire_db_handler();
-                UserManager userManager(std::move(db_handler));
+                auto db_handler = acquire_read_handler(user_id);
+                UserManager userManager(std::move(db_handler), shard_leases(), logAppender.get());
                 
-                Json::Value result = userManager.getOrderHistory(user_id, page, page_size);
+                Json::Value result = userManager.getOrderHistory(user_id, page, page_size, cursor);
                 res.set_content(result.toStyledString(), "application/json");
                 
             } catch (const std::exception& e) {
@@ -468,36 +1045,527 @@ namespace TakeAwayPlatform
             }
         });
 
+        // 批量接口：一次往返执行多个用户子请求，共享会话校验与数据库连接
+        srv.Post("/api/batch", [this](const httplib::Request& req, httplib::Response& res) {
+            try {
+                std::string authHeader = req.get_header_value("Authorization");
+                if (authHeader.empty()) {
+                    Json::Value error;
+                    error["success"] = false;
+                    error["message"] = "未提供授权令牌";
+                    error["timestamp"] = static_cast<int64_t>(std::time(nullptr));
+                    res.set_content(error.toStyledString(), "application/json");
+                    res.status = 401;
+                    return;
+                }
+
+                int64_t user_id;
+                if (!g_userSession.validateSession(authHeader, user_id)) {
+                    Json::Value error;
+                    error["success"] = false;
+                    error["message"] = "无效的会话令牌";
+                    error["timestamp"] = static_cast<int64_t>(std::time(nullptr));
+                    res.set_content(error.toStyledString(), "application/json");
+                    res.status = 401;
+                    return;
+                }
+
+                Json::Value requestData = parse_json(req.body);
+                const Json::Value& subRequests = requestData["requests"];
+                if (!subRequests.isArray() || subRequests.empty() || subRequests.size() > MAX_BATCH_SIZE) {
+                    Json::Value error;
+                    error["success"] = false;
+                    error["message"] = "requests 必须是 1~" + std::to_string(MAX_BATCH_SIZE) + " 个子请求的数组";
+                    error["timestamp"] = static_cast<int64_t>(std::time(nullptr));
+                    res.set_content(error.toStyledString(), "application/json");
+                    res.status = 400;
+                    return;
+                }
+
+                Json::Value result;
+                result["success"] = true;
+                result["message"] = "批量请求执行完成";
+                result["timestamp"] = static_cast<int64_t>(std::time(nullptr));
+                result["data"]["responses"] = execute_batch(user_id, subRequests);
+                res.set_content(result.toStyledString(), "application/json");
+
+            } catch (const std::exception& e) {
+                Json::Value error;
+                error["success"] = false;
+                error["message"] = "服务器错误: " + std::string(e.what());
+                error["timestamp"] = static_cast<int64_t>(std::time(nullptr));
+                res.set_content(error.toStyledString(), "application/json");
+                res.status = 500;
+            }
+        });
+
         // ==================== 原有的示例接口 ====================
         
-        // 示例路由：获取所有菜品（使用线程池处理）
-        server.Get("/menu", [&](const httplib::Request&, httplib::Response& res) 
+        // 示例路由：获取所有菜品。结果经游标逐批读取并以分块响应写出，
+        // 菜品再多内存占用也只有一批，客户端在第一批到达时即开始接收
+        srv.Get("/menu", [this](const httplib::Request&, httplib::Response& res) 
         {
-            threadPool.enqueue([this, &res] {
-                auto db_handler = acquire_db_handler();
-                Json::Value menu = db_handler->query("SELECT * FROM dishes");
-                release_db_handler(std::move(db_handler));
-                
-                res.set_content(menu.toStyledString(), "application/json");
-            });
+            struct MenuStream {
+                DBLease lease;
+                QueryCursor cursor;
+                bool first = true;
+            };
+
+            try {
+                auto stream = std::make_shared<MenuStream>();
+                stream->lease = acquire_read_handler(0);
+                stream->cursor = stream->lease->open_cursor("SELECT * FROM dishes", {});
+                if (!stream->cursor) {
+                    res.set_content("服务器错误: 查询菜品失败", "text/plain");
+                    res.status = 503;
+                    return;
+                }
+
+                res.set_chunked_content_provider("application/json",
+                    [stream](size_t, httplib::DataSink& sink) {
+                        Json::StreamWriterBuilder builder;
+                        builder["indentation"] = "";
+
+                        std::string chunk = stream->first ? "[" : "";
+                        Json::Value rows(Json::arrayValue);
+                        stream->cursor.next_batch(rows, MENU_STREAM_BATCH_ROWS);
+                        for (const auto& row : rows) {
+                            if (!stream->first) {
+                                chunk += ",";
+                            }
+                            stream->first = false;
+                            chunk += Json::writeString(builder, row);
+                        }
+
+                        // 读取中途出错时中断连接，客户端收到不完整的 JSON 即可判断失败
+                        if (!stream->cursor) {
+                            return false;
+                        }
+
+                        if (rows.empty()) {
+                            chunk += "]";
+                            sink.write(chunk.data(), chunk.size());
+                            sink.done();
+                            return true;
+                        }
+                        return sink.write(chunk.data(), chunk.size());
+                    },
+                    [stream](bool) {
+                        // 响应结束（包括客户端断开）时立即归还连接
+                        stream->cursor = QueryCursor();
+                        stream->lease.release();
+                    });
+            } catch (const std::exception& e) {
+                res.set_content("服务器错误: " + std::string(e.what()), "text/plain");
+                res.status = 503;
+            }
         });
 
         // 示例路由：创建订单（使用线程池处理）
-        server.Post("/order", [&](const httplib::Request& req, httplib::Response& res) 
+        srv.Post("/order", [this](const httplib::Request& req, httplib::Response& res) 
         {
-            threadPool.enqueue([this, req, &res] {
-                Json::Value order = parse_json(req.body);
-                auto db_handler = acquire_db_handler();
-                
-                // 验证订单数据...
-                // 插入数据库...
-                
-                release_db_handler(std::move(db_handler));
-                res.set_content("{\"status\":\"created\"}", "application/json");
+            auto done = std::make_shared<std::promise<void>>();
+            std::future<void> finished = done->get_future();
+
+            bool accepted = threadPool.enqueue([this, done, &req, &res] {
+                try {
+                    // 下单用户取自会话，不信任请求体中的 user_id
+                    const std::string authHeader = req.get_header_value("Authorization");
+                    int64_t userId = 0;
+                    if (authHeader.empty()) {
+                        deny(res, 401, "未提供授权令牌");
+                    } else if (!g_userSession.validateSession(authHeader, userId)) {
+                        deny(res, 401, "无效的会话令牌");
+                    } else {
+                        create_order(userId, parse_json(req.body), res);
+                    }
+                } catch (const std::exception& e) {
+                    res.set_content("服务器错误: " + std::string(e.what()), "text/plain");
+                    res.status = 503;
+                }
+                done->set_value();
             });
+
+            if (!accepted) {
+                res.set_content("SHUTTING_DOWN", "text/plain");
+                res.status = 503;
+                return;
+            }
+            finished.wait();
         });
     }
 
+    void RestServer::create_order(int64_t user_id, const Json::Value& order, httplib::Response& res)
+    {
+        const Json::Value& items = order["items"];
+        bool valid = items.isArray() && !items.empty() && items.size() <= MAX_ORDER_ITEMS;
+        for (Json::ArrayIndex index = 0; valid && index < items.size(); ++index) {
+            valid = items[index]["dish_id"].isIntegral() && items[index]["quantity"].isIntegral() &&
+                    items[index]["quantity"].asInt() > 0;
+        }
+        if (!valid) {
+            res.set_content("{\"status\":\"invalid_items\"}", "application/json");
+            res.status = 400;
+            return;
+        }
+
+        const Json::Value& address = order["delivery_address"];
+        const Json::Value& phone = order["contact_phone"];
+        if (!(address.isObject() || (address.isString() && !address.asString().empty())) ||
+            !phone.isString() || phone.asString().empty()) {
+            res.set_content("{\"status\":\"invalid_contact\"}", "application/json");
+            res.status = 400;
+            return;
+        }
+
+        // 商家和价格以数据库为准，不信任请求中的金额；一个订单只能包含同一商家的菜品
+        std::string sql = "SELECT dish_id, merchant_id, price FROM dishes WHERE dish_id IN (";
+        SqlParams params;
+        for (Json::ArrayIndex index = 0; index < items.size(); ++index) {
+            sql += index ? ", ?" : "?";
+            params.emplace_back(items[index]["dish_id"].asInt64());
+        }
+        sql += ")";
+
+        Json::Value dishes;
+        {
+            DBLease menuDb = acquire_read_handler(user_id);
+            dishes = menuDb->query(sql, params);
+            if (!dishes.isArray()) {
+                throw std::runtime_error("查询菜品失败: " + menuDb->last_error());
+            }
+        }
+
+        std::unordered_map<int64_t, std::pair<int64_t, Money>> menu;
+        for (const auto& dish : dishes) {
+            Money price;
+            Money::parse(dish["price"].asString(), price);
+            menu[dish["dish_id"].asInt64()] = {dish["merchant_id"].asInt64(), price};
+        }
+
+        int64_t merchantId = 0;
+        Money total;
+        Json::Value lines(Json::arrayValue);
+        for (const auto& item : items) {
+            const int64_t dishId = item["dish_id"].asInt64();
+            const int quantity = item["quantity"].asInt();
+
+            auto it = menu.find(dishId);
+            if (it == menu.end() || (merchantId != 0 && it->second.first != merchantId)) {
+                Json::Value result;
+                result["status"] = it == menu.end() ? "unknown_dish" : "mixed_merchants";
+                result["dish_id"] = static_cast<Json::Int64>(dishId);
+                res.set_content(result.toStyledString(), "application/json");
+                res.status = 400;
+                return;
+            }
+            merchantId = it->second.first;
+
+            // 逐项检查，总额不超过 DECIMAL(10,2)，乘法也不会溢出
+            const Money price = it->second.second;
+            if (price.cents() > 0 && quantity > (Money::MAX_CENTS - total.cents()) / price.cents()) {
+                res.set_content("{\"status\":\"amount_too_large\"}", "application/json");
+                res.status = 400;
+                return;
+            }
+            total += Money::fromCents(price.cents() * quantity);
+
+            Json::Value line;
+            line["dish_id"] = static_cast<Json::Int64>(dishId);
+            line["quantity"] = quantity;
+            line["price"] = price.toString();
+            lines.append(line);
+        }
+
+        OrderStockReservation reserved;
+        const int64_t soldOutDish = reserve_order_stock(user_id, items, reserved);
+        if (soldOutDish != 0) {
+            Json::Value result;
+            result["status"] = "sold_out";
+            result["dish_id"] = static_cast<Json::Int64>(soldOutDish);
+            res.set_content(result.toStyledString(), "application/json");
+            res.status = 409;
+            return;
+        }
+
+        // 库存已预留：插入订单失败（包括抛出异常）时撤销全部预留，库存与订单保持一致
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        const std::string orderNumber = next_order_number(user_id);
+
+        int64_t orderId = 0;
+        std::string failure;
+        try {
+            // 订单写入下单用户所在的分片
+            DBLease orderDb = acquire_shard_handler(user_id, true);
+            if (!orderDb) {
+                orderDb = acquire_db_handler(user_id);
+            }
+
+            const std::string addressText = address.isString() ? address.asString() : Json::writeString(builder, address);
+            if (orderDb->execute(SQL_INSERT_ORDER, {orderNumber, user_id, merchantId, total.toString(), addressText,
+                                                    phone.asString(), Json::writeString(builder, lines)}) > 0) {
+                orderId = static_cast<int64_t>(orderDb->last_insert_id());
+            } else {
+                failure = orderDb->last_error();
+            }
+        } catch (const std::exception& e) {
+            failure = e.what();
+        }
+
+        if (orderId == 0) {
+            release_order_stock(user_id, reserved);
+            throw std::runtime_error("订单写入失败，库存已恢复: " + failure);
+        }
+
+        Json::Value result;
+        result["status"] = "created";
+        result["order_id"] = static_cast<Json::Int64>(orderId);
+        result["order_number"] = orderNumber;
+        result["total_amount"] = total.toYuan();
+        res.set_content(result.toStyledString(), "application/json");
+    }
+
+    int64_t RestServer::reserve_order_stock(int64_t user_id, const Json::Value& items, OrderStockReservation& reserved)
+    {
+        DBLease stockDb;
+
+        for (const auto& item : items) {
+            const int64_t dishId = item["dish_id"].asInt64();
+            const int quantity = item["quantity"].asInt();
+
+            StockReservation reservation = stockEngine->reserve(dishId, quantity);
+            if (reservation == StockReservation::RESERVED) {
+                reserved.hot.emplace_back(dishId, quantity);
+                continue;
+            }
+
+            // 冷门菜品的库存在全局库，以版本号为条件扣减
+            if (reservation == StockReservation::NOT_HOT) {
+                if (!stockDb) {
+                    stockDb = acquire_db_handler(user_id);
+                }
+                const int64_t affected = StockEngine::reserve_in_db(*stockDb, dishId, quantity);
+                if (affected > 0) {
+                    reserved.cold.emplace_back(dishId, quantity);
+                    continue;
+                }
+                if (affected < 0) {
+                    const std::string error = stockDb->last_error();
+                    stockDb.release();
+                    release_order_stock(user_id, reserved);
+                    throw std::runtime_error("库存扣减失败: " + error);
+                }
+            }
+
+            stockDb.release();
+            release_order_stock(user_id, reserved);
+            return dishId;
+        }
+        return 0;
+    }
+
+    void RestServer::release_order_stock(int64_t user_id, const OrderStockReservation& reserved)
+    {
+        for (const auto& [dishId, quantity] : reserved.hot) {
+            stockEngine->release(dishId, quantity);
+        }
+        if (reserved.cold.empty()) {
+            return;
+        }
+
+        // 撤销失败只能记录下来人工对账，库存会偏少而不会超卖
+        try {
+            DBLease stockDb = acquire_db_handler(user_id);
+            for (const auto& [dishId, quantity] : reserved.cold) {
+                if (!StockEngine::release_in_db(*stockDb, dishId, quantity)) {
+                    std::cerr << "Order: failed to release " << quantity << " of dish " << dishId
+                              << ": " << stockDb->last_error() << std::endl;
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Order: failed to release stock of " << reserved.cold.size()
+                      << " dishes: " << e.what() << std::endl;
+        }
+    }
+
+    void RestServer::register_batch_routes()
+    {
+        // 子请求参数可能是数字也可能是字符串（与 query string 保持一致）
+        auto int_param = [](const Json::Value& params, const char* key, int defaultValue) {
+            const Json::Value& value = params[key];
+            if (value.isIntegral()) {
+                return value.asInt();
+            }
+            if (value.isString() && !value.asString().empty()) {
+                return std::stoi(value.asString());
+            }
+            return defaultValue;
+        };
+
+        batchRoutes["GET /api/user/info"] = {true,
+            [](UserManager& userManager, int64_t user_id, const Json::Value&) {
+                return userManager.getUserInfo(user_id);
+            }};
+
+        batchRoutes["GET /api/user/wallet"] = {true,
+            [](UserManager& userManager, int64_t user_id, const Json::Value&) {
+                return userManager.getWalletInfo(user_id);
+            }};
+
+        batchRoutes["GET /api/user/orders"] = {true,
+            [int_param](UserManager& userManager, int64_t user_id, const Json::Value& params) {
+                return userManager.getOrderHistory(user_id, int_param(params, "page", 1),
+                                                   int_param(params, "page_size", 10),
+                                                   params.get("cursor", "").asString());
+            }};
+
+        batchRoutes["POST /api/user/recharge"] = {false,
+            [](UserManager& userManager, int64_t user_id, const Json::Value& params) {
+                return userManager.rechargeBalance(user_id, money_param(params, "amount"));
+            }};
+    }
+
+    Json::Value RestServer::execute_batch(int64_t user_id, const Json::Value& subRequests)
+    {
+        Json::ArrayIndex count = subRequests.size();
+        std::vector<const BatchRoute*> routes(count, nullptr);
+        std::vector<std::string> keys(count);
+        bool allReadOnly = true;
+
+        for (Json::ArrayIndex index = 0; index < count; ++index) {
+            const Json::Value& subRequest = subRequests[index];
+            keys[index] = subRequest.get("method", "GET").asString() + " " + subRequest.get("path", "").asString();
+
+            auto it = batchRoutes.find(keys[index]);
+            if (it != batchRoutes.end()) {
+                routes[index] = &it->second;
+                allReadOnly = allReadOnly && it->second.readOnly;
+            }
+        }
+
+        // 每个子请求写入各自的槽位，并行执行时互不干扰
+        std::vector<Json::Value> bodies(count);
+        std::vector<int> statuses(count, 200);
+
+        auto run_one = [&](Json::ArrayIndex index, UserManager* userManager) {
+            try {
+                if (userManager) {
+                    bodies[index] = routes[index]->handler(*userManager, user_id, subRequests[index]["params"]);
+                } else {
+                    UserManager ownManager(acquire_read_handler(user_id), shard_leases(), logAppender.get());
+                    bodies[index] = routes[index]->handler(ownManager, user_id, subRequests[index]["params"]);
+                }
+            } catch (const std::exception& e) {
+                statuses[index] = 500;
+                bodies[index]["success"] = false;
+                bodies[index]["message"] = "服务器错误: " + std::string(e.what());
+            }
+        };
+
+        if (allReadOnly && count > 1) {
+            // mysqlx::Session 不是线程安全的：并行的只读子请求各自从连接池借用连接。
+            // 当前线程与至多 batchParallelism - 1 个池线程一起领取子请求，同时占用的连接数不超过 batchParallelism；
+            // 线程池拒绝任务（排空中）时剩余子请求全部由当前线程执行
+            struct BatchProgress {
+                std::vector<Json::ArrayIndex> items;
+                std::atomic<size_t> next {0};
+                std::mutex mutex;
+                std::condition_variable cv;
+                size_t finished = 0;
+            };
+
+            auto progress = std::make_shared<BatchProgress>();
+            for (Json::ArrayIndex index = 0; index < count; ++index) {
+                if (routes[index]) {
+                    progress->items.push_back(index);
+                }
+            }
+
+            // 晚启动的池线程领不到子请求时只访问 progress，不会触及已返回的栈帧
+            auto claim_items = [progress, &run_one] {
+                size_t slot;
+                while ((slot = progress->next++) < progress->items.size()) {
+                    run_one(progress->items[slot], nullptr);
+                    std::lock_guard<std::mutex> lock(progress->mutex);
+                    ++progress->finished;
+                    progress->cv.notify_all();
+                }
+            };
+
+            const size_t workers = std::min<size_t>(batchParallelism, progress->items.size());
+            for (size_t helper = 1; helper < workers; ++helper) {
+                if (!threadPool.enqueue(claim_items)) {
+                    break;
+                }
+            }
+            claim_items();
+
+            std::unique_lock<std::mutex> lock(progress->mutex);
+            progress->cv.wait(lock, [&] { return progress->finished == progress->items.size(); });
+        } else {
+            // 含写操作时按提交顺序在同一个连接上串行执行，保证先写后读可见
+            UserManager userManager(allReadOnly ? acquire_read_handler(user_id) : acquire_db_handler(user_id),
+                                    shard_leases(), logAppender.get());
+            for (Json::ArrayIndex index = 0; index < count; ++index) {
+                if (routes[index]) {
+                    run_one(index, &userManager);
+                }
+            }
+        }
+
+        Json::Value responses(Json::arrayValue);
+        for (Json::ArrayIndex index = 0; index < count; ++index) {
+            Json::Value response;
+            response["id"] = subRequests[index].get("id", static_cast<int>(index));
+            if (routes[index]) {
+                response["status"] = statuses[index];
+                response["body"] = bodies[index];
+            } else {
+                response["status"] = 404;
+                response["body"]["success"] = false;
+                response["body"]["message"] = "批量接口不支持该子请求: " + keys[index];
+            }
+            responses.append(response);
+        }
+
+        return responses;
+    }
+
+    bool RestServer::authorize_admin(const httplib::Request& req, httplib::Response& res)
+    {
+        const std::string adminHeader = req.get_header_value("X-Admin-Token");
+        if (!adminHeader.empty()) {
+            if (!adminToken.empty() && same_secret(adminHeader, adminToken)) {
+                return true;
+            }
+            deny(res, 403, "无效的管理令牌");
+            return false;
+        }
+
+        const std::string authHeader = req.get_header_value("Authorization");
+        int64_t user_id;
+        if (authHeader.empty() || !g_userSession.validateSession(authHeader, user_id)) {
+            deny(res, 401, authHeader.empty() ? "未提供授权令牌" : "无效的会话令牌");
+            return false;
+        }
+
+        // 角色从主库读取，降级后的账号立即失去管理权限
+        try {
+            UserManager userManager(acquire_db_handler(), shard_leases(), logAppender.get());
+            Json::Value info = userManager.getUserInfo(user_id);
+            if (info["success"].asBool() && info["data"]["role"].asString() == "admin") {
+                return true;
+            }
+        } catch (const std::exception& e) {
+            deny(res, 500, "服务器错误: " + std::string(e.what()));
+            return false;
+        }
+
+        deny(res, 403, "需要管理员权限");
+        return false;
+    }
+
     Json::Value RestServer::parse_json(const std::string& jsonStr) 
     {
         Json::Value root;
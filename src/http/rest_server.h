@@ -1,57 +1,183 @@
 #pragma once
 
+#include <functional>
+#include <unordered_map>
 #include <httplib.h>
 #include <mysqlx/xdevapi.h>
 
 #include "common.h"
 #include "thread_pool.h"
 #include "db_handler.h"
+#include "db_pool.h"
+#include "db_router.h"
+#include "shard_router.h"
+#include "log_appender.h"
+#include "stock_engine.h"
+#include "migration_runner.h"
+#include "http_server.h"
 
 
 namespace TakeAwayPlatform
 {
+    class UserManager;
+
     class RestServer 
     {
     public:
-        RestServer(const std::string& configPath);
+        // sharedStock：prefork 模式下由 master 在 fork 之前创建的热点库存计数器，单进程模式为空
+        RestServer(const std::string& configPath, SharedStockTable* sharedStock = nullptr);
         ~RestServer();
 
-        void start(int port);
+        // takeover 为 true 时从旧进程接管监听套接字（热重启），失败则回退为冷启动
+        void start(int port, bool takeover = false);
+        // prefork worker：在 master 创建的共享监听套接字上 accept
+        void start_on_listener(int listenFd);
+
         void stop();
         bool is_running() const;
+        bool is_handed_off() const;
+
+        // 排空阶段在 DB 连接关闭之前执行的刷新钩子（异步日志、批量写入等）
+        void add_drain_hook(const std::string& name, std::function<void()> hook);
+
+        // 最近一次排空耗时（毫秒），未排空过时为 -1
+        int64_t drain_millis() const;
         
 
     private:
         void init_db_pool(const Json::Value& config);
 
-        void run_server(int port);
+        void run_server(int port, int listenFd);
+
+        // 同时监听 TCP 与 Unix 域套接字时，后者在独立线程中运行
+        void run_unix_server();
+
+        // 热重启：新进程等待全部连接池预热到 min_idle，超时返回 false
+        bool wait_warm_up_reached(int timeoutSec);
+
+        // 热重启：新进程完成接管后通知旧进程
+        void complete_takeover(int channel);
 
-        std::unique_ptr<DatabaseHandler> create_db_handler();
+        // 热重启：旧进程在控制通道上等待新进程接管监听套接字
+        void start_handoff_listener();
+        void stop_handoff_listener();
+        void handoff_loop();
+        void drain_after_handoff();
 
-        std::unique_ptr<DatabaseHandler> acquire_db_handler();
+        // 借用主库连接，租约离开作用域时自动归还；连接池耗尽超时抛出 std::runtime_error。
+        // 传入 user_id 时该用户随后在本进程内的读请求在 read_pin_sec 内也走主库
+        DBLease acquire_db_handler(int64_t user_id = 0);
 
-        void release_db_handler(std::unique_ptr<DatabaseHandler> handler);
+        // 借用只读连接（从库，写后固定期内或无可用从库时为主库）
+        DBLease acquire_read_handler(int64_t user_id);
 
-        void setup_routes();
+        // 借用 user_id 所在分片的连接；未启用分片时返回空租约，UserManager 回落到全局库连接
+        DBLease acquire_shard_handler(int64_t user_id, bool write);
+
+        // 交给 UserManager 的分片连接来源，未启用分片时为空
+        ShardLeaseProvider shard_leases();
+
+        void setup_routes(HttpServer& srv);
+
+        // 注册可被 /api/batch 复用的用户接口
+        void register_batch_routes();
+
+        Json::Value execute_batch(int64_t user_id, const Json::Value& subRequests);
 
         Json::Value parse_json(const std::string& jsonStr);
 
+        // /admin 接口的访问控制：X-Admin-Token 与 server.admin_token 一致（未配置时不接受该方式），
+        // 或 Authorization 会话属于 admin 角色的用户。未通过时写入 401/403 响应并返回 false
+        bool authorize_admin(const httplib::Request& req, httplib::Response& res);
+
+        // 一个订单已预留的库存：热点菜品在库存引擎中，其余在数据库中
+        struct OrderStockReservation {
+            std::vector<std::pair<int64_t, int>> hot;
+            std::vector<std::pair<int64_t, int>> cold;
+        };
+
+        // 下单：按数据库中的价格计算总额，预留库存后写入订单；写入失败时撤销预留并抛出 std::runtime_error
+        void create_order(int64_t user_id, const Json::Value& order, httplib::Response& res);
+
+        // 为订单的全部菜品预留库存：热点菜品在库存引擎中扣减，其余菜品扣减数据库。
+        // 全部成功返回 0，预留记入 reserved；某个菜品库存不足时撤销已预留的部分并返回该菜品 ID；
+        // 数据库失败时撤销后抛出 std::runtime_error
+        int64_t reserve_order_stock(int64_t user_id, const Json::Value& items, OrderStockReservation& reserved);
+
+        // 撤销 reserve_order_stock 的预留（订单写入失败）
+        void release_order_stock(int64_t user_id, const OrderStockReservation& reserved);
+
 
     private:
-        httplib::Server server;
+        // 批量子请求处理函数：(用户管理器, 已验证的用户ID, 子请求参数) -> 接口响应
+        using BatchHandler = std::function<Json::Value(UserManager&, int64_t, const Json::Value&)>;
+
+        struct BatchRoute {
+            bool readOnly;          // 只读接口可并行执行
+            BatchHandler handler;
+        };
+
+        static constexpr Json::ArrayIndex MAX_BATCH_SIZE = 16;
+
+        // 一个订单最多的菜品项数
+        static constexpr Json::ArrayIndex MAX_ORDER_ITEMS = 50;
+
+        // 一个批量请求最多同时占用的连接数，实际取 max_total / 3 与此值中的较小者
+        static constexpr int MAX_BATCH_PARALLELISM = 4;
+
+        static constexpr int HANDOFF_TIMEOUT_SEC = 30;
+
+        // /menu 分块响应每块的行数
+        static constexpr size_t MENU_STREAM_BATCH_ROWS = 64;
+
+    private:
+        HttpServer server;
         ThreadPool threadPool;
         std::vector<DBConfig> dbConfig;
-        std::mutex dbPoolMutex;
-        std::queue<std::unique_ptr<DatabaseHandler>> dbPool;
+        std::shared_ptr<DBRouter> dbRouter;
+        std::unique_ptr<ShardRouter> shardRouter;
+        std::unique_ptr<LogAppender> logAppender;
+        std::unique_ptr<StockEngine> stockEngine;
+        SharedStockTable* sharedStock = nullptr;
+
+        // 键为 "METHOD path"，如 "GET /api/user/info"
+        std::unordered_map<std::string, BatchRoute> batchRoutes;
+        int batchParallelism {1};
 
         std::atomic<bool> isRunning {false};
         std::atomic<bool> stopRequested {false};
+        std::atomic<bool> drained {false};
+
+        // 优雅排空
+        int drainTimeoutSec {10};
+        std::atomic<int> inFlightRequests {0};
+        std::atomic<int64_t> lastDrainMillis {-1};
+        std::mutex drainHookMutex;
+        std::vector<std::pair<std::string, std::function<void()>>> drainHooks;
 
         // 用于等待服务器停止的同步对象
         std::mutex stopMtx;
         std::condition_variable stopCv;
 
         std::thread serverThread;
+
+        // Unix 域套接字监听（config.json 中 server.unix_socket，为空则不启用）；
+        // listen_tcp 为 false 时由 server 直接监听该路径
+        std::string unixSocketPath;
+        mode_t unixSocketMode {0660};
+        bool listenTcp {true};
+
+        // 管理接口令牌（config.json 中 server.admin_token），为空时只能以 admin 角色的会话访问
+        std::string adminToken;
+        bool sharedListener {false};
+        HttpServer unixServer;
+        std::thread unixServerThread;
+
+        // 热重启控制通道（config.json 中 server.handoff_path，为空则不启用）
+        std::string handoffPath;
+        int controlFd {-1};
+        std::atomic<bool> handedOff {false};
+        std::thread handoffThread;
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <filesystem>
+
+#include "socket_handoff.h"
+
+
+namespace TakeAwayPlatform
+{
+    namespace SocketHandoff
+    {
+        namespace
+        {
+            bool make_address(const std::string& path, sockaddr_un& addr)
+            {
+                if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+                    std::cerr << "Invalid handoff socket path: " << path << std::endl;
+                    return false;
+                }
+
+                std::memset(&addr, 0, sizeof(addr));
+                addr.sun_family = AF_UNIX;
+                std::memcpy(addr.sun_path, path.c_str(), path.size());
+                return true;
+            }
+
+            bool wait_readable(int fd, int timeoutSec)
+            {
+                pollfd pfd {fd, POLLIN, 0};
+                int ret;
+                do {
+                    ret = ::poll(&pfd, 1, timeoutSec * 1000);
+                } while (ret < 0 && errno == EINTR);
+
+                return ret > 0;
+            }
+
+            // 控制通道可以拿到监听套接字，所在目录只能由当前用户写入
+            bool ensure_private_directory(const std::string& path)
+            {
+                std::string directory = std::filesystem::path(path).parent_path().string();
+                if (directory.empty()) {
+                    directory = ".";
+                }
+
+                if (::mkdir(directory.c_str(), 0700) < 0 && errno != EEXIST) {
+                    std::cerr << "Failed to create handoff directory " << directory << ": " << std::strerror(errno) << std::endl;
+                    return false;
+                }
+
+                struct stat st;
+                if (::stat(directory.c_str(), &st) < 0 || !S_ISDIR(st.st_mode)) {
+                    std::cerr << "Invalid handoff directory: " << directory << std::endl;
+                    return false;
+                }
+                if (st.st_uid != ::geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+                    std::cerr << "Handoff directory " << directory
+                              << " must be owned by the server user and not writable by others" << std::endl;
+                    return false;
+                }
+                return true;
+            }
+        }
+
+        int listen_control(const std::string& path)
+        {
+            sockaddr_un addr;
+            if (!make_address(path, addr) || !ensure_private_directory(path)) {
+                return -1;
+            }
+
+            int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                return -1;
+            }
+
+            // 残留的套接字文件来自已退出的进程
+            ::unlink(path.c_str());
+
+            // 先收紧权限再 listen，其他用户在任何时刻都连不上
+            if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+                ::chmod(path.c_str(), 0600) < 0 || ::listen(fd, 1) < 0) {
+                std::cerr << "Failed to listen on handoff socket " << path << ": " << std::strerror(errno) << std::endl;
+                ::close(fd);
+                return -1;
+            }
+
+            return fd;
+        }
+
+        int connect_control(const std::string& path)
+        {
+            sockaddr_un addr;
+            if (!make_address(path, addr)) {
+                return -1;
+            }
+
+            int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                return -1;
+            }
+
+            if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+                std::cerr << "Failed to connect handoff socket " << path << ": " << std::strerror(errno) << std::endl;
+                ::close(fd);
+                return -1;
+            }
+
+            return fd;
+        }
+
+        bool peer_is_trusted(int channel)
+        {
+            ucred cred {};
+            socklen_t length = sizeof(cred);
+            if (::getsockopt(channel, SOL_SOCKET, SO_PEERCRED, &cred, &length) < 0) {
+                return false;
+            }
+
+            if (cred.uid != ::geteuid()) {
+                std::cerr << "Rejected handoff peer pid " << cred.pid << " uid " << cred.uid << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        bool send_fd(int channel, int fd)
+        {
+            char payload = 'F';
+            iovec iov {&payload, 1};
+
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+            std::memset(control, 0, sizeof(control));
+
+            msghdr msg {};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+            std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+            ssize_t sent;
+            do {
+                sent = ::sendmsg(channel, &msg, MSG_NOSIGNAL);
+            } while (sent < 0 && errno == EINTR);
+
+            return sent == 1;
+        }
+
+        int recv_fd(int channel, int timeoutSec)
+        {
+            if (!wait_readable(channel, timeoutSec)) {
+                return -1;
+            }
+
+            char payload = 0;
+            iovec iov {&payload, 1};
+
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+
+            msghdr msg {};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            if (::recvmsg(channel, &msg, MSG_CMSG_CLOEXEC) != 1) {
+                return -1;
+            }
+
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                    int fd;
+                    std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+                    return fd;
+                }
+            }
+
+            return -1;
+        }
+
+        bool send_message(int channel, const std::string& message)
+        {
+            return ::send(channel, message.data(), message.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(message.size());
+        }
+
+        bool wait_message(int channel, const std::string& expected, int timeoutSec)
+        {
+            std::string received;
+            while (received.size() < expected.size()) {
+                if (!wait_readable(channel, timeoutSec)) {
+                    return false;
+                }
+
+                char buffer[64];
+                ssize_t size = ::recv(channel, buffer, sizeof(buffer), 0);
+                if (size <= 0) {
+                    return false;
+                }
+                received.append(buffer, static_cast<size_t>(size));
+            }
+
+            return received.compare(0, expected.size(), expected) == 0;
+        }
+    }
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+
+
+namespace TakeAwayPlatform
+{
+    // 热重启时新旧进程之间通过 Unix 域套接字传递监听 fd（SCM_RIGHTS）
+    namespace SocketHandoff
+    {
+        // 新进程发送给旧进程的就绪通知：连接池已预热，且已开始 accept
+        constexpr char READY_MESSAGE[] = "READY";
+
+        // 旧进程：在 path 上创建控制通道监听套接字（权限 0600），失败返回 -1。
+        // path 所在目录不存在时以 0700 创建；目录须属于当前用户且组和其他用户不可写，/tmp 之类的公共目录会被拒绝
+        int listen_control(const std::string& path);
+
+        // 新进程：连接旧进程的控制通道，失败返回 -1
+        int connect_control(const std::string& path);
+
+        // 对端进程与当前进程属于同一用户（SO_PEERCRED），不是则不能交换监听套接字
+        bool peer_is_trusted(int channel);
+
+        // 通过控制通道发送/接收一个文件描述符
+        bool send_fd(int channel, int fd);
+        int recv_fd(int channel, int timeoutSec);
+
+        // 控制通道上的简单文本消息
+        bool send_message(int channel, const std::string& message);
+        bool wait_message(int channel, const std::string& expected, int timeoutSec);
+    }
+
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "transport_bench.h"
+#include "http_server.h"
+
+
+namespace TakeAwayPlatform
+{
+    namespace
+    {
+        const char* const BENCH_PATH = "/bench";
+        const char* const BENCH_BODY = "OK";
+
+        // 已排序样本的分位数（最近秩）
+        int64_t percentile(const std::vector<int64_t>& sorted, double quantile)
+        {
+            if (sorted.empty()) {
+                return 0;
+            }
+            const size_t rank = static_cast<size_t>(std::ceil(quantile * sorted.size()));
+            return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+        }
+    }
+
+    Json::Value TransportBenchResult::toJson() const
+    {
+        Json::Value json;
+        json["transport"] = transport;
+        json["ok"] = ok;
+        json["threads"] = threads;
+        json["requests"] = static_cast<Json::UInt64>(requests);
+        json["errors"] = static_cast<Json::UInt64>(errors);
+        json["throughput"] = std::round(throughput * 10) / 10;
+        json["p50_us"] = static_cast<Json::Int64>(p50Us);
+        json["p95_us"] = static_cast<Json::Int64>(p95Us);
+        json["p99_us"] = static_cast<Json::Int64>(p99Us);
+        json["max_us"] = static_cast<Json::Int64>(maxUs);
+        return json;
+    }
+
+    TransportBenchResult run_transport_benchmark(bool unixSocket, const TransportBenchOptions& options)
+    {
+        TransportBenchResult result;
+        result.transport = unixSocket ? "uds" : "tcp";
+        result.threads = options.threads;
+
+        HttpServer server;
+        server.Get(BENCH_PATH, [](const httplib::Request&, httplib::Response& res) {
+            res.set_content(BENCH_BODY, "text/plain");
+        });
+        // 客户端数可能超过默认线程池大小，长连接各占一个服务端线程
+        server.new_task_queue = [&options] {
+            return new httplib::ThreadPool(static_cast<size_t>(std::max(options.threads, 1)) + 1);
+        };
+
+        // 关闭 Nagle，否则响应头与正文分两次写出时会等对端的延迟确认，测到的是约 40ms 的定时器而不是传输开销
+        server.set_tcp_nodelay(true);
+
+        int port = 0;
+        if (unixSocket) {
+            server.set_address_family(AF_UNIX);
+            ::unlink(options.socketPath.c_str());
+            if (!server.bind_to_port(options.socketPath, 80)) {
+                return result;
+            }
+        } else {
+            port = server.bind_to_any_port("127.0.0.1");
+            if (port < 0) {
+                return result;
+            }
+        }
+
+        std::thread serverThread([&server] { server.listen_after_bind(); });
+        server.wait_until_ready();
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto measureFrom = start + std::chrono::seconds(options.warmUpSec);
+        const auto deadline = measureFrom + std::chrono::seconds(options.durationSec);
+
+        std::vector<std::vector<int64_t>> latencies(options.threads);
+        std::vector<uint64_t> errors(options.threads, 0);
+        std::vector<std::thread> clients;
+        for (int worker = 0; worker < options.threads; ++worker) {
+            clients.emplace_back([&, worker] {
+                httplib::Client client(unixSocket ? options.socketPath : "127.0.0.1", unixSocket ? 80 : port);
+                if (unixSocket) {
+                    client.set_address_family(AF_UNIX);
+                }
+                client.set_keep_alive(true);
+                client.set_tcp_nodelay(true);
+
+                while (true) {
+                    const auto begin = std::chrono::steady_clock::now();
+                    if (begin >= deadline) {
+                        break;
+                    }
+                    auto response = client.Get(BENCH_PATH);
+                    const auto end = std::chrono::steady_clock::now();
+
+                    if (begin >= measureFrom) {
+                        latencies[worker].push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count());
+                        if (!response || response->status != 200) {
+                            ++errors[worker];
+                        }
+                    }
+                }
+            });
+        }
+        for (auto& client : clients) {
+            client.join();
+        }
+
+        server.stop();
+        serverThread.join();
+        if (unixSocket) {
+            ::unlink(options.socketPath.c_str());
+        }
+
+        std::vector<int64_t> merged;
+        for (int worker = 0; worker < options.threads; ++worker) {
+            merged.insert(merged.end(), latencies[worker].begin(), latencies[worker].end());
+            result.errors += errors[worker];
+        }
+        std::sort(merged.begin(), merged.end());
+
+        result.ok = true;
+        result.requests = merged.size();
+        result.throughput = options.durationSec > 0 ? static_cast<double>(merged.size()) / options.durationSec : 0;
+        result.p50Us = percentile(merged, 0.50);
+        result.p95Us = percentile(merged, 0.95);
+        result.p99Us = percentile(merged, 0.99);
+        result.maxUs = merged.empty() ? 0 : merged.back();
+        return result;
+    }
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <json/json.h>
+
+
+namespace TakeAwayPlatform
+{
+    // 传输层基准参数，沿用 database 节的 bench_* 配置项
+    struct TransportBenchOptions {
+        int threads = 8;            // 并发客户端数，每个客户端一条长连接
+        int durationSec = 10;
+        int warmUpSec = 2;
+        std::string socketPath = "/tmp/TakeAwayPlatform.bench.sock";
+    };
+
+    // 一种传输方式的结果
+    struct TransportBenchResult {
+        std::string transport;      // "tcp" 或 "uds"
+        bool ok = false;            // 服务端监听成功
+        int threads = 0;
+        uint64_t requests = 0;
+        uint64_t errors = 0;
+        double throughput = 0;      // 每秒请求数
+        int64_t p50Us = 0;
+        int64_t p95Us = 0;
+        int64_t p99Us = 0;
+        int64_t maxUs = 0;
+
+        Json::Value toJson() const;
+    };
+
+    // 在本进程内分别以 127.0.0.1 回环 TCP 和 Unix 域套接字启动只有一个路由（与 /health 相同的 "OK" 文本响应）的
+    // HttpServer，以固定并发的长连接客户端循环请求，对比两种传输的吞吐和延迟分位数。
+    // 不经过数据库，结果只反映传输层与 HTTP 解析的开销
+    TransportBenchResult run_transport_benchmark(bool unixSocket, const TransportBenchOptions& options);
+
+}
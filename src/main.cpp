@@ -1,16 +1,33 @@
+#include <algorithm>
 #include <csignal>
+#include <cstring>
+#include <sstream>
 #include <atomic>
 #include <thread>
 #include <condition_variable>
 
 #include "common.h"
 #include "rest_server.h"
+#include "prefork_master.h"
+#include "migration_runner.h"
+#include "db_bench.h"
+#include "transport_bench.h"
+#include "../user/user.h"
 
 
+static const char* CONFIG_PATH = "/opt/TakeAwayPlatform/config/config.json";
+static const int SERVER_PORT = 9090;
+static const int SESSION_PURGE_INTERVAL_SEC = 60;
+// 共享热点库存表每个热点菜品预留的槽位数，热度排名变化时新进入前 N 的菜品也有位置
+static const size_t SHARED_STOCK_SLOTS_PER_DISH = 4;
+
 std::atomic<bool> running(true);
 std::mutex mtx;
 std::condition_variable cv;
 
+// prefork 模式下由 master 在 fork 之前创建，各 worker 共用
+TakeAwayPlatform::SharedStockTable* sharedStock = nullptr;
+
 
 void signal_handler(int signal) {
     std::cout << "Received signal " << signal << ", shutting down..." << std::endl;
@@ -21,10 +38,288 @@ void signal_handler(int signal) {
     cv.notify_all();  // 唤醒可能阻塞的主线程
 }
 
-int main() {
+// 等待退出信号，或服务线程自行退出（如热重启移交后，此时不会通知 cv，需定期检查）。
+// 等待期间每 SESSION_PURGE_INTERVAL_SEC 清理一次过期会话（prefork 模式下各 worker 清理同一张共享表）
+void wait_for_shutdown(TakeAwayPlatform::RestServer& restSrv) {
+    auto nextPurge = std::chrono::steady_clock::now() + std::chrono::seconds(SESSION_PURGE_INTERVAL_SEC);
+
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!cv.wait_for(lock, std::chrono::seconds(1), [&]{
+        return !running || !restSrv.is_running();
+    })) {
+        if (std::chrono::steady_clock::now() >= nextPurge) {
+            TakeAwayPlatform::g_userSession.cleanExpiredSessions();
+            nextPurge = std::chrono::steady_clock::now() + std::chrono::seconds(SESSION_PURGE_INTERVAL_SEC);
+        }
+    }
+}
+
+// prefork worker 入口：独立的 RestServer（线程池、数据库连接池）在共享监听套接字上服务
+int run_worker(int listenFd) {
+    try 
+    {
+        TakeAwayPlatform::RestServer restSrv(CONFIG_PATH, sharedStock);
+        restSrv.start_on_listener(listenFd);
+
+        wait_for_shutdown(restSrv);
+
+        restSrv.stop();
+        std::cout << "metric server_drain_ms " << restSrv.drain_millis() << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Worker error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+// 数据库维护命令：在全局库和配置的各分片主库上执行迁移（migrate）或检查执行计划（checkExplain）
+int run_db_tool(bool migrate, bool checkExplain) {
+    try 
+    {
+        Json::Value config = TakeAwayPlatform::load_config(CONFIG_PATH)["database"];
+        const std::string directory = config.get("migrations_dir",
+            TakeAwayPlatform::MigrationRunner::DEFAULT_DIRECTORY).asString();
+
+        std::vector<TakeAwayPlatform::DBConfig> targets {TakeAwayPlatform::load_db_config(config, config)};
+        for (const auto& shard : config["shards"]) {
+            targets.push_back(TakeAwayPlatform::load_db_config(shard, config));
+        }
+
+        bool ok = true;
+        for (const auto& target : targets) {
+            TakeAwayPlatform::DatabaseHandler db(target);
+            if (!db.is_connected()) {
+                std::cerr << "Cannot connect to " << target.host << ":" << target.port << std::endl;
+                return 1;
+            }
+
+            if (migrate) {
+                int applied = TakeAwayPlatform::MigrationRunner(db, directory).migrate();
+                if (applied < 0) {
+                    return 1;
+                }
+                std::cout << target.host << ":" << target.port << " applied " << applied << " migrations" << std::endl;
+            }
+
+            if (checkExplain) {
+                ok = TakeAwayPlatform::MigrationRunner::check_query_plans(
+                    db, TakeAwayPlatform::UserManager::queryTemplates()) && ok;
+            }
+        }
+        return ok ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Database tool error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// 数据库基准：在全局库上依次以 backends（逗号分隔）执行查询组合，输出各后端的吞吐与延迟
+int run_db_bench(const std::string& backends) {
+    try 
+    {
+        Json::Value config = TakeAwayPlatform::load_config(CONFIG_PATH)["database"];
+
+        TakeAwayPlatform::DbBenchOptions options;
+        options.threads = config.get("bench_threads", options.threads).asInt();
+        options.durationSec = config.get("bench_duration_sec", options.durationSec).asInt();
+        options.warmUpSec = config.get("bench_warm_up_sec", options.warmUpSec).asInt();
+
+        const auto mix = TakeAwayPlatform::UserManager::queryTemplates();
+
+        bool ok = true;
+        Json::Value report(Json::arrayValue);
+        std::stringstream names(backends);
+        std::string backend;
+        while (std::getline(names, backend, ',')) {
+            TakeAwayPlatform::DBConfig target = TakeAwayPlatform::load_db_config(config, config);
+            target.backend = backend;
+
+            TakeAwayPlatform::DbBenchResult result = TakeAwayPlatform::run_db_benchmark(target, mix, options);
+            if (!result.ok) {
+                std::cerr << "Benchmark " << backend << ": cannot connect" << std::endl;
+            }
+            ok = ok && result.ok;
+            report.append(result.toJson());
+        }
+
+        std::cout << report.toStyledString() << std::endl;
+        return ok ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Database benchmark error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// 结果集解码基准：在 backend（为空时使用配置的后端）上对比 parse_result 与 query_as 解码 bench_decode_rows 行的耗时
+int run_decode_bench(const std::string& backend) {
+    try 
+    {
+        Json::Value config = TakeAwayPlatform::load_config(CONFIG_PATH)["database"];
+
+        TakeAwayPlatform::DbBenchOptions options;
+        options.durationSec = config.get("bench_duration_sec", options.durationSec).asInt();
+        options.warmUpSec = config.get("bench_warm_up_sec", options.warmUpSec).asInt();
+        options.decodeRows = config.get("bench_decode_rows", options.decodeRows).asInt();
+
+        TakeAwayPlatform::DBConfig target = TakeAwayPlatform::load_db_config(config, config);
+        if (!backend.empty()) {
+            target.backend = backend;
+        }
+
+        bool ok = true;
+        Json::Value report(Json::arrayValue);
+        for (auto strategy : {TakeAwayPlatform::DecodeStrategy::PARSE_RESULT, TakeAwayPlatform::DecodeStrategy::QUERY_AS}) {
+            TakeAwayPlatform::DbBenchResult result = TakeAwayPlatform::run_decode_benchmark(target, strategy, options);
+            if (!result.ok) {
+                std::cerr << "Decode benchmark " << result.decoder << ": cannot connect or prepare table" << std::endl;
+            }
+            ok = ok && result.ok && result.errors == 0;
+            report.append(result.toJson());
+        }
+
+        std::cout << report.toStyledString() << std::endl;
+        return ok ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Decode benchmark error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// 热点行争用基准：在 backend（为空时使用配置的后端）上依次以加锁事务和版本号条件更新执行读改写，输出对比结果
+int run_contention_bench(const std::string& backend) {
+    try 
+    {
+        Json::Value config = TakeAwayPlatform::load_config(CONFIG_PATH)["database"];
+
+        TakeAwayPlatform::DbBenchOptions options;
+        options.threads = config.get("bench_threads", options.threads).asInt();
+        options.durationSec = config.get("bench_duration_sec", options.durationSec).asInt();
+        options.warmUpSec = config.get("bench_warm_up_sec", options.warmUpSec).asInt();
+        options.contentionRows = config.get("bench_contention_rows", options.contentionRows).asInt();
+
+        TakeAwayPlatform::DBConfig target = TakeAwayPlatform::load_db_config(config, config);
+        if (!backend.empty()) {
+            target.backend = backend;
+        }
+
+        bool ok = true;
+        Json::Value report(Json::arrayValue);
+        for (auto strategy : {TakeAwayPlatform::ContentionStrategy::LOCKING, TakeAwayPlatform::ContentionStrategy::CAS}) {
+            TakeAwayPlatform::DbBenchResult result = TakeAwayPlatform::run_contention_benchmark(target, strategy, options);
+            if (!result.ok) {
+                std::cerr << "Contention benchmark " << result.strategy << ": cannot connect or prepare table" << std::endl;
+            }
+            ok = ok && result.ok && result.lostUpdates == 0;
+            report.append(result.toJson());
+        }
+
+        std::cout << report.toStyledString() << std::endl;
+        return ok ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Contention benchmark error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// 传输层基准：依次在本机 TCP 回环和 Unix 域套接字上压测同一个最小路由，输出两者的吞吐与延迟
+int run_uds_bench() {
+    try 
+    {
+        Json::Value config = TakeAwayPlatform::load_config(CONFIG_PATH);
+
+        TakeAwayPlatform::TransportBenchOptions options;
+        options.threads = config["database"].get("bench_threads", options.threads).asInt();
+        options.durationSec = config["database"].get("bench_duration_sec", options.durationSec).asInt();
+        options.warmUpSec = config["database"].get("bench_warm_up_sec", options.warmUpSec).asInt();
+        // 不使用 server.unix_socket，避免删除正在运行的服务的套接字文件
+        options.socketPath = config["server"].get("bench_unix_socket", options.socketPath).asString();
+
+        bool ok = true;
+        Json::Value report(Json::arrayValue);
+        for (bool unixSocket : {false, true}) {
+            TakeAwayPlatform::TransportBenchResult result = TakeAwayPlatform::run_transport_benchmark(unixSocket, options);
+            if (!result.ok) {
+                std::cerr << "Transport benchmark " << result.transport << ": cannot listen" << std::endl;
+            }
+            ok = ok && result.ok && result.errors == 0;
+            report.append(result.toJson());
+        }
+
+        std::cout << report.toStyledString() << std::endl;
+        return ok ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Transport benchmark error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int main(int argc, char* argv[]) {
     std::cout << "Entry main.." << std::endl;
     std::cout.flush();
 
+    // --hot-restart: 从正在运行的旧进程接管监听套接字，实现零停机发布
+    // --migrate: 执行未应用的 schema 迁移后退出
+    // --check-explain: 检查查询模板的执行计划，存在全表扫描时以非 0 状态退出
+    // --db-bench[=后端,...]: 对比各后端执行查询组合的吞吐和延迟，默认对比 X 协议与经典协议
+    // --db-contention[=后端]: 对比热点行上加锁事务与版本号条件更新的吞吐、延迟和重试次数
+    // --db-decode-bench[=后端]: 对比 parse_result 与 query_as 解码大结果集的耗时
+    // --uds-bench: 对比本机 TCP 回环与 Unix 域套接字上 HTTP 请求的吞吐和延迟
+    bool hotRestart = false;
+    bool migrate = false;
+    bool checkExplain = false;
+    std::string benchBackends;
+    bool contention = false;
+    std::string contentionBackend;
+    bool decodeBench = false;
+    std::string decodeBackend;
+    bool udsBench = false;
+    for (int index = 1; index < argc; ++index) {
+        if (std::strcmp(argv[index], "--hot-restart") == 0) {
+            hotRestart = true;
+        } else if (std::strcmp(argv[index], "--migrate") == 0) {
+            migrate = true;
+        } else if (std::strcmp(argv[index], "--check-explain") == 0) {
+            checkExplain = true;
+        } else if (std::strcmp(argv[index], "--db-bench") == 0) {
+            benchBackends = "mysql,mysql_classic";
+        } else if (std::strncmp(argv[index], "--db-bench=", 11) == 0) {
+            benchBackends = argv[index] + 11;
+        } else if (std::strcmp(argv[index], "--db-contention") == 0) {
+            contention = true;
+        } else if (std::strncmp(argv[index], "--db-contention=", 16) == 0) {
+            contention = true;
+            contentionBackend = argv[index] + 16;
+        } else if (std::strcmp(argv[index], "--db-decode-bench") == 0) {
+            decodeBench = true;
+        } else if (std::strncmp(argv[index], "--db-decode-bench=", 18) == 0) {
+            decodeBench = true;
+            decodeBackend = argv[index] + 18;
+        } else if (std::strcmp(argv[index], "--uds-bench") == 0) {
+            udsBench = true;
+        }
+    }
+
+    if (!benchBackends.empty()) {
+        return run_db_bench(benchBackends);
+    }
+
+    if (contention) {
+        return run_contention_bench(contentionBackend);
+    }
+
+    if (decodeBench) {
+        return run_decode_bench(decodeBackend);
+    }
+
+    if (udsBench) {
+        return run_uds_bench();
+    }
+
+    if (migrate || checkExplain) {
+        return run_db_tool(migrate, checkExplain);
+    }
+
     // 设置信号处理
     struct sigaction sa;
     sa.sa_handler = signal_handler;
@@ -37,44 +332,65 @@ int main() {
 
     try 
     {
-        TakeAwayPlatform::RestServer restSrv("/opt/TakeAwayPlatform/config/config.json");
-        std::cout << "Starting server on port 9090..." << std::endl;
+        // server.workers > 0 时进入 prefork 模式：master 绑定端口并监督 N 个 worker 进程
+        Json::Value serverConfig = TakeAwayPlatform::load_config(CONFIG_PATH)["server"];
+        int workerCount = serverConfig.get("workers", 0).asInt();
+        if (workerCount > 0) {
+            // 会话表在 fork 之前创建，所有 worker 共享，登录后的令牌在任意 worker 上都有效
+            auto* sessionTable = TakeAwayPlatform::SharedSessionTable::create(
+                serverConfig.get("session_capacity", 65536).asUInt());
+            if (!sessionTable) {
+                return 1;
+            }
+            TakeAwayPlatform::g_userSession.attachSharedTable(sessionTable);
+
+            Json::Value databaseConfig = TakeAwayPlatform::load_config(CONFIG_PATH)["database"];
+
+            // 写后读主库的固定期记录在各 worker 进程内，其他 worker 上的读请求仍会走从库
+            bool hasReplicas = !databaseConfig["replicas"].empty();
+            for (const auto& shard : databaseConfig["shards"]) {
+                hasReplicas = hasReplicas || !shard["replicas"].empty();
+            }
+            if (hasReplicas && databaseConfig.get("read_pin_sec", 5).asInt() > 0) {
+                std::cerr << "Warning: read_pin_sec only holds within one worker; with workers > 0 a user may "
+                          << "read stale replica data right after a write handled by another worker" << std::endl;
+            }
+
+            // 热点库存计数器同样在 fork 之前创建：各 worker 各自载入库存会把同一份库存各卖一遍
+            const size_t hotDishes = databaseConfig["stock_hot_dishes"].size() +
+                                     std::max(databaseConfig.get("stock_hot_top_n", 0).asInt(), 0);
+            if (hotDishes > 0) {
+                sharedStock = TakeAwayPlatform::SharedStockTable::create(hotDishes * SHARED_STOCK_SLOTS_PER_DISH);
+                if (!sharedStock) {
+                    return 1;
+                }
+            }
+
+            TakeAwayPlatform::PreforkMaster master(workerCount, SERVER_PORT,
+                                                   serverConfig.get("drain_timeout", 10).asInt() + 5);
+            return master.run(run_worker, running);
+        }
+
+        TakeAwayPlatform::RestServer restSrv(CONFIG_PATH);
+        std::cout << "Starting server on port " << SERVER_PORT << "..." << std::endl;
         std::cout.flush();
         
         // 启动服务器（分离线程）
-        restSrv.start(9090);
+        restSrv.start(SERVER_PORT, hotRestart);
         
-        // 使用条件变量等待信号，避免忙等待
-        {
-            std::unique_lock<std::mutex> lock(mtx);
-            cv.wait(lock, [&]{
-                return !running || !restSrv.is_running();
-            });
-        }
+        wait_for_shutdown(restSrv);
         
         // 检测服务器是否意外停止
-        if (!restSrv.is_running()) {
+        if (!restSrv.is_running() && !restSrv.is_handed_off()) {
             std::cerr << "Server thread has stopped unexpectedly!" << std::endl;
         }
         
-        // 优雅关闭
+        // 优雅关闭：停止 accept，在 drain_timeout 内处理完在途请求和排队任务，最后关闭数据库连接
         std::cout << "Shutting down server..." << std::endl;
         std::cout.flush();
         restSrv.stop();
-        
-        // 等待服务器完全停止（最多10秒）
-        const auto timeout = std::chrono::seconds(10);
-        const auto start = std::chrono::steady_clock::now();
-        
-        while (restSrv.is_running() && 
-               (std::chrono::steady_clock::now() - start) < timeout) 
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-        
-        if (restSrv.is_running()) {
-            std::cerr << "Warning: Server did not stop within timeout" << std::endl;
-        }
+
+        std::cout << "metric server_drain_ms " << restSrv.drain_millis() << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "Server error: " << e.what() << std::endl;
         return 1;
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C), 2025-2030, 华中师范大学计算机学院
+ * FileName: shared_session_table.cpp
+ * Author: sz
+ * Date: 2025-7-20
+ * Description: 多进程共享的会话表实现
+ * History:
+ * <author>   <time>      <version>    <desc>
+ * sz        2025-7-20   1.0          初始文件
+ */
+
+#include "shared_session_table.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include <sys/mman.h>
+
+namespace TakeAwayPlatform
+{
+    // 持有共享互斥锁；上一个持有者（崩溃的 worker）未释放时恢复锁的一致性
+    class SharedSessionTable::Lock
+    {
+    public:
+        explicit Lock(pthread_mutex_t* mutex) : m_mutex(mutex) {
+            if (pthread_mutex_lock(m_mutex) == EOWNERDEAD) {
+                pthread_mutex_consistent(m_mutex);
+            }
+        }
+
+        ~Lock() {
+            pthread_mutex_unlock(m_mutex);
+        }
+
+    private:
+        pthread_mutex_t* m_mutex;
+    };
+
+    SharedSessionTable* SharedSessionTable::create(size_t capacity) {
+        size_t bytes = sizeof(Header) + capacity * sizeof(Slot);
+        void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            std::cerr << "创建共享会话表失败: " << std::strerror(errno) << std::endl;
+            return nullptr;
+        }
+
+        // 匿名映射已清零，所有槽位初始即为 SLOT_EMPTY
+        Header* header = static_cast<Header*>(memory);
+        header->capacity = capacity;
+        header->count = 0;
+        header->tombstones = 0;
+
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&header->mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        // 映射随进程存在，master 和 worker 退出时由内核回收
+        SharedSessionTable* table = new SharedSessionTable();
+        table->m_header = header;
+        return table;
+    }
+
+    SharedSessionTable::Slot* SharedSessionTable::slots() const {
+        return reinterpret_cast<Slot*>(m_header + 1);
+    }
+
+    SharedSessionTable::Slot* SharedSessionTable::find(const std::string& token) const {
+        size_t capacity = m_header->capacity;
+        size_t index = std::hash<std::string>()(token) % capacity;
+
+        for (size_t probe = 0; probe < capacity; ++probe) {
+            Slot& slot = slots()[(index + probe) % capacity];
+            if (slot.state == SLOT_EMPTY) {
+                return nullptr;
+            }
+            if (slot.state == SLOT_USED && token == slot.token) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    void SharedSessionTable::compact() {
+        size_t capacity = m_header->capacity;
+
+        std::vector<Slot> live;
+        live.reserve(m_header->count);
+        for (size_t index = 0; index < capacity; ++index) {
+            if (slots()[index].state == SLOT_USED) {
+                live.push_back(slots()[index]);
+            }
+        }
+
+        std::memset(slots(), 0, capacity * sizeof(Slot));
+        for (const Slot& entry : live) {
+            size_t index = std::hash<std::string>()(entry.token) % capacity;
+            while (slots()[index].state != SLOT_EMPTY) {
+                index = (index + 1) % capacity;
+            }
+            slots()[index] = entry;
+        }
+
+        m_header->count = live.size();
+        m_header->tombstones = 0;
+    }
+
+    bool SharedSessionTable::insert(const std::string& token, int64_t user_id,
+                                    const std::string& username, std::time_t now, int timeout) {
+        if (token.size() > TOKEN_SIZE) {
+            return false;
+        }
+
+        Lock lock(&m_header->mutex);
+
+        size_t capacity = m_header->capacity;
+        if (m_header->tombstones > capacity / 4) {
+            compact();
+        }
+
+        size_t index = std::hash<std::string>()(token) % capacity;
+
+        for (size_t probe = 0; probe < capacity; ++probe) {
+            Slot& slot = slots()[(index + probe) % capacity];
+            if (slot.state == SLOT_USED) {
+                // 过期未清理的会话原地替换，会话数不变
+                if (now - slot.last_access <= timeout) {
+                    continue;
+                }
+            } else {
+                if (slot.state == SLOT_DELETED) {
+                    --m_header->tombstones;
+                }
+                ++m_header->count;
+            }
+
+            slot.state = SLOT_USED;
+            std::strncpy(slot.token, token.c_str(), TOKEN_SIZE);
+            slot.token[TOKEN_SIZE] = '\0';
+            std::strncpy(slot.username, username.c_str(), USERNAME_SIZE);
+            slot.username[USERNAME_SIZE] = '\0';
+            slot.user_id = user_id;
+            slot.created_at = now;
+            slot.last_access = now;
+            return true;
+        }
+
+        std::cerr << "共享会话表已满，容量: " << capacity << std::endl;
+        return false;
+    }
+
+    bool SharedSessionTable::touch(const std::string& token, std::time_t now, int timeout, int64_t& user_id) {
+        Lock lock(&m_header->mutex);
+
+        Slot* slot = find(token);
+        if (!slot) {
+            return false;
+        }
+
+        if (now - slot->last_access > timeout) {
+            slot->state = SLOT_DELETED;
+            --m_header->count;
+            ++m_header->tombstones;
+            return false;
+        }
+
+        slot->last_access = now;
+        user_id = slot->user_id;
+        return true;
+    }
+
+    void SharedSessionTable::erase(const std::string& token) {
+        Lock lock(&m_header->mutex);
+
+        Slot* slot = find(token);
+        if (slot) {
+            slot->state = SLOT_DELETED;
+            --m_header->count;
+            ++m_header->tombstones;
+        }
+    }
+
+    size_t SharedSessionTable::purgeExpired(std::time_t now, int timeout) {
+        Lock lock(&m_header->mutex);
+
+        size_t purged = 0;
+        for (size_t index = 0; index < m_header->capacity; ++index) {
+            Slot& slot = slots()[index];
+            if (slot.state == SLOT_USED && now - slot.last_access > timeout) {
+                slot.state = SLOT_DELETED;
+                ++purged;
+            }
+        }
+
+        m_header->count -= purged;
+        m_header->tombstones += purged;
+        if (m_header->tombstones > 0) {
+            compact();
+        }
+        return purged;
+    }
+
+    size_t SharedSessionTable::size() const {
+        Lock lock(&m_header->mutex);
+        return m_header->count;
+    }
+}
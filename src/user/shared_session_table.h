@@ -0,0 +1,84 @@
+/*
+ * Copyright (C), 2025-2030, 华中师范大学计算机学院
+ * FileName: shared_session_table.h
+ * Author: sz
+ * Date: 2025-7-20
+ * Description: 多进程共享的会话表（prefork 模式下各 worker 共用）
+ * History:
+ * <author>   <time>      <version>    <desc>
+ * sz        2025-7-20   1.0          初始文件
+ */
+
+#pragma once
+
+#include <string>
+#include <ctime>
+#include <cstdint>
+#include <pthread.h>
+
+namespace TakeAwayPlatform
+{
+    // 基于匿名共享内存的定长开放寻址哈希表。
+    // 由 master 在 fork 之前创建，所有 worker 继承同一映射，
+    // 因此无论请求落到哪个 worker，会话令牌都能校验通过
+    class SharedSessionTable
+    {
+    public:
+        static constexpr size_t TOKEN_SIZE = 32;
+        static constexpr size_t USERNAME_SIZE = 50;
+
+        // 创建共享映射，失败返回 nullptr
+        static SharedSessionTable* create(size_t capacity);
+
+        // 探测链上已过期的会话与墓碑一样可以直接复用；只有容量内全是未过期会话时才失败。
+        // 墓碑超过容量的 1/4 时先整理
+        bool insert(const std::string& token, int64_t user_id, const std::string& username,
+                    std::time_t now, int timeout);
+
+        // 校验令牌并刷新最后访问时间，过期的令牌会被删除
+        bool touch(const std::string& token, std::time_t now, int timeout, int64_t& user_id);
+
+        void erase(const std::string& token);
+
+        // 删除过期会话并整理墓碑，返回删除的会话数。由 UserSession::cleanExpiredSessions 周期性调用
+        size_t purgeExpired(std::time_t now, int timeout);
+
+        size_t size() const;
+
+    private:
+        enum SlotState : uint8_t {
+            SLOT_EMPTY = 0,
+            SLOT_USED = 1,
+            SLOT_DELETED = 2     // 墓碑，保证探测链不断
+        };
+
+        struct Slot {
+            uint8_t state;
+            char token[TOKEN_SIZE + 1];
+            char username[USERNAME_SIZE + 1];
+            int64_t user_id;
+            std::time_t created_at;
+            std::time_t last_access;
+        };
+
+        struct Header {
+            pthread_mutex_t mutex;   // PTHREAD_PROCESS_SHARED + ROBUST，worker 崩溃时可恢复
+            size_t capacity;
+            size_t count;
+            size_t tombstones;
+        };
+
+        class Lock;
+
+        SharedSessionTable() = default;
+
+        Slot* slots() const;
+        Slot* find(const std::string& token) const;
+
+        // 重新散列全部未删除的会话，墓碑清零，未命中的探测重新在第一个空槽结束。调用方须持有锁
+        void compact();
+
+    private:
+        Header* m_header = nullptr;
+    };
+}
@@ -18,9 +18,197 @@
 #include <functional>
 #include <chrono>
 #include <stdexcept>
+#include <cstdio>
+#include <algorithm>
 
 namespace TakeAwayPlatform
 {
+    // ==================== SQL 模板 ====================
+    // 所有参数通过 '?' 占位符绑定，模板本身即语句缓存的键
+    namespace
+    {
+        const std::string SQL_SELECT_WALLET =
+            "SELECT wallet_id, user_id, balance, status, created_at "
+            "FROM wallet WHERE user_id = ?";
+
+        const std::string SQL_INSERT_USER =
+            "INSERT INTO applicant (user_name, password, email, phone, role, create_at) "
+            "VALUES (?, ?, ?, ?, 'customer', NOW())";
+
+        const std::string SQL_SELECT_LOGIN =
+            "SELECT user_id, user_name, password, email, phone, role, avatar_url "
+            "FROM applicant WHERE user_name = ?";
+
+        const std::string SQL_SELECT_USER =
+            "SELECT user_id, user_name, email, phone, role, avatar_url, create_at "
+            "FROM applicant WHERE user_id = ?";
+
+        // 历史记录按 (created_at, id) 倒序。OFFSET 分页仅为兼容旧客户端保留，
+        // 游标分页从上一页最后一行之后继续，沿 (user_id, created_at, id) 索引定位，不扫描前面的行
+        const std::string SQL_SELECT_RECHARGE_PAGE =
+            "SELECT recharge_id, user_id, amount, transaction_id, status, paid_at, created_at "
+            "FROM recharge_record WHERE user_id = ? "
+            "ORDER BY created_at DESC, recharge_id DESC "
+            "LIMIT ? OFFSET ?";
+
+        const std::string SQL_SELECT_RECHARGE_AFTER =
+            "SELECT recharge_id, user_id, amount, transaction_id, status, paid_at, created_at "
+            "FROM recharge_record WHERE user_id = ? "
+            "AND (created_at < ? OR (created_at = ? AND recharge_id < ?)) "
+            "ORDER BY created_at DESC, recharge_id DESC "
+            "LIMIT ?";
+
+        const std::string SQL_SELECT_ORDER_PAGE =
+            "SELECT o.order_id, o.order_number, o.merchant_id, o.total_amount, "
+            "o.status, o.created_at, m.shop_name "
+            "FROM orders o "
+            "LEFT JOIN merchants m ON o.merchant_id = m.merchant_id "
+            "WHERE o.user_id = ? "
+            "ORDER BY o.created_at DESC, o.order_id DESC "
+            "LIMIT ? OFFSET ?";
+
+        const std::string SQL_SELECT_ORDER_AFTER =
+            "SELECT o.order_id, o.order_number, o.merchant_id, o.total_amount, "
+            "o.status, o.created_at, m.shop_name "
+            "FROM orders o "
+            "LEFT JOIN merchants m ON o.merchant_id = m.merchant_id "
+            "WHERE o.user_id = ? "
+            "AND (o.created_at < ? OR (o.created_at = ? AND o.order_id < ?)) "
+            "ORDER BY o.created_at DESC, o.order_id DESC "
+            "LIMIT ?";
+
+        // 余额的读改写：不加锁读取余额和版本号，以版本号为条件写回，被并发修改时重读重试
+        const std::string SQL_SELECT_BALANCE_VERSION =
+            "SELECT balance, version FROM wallet WHERE user_id = ?";
+
+        const std::string SQL_CAS_BALANCE =
+            "UPDATE wallet SET balance = CAST(? AS DECIMAL(10,2)), version = version + 1 "
+            "WHERE user_id = ? AND version = ?";
+
+        // 充值不对应订单交易，transaction_id 留空（迁移 0003 改为可空）；recharge_id 自增
+        const std::string SQL_INSERT_RECHARGE =
+            "INSERT INTO recharge_record (user_id, amount, status, paid_at, created_at) "
+            "VALUES (?, ?, 'completed', NOW(), NOW())";
+
+        const std::string SQL_SELECT_BALANCE =
+            "SELECT balance FROM wallet WHERE user_id = ?";
+
+        const std::string SQL_SELECT_PASSWORD =
+            "SELECT password FROM applicant WHERE user_id = ?";
+
+        const std::string SQL_UPDATE_PASSWORD =
+            "UPDATE applicant SET password = ? WHERE user_id = ?";
+
+        // 一次往返检查用户名、邮箱、手机号是否已被占用
+        const std::string SQL_COUNT_CONFLICTS =
+            "SELECT COUNT(CASE WHEN user_name = ? THEN 1 END) AS name_count, "
+            "COUNT(CASE WHEN email = ? THEN 1 END) AS email_count, "
+            "COUNT(CASE WHEN phone = ? THEN 1 END) AS phone_count "
+            "FROM applicant WHERE user_name = ? OR email = ? OR phone = ?";
+
+        const std::string SQL_INSERT_LOG =
+            "INSERT INTO log_records (user_id, action_type, status, created_at) "
+            "VALUES (?, ?, ?, NOW())";
+
+        const std::string SQL_INSERT_WALLET =
+            "INSERT INTO wallet (user_id, balance, status, created_at) "
+            "VALUES (?, 0.00, 'active', NOW())";
+
+        // 数据库 ENUM 文本与枚举之间的转换
+        UserRole userRoleFromName(const std::string& name) {
+            if (name == "admin") return UserRole::ADMIN;
+            if (name == "merchant") return UserRole::MERCHANT;
+            return UserRole::CUSTOMER;
+        }
+
+        const char* userRoleName(UserRole role) {
+            switch (role) {
+                case UserRole::ADMIN: return "admin";
+                case UserRole::MERCHANT: return "merchant";
+                default: return "customer";
+            }
+        }
+
+        WalletStatus walletStatusFromName(const std::string& name) {
+            if (name == "frozen") return WalletStatus::FROZEN;
+            if (name == "closed") return WalletStatus::CLOSED;
+            return WalletStatus::ACTIVE;
+        }
+
+        const char* walletStatusName(WalletStatus status) {
+            switch (status) {
+                case WalletStatus::FROZEN: return "frozen";
+                case WalletStatus::CLOSED: return "closed";
+                default: return "active";
+            }
+        }
+
+        // 时间点格式化为 "YYYY-MM-DD HH:MM:SS"，未取到值时返回空串
+        std::string formatDateTime(DateTime dateTime) {
+            if (dateTime == DateTime()) {
+                return "";
+            }
+
+            std::time_t time = std::chrono::system_clock::to_time_t(dateTime);
+            std::tm local {};
+            localtime_r(&time, &local);
+            char buffer[20];
+            std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+            return buffer;
+        }
+
+        // 分页游标：上一页最后一行的 (created_at, id)，以十六进制编码，客户端原样回传即可
+        struct PageCursor {
+            std::time_t createdAt;
+            int64_t id;
+        };
+
+        std::string encodeCursor(DateTime createdAt, int64_t id) {
+            std::string payload = std::to_string(std::chrono::system_clock::to_time_t(createdAt))
+                                + ":" + std::to_string(id);
+
+            std::ostringstream out;
+            out << std::hex << std::setfill('0');
+            for (unsigned char ch : payload) {
+                out << std::setw(2) << static_cast<int>(ch);
+            }
+            return out.str();
+        }
+
+        bool decodeCursor(const std::string& cursor, PageCursor& out) {
+            if (cursor.empty() || cursor.size() % 2 != 0 || cursor.size() > 64) {
+                return false;
+            }
+
+            std::string payload;
+            for (size_t index = 0; index < cursor.size(); index += 2) {
+                char* end = nullptr;
+                std::string byte = cursor.substr(index, 2);
+                long value = std::strtol(byte.c_str(), &end, 16);
+                if (*end != '\0') {
+                    return false;
+                }
+                payload.push_back(static_cast<char>(value));
+            }
+
+            long long createdAt = 0;
+            long long id = 0;
+            char tail = 0;
+            if (std::sscanf(payload.c_str(), "%lld:%lld%c", &createdAt, &id, &tail) != 2 || createdAt <= 0) {
+                return false;
+            }
+
+            out.createdAt = static_cast<std::time_t>(createdAt);
+            out.id = id;
+            return true;
+        }
+
+        // 游标处的时间按本地时间文本绑定，与 DATETIME 列的解码方式一致
+        std::string cursorTime(const PageCursor& cursor) {
+            return formatDateTime(std::chrono::system_clock::from_time_t(cursor.createdAt));
+        }
+    }
+
     // 全局会话管理器实例
     UserSession g_userSession;
 
@@ -33,7 +221,7 @@ namespace TakeAwayPlatform
         json["phone"] = phone;
         json["role"] = static_cast<int>(role);
         json["avatar_url"] = avatar_url;
-        json["create_at"] = static_cast<int64_t>(create_at);
+        json["create_at"] = static_cast<int64_t>(std::chrono::system_clock::to_time_t(create_at));
         return json;
     }
 
@@ -45,7 +233,7 @@ namespace TakeAwayPlatform
         user.phone = json.get("phone", "").asString();
         user.role = static_cast<UserRole>(json.get("role", 0).asInt());
         user.avatar_url = json.get("avatar_url", "").asString();
-        user.create_at = static_cast<std::time_t>(json.get("create_at", 0).asInt64());
+        user.create_at = std::chrono::system_clock::from_time_t(json.get("create_at", 0).asInt64());
         return user;
     }
 
@@ -54,9 +242,9 @@ namespace TakeAwayPlatform
         Json::Value json;
         json["wallet_id"] = wallet_id;
         json["user_id"] = static_cast<int64_t>(user_id);
-        json["balance"] = balance;
+        json["balance"] = balance.toYuan();
         json["status"] = static_cast<int>(status);
-        json["created_at"] = static_cast<int64_t>(created_at);
+        json["created_at"] = static_cast<int64_t>(std::chrono::system_clock::to_time_t(created_at));
         return json;
     }
 
@@ -64,9 +252,9 @@ namespace TakeAwayPlatform
         WalletInfo wallet;
         wallet.wallet_id = json.get("wallet_id", 0).asInt();
         wallet.user_id = json.get("user_id", 0).asInt64();
-        wallet.balance = json.get("balance", 0.0).asDouble();
+        wallet.balance = Money::fromYuan(json.get("balance", 0.0).asDouble());
         wallet.status = static_cast<WalletStatus>(json.get("status", 0).asInt());
-        wallet.created_at = static_cast<std::time_t>(json.get("created_at", 0).asInt64());
+        wallet.created_at = std::chrono::system_clock::from_time_t(json.get("created_at", 0).asInt64());
         return wallet;
     }
 
@@ -75,11 +263,11 @@ namespace TakeAwayPlatform
         Json::Value json;
         json["recharge_id"] = recharge_id;
         json["user_id"] = static_cast<int64_t>(user_id);
-        json["amount"] = amount;
+        json["amount"] = amount.toYuan();
         json["transaction_id"] = transaction_id;
         json["status"] = status;
-        json["paid_at"] = static_cast<int64_t>(paid_at);
-        json["created_at"] = static_cast<int64_t>(created_at);
+        json["paid_at"] = static_cast<int64_t>(std::chrono::system_clock::to_time_t(paid_at));
+        json["created_at"] = static_cast<int64_t>(std::chrono::system_clock::to_time_t(created_at));
         return json;
     }
 
@@ -87,37 +275,164 @@ namespace TakeAwayPlatform
         RechargeRecord record;
         record.recharge_id = json.get("recharge_id", 0).asInt();
         record.user_id = json.get("user_id", 0).asInt64();
-        record.amount = json.get("amount", 0.0).asDouble();
+        record.amount = Money::fromYuan(json.get("amount", 0.0).asDouble());
         record.transaction_id = json.get("transaction_id", 0).asInt();
         record.status = json.get("status", "").asString();
-        record.paid_at = static_cast<std::time_t>(json.get("paid_at", 0).asInt64());
-        record.created_at = static_cast<std::time_t>(json.get("created_at", 0).asInt64());
+        record.paid_at = std::chrono::system_clock::from_time_t(json.get("paid_at", 0).asInt64());
+        record.created_at = std::chrono::system_clock::from_time_t(json.get("created_at", 0).asInt64());
+        return record;
+    }
+
+    // ==================== 结果集解码 ====================
+    UserInfo::Columns::Columns(const ColumnIndex& index)
+        : user_id(index["user_id"]), user_name(index["user_name"]), email(index["email"]),
+          phone(index["phone"]), role(index["role"]), avatar_url(index["avatar_url"]),
+          create_at(index["create_at"]) {
+    }
+
+    UserInfo UserInfo::fromRow(const mysqlx::Row& row, const Columns& columns) {
+        UserInfo user {};
+        std::string role;
+        RowField::read(row, columns.user_id, user.user_id);
+        RowField::read(row, columns.user_name, user.user_name);
+        RowField::read(row, columns.email, user.email);
+        RowField::read(row, columns.phone, user.phone);
+        RowField::read(row, columns.avatar_url, user.avatar_url);
+        RowField::read(row, columns.create_at, user.create_at);
+        if (RowField::read(row, columns.role, role)) {
+            user.role = userRoleFromName(role);
+        }
+        return user;
+    }
+
+    WalletInfo::Columns::Columns(const ColumnIndex& index)
+        : wallet_id(index["wallet_id"]), user_id(index["user_id"]), balance(index["balance"]),
+          status(index["status"]), created_at(index["created_at"]) {
+    }
+
+    WalletInfo WalletInfo::fromRow(const mysqlx::Row& row, const Columns& columns) {
+        WalletInfo wallet {};
+        std::string status;
+        RowField::read(row, columns.wallet_id, wallet.wallet_id);
+        RowField::read(row, columns.user_id, wallet.user_id);
+        RowField::read(row, columns.balance, wallet.balance);
+        RowField::read(row, columns.created_at, wallet.created_at);
+        if (RowField::read(row, columns.status, status)) {
+            wallet.status = walletStatusFromName(status);
+        }
+        return wallet;
+    }
+
+    RechargeRecord::Columns::Columns(const ColumnIndex& index)
+        : recharge_id(index["recharge_id"]), user_id(index["user_id"]), amount(index["amount"]),
+          transaction_id(index["transaction_id"]), status(index["status"]),
+          paid_at(index["paid_at"]), created_at(index["created_at"]) {
+    }
+
+    RechargeRecord RechargeRecord::fromRow(const mysqlx::Row& row, const Columns& columns) {
+        RechargeRecord record {};
+        RowField::read(row, columns.recharge_id, record.recharge_id);
+        RowField::read(row, columns.user_id, record.user_id);
+        RowField::read(row, columns.amount, record.amount);
+        RowField::read(row, columns.transaction_id, record.transaction_id);
+        RowField::read(row, columns.status, record.status);
+        RowField::read(row, columns.paid_at, record.paid_at);
+        RowField::read(row, columns.created_at, record.created_at);
         return record;
     }
 
+    // ==================== OrderSummary 实现 ====================
+    Json::Value OrderSummary::toJson() const {
+        Json::Value json;
+        json["order_id"] = order_id;
+        json["order_number"] = order_number;
+        json["merchant_id"] = static_cast<int64_t>(merchant_id);
+        json["shop_name"] = shop_name;
+        json["total_amount"] = total_amount.toYuan();
+        json["status"] = status;
+        json["created_at"] = formatDateTime(created_at);
+        return json;
+    }
+
+    OrderSummary::Columns::Columns(const ColumnIndex& index)
+        : order_id(index["order_id"]), order_number(index["order_number"]),
+          merchant_id(index["merchant_id"]), shop_name(index["shop_name"]),
+          total_amount(index["total_amount"]), status(index["status"]),
+          created_at(index["created_at"]) {
+    }
+
+    OrderSummary OrderSummary::fromRow(const mysqlx::Row& row, const Columns& columns) {
+        OrderSummary order {};
+        RowField::read(row, columns.order_id, order.order_id);
+        RowField::read(row, columns.order_number, order.order_number);
+        RowField::read(row, columns.merchant_id, order.merchant_id);
+        RowField::read(row, columns.shop_name, order.shop_name);
+        RowField::read(row, columns.total_amount, order.total_amount);
+        RowField::read(row, columns.status, order.status);
+        RowField::read(row, columns.created_at, order.created_at);
+        return order;
+    }
+
     // ==================== UserManager 实现 ====================
-    UserManager::UserManager(std::unique_ptr<DatabaseHandler> dbHandler) 
-        : m_dbHandler(std::move(dbHandler)) {
+    std::vector<QueryTemplate> UserManager::queryTemplates() {
+        // 只列出读和按条件更新的语句，INSERT 没有扫描路径
+        const int64_t userId = 1000;
+        const std::string createdAt = "2025-01-01 00:00:00";
+        return {
+            {"SQL_SELECT_WALLET", SQL_SELECT_WALLET, {userId}},
+            {"SQL_SELECT_LOGIN", SQL_SELECT_LOGIN, {"user"}},
+            {"SQL_SELECT_USER", SQL_SELECT_USER, {userId}},
+            {"SQL_SELECT_RECHARGE_PAGE", SQL_SELECT_RECHARGE_PAGE, {userId, 11, 0}},
+            {"SQL_SELECT_RECHARGE_AFTER", SQL_SELECT_RECHARGE_AFTER, {userId, createdAt, createdAt, 1, 11}},
+            {"SQL_SELECT_ORDER_PAGE", SQL_SELECT_ORDER_PAGE, {userId, 11, 0}},
+            {"SQL_SELECT_ORDER_AFTER", SQL_SELECT_ORDER_AFTER, {userId, createdAt, createdAt, 1, 11}},
+            {"SQL_SELECT_BALANCE_VERSION", SQL_SELECT_BALANCE_VERSION, {userId}},
+            {"SQL_CAS_BALANCE", SQL_CAS_BALANCE, {"0.00", userId, 0}},
+            {"SQL_SELECT_BALANCE", SQL_SELECT_BALANCE, {userId}},
+            {"SQL_SELECT_PASSWORD", SQL_SELECT_PASSWORD, {userId}},
+            {"SQL_UPDATE_PASSWORD", SQL_UPDATE_PASSWORD, {"", userId}},
+            {"SQL_COUNT_CONFLICTS", SQL_COUNT_CONFLICTS, {"user", "mail", "phone", "user", "mail", "phone"}},
+        };
+    }
+
+    UserManager::UserManager(DBLease dbHandler, ShardLeaseProvider shardLeases, LogAppender* logAppender) 
+        : m_dbHandler(std::move(dbHandler)), m_shardLeases(std::move(shardLeases)), m_logAppender(logAppender) {
+    }
+
+    DatabaseHandler& UserManager::shardDb(int64_t user_id, bool write) {
+        if (!m_shardLeases) {
+            return *m_dbHandler;
+        }
+
+        // 同一用户的连接复用；已持有的主库连接也能满足读请求，保证事务内读到本事务的写入
+        bool reusable = m_shardHandler && m_shardUserId == user_id && (m_shardWrite || !write);
+        if (!reusable) {
+            DBLease lease = m_shardLeases(user_id, write);
+            if (!lease) {
+                return *m_dbHandler;
+            }
+
+            m_shardHandler = std::move(lease);
+            m_shardUserId = user_id;
+            m_shardWrite = write;
+        }
+        return *m_shardHandler;
     }
 
     Json::Value UserManager::getWalletInfo(int64_t user_id) {
         try {
-            std::string sql = "SELECT wallet_id, user_id, balance, status, created_at "
-                             "FROM wallet WHERE user_id = " + std::to_string(user_id);
-            
-            auto result = m_dbHandler->query(sql);
-            
-            if (result.empty()) {
+            std::vector<WalletInfo> wallets;
+            if (!shardDb(user_id, false).query_as(SQL_SELECT_WALLET, {user_id}, wallets) || wallets.empty()) {
                 return createResponse(false, "钱包不存在");
             }
 
-            const auto& walletRow = result[0];
+            const WalletInfo& wallet = wallets.front();
             Json::Value walletData;
-            walletData["wallet_id"] = static_cast<int>(std::stoi(walletRow["wallet_id"].asString()));
-            walletData["user_id"] = static_cast<int64_t>(std::stoll(walletRow["user_id"].asString()));
-            walletData["balance"] = std::stod(walletRow["balance"].asString());
-            walletData["status"] = walletRow["status"].asString();
-            walletData["created_at"] = walletRow["created_at"].asString();
+            walletData["wallet_id"] = wallet.wallet_id;
+            walletData["user_id"] = static_cast<int64_t>(wallet.user_id);
+            walletData["balance"] = wallet.balance.toYuan();
+            walletData["status"] = walletStatusName(wallet.status);
+            walletData["created_at"] = formatDateTime(wallet.created_at);
 
             return createResponse(true, "获取钱包信息成功", walletData);
 
@@ -143,48 +458,62 @@ namespace TakeAwayPlatform
             }
 
             // 检查用户名、邮箱、手机号是否已存在
-            if (userExists(username)) {
+            auto conflicts = m_dbHandler->query(SQL_COUNT_CONFLICTS,
+                                                {username, email, phone, username, email, phone});
+            if (conflicts.empty()) {
+                return createResponse(false, "注册失败：数据库错误");
+            }
+
+            if (conflicts[0]["name_count"].asInt64() > 0) {
                 return createResponse(false, "用户名已存在");
             }
 
-            if (emailExists(email)) {
+            if (conflicts[0]["email_count"].asInt64() > 0) {
                 return createResponse(false, "邮箱已被注册");
             }
 
-            if (phoneExists(phone)) {
+            if (conflicts[0]["phone_count"].asInt64() > 0) {
                 return createResponse(false, "手机号已被注册");
             }
 
             // 密码加密
             std::string hashedPassword = hashPassword(password);
 
-            // 插入用户数据到applicant表
-            std::string insertUserSql = 
-                "INSERT INTO applicant (user_name, password, email, phone, role, create_at) "
-                "VALUES ('" + username + "', '" + hashedPassword + "', '" + email + "', '"
-                + phone + "', 'customer', NOW())";
+            // 用户和钱包在同一事务中写入，一次提交
+            TransactionScope transaction(*m_dbHandler);
+            if (!transaction) {
+                return createResponse(false, "注册失败：数据库错误");
+            }
 
-            auto insertResult = m_dbHandler->query(insertUserSql);
-            if (insertResult.empty()) {
+            // 插入用户数据到applicant表
+            if (m_dbHandler->execute(SQL_INSERT_USER, {username, hashedPassword, email, phone}) <= 0) {
                 return createResponse(false, "注册失败：数据库错误");
             }
 
             // 获取插入的用户ID
-            std::string getUserIdSql = "SELECT LAST_INSERT_ID() as user_id";
-            auto result = m_dbHandler->query(getUserIdSql);
-            
-            if (result.empty()) {
+            int64_t userId = static_cast<int64_t>(m_dbHandler->last_insert_id());
+            if (userId == 0) {
                 return createResponse(false, "注册失败：无法获取用户ID");
             }
 
-            int64_t userId = std::stoll(result[0]["user_id"].asString());
-
             // 为新用户创建钱包
-            if (!createWalletForUser(userId)) {
-                return createResponse(false, "注册失败：钱包创建失败");
+            DatabaseHandler& walletDb = shardDb(userId, true);
+            if (&walletDb == &*m_dbHandler) {
+                if (m_dbHandler->execute(SQL_INSERT_WALLET, {userId}) <= 0) {
+                    return createResponse(false, "注册失败：钱包创建失败");
+                }
+            } else {
+                // 钱包在用户所在分片上，先于全局事务单独提交；
+                // 全局事务随后失败时留下的钱包不会被引用，重新注册会分配新的 user_id
+                if (walletDb.execute(SQL_INSERT_WALLET, {userId}) <= 0) {
+                    return createResponse(false, "注册失败：钱包创建失败");
+                }
+            }
+
+            if (!transaction.commit()) {
+                return createResponse(false, "注册失败：数据库错误");
             }
 
-            // 记录注册日志
             recordLoginAction(userId, "register", "success");
 
             // 构造返回数据
@@ -205,10 +534,7 @@ namespace TakeAwayPlatform
     Json::Value UserManager::loginUser(const std::string& username, const std::string& password) {
         try {
             // 查询用户信息
-            std::string sql = "SELECT user_id, user_name, password, email, phone, role, avatar_url "
-                             "FROM applicant WHERE user_name = '" + username + "'";
-            
-            auto result = m_dbHandler->query(sql);
+            auto result = m_dbHandler->query(SQL_SELECT_LOGIN, {username});
             
             if (result.empty()) {
                 recordLoginAction(0, "login", "failed");
@@ -252,24 +578,20 @@ namespace TakeAwayPlatform
 
     Json::Value UserManager::getUserInfo(int64_t user_id) {
         try {
-            std::string sql = "SELECT user_id, user_name, email, phone, role, avatar_url, create_at "
-                             "FROM applicant WHERE user_id = " + std::to_string(user_id);
-            
-            auto result = m_dbHandler->query(sql);
-            
-            if (result.empty()) {
+            std::vector<UserInfo> users;
+            if (!m_dbHandler->query_as(SQL_SELECT_USER, {user_id}, users) || users.empty()) {
                 return createResponse(false, "用户不存在");
             }
 
-            const auto& userRow = result[0];
+            const UserInfo& user = users.front();
             Json::Value userData;
-            userData["user_id"] = static_cast<int64_t>(std::stoll(userRow["user_id"].asString()));
-            userData["user_name"] = userRow["user_name"].asString();
-            userData["email"] = userRow["email"].asString();
-            userData["phone"] = userRow["phone"].asString();
-            userData["role"] = userRow["role"].asString();
-            userData["avatar_url"] = userRow["avatar_url"].asString();
-            userData["create_at"] = userRow["create_at"].asString();
+            userData["user_id"] = static_cast<int64_t>(user.user_id);
+            userData["user_name"] = user.user_name;
+            userData["email"] = user.email;
+            userData["phone"] = user.phone;
+            userData["role"] = userRoleName(user.role);
+            userData["avatar_url"] = user.avatar_url;
+            userData["create_at"] = formatDateTime(user.create_at);
 
             return createResponse(true, "获取用户信息成功", userData);
 
@@ -278,34 +600,56 @@ namespace TakeAwayPlatform
         }
     }
 
-    Json::Value UserManager::getRechargeHistory(int64_t user_id, int page, int pageSize) {
+    Json::Value UserManager::getRechargeHistory(int64_t user_id, int page, int pageSize, const std::string& cursor) {
         try {
-            int offset = (page - 1) * pageSize;
-            
-            std::string sql = "SELECT recharge_id, user_id, amount, transaction_id, status, paid_at, created_at "
-                             "FROM recharge_record WHERE user_id = " + std::to_string(user_id) + " "
-                             "ORDER BY created_at DESC "
-                             "LIMIT " + std::to_string(pageSize) + " OFFSET " + std::to_string(offset);
-            
-            auto result = m_dbHandler->query(sql);
+            page = std::max(page, 1);
+            pageSize = std::max(pageSize, 1);
+
+            // 多取一行判断是否还有下一页
+            std::vector<RechargeRecord> result;
+            bool ok = false;
+            if (!cursor.empty()) {
+                PageCursor after;
+                if (!decodeCursor(cursor, after)) {
+                    return createResponse(false, "获取充值历史失败：无效的分页游标");
+                }
+                const std::string afterTime = cursorTime(after);
+                ok = shardDb(user_id, false).query_as(SQL_SELECT_RECHARGE_AFTER,
+                    {user_id, afterTime, afterTime, after.id, pageSize + 1}, result);
+            } else {
+                int offset = (page - 1) * pageSize;
+                ok = shardDb(user_id, false).query_as(SQL_SELECT_RECHARGE_PAGE, {user_id, pageSize + 1, offset}, result);
+            }
+
+            if (!ok) {
+                return createResponse(false, "获取充值历史失败：数据库错误");
+            }
+
+            const bool hasMore = result.size() > static_cast<size_t>(pageSize);
+            if (hasMore) {
+                result.resize(pageSize);
+            }
             
             Json::Value records(Json::arrayValue);
             for (const auto& row : result) {
                 Json::Value record;
-                record["recharge_id"] = static_cast<int>(std::stoi(row["recharge_id"].asString()));
-                record["user_id"] = static_cast<int64_t>(std::stoll(row["user_id"].asString()));
-                record["amount"] = std::stod(row["amount"].asString());
-                record["transaction_id"] = static_cast<int>(std::stoi(row["transaction_id"].asString()));
-                record["status"] = row["status"].asString();
-                record["paid_at"] = row["paid_at"].asString();
-                record["created_at"] = row["created_at"].asString();
+                record["recharge_id"] = row.recharge_id;
+                record["user_id"] = static_cast<int64_t>(row.user_id);
+                record["amount"] = row.amount.toYuan();
+                record["transaction_id"] = row.transaction_id;
+                record["status"] = row.status;
+                record["paid_at"] = formatDateTime(row.paid_at);
+                record["created_at"] = formatDateTime(row.created_at);
                 records.append(record);
             }
 
             Json::Value resultData;
             resultData["records"] = records;
-            resultData["page"] = page;
             resultData["page_size"] = pageSize;
+            resultData["next_cursor"] = hasMore ? encodeCursor(result.back().created_at, result.back().recharge_id) : "";
+            if (cursor.empty()) {
+                resultData["page"] = page;
+            }
 
             return createResponse(true, "获取充值历史成功", resultData);
 
@@ -314,37 +658,48 @@ namespace TakeAwayPlatform
         }
     }
 
-    Json::Value UserManager::getOrderHistory(int64_t user_id, int page, int pageSize) {
+    Json::Value UserManager::getOrderHistory(int64_t user_id, int page, int pageSize, const std::string& cursor) {
         try {
-            int offset = (page - 1) * pageSize;
-            
-            std::string sql = "SELECT o.order_id, o.order_number, o.merchant_id, o.total_amount, "
-                             "o.status, o.created_at, m.shop_name "
-                             "FROM orders o "
-                             "LEFT JOIN merchants m ON o.merchant_id = m.merchant_id "
-                             "WHERE o.user_id = " + std::to_string(user_id) + " "
-                             "ORDER BY o.created_at DESC "
-                             "LIMIT " + std::to_string(pageSize) + " OFFSET " + std::to_string(offset);
-            
-            auto result = m_dbHandler->query(sql);
+            page = std::max(page, 1);
+            pageSize = std::max(pageSize, 1);
+
+            // 多取一行判断是否还有下一页
+            std::vector<OrderSummary> result;
+            bool ok = false;
+            if (!cursor.empty()) {
+                PageCursor after;
+                if (!decodeCursor(cursor, after)) {
+                    return createResponse(false, "获取订单历史失败：无效的分页游标");
+                }
+                const std::string afterTime = cursorTime(after);
+                ok = shardDb(user_id, false).query_as(SQL_SELECT_ORDER_AFTER,
+                    {user_id, afterTime, afterTime, after.id, pageSize + 1}, result);
+            } else {
+                int offset = (page - 1) * pageSize;
+                ok = shardDb(user_id, false).query_as(SQL_SELECT_ORDER_PAGE, {user_id, pageSize + 1, offset}, result);
+            }
+
+            if (!ok) {
+                return createResponse(false, "获取订单历史失败：数据库错误");
+            }
+
+            const bool hasMore = result.size() > static_cast<size_t>(pageSize);
+            if (hasMore) {
+                result.resize(pageSize);
+            }
             
             Json::Value orders(Json::arrayValue);
-            for (const auto& row : result) {
-                Json::Value order;
-                order["order_id"] = static_cast<int>(std::stoi(row["order_id"].asString()));
-                order["order_number"] = row["order_number"].asString();
-                order["merchant_id"] = static_cast<int64_t>(std::stoll(row["merchant_id"].asString()));
-                order["shop_name"] = row["shop_name"].asString();
-                order["total_amount"] = std::stod(row["total_amount"].asString());
-                order["status"] = row["status"].asString();
-                order["created_at"] = row["created_at"].asString();
-                orders.append(order);
+            for (const auto& order : result) {
+                orders.append(order.toJson());
             }
 
             Json::Value resultData;
             resultData["orders"] = orders;
-            resultData["page"] = page;
             resultData["page_size"] = pageSize;
+            resultData["next_cursor"] = hasMore ? encodeCursor(result.back().created_at, result.back().order_id) : "";
+            if (cursor.empty()) {
+                resultData["page"] = page;
+            }
 
             return createResponse(true, "获取订单历史成功", resultData);
 
@@ -364,30 +719,50 @@ namespace TakeAwayPlatform
         }
     }
 
-    Json::Value UserManager::rechargeBalance(int64_t user_id, double amount) {
+    Json::Value UserManager::rechargeBalance(int64_t user_id, Money amount) {
         try {
-            if (amount <= 0) {
+            if (!amount.isPositive()) {
                 return createResponse(false, "充值金额必须大于0");
             }
 
-            // 更新钱包余额
-            std::string updateSql = "UPDATE wallet SET balance = balance + " + std::to_string(amount) +
-                                   " WHERE user_id = " + std::to_string(user_id);
-            
-            auto updateResult = m_dbHandler->query(updateSql);
-            if (updateResult.empty()) {
+            // 充值记录与余额在同一个短事务中写入：条件更新放在最后，行锁只持有到提交，
+            // 读取余额和计算新余额都在事务之外。金额以十进制文本绑定，不经过浮点
+            // 充值记录与条件更新同在一个事务：版本冲突时一起回滚，重试时重新插入，不会留下重复记录；
+            // 插入依赖迁移 0003（recharge_id 自增、transaction_id 可空），启动时已检查迁移全部应用。
+            // 充值记录为简化版，实际应该配合支付系统
+            DatabaseHandler& walletDb = shardDb(user_id, true);
+            const std::string amountText = amount.toString();
+            Money newBalance;
+            CasResult result = walletDb.compare_and_swap(SQL_SELECT_BALANCE_VERSION, {user_id},
+                [&](const Json::Value& wallet, std::vector<BatchStatement>& writes) {
+                    // balance 可为 NULL，视为 0
+                    Money balance;
+                    Money::parse(wallet["balance"].asString(), balance);
+                    balance += amount;
+                    newBalance = balance;
+
+                    writes.push_back({SQL_INSERT_RECHARGE, {user_id, amountText}});
+                    writes.push_back({SQL_CAS_BALANCE, {balance.toString(), user_id, wallet["version"].asInt64()}});
+                    return true;
+                });
+
+            if (result == CasResult::NOT_FOUND) {
+                return createResponse(false, "充值失败：钱包不存在");
+            }
+            if (result == CasResult::CONFLICT) {
+                return createResponse(false, "充值失败：钱包正被频繁修改，请稍后重试");
+            }
+            if (result != CasResult::APPLIED) {
                 return createResponse(false, "充值失败：数据库更新错误");
             }
 
-            // 记录充值记录（简化版，实际应该配合支付系统）
-            std::string insertSql = "INSERT INTO recharge_record (user_id, amount, transaction_id, status, paid_at, created_at) "
-                                   "VALUES (" + std::to_string(user_id) + ", " + std::to_string(amount) + 
-                                   ", 0, 'completed', NOW(), NOW())";
-            
-            m_dbHandler->query(insertSql);
-
-            // 获取更新后的余额
+            // 获取更新后的钱包信息；充值已提交，回读失败时只返回本次计算出的余额
             Json::Value walletInfo = getWalletInfo(user_id);
+            if (!walletInfo["success"].asBool()) {
+                Json::Value balanceData;
+                balanceData["balance"] = newBalance.toYuan();
+                return createResponse(true, "充值成功", balanceData);
+            }
             
             return createResponse(true, "充值成功", walletInfo["data"]);
 
@@ -398,16 +773,13 @@ namespace TakeAwayPlatform
 
     Json::Value UserManager::getBalance(int64_t user_id) {
         try {
-            std::string sql = "SELECT balance FROM wallet WHERE user_id = " + std::to_string(user_id);
-            
-            auto result = m_dbHandler->query(sql);
-            
-            if (result.empty()) {
+            std::vector<WalletInfo> wallets;
+            if (!shardDb(user_id, false).query_as(SQL_SELECT_BALANCE, {user_id}, wallets) || wallets.empty()) {
                 return createResponse(false, "钱包不存在");
             }
 
             Json::Value balanceData;
-            balanceData["balance"] = std::stod(result[0]["balance"].asString());
+            balanceData["balance"] = wallets.front().balance.toYuan();
 
             return createResponse(true, "获取余额成功", balanceData);
 
@@ -418,10 +790,13 @@ namespace TakeAwayPlatform
 
     Json::Value UserManager::updateUserInfo(int64_t user_id, const Json::Value& updateData) {
         try {
+            // 列名固定，只有取值走参数绑定
             std::vector<std::string> updates;
+            SqlParams params;
             
             if (updateData.isMember("user_name") && !updateData["user_name"].asString().empty()) {
-                updates.push_back("user_name = '" + updateData["user_name"].asString() + "'");
+                updates.push_back("user_name = ?");
+                params.emplace_back(updateData["user_name"].asString());
             }
             
             if (updateData.isMember("email") && !updateData["email"].asString().empty()) {
@@ -429,7 +804,8 @@ namespace TakeAwayPlatform
                 if (!isValidEmail(email)) {
                     return createResponse(false, "邮箱格式不正确");
                 }
-                updates.push_back("email = '" + email + "'");
+                updates.push_back("email = ?");
+                params.emplace_back(email);
             }
             
             if (updateData.isMember("phone") && !updateData["phone"].asString().empty()) {
@@ -437,11 +813,13 @@ namespace TakeAwayPlatform
                 if (!isValidPhone(phone)) {
                     return createResponse(false, "手机号格式不正确");
                 }
-                updates.push_back("phone = '" + phone + "'");
+                updates.push_back("phone = ?");
+                params.emplace_back(phone);
             }
             
             if (updateData.isMember("avatar_url")) {
-                updates.push_back("avatar_url = '" + updateData["avatar_url"].asString() + "'");
+                updates.push_back("avatar_url = ?");
+                params.emplace_back(updateData["avatar_url"].asString());
             }
             
             if (updates.empty()) {
@@ -453,10 +831,10 @@ namespace TakeAwayPlatform
                 if (i > 0) sql += ", ";
                 sql += updates[i];
             }
-            sql += " WHERE user_id = " + std::to_string(user_id);
+            sql += " WHERE user_id = ?";
+            params.emplace_back(user_id);
             
-            auto updateResult = m_dbHandler->query(sql);
-            if (updateResult.empty()) {
+            if (m_dbHandler->execute(sql, params) < 0) {
                 return createResponse(false, "更新失败：数据库错误");
             }
             
@@ -471,8 +849,7 @@ namespace TakeAwayPlatform
                                            const std::string& newPassword) {
         try {
             // 验证旧密码
-            std::string sql = "SELECT password FROM applicant WHERE user_id = " + std::to_string(user_id);
-            auto result = m_dbHandler->query(sql);
+            auto result = m_dbHandler->query(SQL_SELECT_PASSWORD, {user_id});
             
             if (result.empty()) {
                 return createResponse(false, "用户不存在");
@@ -485,11 +862,7 @@ namespace TakeAwayPlatform
             
             // 更新密码
             std::string hashedNewPassword = hashPassword(newPassword);
-            std::string updateSql = "UPDATE applicant SET password = '" + hashedNewPassword + 
-                                   "' WHERE user_id = " + std::to_string(user_id);
-            
-            auto updateResult = m_dbHandler->query(updateSql);
-            if (updateResult.empty()) {
+            if (m_dbHandler->execute(SQL_UPDATE_PASSWORD, {hashedNewPassword, user_id}) < 0) {
                 return createResponse(false, "密码修改失败：数据库错误");
             }
             
@@ -524,85 +897,6 @@ namespace TakeAwayPlatform
         return std::regex_match(phone, phoneRegex);
     }
 
-    bool UserManager::userExists(const std::string& username) const {
-        try {
-            std::string sql = "SELECT COUNT(*) as count FROM applicant WHERE user_name = '" + username + "'";
-            auto result = m_dbHandler->query(sql);
-            
-            if (result.empty()) {
-                std::cerr << "DEBUG: userExists query returned empty result" << std::endl;
-                return false;
-            }
-            
-            std::string countStr = result[0]["count"].asString();
-            std::cerr << "DEBUG: Count result: '" << countStr << "'" << std::endl;
-            
-            if (countStr.empty()) {
-                std::cerr << "DEBUG: Count string is empty" << std::endl;
-                return false;
-            }
-            
-            int count = std::stoi(countStr);
-            return count > 0;
-            
-        } catch (const std::exception& e) {
-            std::cerr << "ERROR in userExists: " << e.what() << std::endl;
-            return false; // 出错时假设用户不存在，让注册继续
-        }
-    }
-
-    bool UserManager::emailExists(const std::string& email) const {
-        try {
-            std::string sql = "SELECT COUNT(*) as count FROM applicant WHERE email = '" + email + "'";
-            auto result = m_dbHandler->query(sql);
-            
-            if (result.empty()) {
-                std::cerr << "DEBUG: emailExists query returned empty result" << std::endl;
-                return false;
-            }
-            
-            std::string countStr = result[0]["count"].asString();
-            std::cerr << "DEBUG: Email count result: '" << countStr << "'" << std::endl;
-            
-            if (countStr.empty()) {
-                return false;
-            }
-            
-            int count = std::stoi(countStr);
-            return count > 0;
-            
-        } catch (const std::exception& e) {
-            std::cerr << "ERROR in emailExists: " << e.what() << std::endl;
-            return false;
-        }
-    }
-
-    bool UserManager::phoneExists(const std::string& phone) const {
-        try {
-            std::string sql = "SELECT COUNT(*) as count FROM applicant WHERE phone = '" + phone + "'";
-            auto result = m_dbHandler->query(sql);
-            
-            if (result.empty()) {
-                std::cerr << "DEBUG: phoneExists query returned empty result" << std::endl;
-                return false;
-            }
-            
-            std::string countStr = result[0]["count"].asString();
-            std::cerr << "DEBUG: Phone count result: '" << countStr << "'" << std::endl;
-            
-            if (countStr.empty()) {
-                return false;
-            }
-            
-            int count = std::stoi(countStr);
-            return count > 0;
-            
-        } catch (const std::exception& e) {
-            std::cerr << "ERROR in phoneExists: " << e.what() << std::endl;
-            return false;
-        }
-    }
-
     Json::Value UserManager::createResponse(bool success, const std::string& message, 
                                            const Json::Value& data) const {
         Json::Value response;
@@ -618,36 +912,40 @@ namespace TakeAwayPlatform
     }
 
     void UserManager::recordLoginAction(int64_t user_id, const std::string& action, const std::string& status) const {
-        try {
-            std::string sql = "INSERT INTO log_records (user_id, action_type, status, created_at) "
-                             "VALUES (" + std::to_string(user_id) + ", '" + action + "', '" + status + "', NOW())";
-            m_dbHandler->query(sql);
-        } catch (const std::exception& e) {
-            std::cerr << "记录登录日志失败: " << e.what() << std::endl;
+        // 配置了后写追加器时只入队，由后台线程批量写入
+        if (m_logAppender) {
+            m_logAppender->append(user_id, action, status);
+            return;
         }
-    }
 
-    bool UserManager::createWalletForUser(int64_t user_id) const {
         try {
-            std::string sql = "INSERT INTO wallet (user_id, balance, status, created_at) "
-                             "VALUES (" + std::to_string(user_id) + ", 0.00, 'active', NOW())";
-            auto result = m_dbHandler->query(sql);
-            return !result.empty();
+            m_dbHandler->execute(SQL_INSERT_LOG, {user_id, action, status});
         } catch (const std::exception& e) {
-            std::cerr << "创建钱包失败: " << e.what() << std::endl;
-            return false;
+            std::cerr << "记录登录日志失败: " << e.what() << std::endl;
         }
     }
 
     // ==================== UserSession 实现 ====================
     UserSession::UserSession() {
-        // 启动清理过期会话的定时器（简化实现）
+        // 过期会话由主线程定期调用 cleanExpiredSessions 清理（见 main.cpp wait_for_shutdown）
+    }
+
+    void UserSession::attachSharedTable(SharedSessionTable* table) {
+        std::lock_guard<std::mutex> lock(m_sessionMutex);
+        m_sharedTable = table;
     }
 
     std::string UserSession::createSession(int64_t user_id, const std::string& username) {
         std::lock_guard<std::mutex> lock(m_sessionMutex);
         
         std::string token = generateSessionToken();
+
+        if (m_sharedTable) {
+            if (!m_sharedTable->insert(token, user_id, username, std::time(nullptr), SESSION_TIMEOUT)) {
+                throw std::runtime_error("会话表已满");
+            }
+            return token;
+        }
         
         SessionInfo session;
         session.user_id = user_id;
@@ -661,6 +959,10 @@ namespace TakeAwayPlatform
     }
 
     bool UserSession::validateSession(const std::string& sessionToken, int64_t& user_id) {
+        if (m_sharedTable) {
+            return m_sharedTable->touch(sessionToken, std::time(nullptr), SESSION_TIMEOUT, user_id);
+        }
+
         std::lock_guard<std::mutex> lock(m_sessionMutex);
         
         auto it = m_sessions.find(sessionToken);
@@ -683,11 +985,21 @@ namespace TakeAwayPlatform
     }
 
     void UserSession::destroySession(const std::string& sessionToken) {
+        if (m_sharedTable) {
+            m_sharedTable->erase(sessionToken);
+            return;
+        }
+
         std::lock_guard<std::mutex> lock(m_sessionMutex);
         m_sessions.erase(sessionToken);
     }
 
     void UserSession::cleanExpiredSessions() {
+        if (m_sharedTable) {
+            m_sharedTable->purgeExpired(std::time(nullptr), SESSION_TIMEOUT);
+            return;
+        }
+
         std::lock_guard<std::mutex> lock(m_sessionMutex);
         
         std::time_t now = std::time(nullptr);
@@ -703,6 +1015,10 @@ namespace TakeAwayPlatform
     }
 
     int UserSession::getOnlineUserCount() const {
+        if (m_sharedTable) {
+            return static_cast<int>(m_sharedTable->size());
+        }
+
         std::lock_guard<std::mutex> lock(m_sessionMutex);
         return static_cast<int>(m_sessions.size());
     }
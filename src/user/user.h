@@ -16,11 +16,17 @@
 #include <memory>
 #include <unordered_map>
 #include <mutex>
+#include <functional>
 #include <ctime>
 #include <json/json.h>
 
 #include "common.h"
+#include "money.h"
 #include "db_handler.h"
+#include "db_pool.h"
+#include "shard_router.h"
+#include "log_appender.h"
+#include "shared_session_table.h"
 
 namespace TakeAwayPlatform
 {
@@ -46,45 +52,90 @@ namespace TakeAwayPlatform
         std::string phone;
         UserRole role;
         std::string avatar_url;
-        std::time_t create_at;
+        DateTime create_at;
 
         Json::Value toJson() const;
         static UserInfo fromJson(const Json::Value& json);
+
+        // 结果集中各字段的列下标
+        struct Columns {
+            int user_id, user_name, email, phone, role, avatar_url, create_at;
+            explicit Columns(const ColumnIndex& index);
+        };
+        static UserInfo fromRow(const mysqlx::Row& row, const Columns& columns);
     };
 
     // 钱包信息（对应wallet表）
     struct WalletInfo {
         int wallet_id;
         int64_t user_id;
-        double balance;
+        Money balance;
         WalletStatus status;
-        std::time_t created_at;
+        DateTime created_at;
 
         Json::Value toJson() const;
         static WalletInfo fromJson(const Json::Value& json);
+
+        struct Columns {
+            int wallet_id, user_id, balance, status, created_at;
+            explicit Columns(const ColumnIndex& index);
+        };
+        static WalletInfo fromRow(const mysqlx::Row& row, const Columns& columns);
     };
 
     // 充值记录（对应recharge_record表）
     struct RechargeRecord {
         int recharge_id;
         int64_t user_id;
-        double amount;
+        Money amount;
         int transaction_id;
         std::string status;  // pending, completed, failed
-        std::time_t paid_at;
-        std::time_t created_at;
+        DateTime paid_at;
+        DateTime created_at;
 
         Json::Value toJson() const;
         static RechargeRecord fromJson(const Json::Value& json);
+
+        struct Columns {
+            int recharge_id, user_id, amount, transaction_id, status, paid_at, created_at;
+            explicit Columns(const ColumnIndex& index);
+        };
+        static RechargeRecord fromRow(const mysqlx::Row& row, const Columns& columns);
+    };
+
+    // 订单摘要（订单历史列表项，orders 关联 merchants）
+    struct OrderSummary {
+        int order_id;
+        std::string order_number;
+        int64_t merchant_id;
+        std::string shop_name;
+        Money total_amount;
+        std::string status;  // unpaid, pending, preparing, delivering, completed, cancelled
+        DateTime created_at;
+
+        Json::Value toJson() const;
+
+        struct Columns {
+            int order_id, order_number, merchant_id, shop_name, total_amount, status, created_at;
+            explicit Columns(const ColumnIndex& index);
+        };
+        static OrderSummary fromRow(const mysqlx::Row& row, const Columns& columns);
     };
 
     // 用户管理类
     class UserManager 
     {
     public:
-        explicit UserManager(std::unique_ptr<DatabaseHandler> dbHandler);
+        // dbHandler 为全局库（applicant、log_records 等）连接；
+        // 钱包、充值记录、订单在 shardLeases 提供的分片连接上读写，为空时也使用 dbHandler；
+        // logAppender 非空时登录日志交给它后写，为空时在 dbHandler 上同步写入
+        explicit UserManager(DBLease dbHandler, ShardLeaseProvider shardLeases = nullptr,
+                             LogAppender* logAppender = nullptr);
         ~UserManager() = default;
 
+        // 本模块的查询模板及示例参数，供 --check-explain 检查执行计划
+        static std::vector<QueryTemplate> queryTemplates();
+
         // 用户注册和登录
         Json::Value registerUser(const std::string& username, const std::string& password, 
                                 const std::string& email, const std::string& phone);
@@ -99,12 +150,16 @@ namespace TakeAwayPlatform
 
         // 钱包管理
         Json::Value getWalletInfo(int64_t user_id);
-        Json::Value rechargeBalance(int64_t user_id, double amount);
+        Json::Value rechargeBalance(int64_t user_id, Money amount);
         Json::Value getBalance(int64_t user_id);
-        Json::Value getRechargeHistory(int64_t user_id, int page = 1, int pageSize = 10);
+        // 历史记录分页：cursor 为上一页返回的 next_cursor，非空时忽略 page；
+        // 返回的 next_cursor 为空表示没有更多记录
+        Json::Value getRechargeHistory(int64_t user_id, int page = 1, int pageSize = 10,
+                                       const std::string& cursor = "");
 
         // 订单相关
-        Json::Value getOrderHistory(int64_t user_id, int page = 1, int pageSize = 10);
+        Json::Value getOrderHistory(int64_t user_id, int page = 1, int pageSize = 10,
+                                    const std::string& cursor = "");
 
     private:
         // 辅助方法
@@ -112,18 +167,22 @@ namespace TakeAwayPlatform
         bool verifyPassword(const std::string& password, const std::string& hashedPassword) const;
         bool isValidEmail(const std::string& email) const;
         bool isValidPhone(const std::string& phone) const;
-        bool userExists(const std::string& username) const;
-        bool emailExists(const std::string& email) const;
-        bool phoneExists(const std::string& phone) const;
         
         Json::Value createResponse(bool success, const std::string& message, 
                                  const Json::Value& data = Json::Value::null) const;
         
         void recordLoginAction(int64_t user_id, const std::string& action, const std::string& status) const;
-        bool createWalletForUser(int64_t user_id) const;
+
+        // user_id 所在分片的连接，未启用分片时为全局库连接
+        DatabaseHandler& shardDb(int64_t user_id, bool write);
 
     private:
-        std::unique_ptr<DatabaseHandler> m_dbHandler;
+        DBLease m_dbHandler;    // 析构时连接归还连接池
+        ShardLeaseProvider m_shardLeases;
+        DBLease m_shardHandler;
+        int64_t m_shardUserId = 0;
+        bool m_shardWrite = false;
+        LogAppender* m_logAppender;     // 由 RestServer 持有
     };
 
     // 用户会话管理类
@@ -142,6 +201,9 @@ namespace TakeAwayPlatform
         // 获取当前在线用户数
         int getOnlineUserCount() const;
 
+        // prefork 模式：改用多进程共享的会话表（须在 fork worker 之前调用）
+        void attachSharedTable(SharedSessionTable* table);
+
     private:
         struct SessionInfo {
             int64_t user_id;
@@ -152,6 +214,7 @@ namespace TakeAwayPlatform
 
         std::unordered_map<std::string, SessionInfo> m_sessions;
         mutable std::mutex m_sessionMutex;  // 添加 mutable
+        SharedSessionTable* m_sharedTable = nullptr;
         static const int SESSION_TIMEOUT = 3600; // 1小时超时
 
         std::string generateSessionToken() const;
@@ -34,5 +34,20 @@ namespace TakeAwayPlatform
         
         return root;
     }
-}
 
+    DBConfig load_db_config(const Json::Value& entry, const Json::Value& defaults)
+    {
+        DBConfig config;
+        config.host = entry.get("host", defaults["host"]).asString();
+        config.port = entry.get("port", defaults["port"]).asInt();
+        config.classicPort = entry.get("classic_port", defaults.get("classic_port", 3306)).asInt();
+        config.user = entry.get("user", defaults["user"]).asString();
+        config.password = entry.get("password", defaults["password"]).asString();
+        config.database = entry.get("name", defaults["name"]).asString();
+        config.backend = entry.get("backend", defaults.get("backend", "mysql")).asString();
+        config.schemaFile = entry.get("schema_file", defaults.get("schema_file", "")).asString();
+        config.sqliteFile = entry.get("sqlite_file", defaults.get("sqlite_file", config.database + ".db")).asString();
+        config.migrationsDir = entry.get("migrations_dir", defaults.get("migrations_dir", "")).asString();
+        return config;
+    }
+}
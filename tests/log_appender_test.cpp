@@ -0,0 +1,69 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "db_handler.h"
+#include "log_appender.h"
+
+using namespace TakeAwayPlatform;
+
+namespace
+{
+    struct LogFixture {
+        DBConfig config;
+        LogAppenderOptions options;
+
+        LogFixture()
+        {
+            const std::string name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+            config.backend = "memory";
+            config.database = "log_" + name;
+            config.schemaFile = TAKEAWAY_SOURCE_DIR "/sql/create_tables.sql";
+            config.migrationsDir = TAKEAWAY_SOURCE_DIR "/sql/migrations";
+
+            options.flushIntervalMs = 20;
+            options.spillPath = ::testing::TempDir() + "takeaway_" + name + ".spill";
+            std::filesystem::remove(options.spillPath);
+        }
+
+        size_t rows()
+        {
+            DatabaseHandler db(config);
+            return db.query("SELECT log_id FROM log_records").size();
+        }
+    };
+}
+
+TEST(LogAppender, WritesQueuedRecords)
+{
+    LogFixture fixture;
+    LogAppender appender(fixture.config, fixture.options);
+    for (int index = 0; index < 250; ++index) {
+        appender.append(1000 + index, "login", "success");
+    }
+    appender.stop();
+
+    EXPECT_EQ(fixture.rows(), 250u);
+    EXPECT_EQ(appender.stats()["written"].asUInt64(), 250u);
+}
+
+// prefork 的两个 worker 共用溢出文件，只有一个回放，记录不会重复写入
+TEST(LogAppender, SharedSpillReplayedOnce)
+{
+    LogFixture fixture;
+    {
+        std::ofstream spill(fixture.options.spillPath);
+        for (int index = 0; index < 3; ++index) {
+            spill << 1767225600 + index << '\t' << 1000 << '\t' << "login" << '\t' << "success" << '\n';
+        }
+    }
+
+    LogAppender first(fixture.config, fixture.options);
+    LogAppender second(fixture.config, fixture.options);
+    first.stop();
+    second.stop();
+
+    EXPECT_EQ(fixture.rows(), 3u);
+    EXPECT_EQ(first.stats()["replayed"].asUInt64() + second.stats()["replayed"].asUInt64(), 3u);
+    EXPECT_FALSE(std::filesystem::exists(fixture.options.spillPath));
+}
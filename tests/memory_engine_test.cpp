@@ -0,0 +1,278 @@
+#include <gtest/gtest.h>
+
+#include "db_handler.h"
+#include "memory_engine.h"
+
+using namespace TakeAwayPlatform;
+
+namespace
+{
+    // 每个用例一个独立的内存库：同名库在进程内共享，库名取用例名
+    DBConfig memory_config()
+    {
+        DBConfig config;
+        config.backend = "memory";
+        config.database = std::string("test_") + ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        config.schemaFile = TAKEAWAY_SOURCE_DIR "/sql/create_tables.sql";
+        config.migrationsDir = TAKEAWAY_SOURCE_DIR "/sql/migrations";
+        return config;
+    }
+
+    // 与 src/user/user.cpp 中 UserManager 的语句保持一致
+    const char* const SQL_INSERT_USER =
+        "INSERT INTO applicant (user_name, password, email, phone, role, create_at) "
+        "VALUES (?, ?, ?, ?, 'customer', NOW())";
+
+    const char* const SQL_COUNT_CONFLICTS =
+        "SELECT COUNT(CASE WHEN user_name = ? THEN 1 END) AS name_count, "
+        "COUNT(CASE WHEN email = ? THEN 1 END) AS email_count, "
+        "COUNT(CASE WHEN phone = ? THEN 1 END) AS phone_count "
+        "FROM applicant WHERE user_name = ? OR email = ? OR phone = ?";
+
+    const char* const SQL_INSERT_WALLET =
+        "INSERT INTO wallet (user_id, balance, status, created_at) "
+        "VALUES (?, 0.00, 'active', NOW())";
+
+    const char* const SQL_SELECT_BALANCE_VERSION =
+        "SELECT balance, version FROM wallet WHERE user_id = ?";
+
+    const char* const SQL_CAS_BALANCE =
+        "UPDATE wallet SET balance = CAST(? AS DECIMAL(10,2)), version = version + 1 "
+        "WHERE user_id = ? AND version = ?";
+
+    const char* const SQL_INSERT_RECHARGE =
+        "INSERT INTO recharge_record (user_id, amount, status, paid_at, created_at) "
+        "VALUES (?, ?, 'completed', NOW(), NOW())";
+
+    const char* const SQL_SELECT_RECHARGE_PAGE =
+        "SELECT recharge_id, user_id, amount, transaction_id, status, paid_at, created_at "
+        "FROM recharge_record WHERE user_id = ? "
+        "ORDER BY created_at DESC, recharge_id DESC "
+        "LIMIT ? OFFSET ?";
+
+    const char* const SQL_SELECT_ORDER_AFTER =
+        "SELECT o.order_id, o.order_number, o.merchant_id, o.total_amount, "
+        "o.status, o.created_at, m.shop_name "
+        "FROM orders o "
+        "LEFT JOIN merchants m ON o.merchant_id = m.merchant_id "
+        "WHERE o.user_id = ? "
+        "AND (o.created_at < ? OR (o.created_at = ? AND o.order_id < ?)) "
+        "ORDER BY o.created_at DESC, o.order_id DESC "
+        "LIMIT ?";
+
+    const char* const SQL_INSERT_ORDER =
+        "INSERT INTO orders (order_number, user_id, merchant_id, total_amount, status, "
+        "delivery_address, contact_phone, items, created_at, updated_at) "
+        "VALUES (?, ?, ?, ?, 'pending', '{}', '13800000000', '[]', ?, ?)";
+
+    int64_t register_user(DatabaseHandler& db, const std::string& name)
+    {
+        if (db.execute(SQL_INSERT_USER, {name, "hash", name + "@t.cn", "139" + name}) != 1) {
+            return -1;
+        }
+        return static_cast<int64_t>(db.last_insert_id());
+    }
+}
+
+TEST(MemoryEngine, RegisterAssignsAutoIncrementIds)
+{
+    DatabaseHandler db(memory_config());
+    ASSERT_TRUE(db.is_connected());
+
+    // create_tables.sql 中 applicant 的 AUTO_INCREMENT=1000
+    EXPECT_EQ(register_user(db, "alice"), 1000);
+    EXPECT_EQ(register_user(db, "bob"), 1001);
+
+    Json::Value rows = db.query("SELECT user_name, role FROM applicant WHERE user_id = ?", {1001});
+    ASSERT_EQ(rows.size(), 1u);
+    EXPECT_EQ(rows[0]["user_name"].asString(), "bob");
+    EXPECT_EQ(rows[0]["role"].asString(), "customer");
+}
+
+TEST(MemoryEngine, UniqueConstraintRejectsDuplicates)
+{
+    DatabaseHandler db(memory_config());
+    ASSERT_GE(register_user(db, "alice"), 0);
+
+    EXPECT_LT(db.execute(SQL_INSERT_USER, {"other", "hash", "alice@t.cn", "13900000001"}), 0);
+    EXPECT_EQ(db.query("SELECT user_id FROM applicant").size(), 1u);
+}
+
+TEST(MemoryEngine, ConflictCountUsesCaseAggregates)
+{
+    DatabaseHandler db(memory_config());
+    ASSERT_GE(register_user(db, "alice"), 0);
+    ASSERT_GE(register_user(db, "bob"), 0);
+
+    Json::Value rows = db.query(SQL_COUNT_CONFLICTS,
+                                {"alice", "bob@t.cn", "nobody", "alice", "bob@t.cn", "nobody"});
+    ASSERT_EQ(rows.size(), 1u);
+    EXPECT_EQ(rows[0]["name_count"].asInt64(), 1);
+    EXPECT_EQ(rows[0]["email_count"].asInt64(), 1);
+    EXPECT_EQ(rows[0]["phone_count"].asInt64(), 0);
+
+    rows = db.query(SQL_COUNT_CONFLICTS, {"x", "y", "z", "x", "y", "z"});
+    ASSERT_EQ(rows.size(), 1u);
+    EXPECT_EQ(rows[0]["name_count"].asInt64(), 0);
+}
+
+TEST(MemoryEngine, CompareAndSwapBalance)
+{
+    DatabaseHandler db(memory_config());
+    const int64_t userId = register_user(db, "alice");
+    ASSERT_EQ(db.execute(SQL_INSERT_WALLET, {userId}), 1);
+
+    Json::Value wallet = db.query(SQL_SELECT_BALANCE_VERSION, {userId});
+    ASSERT_EQ(wallet.size(), 1u);
+    const int64_t version = wallet[0]["version"].asInt64();
+
+    EXPECT_EQ(db.execute(SQL_CAS_BALANCE, {"12.50", userId, version}), 1);
+    // 版本号已变化，旧版本的条件更新不生效
+    EXPECT_EQ(db.execute(SQL_CAS_BALANCE, {"99.00", userId, version}), 0);
+
+    wallet = db.query(SQL_SELECT_BALANCE_VERSION, {userId});
+    Money balance;
+    ASSERT_TRUE(Money::parse(wallet[0]["balance"].asString(), balance));
+    EXPECT_EQ(balance.cents(), 1250);
+    EXPECT_EQ(wallet[0]["version"].asInt64(), version + 1);
+}
+
+TEST(MemoryEngine, RechargeAfterMigrations)
+{
+    DatabaseHandler db(memory_config());
+    const int64_t userId = register_user(db, "alice");
+
+    // 迁移 0003 之后 recharge_id 自增、transaction_id 可空
+    ASSERT_EQ(db.execute(SQL_INSERT_RECHARGE, {userId, "10.00"}), 1);
+    const uint64_t first = db.last_insert_id();
+    ASSERT_EQ(db.execute(SQL_INSERT_RECHARGE, {userId, "20.00"}), 1);
+    EXPECT_EQ(db.last_insert_id(), first + 1);
+
+    Json::Value rows = db.query(SQL_SELECT_RECHARGE_PAGE, {userId, 10, 0});
+    ASSERT_EQ(rows.size(), 2u);
+    // created_at 相同，按 recharge_id 倒序
+    EXPECT_EQ(rows[0]["recharge_id"].asUInt64(), first + 1);
+    EXPECT_EQ(rows[0]["status"].asString(), "completed");
+    EXPECT_EQ(db.query("SELECT recharge_id FROM recharge_record WHERE transaction_id IS NULL").size(), 2u);
+
+    rows = db.query(SQL_SELECT_RECHARGE_PAGE, {userId, 10, 1});
+    ASSERT_EQ(rows.size(), 1u);
+    EXPECT_EQ(rows[0]["recharge_id"].asUInt64(), first);
+}
+
+TEST(MemoryEngine, OrderCursorPageWithLeftJoin)
+{
+    DatabaseHandler db(memory_config());
+    const int64_t userId = register_user(db, "alice");
+    ASSERT_EQ(db.execute("INSERT INTO merchants (merchant_id, user_id, shop_name, contact_phone, shop_address, "
+                         "delivery_fee, min_order_amount) VALUES (1, ?, 'Noodle', '1', 'addr', 0, 0)", {userId}), 1);
+
+    // merchant 2 不存在，LEFT JOIN 补 NULL
+    const char* times[] = {"2026-01-01 10:00:00", "2026-01-01 11:00:00", "2026-01-01 11:00:00"};
+    const int64_t merchants[] = {1, 2, 1};
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(db.execute(SQL_INSERT_ORDER, {"N" + std::to_string(i), userId, merchants[i], "8.00",
+                                                times[i], times[i]}), 1);
+    }
+
+    Json::Value first = db.query("SELECT order_id FROM orders ORDER BY order_id");
+    ASSERT_EQ(first.size(), 3u);
+    const int64_t lastId = first[2]["order_id"].asInt64();
+
+    // 游标位于最新一行 (11:00, lastId) 之后
+    Json::Value rows = db.query(SQL_SELECT_ORDER_AFTER,
+                                {userId, times[2], times[2], lastId, 10});
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_EQ(rows[0]["order_number"].asString(), "N1");
+    EXPECT_EQ(rows[1]["order_number"].asString(), "N0");
+    EXPECT_EQ(rows[1]["shop_name"].asString(), "Noodle");
+
+    rows = db.query("SELECT o.order_number FROM orders o LEFT JOIN merchants m ON o.merchant_id = m.merchant_id "
+                    "WHERE m.shop_name IS NULL");
+    ASSERT_EQ(rows.size(), 1u);
+    EXPECT_EQ(rows[0]["order_number"].asString(), "N1");
+}
+
+TEST(MemoryEngine, ModifyColumnConvertsAndChecks)
+{
+    DatabaseHandler db(memory_config());
+    ASSERT_GE(db.execute("CREATE TABLE t (id INT NOT NULL PRIMARY KEY, note VARCHAR(10))", {}), 0);
+    ASSERT_EQ(db.execute("INSERT INTO t (id, note) VALUES (5, '7'), (6, NULL)", {}), 2);
+
+    // 已有 NULL 的列不能改为 NOT NULL，失败后表不变
+    EXPECT_LT(db.execute("ALTER TABLE t MODIFY note INT NOT NULL", {}), 0);
+    EXPECT_EQ(db.query("SELECT id FROM t").size(), 2u);
+
+    ASSERT_GE(db.execute("ALTER TABLE t MODIFY note INT NULL", {}), 0);
+    EXPECT_EQ(db.query("SELECT note FROM t WHERE id = 5")[0]["note"].asInt64(), 7);
+
+    // 改为自增后从现有最大值之后分配
+    ASSERT_GE(db.execute("ALTER TABLE t MODIFY id INT NOT NULL AUTO_INCREMENT", {}), 0);
+    ASSERT_EQ(db.execute("INSERT INTO t (note) VALUES (1)", {}), 1);
+    EXPECT_EQ(db.last_insert_id(), 7u);
+}
+
+TEST(MemoryEngine, FailedStatementLeavesNoPartialRows)
+{
+    DatabaseHandler db(memory_config());
+    ASSERT_GE(register_user(db, "alice"), 0);
+
+    // 第二行与已有邮箱冲突，整条语句不生效
+    EXPECT_LT(db.execute("INSERT INTO applicant (user_name, password, email, phone) "
+                         "VALUES ('b', 'p', 'b@t.cn', '1'), ('c', 'p', 'alice@t.cn', '2')", {}), 0);
+    EXPECT_EQ(db.query("SELECT user_id FROM applicant").size(), 1u);
+}
+
+// 以下用例记录 memory_engine.h 中说明的隔离性限制，行为变化时应同步修改文档
+TEST(MemoryEngine, RollbackRestoresPreImages)
+{
+    DatabaseHandler db(memory_config());
+    const int64_t userId = register_user(db, "alice");
+
+    ASSERT_TRUE(db.begin());
+    ASSERT_EQ(db.execute("UPDATE applicant SET user_name = 'changed' WHERE user_id = ?", {userId}), 1);
+    ASSERT_GE(register_user(db, "bob"), 0);
+    ASSERT_TRUE(db.rollback());
+
+    Json::Value rows = db.query("SELECT user_name FROM applicant");
+    ASSERT_EQ(rows.size(), 1u);
+    EXPECT_EQ(rows[0]["user_name"].asString(), "alice");
+}
+
+TEST(MemoryEngine, UncommittedWritesAreVisibleToOtherSessions)
+{
+    const DBConfig config = memory_config();
+    DatabaseHandler writer(config);
+    DatabaseHandler reader(config);
+    const int64_t userId = register_user(writer, "alice");
+
+    ASSERT_TRUE(writer.begin());
+    ASSERT_EQ(writer.execute("UPDATE applicant SET user_name = 'dirty' WHERE user_id = ?", {userId}), 1);
+
+    // 脏读：另一会话立即读到未提交的修改
+    EXPECT_EQ(reader.query("SELECT user_name FROM applicant WHERE user_id = ?", {userId})[0]["user_name"].asString(),
+              "dirty");
+
+    ASSERT_TRUE(writer.rollback());
+    EXPECT_EQ(reader.query("SELECT user_name FROM applicant WHERE user_id = ?", {userId})[0]["user_name"].asString(),
+              "alice");
+}
+
+TEST(MemoryEngine, RollbackOverwritesOtherSessionsChanges)
+{
+    const DBConfig config = memory_config();
+    DatabaseHandler first(config);
+    DatabaseHandler second(config);
+    const int64_t userId = register_user(first, "alice");
+
+    ASSERT_TRUE(first.begin());
+    ASSERT_EQ(first.execute("UPDATE applicant SET phone = '1' WHERE user_id = ?", {userId}), 1);
+
+    // 没有行锁，第二个会话可以修改同一行
+    ASSERT_EQ(second.execute("UPDATE applicant SET user_name = 'bob' WHERE user_id = ?", {userId}), 1);
+
+    // 回滚恢复整行镜像，第二个会话已提交的修改丢失
+    ASSERT_TRUE(first.rollback());
+    EXPECT_EQ(second.query("SELECT user_name FROM applicant WHERE user_id = ?", {userId})[0]["user_name"].asString(),
+              "alice");
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include "memory_sql.h"
+
+using namespace TakeAwayPlatform;
+
+// 语句形状与 UserManager（src/user/user.cpp）发出的语句一致
+TEST(MemorySqlParser, SelectWithPlaceholders)
+{
+    auto st = parse_statement(
+        "SELECT user_id, user_name, password, email, phone, role, avatar_url "
+        "FROM applicant WHERE user_name = ?");
+
+    ASSERT_EQ(st->kind, Statement::SELECT);
+    EXPECT_EQ(st->paramCount, 1u);
+    ASSERT_EQ(st->from.size(), 1u);
+    EXPECT_EQ(st->from[0].table, "applicant");
+    EXPECT_EQ(st->items.size(), 7u);
+    ASSERT_TRUE(st->where);
+    EXPECT_EQ(st->where->kind, Expr::BINARY);
+}
+
+TEST(MemorySqlParser, LeftJoinPageQuery)
+{
+    auto st = parse_statement(
+        "SELECT o.order_id, o.order_number, o.merchant_id, o.total_amount, "
+        "o.status, o.created_at, m.shop_name "
+        "FROM orders o "
+        "LEFT JOIN merchants m ON o.merchant_id = m.merchant_id "
+        "WHERE o.user_id = ? "
+        "AND (o.created_at < ? OR (o.created_at = ? AND o.order_id < ?)) "
+        "ORDER BY o.created_at DESC, o.order_id DESC "
+        "LIMIT ?");
+
+    ASSERT_EQ(st->kind, Statement::SELECT);
+    EXPECT_EQ(st->paramCount, 5u);
+    ASSERT_EQ(st->from.size(), 2u);
+    EXPECT_EQ(st->from[0].alias, "o");
+    EXPECT_EQ(st->from[1].table, "merchants");
+    EXPECT_TRUE(st->from[1].left);
+    ASSERT_TRUE(st->from[1].on);
+    ASSERT_EQ(st->orderBy.size(), 2u);
+    EXPECT_TRUE(st->orderBy[0].desc);
+    EXPECT_TRUE(st->orderBy[1].desc);
+    ASSERT_TRUE(st->limit);
+    EXPECT_EQ(st->limit->kind, Expr::PARAM);
+    EXPECT_FALSE(st->offset);
+}
+
+TEST(MemorySqlParser, CountCaseAggregates)
+{
+    auto st = parse_statement(
+        "SELECT COUNT(CASE WHEN user_name = ? THEN 1 END) AS name_count, "
+        "COUNT(CASE WHEN email = ? THEN 1 END) AS email_count, "
+        "COUNT(CASE WHEN phone = ? THEN 1 END) AS phone_count "
+        "FROM applicant WHERE user_name = ? OR email = ? OR phone = ?");
+
+    EXPECT_EQ(st->paramCount, 6u);
+    ASSERT_EQ(st->items.size(), 3u);
+    EXPECT_EQ(st->items[0].alias, "name_count");
+    ASSERT_EQ(st->items[0].expr->kind, Expr::FUNCTION);
+    EXPECT_EQ(st->items[0].expr->op, "COUNT");
+    ASSERT_EQ(st->items[0].expr->args.size(), 1u);
+    EXPECT_EQ(st->items[0].expr->args[0]->kind, Expr::CASE);
+}
+
+TEST(MemorySqlParser, CompareAndSwapUpdate)
+{
+    auto st = parse_statement(
+        "UPDATE wallet SET balance = CAST(? AS DECIMAL(10,2)), version = version + 1 "
+        "WHERE user_id = ? AND version = ?");
+
+    ASSERT_EQ(st->kind, Statement::UPDATE);
+    EXPECT_EQ(st->paramCount, 3u);
+    ASSERT_EQ(st->assignments.size(), 2u);
+    EXPECT_EQ(st->assignments[0].column, "balance");
+    ASSERT_EQ(st->assignments[0].value->kind, Expr::CAST);
+    EXPECT_EQ(st->assignments[0].value->castType, Cell::DECIMAL);
+    EXPECT_EQ(st->assignments[1].column, "version");
+    EXPECT_EQ(st->assignments[1].value->kind, Expr::BINARY);
+}
+
+TEST(MemorySqlParser, InsertWithFunctionsAndLiterals)
+{
+    auto st = parse_statement(
+        "INSERT INTO recharge_record (user_id, amount, status, paid_at, created_at) "
+        "VALUES (?, ?, 'completed', NOW(), NOW())");
+
+    ASSERT_EQ(st->kind, Statement::INSERT);
+    EXPECT_EQ(st->table, "recharge_record");
+    EXPECT_EQ(st->paramCount, 2u);
+    ASSERT_EQ(st->columns.size(), 5u);
+    ASSERT_EQ(st->values.size(), 1u);
+    ASSERT_EQ(st->values[0].size(), 5u);
+    EXPECT_EQ(st->values[0][2]->kind, Expr::LITERAL);
+    EXPECT_EQ(st->values[0][2]->value.text, "completed");
+    EXPECT_EQ(st->values[0][3]->kind, Expr::FUNCTION);
+}
+
+TEST(MemorySqlParser, LockingReadIsAccepted)
+{
+    auto st = parse_statement("SELECT balance FROM wallet WHERE user_id = ? FOR UPDATE");
+    EXPECT_EQ(st->kind, Statement::SELECT);
+    EXPECT_EQ(st->paramCount, 1u);
+}
+
+TEST(MemorySqlParser, SessionVariableSet)
+{
+    auto st = parse_statement("SET FOREIGN_KEY_CHECKS = 0");
+
+    ASSERT_EQ(st->kind, Statement::SET);
+    ASSERT_EQ(st->assignments.size(), 1u);
+    EXPECT_EQ(st->assignments[0].value->kind, Expr::LITERAL);
+    EXPECT_EQ(st->assignments[0].value->value.number, 0);
+}
+
+TEST(MemorySqlParser, AlterModifyColumn)
+{
+    auto st = parse_statement(
+        "ALTER TABLE recharge_record "
+        "MODIFY COLUMN recharge_id BIGINT NOT NULL AUTO_INCREMENT, "
+        "MODIFY transaction_id VARCHAR(64) NULL AFTER amount");
+
+    ASSERT_EQ(st->kind, Statement::ALTER_TABLE);
+    EXPECT_EQ(st->table, "recharge_record");
+    ASSERT_EQ(st->actions.size(), 2u);
+
+    EXPECT_EQ(st->actions[0].kind, AlterAction::MODIFY_COLUMN);
+    EXPECT_EQ(st->actions[0].column.name, "recharge_id");
+    EXPECT_EQ(st->actions[0].column.type, Cell::INT);
+    EXPECT_TRUE(st->actions[0].column.notNull);
+    EXPECT_TRUE(st->actions[0].column.autoIncrement);
+
+    EXPECT_EQ(st->actions[1].kind, AlterAction::MODIFY_COLUMN);
+    EXPECT_EQ(st->actions[1].column.name, "transaction_id");
+    EXPECT_EQ(st->actions[1].column.type, Cell::TEXT);
+    EXPECT_FALSE(st->actions[1].column.notNull);
+}
+
+TEST(MemorySqlParser, ScriptSkipsComments)
+{
+    auto statements = parse_script(
+        "-- 迁移说明\n"
+        "SET FOREIGN_KEY_CHECKS = 0;\n"
+        "/* 块注释 */ CREATE INDEX idx_user ON orders (user_id, created_at);\n"
+        "SET FOREIGN_KEY_CHECKS = 1;");
+
+    ASSERT_EQ(statements.size(), 3u);
+    EXPECT_EQ(statements[0]->kind, Statement::SET);
+    EXPECT_EQ(statements[1]->kind, Statement::CREATE_INDEX);
+    EXPECT_EQ(statements[2]->kind, Statement::SET);
+}
+
+TEST(MemorySqlParser, RejectsUnsupportedSyntax)
+{
+    EXPECT_THROW(parse_statement("SELECT user_id FROM applicant GROUP BY role"), SqlError);
+    EXPECT_THROW(parse_statement("SELECT * FROM (SELECT 1) t"), SqlError);
+    EXPECT_THROW(parse_statement("UPDATE wallet SET balance = WHERE user_id = ?"), SqlError);
+}
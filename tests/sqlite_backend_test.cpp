@@ -0,0 +1,158 @@
+#include <filesystem>
+#include <gtest/gtest.h>
+
+#include "db_handler.h"
+#include "sqlite_backend.h"
+
+using namespace TakeAwayPlatform;
+
+namespace
+{
+    // 每个用例一个新的数据库文件
+    std::string fresh_file()
+    {
+        const std::string file = ::testing::TempDir() + "takeaway_" +
+                                 ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".db";
+        for (const char* suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(file + suffix);
+        }
+        return file;
+    }
+
+    DBConfig sqlite_config(const std::string& file)
+    {
+        DBConfig config;
+        config.backend = "sqlite";
+        config.database = "takeaway";
+        config.sqliteFile = file;
+        config.schemaFile = TAKEAWAY_SOURCE_DIR "/sql/create_tables.sql";
+        config.migrationsDir = TAKEAWAY_SOURCE_DIR "/sql/migrations";
+        return config;
+    }
+
+    // 单列结果：NULL 返回 -1
+    int64_t scalar(SqliteBackend& backend, const std::string& sql, const SqlParams& params)
+    {
+        StorageResult result;
+        std::string error;
+        if (!backend.execute(sql, params, result, error)) {
+            ADD_FAILURE() << sql << ": " << error;
+            return -2;
+        }
+        const mysqlx::Value& value = result.rows.at(0)[0];
+        return value.getType() == mysqlx::Value::VNULL ? -1 : value.get<int64_t>();
+    }
+}
+
+TEST(SqliteBackend, SchemaAndMigrationsTranslate)
+{
+    DatabaseHandler db(sqlite_config(fresh_file()));
+    ASSERT_TRUE(db.is_connected());
+
+    // 迁移 0001 的索引和 0002 的版本列
+    EXPECT_EQ(db.column_exists("wallet", "version"), 1);
+    EXPECT_EQ(db.column_exists("wallet", "missing"), 0);
+    EXPECT_EQ(db.index_exists("orders", "missing"), 0);
+
+    // MySQL 方言的建表语句（ENUM、JSON、ON UPDATE）转换后仍保留默认值
+    ASSERT_EQ(db.execute("INSERT INTO applicant (user_name, password, email, phone) VALUES ('a', 'p', 'a@t', '1')", {}), 1);
+    Json::Value rows = db.query("SELECT role FROM applicant");
+    ASSERT_EQ(rows.size(), 1u);
+    EXPECT_EQ(rows[0]["role"].asString(), "customer");
+}
+
+TEST(SqliteBackend, LastInsertIdFollowsAutoIncrement)
+{
+    DatabaseHandler db(sqlite_config(fresh_file()));
+
+    // create_tables.sql 中 applicant 的 AUTO_INCREMENT=1000
+    ASSERT_EQ(db.execute("INSERT INTO applicant (user_name, password, email, phone) VALUES ('a', 'p', 'a@t', '1')", {}), 1);
+    EXPECT_EQ(db.last_insert_id(), 1000u);
+    ASSERT_EQ(db.execute("INSERT INTO applicant (user_name, password, email, phone) VALUES ('b', 'p', 'b@t', '2')", {}), 1);
+    EXPECT_EQ(db.last_insert_id(), 1001u);
+
+    // 迁移 0003 之后 recharge_id 自增，transaction_id 可空
+    ASSERT_EQ(db.execute("INSERT INTO recharge_record (user_id, amount, status, paid_at, created_at) "
+                         "VALUES (1000, ?, 'completed', NOW(), NOW())", {"5.00"}), 1);
+    const uint64_t first = db.last_insert_id();
+    EXPECT_GT(first, 0u);
+    ASSERT_EQ(db.execute("INSERT INTO recharge_record (user_id, amount, status, paid_at, created_at) "
+                         "VALUES (1000, ?, 'completed', NOW(), NOW())", {"6.00"}), 1);
+    EXPECT_EQ(db.last_insert_id(), first + 1);
+}
+
+TEST(SqliteBackend, DecimalRoundTrips)
+{
+    DatabaseHandler db(sqlite_config(fresh_file()));
+    ASSERT_EQ(db.execute("INSERT INTO applicant (user_name, password, email, phone) VALUES ('a', 'p', 'a@t', '1')", {}), 1);
+    ASSERT_EQ(db.execute("INSERT INTO wallet (user_id, balance, status, created_at) "
+                         "VALUES (1000, 0.00, 'active', NOW())", {}), 1);
+
+    Json::Value rows = db.query("SELECT balance, version FROM wallet WHERE user_id = ?", {1000});
+    ASSERT_EQ(rows.size(), 1u);
+    EXPECT_EQ(rows[0]["balance"].asString(), "0.00");
+
+    // UserManager 的 CAS 写回：文本参数按 DECIMAL(10,2) 保存，读回仍是两位小数
+    for (const char* amount : {"0.10", "12.30", "99999999.99"}) {
+        const int64_t version = rows[0]["version"].asInt64();
+        ASSERT_EQ(db.execute("UPDATE wallet SET balance = CAST(? AS DECIMAL(10,2)), version = version + 1 "
+                             "WHERE user_id = ? AND version = ?", {amount, 1000, version}), 1);
+        rows = db.query("SELECT balance, version FROM wallet WHERE user_id = ?", {1000});
+        EXPECT_EQ(rows[0]["balance"].asString(), amount);
+    }
+}
+
+TEST(SqliteBackend, ModifyColumnRebuildsTable)
+{
+    DatabaseHandler db(sqlite_config(fresh_file()));
+    ASSERT_GE(db.execute("CREATE TABLE t (id INT NOT NULL PRIMARY KEY, code VARCHAR(10) NOT NULL, "
+                         "amount DECIMAL(10,2) DEFAULT 1.50)", {}), 0);
+    ASSERT_GE(db.execute("CREATE UNIQUE INDEX idx_code ON t (code)", {}), 0);
+    ASSERT_EQ(db.execute("INSERT INTO t (id, code) VALUES (3, 'x'), (4, 'y')", {}), 2);
+
+    ASSERT_GE(db.execute("ALTER TABLE t MODIFY COLUMN id INT NOT NULL AUTO_INCREMENT", {}), 0);
+
+    // 行、默认值和索引在重建后保留，自增从现有最大值之后分配
+    EXPECT_EQ(db.query("SELECT id FROM t").size(), 2u);
+    EXPECT_EQ(db.index_exists("t", "idx_code"), 1);
+    ASSERT_EQ(db.execute("INSERT INTO t (code) VALUES ('z')", {}), 1);
+    EXPECT_EQ(db.last_insert_id(), 5u);
+    EXPECT_EQ(db.query("SELECT amount FROM t WHERE id = 5")[0]["amount"].asString(), "1.50");
+    EXPECT_LT(db.execute("INSERT INTO t (code) VALUES ('x')", {}), 0);
+}
+
+TEST(SqliteBackend, NamedLocksExcludeOtherConnections)
+{
+    const std::string file = fresh_file();
+    SqliteBackend first(file, "");
+    SqliteBackend second(file, "");
+
+    EXPECT_EQ(scalar(first, "SELECT GET_LOCK(?, ?)", {"schema_migration", 1}), 1);
+    // 同一连接可重复获取
+    EXPECT_EQ(scalar(first, "SELECT GET_LOCK(?, ?)", {"schema_migration", 1}), 1);
+
+    EXPECT_EQ(scalar(second, "SELECT GET_LOCK(?, ?)", {"schema_migration", 0}), 0);
+    EXPECT_EQ(scalar(second, "SELECT RELEASE_LOCK(?)", {"schema_migration"}), 0);
+    // 其他锁名互不影响
+    EXPECT_EQ(scalar(second, "SELECT GET_LOCK(?, ?)", {"other", 0}), 1);
+
+    // 释放与获取次数相同后才真正释放
+    EXPECT_EQ(scalar(first, "SELECT RELEASE_LOCK(?)", {"schema_migration"}), 1);
+    EXPECT_EQ(scalar(second, "SELECT GET_LOCK(?, ?)", {"schema_migration", 0}), 0);
+    EXPECT_EQ(scalar(first, "SELECT RELEASE_LOCK(?)", {"schema_migration"}), 1);
+    EXPECT_EQ(scalar(first, "SELECT RELEASE_LOCK(?)", {"schema_migration"}), -1);
+
+    EXPECT_EQ(scalar(second, "SELECT GET_LOCK(?, ?)", {"schema_migration", 1}), 1);
+}
+
+TEST(SqliteBackend, NamedLockReleasedWhenConnectionCloses)
+{
+    const std::string file = fresh_file();
+    SqliteBackend waiter(file, "");
+    {
+        SqliteBackend holder(file, "");
+        EXPECT_EQ(scalar(holder, "SELECT GET_LOCK(?, ?)", {"schema_migration", 0}), 1);
+        EXPECT_EQ(scalar(waiter, "SELECT GET_LOCK(?, ?)", {"schema_migration", 0}), 0);
+    }
+    EXPECT_EQ(scalar(waiter, "SELECT GET_LOCK(?, ?)", {"schema_migration", 0}), 1);
+}
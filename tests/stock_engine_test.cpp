@@ -0,0 +1,117 @@
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <gtest/gtest.h>
+
+#include "db_handler.h"
+#include "stock_engine.h"
+
+using namespace TakeAwayPlatform;
+
+namespace
+{
+    const int64_t HOT_DISH = 7;
+    const int64_t STOCK = 1000;
+
+    // 每个用例一个独立的内存库和溢出文件，菜品 HOT_DISH 的库存为 STOCK
+    struct StockFixture {
+        DBConfig config;
+        StockEngineOptions options;
+
+        StockFixture()
+        {
+            const std::string name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+            config.backend = "memory";
+            config.database = "stock_" + name;
+            config.schemaFile = TAKEAWAY_SOURCE_DIR "/sql/create_tables.sql";
+            config.migrationsDir = TAKEAWAY_SOURCE_DIR "/sql/migrations";
+
+            options.hotDishes = {HOT_DISH};
+            options.flushIntervalMs = 20;
+            options.spillPath = ::testing::TempDir() + "takeaway_" + name + ".spill";
+            std::filesystem::remove(options.spillPath);
+
+            DatabaseHandler db(config);
+            db.execute("INSERT INTO dishes (dish_id, merchant_id, name, price, stock, category, status, "
+                       "sales_count, created_at, updated_at) "
+                       "VALUES (?, 1, 'noodle', 8.00, ?, 'main', 'available', 0, NOW(), NOW())",
+                       {HOT_DISH, STOCK});
+        }
+
+        int64_t stock_in_db()
+        {
+            DatabaseHandler db(config);
+            return db.query("SELECT stock FROM dishes WHERE dish_id = ?", {HOT_DISH})[0]["stock"].asInt64();
+        }
+    };
+
+    // 各线程在各自的引擎上逐份预留直到售罄，返回合计预留的份数
+    int64_t reserve_until_sold_out(std::vector<StockEngine*> engines)
+    {
+        std::atomic<int64_t> total {0};
+        std::vector<std::thread> threads;
+        for (StockEngine* engine : engines) {
+            threads.emplace_back([engine, &total] {
+                while (engine->reserve(HOT_DISH, 1) == StockReservation::RESERVED) {
+                    ++total;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        return total;
+    }
+}
+
+TEST(StockEngine, ReservesWithinStock)
+{
+    StockFixture fixture;
+    StockEngine engine(fixture.config, fixture.options);
+
+    EXPECT_EQ(engine.reserve(HOT_DISH, 400), StockReservation::RESERVED);
+    EXPECT_EQ(engine.reserve(HOT_DISH, 601), StockReservation::SOLD_OUT);
+    engine.release(HOT_DISH, 100);
+    EXPECT_EQ(engine.reserve(HOT_DISH, 700), StockReservation::RESERVED);
+    EXPECT_EQ(engine.reserve(HOT_DISH + 1, 1), StockReservation::NOT_HOT);
+
+    engine.stop();
+    EXPECT_EQ(fixture.stock_in_db(), 0);
+}
+
+// prefork 的两个 worker：在同一张共享表上预留，合计不超过库存
+TEST(StockEngine, SharedTableBoundsReservationsAcrossEngines)
+{
+    StockFixture fixture;
+    SharedStockTable* table = SharedStockTable::create(8);
+    ASSERT_NE(table, nullptr);
+    fixture.options.sharedTable = table;
+
+    StockEngine first(fixture.config, fixture.options);
+    StockEngine second(fixture.config, fixture.options);
+
+    EXPECT_EQ(reserve_until_sold_out({&first, &second}), STOCK);
+    EXPECT_EQ(second.reserve(HOT_DISH, 1), StockReservation::SOLD_OUT);
+
+    first.stop();
+    second.stop();
+    EXPECT_EQ(fixture.stock_in_db(), 0);
+}
+
+TEST(StockEngine, SpillReplayedOnce)
+{
+    StockFixture fixture;
+    {
+        std::ofstream spill(fixture.options.spillPath);
+        spill << HOT_DISH << '\t' << 3 << '\n' << HOT_DISH << '\t' << 2 << '\n';
+    }
+
+    // 两个引擎依次启动，只有先启动的一个回放溢出文件
+    StockEngine first(fixture.config, fixture.options);
+    StockEngine second(fixture.config, fixture.options);
+    first.stop();
+    second.stop();
+
+    EXPECT_EQ(fixture.stock_in_db(), STOCK - 5);
+    EXPECT_FALSE(std::filesystem::exists(fixture.options.spillPath));
+}